@@ -0,0 +1,18 @@
+# - Find Gpiod
+# Find the native libgpiod includes and library.
+# Once done this will define
+#
+#  GPIOD_INCLUDE_DIR    - where to find gpiod.h, etc.
+#  GPIOD_LIBRARY        - List of libraries when using libgpiod.
+#  GPIOD_FOUND          - True if libgpiod found.
+#
+
+FIND_LIBRARY(GPIOD_LIBRARY NAMES gpiod libgpiod HINTS ${GPIOD_ROOT_DIR}/lib)
+find_path(GPIOD_INCLUDE_DIR NAMES gpiod.h HINTS ${GPIOD_ROOT_DIR}/include)
+
+# handle the QUIETLY and REQUIRED arguments and set GPIOD_FOUND to TRUE if
+# all listed variables are TRUE
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Gpiod REQUIRED_VARS GPIOD_LIBRARY GPIOD_INCLUDE_DIR)
+
+MARK_AS_ADVANCED(GPIOD_LIBRARY GPIOD_INCLUDE_DIR)
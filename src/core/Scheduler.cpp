@@ -19,9 +19,14 @@
 
 #include "Scheduler.hpp"
 #include "core/tasks/Task.hpp"
+#include "exception/leosacexception.hpp"
+#include "tools/log.hpp"
+#include "tools/unixsyscall.hpp"
+#include <algorithm>
 #include <assert.h>
-#include <future>
 #include <functional>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 using namespace Leosac;
 using namespace Leosac::Tasks;
@@ -30,17 +35,34 @@ void Scheduler::enqueue(TaskPtr t, TargetThread policy)
 {
     if (policy == TargetThread::POOL)
     {
-        std::thread(std::bind(&Task::run, t)).detach();
+        if (!pool_.enqueue(t))
+        {
+            WARN("Thread pool is stopped. Running task ~" << t->get_guid()
+                                                          << "~ synchronously.");
+            t->run();
+        }
     }
     else
     {
-        std::lock_guard<std::mutex> lg(mutex_);
-        queues_[policy].push(t);
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            queues_[policy].push(t);
+        }
+        wakeup(policy);
     }
 }
 
 void Scheduler::update(TargetThread me) noexcept
 {
+    // Reset the wakeup fd before looking at the queue: a task enqueued
+    // past this point signals it again.
+    if (me == TargetThread::MAIN)
+    {
+        uint64_t count;
+        if (::read(main_wakeup_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            WARN(Tools::UnixSyscall::getErrorString("read", errno));
+    }
+
     mutex_.lock();
     auto &queue = queues_[me];
     int run     = queue.size();
@@ -57,6 +79,23 @@ void Scheduler::update(TargetThread me) noexcept
     }
 }
 
+int Scheduler::wakeup_fd(TargetThread me) const
+{
+    ASSERT_LOG(me == TargetThread::MAIN, "Only MAIN has a wakeup fd.");
+    return main_wakeup_fd_;
+}
+
+void Scheduler::wakeup(TargetThread me) noexcept
+{
+    if (me != TargetThread::MAIN)
+        return;
+    // Can only fail if the counter would overflow, in which case
+    // the fd is readable anyway.
+    uint64_t one = 1;
+    ssize_t ret  = ::write(main_wakeup_fd_, &one, sizeof(one));
+    (void)ret;
+}
+
 void Scheduler::register_thread(TargetThread me)
 {
     std::lock_guard<std::mutex> lg(mutex_);
@@ -64,9 +103,103 @@ void Scheduler::register_thread(TargetThread me)
     queues_[me];
 }
 
-Scheduler::Scheduler(Kernel *kptr)
-    : kptr_(kptr)
+/**
+ * Number of pool threads when none is configured.
+ */
+static size_t default_pool_size()
+{
+    return std::max(2u, std::thread::hardware_concurrency());
+}
+
+Scheduler::Scheduler(Kernel *kptr, size_t pool_size)
+    : pool_(pool_size ? pool_size : default_pool_size())
+    , kptr_(kptr)
+    , main_wakeup_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , timers_stop_(false)
+{
+    if (main_wakeup_fd_ < 0)
+        throw LEOSACException(Tools::UnixSyscall::getErrorString("eventfd", errno));
+    timers_thread_ = std::thread(&Scheduler::run_timers, this);
+}
+
+Scheduler::~Scheduler()
+{
+    shutdown();
+    ::close(main_wakeup_fd_);
+}
+
+void Scheduler::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lg(timers_mutex_);
+        timers_stop_ = true;
+    }
+    timers_cv_.notify_all();
+    if (timers_thread_.joinable())
+    {
+        timers_thread_.join();
+        if (!timers_.empty())
+            INFO("Dropping " << timers_.size() << " scheduled tasks.");
+    }
+    pool_.shutdown();
+}
+
+TimerHandle Scheduler::enqueue_at(TimePoint when, TaskPtr t, TargetThread policy)
+{
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lg(timers_mutex_);
+        id = timers_.add(when, DelayedTask{t, policy});
+    }
+    // The timer thread may need to wake up earlier than planned.
+    timers_cv_.notify_one();
+    return TimerHandle(id);
+}
+
+TimerHandle Scheduler::enqueue_after(Clock::duration delay, TaskPtr t,
+                                     TargetThread policy)
+{
+    return enqueue_at(Clock::now() + delay, t, policy);
+}
+
+bool Scheduler::cancel(const TimerHandle &handle)
+{
+    if (!handle.valid())
+        return false;
+    std::lock_guard<std::mutex> lg(timers_mutex_);
+    return timers_.cancel(handle.id_);
+}
+
+void Scheduler::run_timers()
+{
+    std::vector<DelayedTask> due;
+    std::unique_lock<std::mutex> ul(timers_mutex_);
+
+    while (!timers_stop_)
+    {
+        auto next = timers_.next_expiry();
+        if (next == TimePoint::max())
+            timers_cv_.wait(ul);
+        else
+            timers_cv_.wait_until(ul, next);
+
+        timers_.advance(Clock::now(), due);
+        if (due.empty())
+            continue;
+
+        // Don't hold the lock while enqueuing: running a task inline
+        // (when the pool is stopped) may schedule other tasks.
+        ul.unlock();
+        for (auto &delayed : due)
+            enqueue(delayed.task, delayed.target);
+        due.clear();
+        ul.lock();
+    }
+}
+
+Tasks::ThreadPool::Stats Scheduler::pool_stats() const
 {
+    return pool_.stats();
 }
 
 Kernel &Scheduler::kernel()
@@ -21,6 +21,10 @@
 
 #include "LeosacFwd.hpp"
 #include "core/tasks/GenericTask.hpp"
+#include "core/tasks/ThreadPool.hpp"
+#include "core/tasks/TimerWheel.hpp"
+#include <chrono>
+#include <condition_variable>
 #include <map>
 #include <mutex>
 #include <queue>
@@ -35,12 +39,49 @@ enum class TargetThread
     POOL,
 };
 
+/**
+ * Identifies a task scheduled with Scheduler::enqueue_at() or
+ * Scheduler::enqueue_after(), so that it can be cancelled.
+ *
+ * A default constructed handle refers to no task.
+ */
+class TimerHandle
+{
+  public:
+    TimerHandle()
+        : id_(0)
+    {
+    }
+
+    bool valid() const
+    {
+        return id_ != 0;
+    }
+
+  private:
+    friend class Scheduler;
+    explicit TimerHandle(uint64_t id)
+        : id_(id)
+    {
+    }
+
+    uint64_t id_;
+};
+
 /**
  * This is a scheduler that is used internally to schedule asynchronous / long
  * running tasks.
  *
- * It currently support running a task on the main thread, or in some
- * random thread.
+ * It currently support running a task on the main thread, or on one of
+ * the threads of a fixed-size pool (see Tasks::ThreadPool).
+ *
+ * Enqueuing a `MAIN` task signals an eventfd (see wakeup_fd()), so that
+ * the main thread can sleep in its reactor until there is work to do,
+ * instead of polling the queue periodically.
+ *
+ * Tasks can also be scheduled to run at a given time. Those are kept in a
+ * timer wheel (see Tasks::TimerWheel) by a dedicated thread, that sleeps
+ * until the next task is due and then enqueues it on its target thread.
  *
  * The scheduler is fully thread-safe.
  */
@@ -51,9 +92,17 @@ class Scheduler
      * Construct a scheduler object (generally 1 per application).
      * The `kptr` pointer should never be null, except when writing test cases.
      *
+     * @param pool_size number of threads running `POOL` tasks. If 0, a
+     * default based on the number of CPUs is used.
+     *
      * @note We use a pointer here to ease testing
      */
-    Scheduler(Kernel *kptr);
+    Scheduler(Kernel *kptr, size_t pool_size = 0);
+
+    /**
+     * Calls shutdown().
+     */
+    ~Scheduler();
 
     Scheduler(const Scheduler &) = delete;
     Scheduler(Scheduler &&)      = delete;
@@ -74,6 +123,48 @@ class Scheduler
      */
     void enqueue(Tasks::TaskPtr t, TargetThread policy);
 
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    template <typename Callable>
+    typename std::enable_if<
+        !std::is_convertible<Callable, std::shared_ptr<Tasks::Task>>::value,
+        TimerHandle>::type
+    enqueue_at(TimePoint when, const Callable &call, TargetThread policy)
+    {
+        return enqueue_at(when, Tasks::GenericTask::build(call), policy);
+    }
+
+    /**
+     * Enqueue a task on thread `policy` once `when` is reached.
+     *
+     * The task is enqueued at most 10ms after `when`, never before.
+     */
+    TimerHandle enqueue_at(TimePoint when, Tasks::TaskPtr t, TargetThread policy);
+
+    template <typename Callable>
+    typename std::enable_if<
+        !std::is_convertible<Callable, std::shared_ptr<Tasks::Task>>::value,
+        TimerHandle>::type
+    enqueue_after(Clock::duration delay, const Callable &call, TargetThread policy)
+    {
+        return enqueue_at(Clock::now() + delay, call, policy);
+    }
+
+    /**
+     * Enqueue a task on thread `policy` once `delay` has elapsed.
+     */
+    TimerHandle enqueue_after(Clock::duration delay, Tasks::TaskPtr t,
+                              TargetThread policy);
+
+    /**
+     * Cancel a task scheduled by enqueue_at() or enqueue_after().
+     *
+     * @return true if the task was cancelled, false if it was already
+     * enqueued on its target thread (or cancelled).
+     */
+    bool cancel(const TimerHandle &handle);
+
     /**
      * This will run queued tasks that are scheduled to run on thread
      * `me`.
@@ -83,6 +174,38 @@ class Scheduler
      */
     void update(TargetThread me) noexcept;
 
+    /**
+     * File descriptor that becomes readable when tasks are enqueued
+     * on thread `me`. It is meant to be registered in the reactor of
+     * that thread, whose handler shall call update().
+     *
+     * Only `MAIN` has such a descriptor.
+     */
+    int wakeup_fd(TargetThread me) const;
+
+    /**
+     * Make wakeup_fd() readable, as if a task had been enqueued.
+     *
+     * This lets the thread re-check its own state. This function is
+     * async-signal-safe.
+     */
+    void wakeup(TargetThread me) noexcept;
+
+    /**
+     * Drop the tasks scheduled to run later, then run the `POOL` tasks that
+     * are already queued, wait for them to complete and stop the pool's
+     * threads.
+     *
+     * `POOL` tasks enqueued afterward run synchronously, on
+     * the thread that enqueues them.
+     */
+    void shutdown();
+
+    /**
+     * Metrics about the tasks run on `POOL`.
+     */
+    Tasks::ThreadPool::Stats pool_stats() const;
+
     /**
      * This is currently useless.
      */
@@ -102,12 +225,39 @@ class Scheduler
      * The internal queues of tasks.
      *
      * Each target thread has its own queue. Tasks scheduled to run
-     * on `POOL` are not queued here, since they run on some detached thread
-     * we don't care about.
+     * on `POOL` are not queued here, but handed to the thread pool.
      */
     TaskQueueMap queues_;
 
+    Tasks::ThreadPool pool_;
+
     Kernel *kptr_;
     mutable std::mutex mutex_;
+
+    /**
+     * eventfd signaled when `MAIN` tasks are enqueued. It is reset
+     * by update() before running the queued tasks.
+     */
+    int main_wakeup_fd_;
+
+    /**
+     * Body of the timer thread.
+     */
+    void run_timers();
+
+    struct DelayedTask
+    {
+        Tasks::TaskPtr task;
+        TargetThread target;
+    };
+
+    /**
+     * Protects the timer wheel and `timers_stop_`.
+     */
+    std::mutex timers_mutex_;
+    std::condition_variable timers_cv_;
+    Tasks::TimerWheel<DelayedTask> timers_;
+    bool timers_stop_;
+    std::thread timers_thread_;
 };
 }
@@ -0,0 +1,195 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/audit/AsyncAuditWriter.hpp"
+#include "core/audit/AuditEntry.hpp"
+#include "core/audit/AuditEntry_odb.h"
+#include "exception/ExceptionsTools.hpp"
+#include "tools/AssertCast.hpp"
+#include "tools/ThreadUtils.hpp"
+#include "tools/log.hpp"
+#include <odb/transaction.hxx>
+
+using namespace Leosac;
+using namespace Leosac::Audit;
+
+AsyncAuditWriter::Config::Config()
+    : queue_size(4096)
+    , batch_size(128)
+    , flush_interval(200)
+    , overflow(OverflowPolicy::DROP_OLDEST)
+{
+}
+
+AsyncAuditWriter::AsyncAuditWriter(DBPtr database, const Config &cfg)
+    : database_(database)
+    , config_(cfg)
+    , in_flight_(0)
+    , flush_waiters_(0)
+    , stop_(false)
+    , dropped_(0)
+{
+    ASSERT_LOG(database_, "Database cannot be null.");
+    thread_ = std::thread(std::bind(&AsyncAuditWriter::run, this));
+}
+
+AsyncAuditWriter::~AsyncAuditWriter()
+{
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        stop_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    thread_.join();
+    if (dropped_)
+        WARN("AsyncAuditWriter dropped " << dropped_ << " audit entries.");
+}
+
+bool AsyncAuditWriter::enqueue(IAuditEntryPtr entry)
+{
+    auto entry_odb = assert_cast<AuditEntryPtr>(entry);
+    ASSERT_LOG(entry_odb->id() == 0, "Audit entry is already persisted.");
+    if (!entry_odb->finalized())
+        entry_odb->finalize_detached();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (queue_.size() >= config_.queue_size)
+    {
+        switch (config_.overflow)
+        {
+        case OverflowPolicy::DROP_NEWEST:
+            ++dropped_;
+            return false;
+        case OverflowPolicy::DROP_OLDEST:
+            queue_.pop_front();
+            ++dropped_;
+            break;
+        case OverflowPolicy::BLOCK:
+            not_full_.wait(lock, [&]() {
+                return stop_ || queue_.size() < config_.queue_size;
+            });
+            break;
+        }
+    }
+    if (stop_)
+    {
+        // The writer thread may be gone already: nobody would
+        // persist the entry.
+        ++dropped_;
+        return false;
+    }
+    queue_.push_back(entry_odb);
+    lock.unlock();
+
+    not_empty_.notify_one();
+    return true;
+}
+
+void AsyncAuditWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++flush_waiters_;
+    not_empty_.notify_one();
+    not_full_.wait(lock, [&]() { return queue_.empty() && in_flight_ == 0; });
+    --flush_waiters_;
+}
+
+size_t AsyncAuditWriter::dropped_count() const
+{
+    return dropped_;
+}
+
+void AsyncAuditWriter::run()
+{
+    set_thread_name("audit_writer");
+    std::vector<AuditEntryPtr> batch;
+    batch.reserve(config_.batch_size);
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty() && stop_)
+                break;
+
+            // Give producers a chance to fill the batch, unless
+            // someone is waiting for the queue to be flushed.
+            if (queue_.size() < config_.batch_size && !stop_ && !flush_waiters_)
+            {
+                not_empty_.wait_for(lock, config_.flush_interval, [&]() {
+                    return stop_ || flush_waiters_ ||
+                           queue_.size() >= config_.batch_size;
+                });
+            }
+
+            while (!queue_.empty() && batch.size() < config_.batch_size)
+            {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            in_flight_ = batch.size();
+        }
+        not_full_.notify_all();
+
+        write_batch(batch);
+        batch.clear();
+
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            in_flight_ = 0;
+        }
+        not_full_.notify_all();
+    }
+}
+
+void AsyncAuditWriter::write_batch(const std::vector<AuditEntryPtr> &batch)
+{
+    try
+    {
+        odb::transaction t(database_->begin());
+        for (const auto &entry : batch)
+            database_->persist(entry);
+        t.commit();
+        return;
+    }
+    catch (const std::exception &e)
+    {
+        WARN("Failed to persist a batch of " << batch.size()
+                                             << " audit entries. Will retry "
+                                                "one by one.");
+        log_exception(e);
+    }
+
+    for (const auto &entry : batch)
+    {
+        try
+        {
+            odb::transaction t(database_->begin());
+            database_->persist(entry);
+            t.commit();
+        }
+        catch (const std::exception &e)
+        {
+            WARN("Failed to persist audit entry.");
+            log_exception(e);
+        }
+    }
+}
@@ -0,0 +1,178 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "core/audit/AuditFwd.hpp"
+#include "tools/db/db_fwd.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Leosac
+{
+namespace Audit
+{
+/**
+ * A core service that persists audit entries in the background.
+ *
+ * Producers build their audit entry in memory (see
+ * Factory::DetachedAuthEvent()) and hand it over to the writer.
+ * Entries are queued in a bounded in-memory queue, and a dedicated
+ * thread persists them in batches, using one transaction per batch.
+ *
+ * This let latency sensitive code (eg. the authentication path) produce
+ * audit entries without waiting for the database.
+ *
+ * The service is registered by the Kernel when a database is configured.
+ * Pending entries are flushed when the service is destroyed.
+ */
+class AsyncAuditWriter
+{
+  public:
+    /**
+     * What to do when an entry is enqueued while the queue is full.
+     */
+    enum class OverflowPolicy
+    {
+        /**
+         * Discard the entry being enqueued.
+         */
+        DROP_NEWEST,
+        /**
+         * Discard the oldest entry in the queue to make room.
+         */
+        DROP_OLDEST,
+        /**
+         * Block the producer until there is room in the queue.
+         */
+        BLOCK
+    };
+
+    struct Config
+    {
+        Config();
+
+        /**
+         * Maximum number of entries waiting to be persisted.
+         */
+        size_t queue_size;
+
+        /**
+         * Maximum number of entries persisted in one transaction.
+         */
+        size_t batch_size;
+
+        /**
+         * How long the writer waits for more entries before
+         * persisting an incomplete batch.
+         */
+        std::chrono::milliseconds flush_interval;
+
+        OverflowPolicy overflow;
+    };
+
+    AsyncAuditWriter(DBPtr database, const Config &cfg);
+
+    /**
+     * Persist all pending entries, then stop the writer thread.
+     */
+    ~AsyncAuditWriter();
+
+    AsyncAuditWriter(const AsyncAuditWriter &) = delete;
+    AsyncAuditWriter &operator=(const AsyncAuditWriter &) = delete;
+
+    /**
+     * Queue an entry for persistence.
+     *
+     * The entry must not be persisted yet, and must not be modified
+     * by the caller after this call. It is finalized (see
+     * AuditEntry::finalize_detached()) if it isn't already.
+     *
+     * @return false if the entry was dropped, because the queue was full
+     * or the writer is stopping.
+     */
+    bool enqueue(IAuditEntryPtr entry);
+
+    /**
+     * Block until all entries queued so far have been handled.
+     *
+     * The writer doesn't wait for `flush_interval` while someone
+     * is flushing.
+     */
+    void flush();
+
+    /**
+     * Number of entries that were dropped (see enqueue()).
+     */
+    size_t dropped_count() const;
+
+  private:
+    void run();
+
+    /**
+     * Persist a batch of entries in a single transaction.
+     *
+     * If the transaction fails, entries are persisted one by one
+     * so that a single faulty entry doesn't cause the loss of
+     * the whole batch.
+     */
+    void write_batch(const std::vector<AuditEntryPtr> &batch);
+
+    DBPtr database_;
+    const Config config_;
+
+    mutable std::mutex mutex_;
+
+    /**
+     * Signaled when entries are enqueued, or when the writer
+     * shall stop.
+     */
+    std::condition_variable not_empty_;
+
+    /**
+     * Signaled when the writer takes entries out of the queue, and
+     * when a batch has been written.
+     */
+    std::condition_variable not_full_;
+
+    std::deque<AuditEntryPtr> queue_;
+
+    /**
+     * Number of entries taken out of the queue but not yet written.
+     */
+    size_t in_flight_;
+
+    /**
+     * Number of threads blocked in flush().
+     */
+    size_t flush_waiters_;
+
+    bool stop_;
+
+    std::atomic<size_t> dropped_;
+
+    std::thread thread_;
+};
+}
+}
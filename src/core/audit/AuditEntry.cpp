@@ -21,6 +21,7 @@
 #include "core/audit/AuditEntry_odb.h"
 #include "core/auth/User.hpp"
 #include "core/auth/User_odb.h"
+#include "tools/db/MultiplexedTransaction.hpp"
 #include "tools/db/OptionalTransaction.hpp"
 #include "tools/log.hpp"
 #include <odb/query.hxx>
@@ -69,6 +70,27 @@ void AuditEntry::finalize()
     database_->update(*this);
 }
 
+void AuditEntry::finalize_detached()
+{
+    ASSERT_LOG(id_ == 0, "Audit entry is already persisted.");
+    ASSERT_LOG(!finalized_, "Audit entry is already finalized.");
+    finalized_ = true;
+    duration_ += etc_.elapsed();
+}
+
+void AuditEntry::persist_detached()
+{
+    ASSERT_LOG(id_ == 0, "Audit entry is already persisted.");
+    ASSERT_LOG(database_, "Null database pointer for AuditEntry.");
+
+    // The entry is committed on its own, like entries created by
+    // WSAPICall::create(): it must survive a rollback of the
+    // caller's transaction, which only owns the child entries.
+    db::MultiplexedTransaction t(database_->begin());
+    database_->persist(shared_from_this());
+    t.commit();
+}
+
 bool AuditEntry::finalized() const
 {
     return finalized_;
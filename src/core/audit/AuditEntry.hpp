@@ -58,6 +58,27 @@ class AuditEntry : virtual public IAuditEntry,
 
     virtual bool finalized() const override;
 
+    /**
+     * Finalize an entry that has not been persisted yet.
+     *
+     * Unlike `finalize()`, this does not touch the database: the entry
+     * is expected to be persisted later, in its final state. This is
+     * used by entries handed over to the AsyncAuditWriter.
+     */
+    void finalize_detached();
+
+    /**
+     * Persist an entry that was built in memory.
+     *
+     * This is used when a detached entry must exist in the database
+     * before it is finalized, for example because a child entry is
+     * about to reference it.
+     *
+     * The entry is persisted in its own transaction, which is committed
+     * even if a transaction is in progress.
+     */
+    void persist_detached();
+
     virtual void event_mask(const EventMask &mask) override;
 
     virtual const EventMask &event_mask() const override;
@@ -173,6 +194,24 @@ struct AuditEntryCount
 #pragma db column("count(" + AuditEntry::id_ + ")")
     std::size_t count;
 };
+
+/**
+ * Number of audit entries, and highest entry id, per audit type.
+ *
+ * The type is the value of the polymorphic discriminator column.
+ */
+#pragma db view object(AuditEntry) query((?) + "GROUP BY typeid")
+struct AuditEntryTypeCount
+{
+#pragma db column("typeid")
+    std::string type;
+
+#pragma db column("count(" + AuditEntry::id_ + ")")
+    std::size_t count;
+
+#pragma db column("max(" + AuditEntry::id_ + ")")
+    AuditEntryId max_id;
+};
 }
 }
 
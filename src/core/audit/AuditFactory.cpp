@@ -41,6 +41,16 @@
 using namespace Leosac;
 using namespace Leosac::Audit;
 
+/**
+ * Parents may have been built in memory (see Factory::DetachedWSAPICall()).
+ * They must be persisted before a child references them.
+ */
+static void persist_parent(const IAuditEntryPtr &parent)
+{
+    if (parent && !parent->id())
+        assert_cast<AuditEntryPtr>(parent)->persist_detached();
+}
+
 IUserEventPtr Factory::UserEvent(const DBPtr &database, Auth::UserPtr target_user,
                                  IAuditEntryPtr parent)
 {
@@ -48,6 +58,7 @@ IUserEventPtr Factory::UserEvent(const DBPtr &database, Auth::UserPtr target_use
     ASSERT_LOG(target_user, "Target user must be non null.");
     ASSERT_LOG(target_user->id(), "Target user must be already persisted.");
     ASSERT_LOG(parent, "Parent must be non null.");
+    persist_parent(parent);
     ASSERT_LOG(parent->id(), "Parent must be already persisted.");
 
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
@@ -64,6 +75,7 @@ IGroupEventPtr Factory::GroupEvent(const DBPtr &database,
     ASSERT_LOG(target_group, "Target group must be non null.");
     ASSERT_LOG(target_group->id(), "Target group must be already persisted.");
     ASSERT_LOG(parent, "Parent must be non null.");
+    persist_parent(parent);
     ASSERT_LOG(parent->id(), "Parent must be already persisted.");
 
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
@@ -79,6 +91,13 @@ IWSAPICallPtr Factory::WSAPICall(const DBPtr &database)
     return Audit::WSAPICall::create(database);
 }
 
+IWSAPICallPtr Factory::DetachedWSAPICall(const DBPtr &database)
+{
+    ASSERT_LOG(database, "Database cannot be null.");
+
+    return Audit::WSAPICall::create_detached(database);
+}
+
 IUserGroupMembershipEventPtr
 Factory::UserGroupMembershipEvent(const DBPtr &database, Auth::GroupPtr target_group,
                                   Auth::UserPtr target_user, IAuditEntryPtr parent)
@@ -89,6 +108,7 @@ Factory::UserGroupMembershipEvent(const DBPtr &database, Auth::GroupPtr target_g
     ASSERT_LOG(target_user, "User shall not be null.");
     ASSERT_LOG(target_user->id(), "User must be already persisted.");
 
+    persist_parent(parent);
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
     ASSERT_LOG(parent_odb, "Parent object was not an instance of AuditEntry");
 
@@ -104,6 +124,7 @@ ICredentialEventPtr Factory::CredentialEventPtr(const DBPtr &database,
     ASSERT_LOG(target_cred, "Credential shall not be null.");
     ASSERT_LOG(target_cred->id(), "Credential must be already persisted.");
 
+    persist_parent(parent);
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
     ASSERT_LOG(parent_odb, "Parent object was not an instance of AuditEntry");
 
@@ -118,6 +139,7 @@ IScheduleEventPtr Factory::ScheduleEvent(const DBPtr &database,
     ASSERT_LOG(target_sched, "Schedule shall not be null.");
     ASSERT_LOG(target_sched->id(), "Schedule must be already persisted.");
 
+    persist_parent(parent);
     auto parent_odb = assert_cast<AuditEntryPtr>(parent);
     return Audit::ScheduleEvent::create(database, target_sched, parent_odb);
 }
@@ -129,6 +151,7 @@ IDoorEventPtr Factory::DoorEvent(const DBPtr &database, Auth::IDoorPtr target_do
     ASSERT_LOG(target_door, "Target door must be non null.");
     ASSERT_LOG(target_door->id(), "Target door must be already persisted.");
     ASSERT_LOG(parent, "Parent must be non null.");
+    persist_parent(parent);
     ASSERT_LOG(parent->id(), "Parent must be already persisted.");
 
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
@@ -144,6 +167,7 @@ IAuthEventPtr Factory::AuthEvent(const DBPtr &database, Cred::ICredentialPtr cre
     ASSERT_LOG(credential, "Credential must be non null.");
     ASSERT_LOG(!door.empty(), "Door must be set.");
     ASSERT_LOG(parent, "Parent must be non null.");
+    persist_parent(parent);
     ASSERT_LOG(parent->id(), "Parent must be already persisted.");
 
     AuditEntryPtr parent_odb;
@@ -156,6 +180,16 @@ IAuthEventPtr Factory::AuthEvent(const DBPtr &database, Cred::ICredentialPtr cre
     return Audit::AuthEvent::create(database, credential, door, parent_odb);
 }
 
+IAuthEventPtr Factory::DetachedAuthEvent(const DBPtr &database,
+                                         Cred::ICredentialPtr credential,
+                                         const std::string &door)
+{
+    ASSERT_LOG(database, "Database cannot be null.");
+    ASSERT_LOG(credential, "Credential must be non null.");
+
+    return Audit::AuthEvent::create_detached(database, credential, door);
+}
+
 IAccessPointEventPtr Factory::AccessPointEvent(const DBPtr &database,
                                                Auth::IAccessPointPtr target_ap,
                                                IAuditEntryPtr parent)
@@ -164,6 +198,7 @@ IAccessPointEventPtr Factory::AccessPointEvent(const DBPtr &database,
     ASSERT_LOG(target_ap, "Target AccessPoint must be non null.");
     ASSERT_LOG(target_ap->id(), "Target AccessPoint must be already persisted.");
     ASSERT_LOG(parent, "Parent must be non null.");
+    persist_parent(parent);
     ASSERT_LOG(parent->id(), "Parent must be already persisted.");
 
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
@@ -180,6 +215,7 @@ IUpdateEventPtr Factory::UpdateEvent(const DBPtr &database,
     ASSERT_LOG(target_update, "Target AccessPoint must be non null.");
     ASSERT_LOG(target_update->id(), "Target AccessPoint must be already persisted.");
     ASSERT_LOG(parent, "Parent must be non null.");
+    persist_parent(parent);
     ASSERT_LOG(parent->id(), "Parent must be already persisted.");
 
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
@@ -195,6 +231,7 @@ IZoneEventPtr Factory::ZoneEvent(const DBPtr &database, Auth::IZonePtr target_zo
     ASSERT_LOG(target_zone, "Target zone must be non null.");
     ASSERT_LOG(target_zone->id(), "Target zone must be already persisted.");
     ASSERT_LOG(parent, "Parent must be non null.");
+    persist_parent(parent);
     ASSERT_LOG(parent->id(), "Parent must be already persisted.");
 
     AuditEntryPtr parent_odb = std::dynamic_pointer_cast<AuditEntry>(parent);
@@ -55,6 +55,15 @@ class Factory
 
     static IWSAPICallPtr WSAPICall(const DBPtr &database);
 
+    /**
+     * Build a WSAPICall in memory only.
+     *
+     * The entry is persisted when it becomes the parent of another
+     * entry. Otherwise, it is meant to be handed over to the
+     * AsyncAuditWriter once finalized.
+     */
+    static IWSAPICallPtr DetachedWSAPICall(const DBPtr &database);
+
 
     static IUserGroupMembershipEventPtr
     UserGroupMembershipEvent(const DBPtr &database, Auth::GroupPtr target_group,
@@ -73,6 +82,16 @@ class Factory
 
     static IAuthEventPtr AuthEvent(const DBPtr &database, Cred::ICredentialPtr credential, const std::string& door,
                                   IAuditEntryPtr parent = nullptr);
+    /**
+     * Build an AuthEvent in memory only.
+     *
+     * The entry is meant to be handed over to the AsyncAuditWriter
+     * which will persist it in the background, so that access decisions
+     * don't wait for the database.
+     */
+    static IAuthEventPtr DetachedAuthEvent(const DBPtr &database,
+                                           Cred::ICredentialPtr credential,
+                                           const std::string &door);
 
     static IAccessPointEventPtr AccessPointEvent(const DBPtr &database,
                                                  Auth::IAccessPointPtr target_ap,
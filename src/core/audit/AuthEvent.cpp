@@ -62,6 +62,21 @@ std::shared_ptr<AuthEvent> AuthEvent::create(const DBPtr &database,
     return audit;
 }
 
+std::shared_ptr<AuthEvent> AuthEvent::create_detached(const DBPtr &database,
+                                                      Cred::ICredentialPtr credential,
+                                                      const std::string &door)
+{
+    ASSERT_LOG(database, "Database cannot be null.");
+    ASSERT_LOG(credential, "Credential must be non null.");
+
+    Audit::AuthEventPtr audit =
+        std::shared_ptr<Audit::AuthEvent>(new Audit::AuthEvent());
+    audit->database_ = database;
+    audit->door(door);
+    audit->credential(credential);
+    return audit;
+}
+
 void AuthEvent::credential(Cred::ICredentialPtr cred)
 {
     ASSERT_LOG(!finalized(), "Audit entry is already finalized.");
@@ -86,6 +101,8 @@ std::string AuthEvent::generate_description() const
         ss << "Access Granted to Credential " << generate_credential_description() << ".";
     else if (event_mask_ & EventType::AUTH_DENIED)
         ss << "Access Denied to Credential " << generate_credential_description() << ".";
+    if (!msg_.empty())
+        ss << " " << msg_ << ".";
 
     return ss.str();
 }
@@ -128,3 +145,14 @@ void AuthEvent::door(const std::string& d)
 {
     door_ = d;
 }
+
+void AuthEvent::repeated(size_t count, std::chrono::seconds period)
+{
+    ASSERT_LOG(!finalized(), "Audit entry is already finalized.");
+
+    std::stringstream ss;
+    ss << count
+       << ((event_mask_ & EventType::AUTH_GRANTED) ? " grants" : " denials")
+       << " in " << period.count() << " seconds";
+    msg_ = ss.str();
+}
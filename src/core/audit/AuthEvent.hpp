@@ -40,6 +40,13 @@ class AuthEvent : virtual public IAuthEvent, public AuditEntry
     static std::shared_ptr<AuthEvent>
     create(const DBPtr &database, Cred::ICredentialPtr credential, const std::string& door, AuditEntryPtr parent = nullptr);
 
+    /**
+     * Create an AuthEvent without persisting it.
+     */
+    static std::shared_ptr<AuthEvent>
+    create_detached(const DBPtr &database, Cred::ICredentialPtr credential,
+                    const std::string &door);
+
   public:
     virtual ~AuthEvent() = default;
 
@@ -55,6 +62,8 @@ class AuthEvent : virtual public IAuthEvent, public AuditEntry
 
     virtual std::string door() const override;
 
+    virtual void repeated(size_t count, std::chrono::seconds period) override;
+
     virtual std::string generate_description() const override;
 
   public:
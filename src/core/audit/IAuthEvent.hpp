@@ -22,6 +22,7 @@
 #include "IAuditEntry.hpp"
 #include "core/auth/Auth.hpp"
 #include "core/credentials/CredentialFwd.hpp"
+#include <chrono>
 
 namespace Leosac
 {
@@ -50,6 +51,14 @@ class IAuthEvent : virtual public IAuditEntry
     virtual void door(const std::string& d) = 0;
 
     virtual std::string door() const = 0;
+
+    /**
+     * Mark the event as standing for `count` identical events
+     * that happened over `period`.
+     *
+     * The event mask must be set before calling this.
+     */
+    virtual void repeated(size_t count, std::chrono::seconds period) = 0;
 };
 }
 }
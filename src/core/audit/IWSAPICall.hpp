@@ -89,6 +89,8 @@ class IWSAPICall : virtual public IAuditEntry
      * The number of database queries.
      */
     virtual void database_operations(uint16_t nb_operation) = 0;
+
+    virtual uint16_t database_operations() const = 0;
 };
 }
 }
@@ -44,6 +44,15 @@ WSAPICallPtr WSAPICall::create(const DBPtr &database)
     return audit;
 }
 
+WSAPICallPtr WSAPICall::create_detached(const DBPtr &database)
+{
+    ASSERT_LOG(database, "Database cannot be null.");
+
+    WSAPICallPtr audit(new Audit::WSAPICall());
+    audit->database_ = database;
+    return audit;
+}
+
 void WSAPICall::method(const std::string &str)
 {
     ASSERT_LOG(!finalized(), "Audit entry is already finalized.");
@@ -92,6 +101,11 @@ void WSAPICall::database_operations(uint16_t nb_operation)
     database_operations_ = nb_operation;
 }
 
+uint16_t WSAPICall::database_operations() const
+{
+    return database_operations_;
+}
+
 const std::string &WSAPICall::method() const
 {
     return api_method_;
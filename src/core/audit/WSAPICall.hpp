@@ -39,6 +39,8 @@ class WSAPICall : virtual public IWSAPICall, public AuditEntry
 
     static WSAPICallPtr create(const DBPtr &database);
 
+    static WSAPICallPtr create_detached(const DBPtr &database);
+
   public:
     virtual ~WSAPICall() = default;
 
@@ -58,6 +60,8 @@ class WSAPICall : virtual public IWSAPICall, public AuditEntry
 
     virtual void database_operations(uint16_t nb_operation) override;
 
+    virtual uint16_t database_operations() const override;
+
     virtual const std::string &method() const override;
 
     virtual const std::string &uuid() const override;
@@ -92,6 +92,9 @@ class ValidityInfo;
 class AuthTarget;
 using AuthTargetPtr = std::shared_ptr<AuthTarget>;
 
+class IAuthSourceMapper;
+using IAuthSourceMapperPtr = std::shared_ptr<IAuthSourceMapper>;
+
 class IAuthenticationSource;
 using IAuthenticationSourcePtr = std::shared_ptr<IAuthenticationSource>;
 
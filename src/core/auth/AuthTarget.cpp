@@ -18,6 +18,7 @@
 */
 
 #include "AuthTarget.hpp"
+#include "tools/ScheduleBitmap.hpp"
 #include "tools/log.hpp"
 
 using namespace Leosac::Auth;
@@ -112,9 +113,10 @@ void AuthTarget::alarm(std::unique_ptr<Leosac::Hardware::FAlarm> alarm)
 bool AuthTarget::is_always_open(
     const std::chrono::system_clock::time_point &tp) const
 {
+    auto minute = Leosac::Tools::ScheduleBitmap::week_minute(tp);
     for (const auto &sched : always_open_)
     {
-        if (sched->is_in_schedule(tp))
+        if (sched->is_in_schedule_minute(minute))
             return true;
     }
     return false;
@@ -123,9 +125,10 @@ bool AuthTarget::is_always_open(
 bool AuthTarget::is_always_closed(
     const std::chrono::system_clock::time_point &tp) const
 {
+    auto minute = Leosac::Tools::ScheduleBitmap::week_minute(tp);
     for (const auto &sched : always_close_)
     {
-        if (sched->is_in_schedule(tp))
+        if (sched->is_in_schedule_minute(minute))
             return true;
     }
     return false;
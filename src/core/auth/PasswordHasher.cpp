@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/auth/PasswordHasher.hpp"
+#include "core/tasks/GenericTask.hpp"
+#include "tools/enforce.hpp"
+#include "tools/log.hpp"
+
+using namespace Leosac;
+using namespace Leosac::Auth;
+
+PasswordHasher::Config::Config()
+    : threads(2)
+    , max_pending(32)
+    , params(Scrypt::DefaultParam())
+{
+}
+
+static const PasswordHasher::Config &validate(const PasswordHasher::Config &cfg)
+{
+    LEOSAC_ENFORCE(cfg.threads, "Password hashing needs at least one thread.");
+    LEOSAC_ENFORCE(cfg.max_pending, "max_pending must be positive.");
+    // N must be a power of 2, greater than 1.
+    LEOSAC_ENFORCE(cfg.params.N >= 2 && !(cfg.params.N & (cfg.params.N - 1)),
+                   "Scrypt N must be a power of 2.");
+    LEOSAC_ENFORCE(cfg.params.r && cfg.params.p, "Scrypt r and p must be positive.");
+    return cfg;
+}
+
+PasswordHasher::PasswordHasher(const Config &cfg)
+    : config_(validate(cfg))
+    , pending_(0)
+    , pool_(cfg.threads)
+{
+    INFO("Password hashing: N=" << config_.params.N << ", r=" << config_.params.r
+                                << ", p=" << config_.params.p << ". Up to "
+                                << config_.threads << " concurrent hashes, using "
+                                << Scrypt::MemoryUsage(config_.params) / 1024
+                                << "KB each.");
+}
+
+bool PasswordHasher::submit(Job job)
+{
+    if (++pending_ > config_.max_pending)
+    {
+        --pending_;
+        WARN("Too many pending password hashing jobs. Rejecting job.");
+        return false;
+    }
+
+    auto task = Tasks::GenericTask::build([this, job]() {
+        job();
+        --pending_;
+        return true;
+    });
+    if (!pool_.enqueue(task))
+    {
+        --pending_;
+        return false;
+    }
+    return true;
+}
+
+const ScryptParam &PasswordHasher::params() const
+{
+    return config_.params;
+}
+
+bool PasswordHasher::needs_rehash(const ScryptResult &hash) const
+{
+    // The hash length is not a tunable.
+    return hash.p.N != config_.params.N || hash.p.r != config_.params.r ||
+           hash.p.p != config_.params.p;
+}
+
+size_t PasswordHasher::pending() const
+{
+    return pending_;
+}
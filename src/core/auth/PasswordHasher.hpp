@@ -0,0 +1,119 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "core/tasks/ThreadPool.hpp"
+#include "tools/scrypt/Scrypt.hpp"
+#include <atomic>
+#include <functional>
+
+namespace Leosac
+{
+namespace Auth
+{
+/**
+ * A core service that runs password hashing jobs on a small, dedicated,
+ * pool of threads.
+ *
+ * Scrypt is purposely slow and memory hungry. Running it on the threads
+ * that serve requests would stall every other request, and running an
+ * unbounded number of hashes concurrently would make memory usage
+ * unpredictable. The pool size caps the number of concurrent hashes, and
+ * thus the memory used (see Scrypt::MemoryUsage()). The number of pending
+ * jobs is capped too: when the limit is reached, new jobs are rejected.
+ *
+ * The service also owns the Scrypt parameters of the deployment (see
+ * params()): jobs hash new passwords with them. Hashes computed with other
+ * parameters should be replaced (see needs_rehash()) the next time the
+ * password is known, ie on login.
+ *
+ * The service is registered by the Kernel.
+ */
+class PasswordHasher
+{
+  public:
+    struct Config
+    {
+        Config();
+
+        /**
+         * Maximum number of hashes computed concurrently.
+         */
+        size_t threads;
+
+        /**
+         * Maximum number of jobs waiting or running.
+         */
+        size_t max_pending;
+
+        /**
+         * Scrypt parameters for new hashes.
+         */
+        ScryptParam params;
+    };
+
+    using Job = std::function<void()>;
+
+    /**
+     * Start the hashing threads.
+     *
+     * @throws LEOSACException if the configuration is invalid.
+     */
+    explicit PasswordHasher(const Config &cfg);
+
+    /**
+     * Run the pending jobs, then stop the hashing threads.
+     */
+    ~PasswordHasher() = default;
+
+    PasswordHasher(const PasswordHasher &) = delete;
+    PasswordHasher &operator=(const PasswordHasher &) = delete;
+
+    /**
+     * Run `job` on a hashing thread.
+     *
+     * The job is responsible for reporting its result, and must not throw.
+     *
+     * @return false if too many jobs are pending. `job` is not run then.
+     */
+    bool submit(Job job);
+
+    /**
+     * Scrypt parameters for new hashes.
+     */
+    const ScryptParam &params() const;
+
+    /**
+     * Was `hash` computed with parameters other than the current ones?
+     */
+    bool needs_rehash(const ScryptResult &hash) const;
+
+    /**
+     * Number of jobs waiting or running.
+     */
+    size_t pending() const;
+
+  private:
+    const Config config_;
+    std::atomic<size_t> pending_;
+    Tasks::ThreadPool pool_;
+};
+}
+}
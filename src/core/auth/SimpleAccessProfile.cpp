@@ -18,6 +18,8 @@
 */
 
 #include "SimpleAccessProfile.hpp"
+#include "tools/ISchedule.hpp"
+#include "tools/ScheduleBitmap.hpp"
 #include <assert.h>
 #include <tools/log.hpp>
 
@@ -27,10 +29,13 @@ using SingleTimeFrame = Leosac::Tools::SingleTimeFrame;
 bool SimpleAccessProfile::isAccessGranted(
     const std::chrono::system_clock::time_point &date, AuthTargetPtr target)
 {
+    // Convert the date once, it is then tested against each schedule.
+    auto minute = Leosac::Tools::ScheduleBitmap::week_minute(date);
+
     // check "general" permissions that apply to all target
     for (const auto &sched : default_schedule_)
     {
-        if (sched->is_in_schedule(date))
+        if (sched->is_in_schedule_minute(minute))
         {
             INFO("Access is granted through schedule '" << sched->name() << "'");
             return true;
@@ -38,11 +43,16 @@ bool SimpleAccessProfile::isAccessGranted(
     }
 
     // check door specific permissions.
-    if (target && schedules_[target->name()].size())
+    // Lookup without inserting: a profile may be shared between
+    // threads once compiled.
+    if (target)
     {
-        for (const auto &sched : schedules_[target->name()])
+        auto itr = schedules_.find(target->name());
+        if (itr == schedules_.end())
+            return false;
+        for (const auto &sched : itr->second)
         {
-            if (sched->is_in_schedule(date))
+            if (sched->is_in_schedule_minute(minute))
             {
                 INFO("Access is granted through schedule '" << sched->name() << "'");
                 return true;
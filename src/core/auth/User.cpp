@@ -158,6 +158,16 @@ std::string User::password() const
     return "";
 }
 
+const boost::optional<ScryptResult> &User::password_hash() const
+{
+    return password_;
+}
+
+void User::password_hash(const ScryptResult &hash)
+{
+    password_ = hash;
+}
+
 UserRank User::rank() const
 {
     return rank_;
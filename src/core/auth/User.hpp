@@ -87,6 +87,20 @@ class User : public std::enable_shared_from_this<User>
      */
     std::string password() const;
 
+    /**
+     * The password hash, or nothing if the user has no password.
+     *
+     * This lets the hash be checked (or computed, see password_hash(const
+     * ScryptResult &)) away from the object, for example on a pool
+     * of threads.
+     */
+    const boost::optional<ScryptResult> &password_hash() const;
+
+    /**
+     * Set the password hash, as computed by Scrypt::Hash().
+     */
+    void password_hash(const ScryptResult &hash);
+
     /**
      * Set a new username.
      *
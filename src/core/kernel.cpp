@@ -18,9 +18,11 @@
 */
 
 #include "kernel.hpp"
+#include "core/audit/AsyncAuditWriter.hpp"
 #include "core/audit/serializers/JSONService.hpp"
 #include "core/auth/AccessPointService.hpp"
 #include "core/auth/Group.hpp"
+#include "core/auth/PasswordHasher.hpp"
 #include "core/auth/User.hpp"
 #include "core/auth/User_odb.h"
 #include "core/auth/serializers/AccessPointSerializer.hpp"
@@ -64,8 +66,11 @@ using namespace Leosac;
 Kernel *Kernel::instance_ = nullptr;
 
 Kernel::Kernel(const boost::property_tree::ptree &config, bool strict)
-    : utils_(std::make_shared<CoreUtils>(this, std::make_shared<Scheduler>(this),
-                                         std::make_shared<ConfigChecker>(), strict))
+    : utils_(std::make_shared<CoreUtils>(
+          this,
+          std::make_shared<Scheduler>(
+              this, config.get<size_t>("scheduler.pool_size", 0)),
+          std::make_shared<ConfigChecker>(), strict))
     , config_manager_(config)
     , ctx_()
     , bus_(ctx_)
@@ -121,6 +126,8 @@ Kernel::~Kernel()
     // A more elegant workaround would be to register core services
     // through a RAII object.
     module_manager_.stopModules();
+    // Tasks still running in the pool may rely on core services.
+    utils_->scheduler().shutdown();
     unregister_core_services();
     instance_ = nullptr;
 }
@@ -163,10 +170,16 @@ bool Kernel::run()
             remote_controller_->socket_,
             std::bind(&RemoteControl::handle_msg, remote_controller_.get()));
 
+    auto &scheduler = utils_->scheduler();
+    reactor_.add(scheduler.wakeup_fd(TargetThread::MAIN),
+                 [&scheduler]() { scheduler.update(TargetThread::MAIN); },
+                 zmqpp::poller::poll_in);
+
+    // Nothing happens on the main thread without a message, a task or
+    // a signal, all of which wake the reactor up.
     while (is_running_)
     {
-        reactor_.poll(25); // this is good enough. May be improved later tho.
-        utils_->scheduler().update(TargetThread::MAIN);
+        reactor_.poll();
         if (send_sighup_)
         {
             bus_push_.send(zmqpp::message() << "KERNEL"
@@ -367,9 +380,11 @@ std::string Kernel::factory_config_directory() const
 
 void Kernel::configure_logger()
 {
-    bool use_syslog              = true;
-    bool use_database            = false;
-    std::string syslog_min_level = "WARNING";
+    bool use_syslog               = true;
+    bool use_database             = false;
+    std::string syslog_min_level  = "WARNING";
+    std::string console_min_level = "DEBUG";
+    Tools::DatabaseLogSink::Config db_sink_cfg;
     std::shared_ptr<spdlog::logger> console;
 
     // Drop existing logger, if any. (This is for the case of a "in process" restart)
@@ -382,6 +397,20 @@ void Kernel::configure_logger()
         use_syslog       = log_cfg_node->get<bool>("enable_syslog", true);
         use_database     = log_cfg_node->get<bool>("enable_database", false);
         syslog_min_level = log_cfg_node->get<std::string>("min_syslog", "WARNING");
+        console_min_level = log_cfg_node->get<std::string>("min_console", "DEBUG");
+        if (auto writer_cfg = log_cfg_node->get_child_optional("database_writer"))
+        {
+            db_sink_cfg.queue_size =
+                writer_cfg->get<size_t>("queue_size", db_sink_cfg.queue_size);
+            db_sink_cfg.batch_size =
+                writer_cfg->get<size_t>("batch_size", db_sink_cfg.batch_size);
+            db_sink_cfg.flush_interval = std::chrono::milliseconds(writer_cfg->get<size_t>(
+                "flush_interval", db_sink_cfg.flush_interval.count()));
+            if (!db_sink_cfg.queue_size || !db_sink_cfg.batch_size)
+                throw ConfigException(
+                    config_file_path(),
+                    "database_writer queue_size and batch_size must be positive.");
+        }
     }
     if (use_syslog)
     {
@@ -394,12 +423,16 @@ void Kernel::configure_logger()
     {
         console = spdlog::create(
             "console", {std::make_shared<spdlog::sinks::stdout_sink_mt>(),
-                        std::make_shared<Tools::DatabaseLogSink>(database_)});
+                        std::make_shared<Tools::DatabaseLogSink>(database_, db_sink_cfg)});
     }
     else
         console = spdlog::create(
             "console", {std::make_shared<spdlog::sinks::stdout_sink_mt>()});
-    console->set_level(spdlog::level::debug);
+    console->set_level(static_cast<spdlog::level::level_enum>(
+        LogHelper::log_level_from_string(console_min_level)));
+
+    // Messages that no logger accepts are not even formatted.
+    LogHelper::update_active_level();
 }
 
 const ModuleManager &Kernel::module_manager() const
@@ -467,10 +500,7 @@ void Kernel::shutdown()
     // to the module subsystem.
     Tools::ElapsedTimeCounter etc;
     while (etc.elapsed() < 5000)
-    {
         reactor_.poll(25);
-        utils_->scheduler().update(TargetThread::MAIN);
-    }
 }
 
 void Kernel::configure_database()
@@ -537,6 +567,56 @@ void Kernel::register_core_services()
                 std::make_unique<DBService>(database_));
         }
 
+        // Asynchronous audit writer
+        if (database_)
+        {
+            using OverflowPolicy = Audit::AsyncAuditWriter::OverflowPolicy;
+            Audit::AsyncAuditWriter::Config cfg;
+            if (auto writer_cfg = config_manager_.kconfig().get_child_optional(
+                    "database.audit_writer"))
+            {
+                cfg.queue_size = writer_cfg->get<size_t>("queue_size", cfg.queue_size);
+                cfg.batch_size = writer_cfg->get<size_t>("batch_size", cfg.batch_size);
+                cfg.flush_interval = std::chrono::milliseconds(writer_cfg->get<size_t>(
+                    "flush_interval", cfg.flush_interval.count()));
+
+                auto overflow =
+                    writer_cfg->get<std::string>("overflow", "drop_oldest");
+                if (overflow == "drop_newest")
+                    cfg.overflow = OverflowPolicy::DROP_NEWEST;
+                else if (overflow == "drop_oldest")
+                    cfg.overflow = OverflowPolicy::DROP_OLDEST;
+                else if (overflow == "block")
+                    cfg.overflow = OverflowPolicy::BLOCK;
+                else
+                    throw ConfigException(config_file_path(),
+                                          "Invalid audit_writer overflow policy: " +
+                                              overflow);
+                if (!cfg.queue_size || !cfg.batch_size)
+                    throw ConfigException(
+                        config_file_path(),
+                        "audit_writer queue_size and batch_size must be positive.");
+            }
+            service_registry_->register_service<Audit::AsyncAuditWriter>(
+                std::make_unique<Audit::AsyncAuditWriter>(database_, cfg));
+        }
+
+        // Password hashing
+        {
+            Auth::PasswordHasher::Config cfg;
+            if (auto hasher_cfg =
+                    config_manager_.kconfig().get_child_optional("password_hashing"))
+            {
+                cfg.threads     = hasher_cfg->get<size_t>("threads", cfg.threads);
+                cfg.max_pending = hasher_cfg->get<size_t>("max_pending", cfg.max_pending);
+                cfg.params.N    = hasher_cfg->get<uint64_t>("N", cfg.params.N);
+                cfg.params.r    = hasher_cfg->get<uint32_t>("r", cfg.params.r);
+                cfg.params.p    = hasher_cfg->get<uint32_t>("p", cfg.params.p);
+            }
+            service_registry_->register_service<Auth::PasswordHasher>(
+                std::make_unique<Auth::PasswordHasher>(cfg));
+        }
+
         // Audit serializers
         {
             service_registry_->register_service<Audit::Serializer::JSONService>(
@@ -585,11 +665,20 @@ void Kernel::unregister_core_services()
         ASSERT_LOG(ret, "Failed to unregister AuditSerializerService.");
         if (database_)
         {
+            // Destroying the writer flushes pending audit entries.
+            ret = service_registry_->unregister_service<Audit::AsyncAuditWriter>();
+            ASSERT_LOG(ret, "Failed to unregister AsyncAuditWriter");
             ret = service_registry_->unregister_service<DBService>();
             ASSERT_LOG(ret, "Failed to unregister DBService");
         }
     }
 
+    // Password hashing
+    {
+        bool ret = service_registry_->unregister_service<Auth::PasswordHasher>();
+        ASSERT_LOG(ret, "Failed to unregister Auth::PasswordHasher");
+    }
+
     // Access Point service
     {
         {
@@ -743,14 +832,21 @@ void Kernel::configure_signal_handler()
         else
         {
             this->is_running_ = false;
+            this->utils_->scheduler().wakeup(TargetThread::MAIN);
         }
     });
 
-    SignalHandler::registerCallback(Signal::SigTerm,
-                                    [this](Signal) { this->is_running_ = false; });
+    // The signal may be delivered to any thread. Wake the main
+    // loop up so that it notices the change.
+    SignalHandler::registerCallback(Signal::SigTerm, [this](Signal) {
+        this->is_running_ = false;
+        this->utils_->scheduler().wakeup(TargetThread::MAIN);
+    });
 
-    SignalHandler::registerCallback(Signal::SigHup,
-                                    [this](Signal) { this->send_sighup_ = true; });
+    SignalHandler::registerCallback(Signal::SigHup, [this](Signal) {
+        this->send_sighup_ = true;
+        this->utils_->scheduler().wakeup(TargetThread::MAIN);
+    });
 }
 
 void Kernel::create_update_schema()
@@ -778,4 +874,23 @@ void Kernel::create_update_schema()
         odb::schema_catalog::migrate(*database_, cv, "core");
         t.commit();
     }
+    create_extra_indexes();
+}
+
+void Kernel::create_extra_indexes()
+{
+    // The audit log is filtered by type and browsed by id. The type is
+    // ODB's polymorphic discriminator column, which an index pragma cannot
+    // refer to.
+    try
+    {
+        odb::transaction t(database_->begin());
+        database_->execute("CREATE INDEX IF NOT EXISTS \"AuditEntry_typeid_id_i\" "
+                           "ON \"AuditEntry\" (\"typeid\", \"id\")");
+        t.commit();
+    }
+    catch (const odb::exception &e)
+    {
+        WARN("Cannot create index on the audit log: " << e.what());
+    }
 }
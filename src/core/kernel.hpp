@@ -237,6 +237,13 @@ class Kernel
      */
     void create_update_schema();
 
+    /**
+     * Create the indexes that are not part of the ODB schema.
+     *
+     * This is idempotent, and runs on every startup.
+     */
+    void create_extra_indexes();
+
     void connect_to_db(const boost::property_tree::ptree &db_cfg_node);
 
     void configure_logger();
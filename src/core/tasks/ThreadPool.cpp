@@ -0,0 +1,207 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/tasks/ThreadPool.hpp"
+#include "core/tasks/Task.hpp"
+#include "tools/log.hpp"
+#include <algorithm>
+#include <cassert>
+
+using namespace Leosac::Tasks;
+
+/**
+ * The pool and the index of the worker running on the current thread,
+ * if the current thread is a worker.
+ */
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local size_t current_worker          = 0;
+
+ThreadPool::ThreadPool(size_t nb_threads)
+    : next_worker_(0)
+    , queued_(0)
+    , running_(0)
+    , stop_(false)
+    , stats_()
+{
+    assert(nb_threads);
+    stats_.threads = nb_threads;
+
+    for (size_t i = 0; i < nb_threads; ++i)
+        workers_.push_back(std::make_unique<Worker>());
+    // Start the threads once all queues exist, as workers
+    // may steal from any queue.
+    for (size_t i = 0; i < nb_threads; ++i)
+        workers_[i]->thread = std::thread(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    shutdown();
+}
+
+bool ThreadPool::enqueue(TaskPtr task)
+{
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        if (stop_)
+            return false;
+        if (current_pool == this)
+            index = current_worker;
+        else
+            index = next_worker_++ % workers_.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(workers_[index]->mutex);
+        workers_[index]->queue.push_back(std::move(task));
+    }
+
+    {
+        // The task is counted once it is in a queue, so that a worker
+        // that claims it is guaranteed to find it.
+        std::lock_guard<std::mutex> lg(mutex_);
+        ++queued_;
+        stats_.max_queued = std::max(stats_.max_queued, queued_);
+    }
+    work_cv_.notify_one();
+    return true;
+}
+
+void ThreadPool::drain()
+{
+    std::unique_lock<std::mutex> ul(mutex_);
+    idle_cv_.wait(ul, [&]() { return queued_ == 0 && running_ == 0; });
+}
+
+void ThreadPool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        if (stop_)
+            return;
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+
+    for (auto &worker : workers_)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+
+    auto st = stats();
+    INFO("Thread pool stopped. " << st.completed << " tasks completed ("
+                                 << st.stolen << " stolen), at most "
+                                 << st.max_queued << " queued, longest ran for "
+                                 << st.max_run_time.count() << "us.");
+}
+
+ThreadPool::Stats ThreadPool::stats() const
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    Stats st   = stats_;
+    st.queued  = queued_;
+    st.running = running_;
+    return st;
+}
+
+void ThreadPool::run(size_t index)
+{
+    current_pool   = this;
+    current_worker = index;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> ul(mutex_);
+            work_cv_.wait(ul, [&]() { return queued_ || stop_; });
+            // When stopping, queued tasks are still run before exiting.
+            if (!queued_)
+                return;
+            --queued_;
+            ++running_;
+        }
+
+        auto task  = take(index);
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            task->run();
+        }
+        catch (...)
+        {
+            // Task::run() handles std::exception. Don't let anything
+            // else kill the worker.
+            WARN("Unexpected exception while running task ~" << task->get_guid()
+                                                            << "~ in thread pool.");
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        DEBUG("Task ~" << task->get_guid() << "~ ran in " << elapsed.count()
+                       << "us on pool worker " << index);
+
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            --running_;
+            ++stats_.completed;
+            stats_.total_run_time += elapsed;
+            stats_.max_run_time = std::max(stats_.max_run_time, elapsed);
+            if (!queued_ && !running_)
+                idle_cv_.notify_all();
+        }
+    }
+}
+
+TaskPtr ThreadPool::take(size_t index)
+{
+    while (true)
+    {
+        {
+            auto &own = *workers_[index];
+            std::lock_guard<std::mutex> lg(own.mutex);
+            if (!own.queue.empty())
+            {
+                auto task = std::move(own.queue.front());
+                own.queue.pop_front();
+                return task;
+            }
+        }
+
+        // Steal from the back of other queues, leaving their
+        // owners the oldest tasks.
+        for (size_t i = 1; i < workers_.size(); ++i)
+        {
+            auto &victim = *workers_[(index + i) % workers_.size()];
+            std::lock_guard<std::mutex> lg(victim.mutex);
+            if (!victim.queue.empty())
+            {
+                auto task = std::move(victim.queue.back());
+                victim.queue.pop_back();
+
+                std::lock_guard<std::mutex> stats_lg(mutex_);
+                ++stats_.stolen;
+                return task;
+            }
+        }
+        // Another worker took the task we claimed, but it has claimed
+        // another one that isn't taken yet. Try again.
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,190 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "LeosacFwd.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Leosac
+{
+namespace Tasks
+{
+/**
+ * A fixed-size pool of threads that runs tasks.
+ *
+ * Each worker owns a queue. Tasks enqueued from outside the pool are
+ * distributed over the queues in a round-robin fashion, while tasks
+ * enqueued by a task running in the pool go to the queue of the
+ * current worker. A worker whose queue is empty steals work from the
+ * other queues, so that a long running task doesn't delay the tasks
+ * queued behind it.
+ *
+ * The pool is thread-safe.
+ */
+class ThreadPool
+{
+  public:
+    /**
+     * Some metrics about the pool activity.
+     */
+    struct Stats
+    {
+        /**
+         * Number of worker threads.
+         */
+        size_t threads;
+
+        /**
+         * Number of tasks waiting for a worker.
+         */
+        size_t queued;
+
+        /**
+         * Number of tasks currently running.
+         */
+        size_t running;
+
+        /**
+         * Highest number of tasks that were waiting at the same time.
+         */
+        size_t max_queued;
+
+        /**
+         * Number of tasks that have run to completion.
+         */
+        uint64_t completed;
+
+        /**
+         * Number of tasks that were run by a worker other than the one
+         * they were queued on.
+         */
+        uint64_t stolen;
+
+        /**
+         * Cumulated time spent running tasks.
+         */
+        std::chrono::microseconds total_run_time;
+
+        /**
+         * Run time of the longest task.
+         */
+        std::chrono::microseconds max_run_time;
+    };
+
+    /**
+     * Start the worker threads.
+     *
+     * @param nb_threads number of workers. Must not be 0.
+     */
+    explicit ThreadPool(size_t nb_threads);
+
+    /**
+     * Calls shutdown().
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&)      = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    /**
+     * Queue a task to be run by one of the workers.
+     *
+     * @return false if the pool is shutting down, in which case
+     * the task is not queued.
+     */
+    bool enqueue(TaskPtr task);
+
+    /**
+     * Block until there is no task queued nor running.
+     */
+    void drain();
+
+    /**
+     * Stop accepting new tasks, run the tasks that are already
+     * queued, then join the worker threads.
+     *
+     * Calling this more than once is harmless. This must not be
+     * called from a task running in the pool.
+     */
+    void shutdown();
+
+    Stats stats() const;
+
+  private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<TaskPtr> queue;
+        std::thread thread;
+    };
+
+    void run(size_t index);
+
+    /**
+     * Take a task for the worker at `index`: from its own queue
+     * first, then from the other workers' queues.
+     *
+     * The caller must have claimed a task (see run()), which
+     * guarantees that one is available.
+     */
+    TaskPtr take(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    /**
+     * Round-robin counter used to pick the queue of tasks
+     * enqueued from outside the pool.
+     */
+    size_t next_worker_;
+
+    /**
+     * Protects everything below, as well as next_worker_.
+     */
+    mutable std::mutex mutex_;
+
+    /**
+     * Signaled when tasks are queued, or when the pool shall stop.
+     */
+    std::condition_variable work_cv_;
+
+    /**
+     * Signaled when the pool becomes idle.
+     */
+    std::condition_variable idle_cv_;
+
+    /**
+     * Number of tasks queued and not yet claimed by a worker.
+     */
+    size_t queued_;
+    size_t running_;
+    bool stop_;
+
+    Stats stats_;
+};
+}
+}
@@ -0,0 +1,303 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace Leosac
+{
+namespace Tasks
+{
+/**
+ * A hierarchical timer wheel.
+ *
+ * Time is divided in ticks of a fixed resolution. The wheel has
+ * `LEVELS` levels of `SLOTS` slots each: level 0 holds the timers
+ * expiring within the next `SLOTS` ticks, one slot per tick, and each
+ * slot of level `n` covers `SLOTS` slots of level `n - 1`. When time
+ * reaches the range covered by a slot of an upper level, its timers are
+ * redistributed into the lower levels.
+ *
+ * Adding and cancelling a timer are O(1), and advancing the wheel is
+ * proportional to the elapsed ticks plus the number of timers that moved.
+ *
+ * Timers never expire before their deadline, but they may expire up to
+ * one tick after it.
+ *
+ * This class is not thread-safe.
+ */
+template <typename T>
+class TimerWheel
+{
+  public:
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS     = 1 << SLOT_BITS;
+    static constexpr int LEVELS    = 4;
+
+    explicit TimerWheel(
+        std::chrono::milliseconds resolution = std::chrono::milliseconds(10),
+        TimePoint origin = Clock::now())
+        : resolution_(resolution)
+        , origin_(origin)
+        , current_tick_(0)
+        , next_id_(1)
+    {
+    }
+
+    /**
+     * Add a timer.
+     *
+     * @return an id that can be passed to cancel(). Ids are never 0.
+     */
+    uint64_t add(TimePoint deadline, T value)
+    {
+        uint64_t id = next_id_++;
+        auto &entry = entries_[id];
+        entry.deadline = deadline;
+        entry.tick     = tick_of(deadline);
+        entry.value    = std::move(value);
+        insert(id, entry.tick);
+        return id;
+    }
+
+    /**
+     * Cancel a timer.
+     *
+     * @return false if no such timer is pending (it already expired,
+     * or was cancelled).
+     */
+    bool cancel(uint64_t id)
+    {
+        // Stale ids are skipped when their slot is processed.
+        return entries_.erase(id) != 0;
+    }
+
+    /**
+     * Move the wheel forward to `now`, appending the values of the
+     * timers that expired to `expired`.
+     */
+    void advance(TimePoint now, std::vector<T> &expired)
+    {
+        if (now < origin_)
+            return;
+        uint64_t target = (now - origin_) / resolution_;
+
+        if (entries_.empty())
+        {
+            // Nothing to expire: the wheel can jump ahead,
+            // as long as all slots are empty.
+            clear_slots();
+            current_tick_ = std::max(current_tick_, target + 1);
+            return;
+        }
+
+        while (current_tick_ <= target)
+        {
+            cascade();
+
+            if (level_empty(0))
+            {
+                // Nothing can expire before the next redistribution.
+                uint64_t boundary = (current_tick_ | (SLOTS - 1)) + 1;
+                current_tick_     = std::min(boundary, target + 1);
+                continue;
+            }
+
+            auto &slot = slots_[0][current_tick_ % SLOTS];
+            auto ids   = std::move(slot);
+            slot.clear();
+            ++current_tick_;
+
+            for (auto id : ids)
+            {
+                auto itr = entries_.find(id);
+                if (itr == entries_.end())
+                    continue;
+                if (itr->second.deadline > now)
+                {
+                    // Deadline beyond the range of the wheel. Reinsert it.
+                    itr->second.tick = tick_of(itr->second.deadline);
+                    insert(id, itr->second.tick);
+                    continue;
+                }
+                expired.push_back(std::move(itr->second.value));
+                entries_.erase(itr);
+            }
+        }
+        // Keep the upper levels' current slots redistributed, as
+        // next_expiry() expects.
+        cascade();
+    }
+
+    /**
+     * The time at which advance() next needs to be called.
+     *
+     * This is either the expiration of a timer, or the time at which
+     * timers of an upper level need to be redistributed. Returns
+     * `TimePoint::max()` if there is no timer.
+     */
+    TimePoint next_expiry() const
+    {
+        if (entries_.empty())
+            return TimePoint::max();
+
+        // Slots of an upper level may need to be redistributed before
+        // the timers of a lower level expire: check them all.
+        uint64_t next = std::numeric_limits<uint64_t>::max();
+        for (int level = 0; level < LEVELS; ++level)
+        {
+            int shift     = level * SLOT_BITS;
+            uint64_t base = current_tick_ >> shift;
+
+            // At level 0, the current slot is the next one to expire.
+            // Above, the current slot has already been redistributed, and
+            // holds timers for the next round.
+            int first = level == 0 ? 0 : 1;
+            for (int i = first; i < first + SLOTS; ++i)
+            {
+                if (has_live_entry(slots_[level][(base + i) % SLOTS]))
+                {
+                    next = std::min(next, (base + i) << shift);
+                    break;
+                }
+            }
+        }
+        if (next == std::numeric_limits<uint64_t>::max())
+            return TimePoint::max();
+        return origin_ + resolution_ * next;
+    }
+
+    size_t size() const
+    {
+        return entries_.size();
+    }
+
+    bool empty() const
+    {
+        return entries_.empty();
+    }
+
+  private:
+    struct Entry
+    {
+        TimePoint deadline;
+        uint64_t tick;
+        T value;
+    };
+
+    /**
+     * First tick that is not before `deadline`.
+     */
+    uint64_t tick_of(TimePoint deadline) const
+    {
+        if (deadline <= origin_)
+            return 0;
+        auto elapsed = deadline - origin_;
+        uint64_t tick = elapsed / resolution_;
+        if (resolution_ * tick < elapsed)
+            ++tick;
+        return tick;
+    }
+
+    void insert(uint64_t id, uint64_t tick)
+    {
+        static constexpr uint64_t max_delta = (uint64_t(1) << (LEVELS * SLOT_BITS)) - 1;
+
+        tick           = std::max(tick, current_tick_);
+        uint64_t delta = std::min(tick - current_tick_, max_delta);
+        tick           = current_tick_ + delta;
+
+        int level = 0;
+        while (level < LEVELS - 1 &&
+               delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS)))
+            ++level;
+        slots_[level][(tick >> (level * SLOT_BITS)) % SLOTS].push_back(id);
+    }
+
+    /**
+     * Redistribute the timers of the upper levels' slots whose
+     * range starts at the current tick.
+     */
+    void cascade()
+    {
+        for (int level = LEVELS - 1; level > 0; --level)
+        {
+            int shift = level * SLOT_BITS;
+            if (current_tick_ % (uint64_t(1) << shift))
+                continue;
+
+            auto &slot = slots_[level][(current_tick_ >> shift) % SLOTS];
+            auto ids   = std::move(slot);
+            slot.clear();
+            for (auto id : ids)
+            {
+                auto itr = entries_.find(id);
+                if (itr != entries_.end())
+                    insert(id, itr->second.tick);
+            }
+        }
+    }
+
+    bool has_live_entry(const std::vector<uint64_t> &slot) const
+    {
+        return std::any_of(slot.begin(), slot.end(), [&](uint64_t id) {
+            return entries_.count(id) != 0;
+        });
+    }
+
+    bool level_empty(int level) const
+    {
+        return std::all_of(slots_[level].begin(), slots_[level].end(),
+                           [](const std::vector<uint64_t> &slot) {
+                               return slot.empty();
+                           });
+    }
+
+    void clear_slots()
+    {
+        for (auto &level : slots_)
+            for (auto &slot : level)
+                slot.clear();
+    }
+
+    std::chrono::milliseconds resolution_;
+    TimePoint origin_;
+
+    /**
+     * The next tick to process.
+     */
+    uint64_t current_tick_;
+
+    uint64_t next_id_;
+
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::array<std::array<std::vector<uint64_t>, SLOTS>, LEVELS> slots_;
+};
+}
+}
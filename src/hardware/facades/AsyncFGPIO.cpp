@@ -0,0 +1,50 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AsyncFGPIO.hpp"
+
+using namespace Leosac::Hardware;
+
+void AsyncFGPIO::turnOn(std::chrono::milliseconds duration, CompletionCallback cb)
+{
+    zmqpp::message msg;
+    msg << "ON" << duration.count();
+    send_command(msg, std::move(cb));
+}
+
+void AsyncFGPIO::turnOn(CompletionCallback cb)
+{
+    zmqpp::message msg;
+    msg << "ON";
+    send_command(msg, std::move(cb));
+}
+
+void AsyncFGPIO::turnOff(CompletionCallback cb)
+{
+    zmqpp::message msg;
+    msg << "OFF";
+    send_command(msg, std::move(cb));
+}
+
+void AsyncFGPIO::toggle(CompletionCallback cb)
+{
+    zmqpp::message msg;
+    msg << "TOGGLE";
+    send_command(msg, std::move(cb));
+}
@@ -0,0 +1,60 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AsyncFacade.hpp"
+
+namespace Leosac
+{
+namespace Hardware
+{
+
+/**
+* Non-blocking counterpart of FGPIO.
+*
+* @see AsyncFacade for the integration with the owner's reactor.
+*/
+class AsyncFGPIO : public AsyncFacade
+{
+  public:
+    using AsyncFacade::AsyncFacade;
+
+    /**
+    * Turn the GPIO ON and turn it OFF duration milliseconds later.
+    */
+    void turnOn(std::chrono::milliseconds duration, CompletionCallback cb = nullptr);
+
+    /**
+    * Turn the GPIO ON.
+    */
+    void turnOn(CompletionCallback cb = nullptr);
+
+    /**
+    * Turn the GPIO OFF.
+    */
+    void turnOff(CompletionCallback cb = nullptr);
+
+    /**
+    * Toggle the GPIO value.
+    */
+    void toggle(CompletionCallback cb = nullptr);
+};
+}
+}
@@ -0,0 +1,74 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AsyncFacade.hpp"
+
+namespace Leosac
+{
+namespace Hardware
+{
+
+/**
+* Non-blocking counterpart of FLED.
+*
+* Commands return immediately. Their outcome is reported through the
+* optional completion callback, from the reactor the facade is registered in.
+*
+* @see AsyncFacade for the integration with the owner's reactor.
+*/
+class AsyncFLED : public AsyncFacade
+{
+  public:
+    using AsyncFacade::AsyncFacade;
+
+    /**
+    * Turn the LED ON and turn it OFF duration milliseconds later.
+    */
+    void turnOn(std::chrono::milliseconds duration, CompletionCallback cb = nullptr);
+
+    /**
+    * Turn the LED ON.
+    */
+    void turnOn(CompletionCallback cb = nullptr);
+
+    /**
+    * Turn the LED OFF.
+    */
+    void turnOff(CompletionCallback cb = nullptr);
+
+    /**
+    * Toggle the LED value.
+    */
+    void toggle(CompletionCallback cb = nullptr);
+
+    /**
+    * Make the LED blink, using the device's default duration and speed.
+    */
+    void blink(CompletionCallback cb = nullptr);
+
+    /**
+    * Blink with a duration and a speed.
+    */
+    void blink(std::chrono::milliseconds duration, std::chrono::milliseconds speed,
+               CompletionCallback cb = nullptr);
+};
+}
+}
@@ -0,0 +1,128 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AsyncFacade.hpp"
+#include "tools/log.hpp"
+#include <cstring>
+
+using namespace Leosac::Hardware;
+
+AsyncFacade::AsyncFacade(zmqpp::context &ctx, const std::string &device_name,
+                         std::chrono::milliseconds timeout)
+    : name_(device_name)
+    , timeout_(timeout)
+    , backend_(ctx, zmqpp::socket_type::dealer)
+    , next_id_(0)
+{
+    backend_.connect("inproc://" + name_);
+}
+
+void AsyncFacade::send(zmqpp::message &cmd, ReplyCallback cb)
+{
+    uint64_t id = next_id_++;
+
+    cmd.push_front("");
+    cmd.push_front(&id, sizeof(id));
+    if (!backend_.send(cmd, true))
+    {
+        WARN("Cannot send command to device " << name_ << ": its queue is full.");
+        if (cb)
+            cb(nullptr);
+        return;
+    }
+    pending_[id] = PendingCommand{std::chrono::steady_clock::now() + timeout_,
+                                  std::move(cb)};
+}
+
+void AsyncFacade::send_command(zmqpp::message &cmd, CompletionCallback cb)
+{
+    send(cmd, [cb](zmqpp::message *reply) {
+        if (!cb)
+            return;
+        std::string status;
+        if (reply && reply->parts())
+            reply->get(status, 0);
+        cb(status == "OK");
+    });
+}
+
+void AsyncFacade::register_sockets(zmqpp::reactor *reactor)
+{
+    reactor->add(backend_, std::bind(&AsyncFacade::handle_reply, this));
+}
+
+void AsyncFacade::handle_reply()
+{
+    zmqpp::message reply;
+    while (backend_.receive(reply, true))
+    {
+        uint64_t id;
+        if (reply.parts() < 2 || reply.size(0) != sizeof(id))
+        {
+            WARN("Malformed reply from device " << name_);
+            continue;
+        }
+        std::memcpy(&id, reply.raw_data(0), sizeof(id));
+
+        auto itr = pending_.find(id);
+        if (itr == pending_.end())
+        {
+            DEBUG("Dropping late reply from device " << name_);
+            continue;
+        }
+        // The callback may send more commands.
+        auto cb = std::move(itr->second.callback);
+        pending_.erase(itr);
+
+        reply.pop_front();
+        reply.pop_front();
+        if (cb)
+            cb(&reply);
+    }
+}
+
+void AsyncFacade::check_timeouts(const std::chrono::steady_clock::time_point &now)
+{
+    while (!pending_.empty() && pending_.begin()->second.deadline <= now)
+    {
+        auto cb = std::move(pending_.begin()->second.callback);
+        pending_.erase(pending_.begin());
+
+        WARN("Command to device " << name_ << " timed out.");
+        if (cb)
+            cb(nullptr);
+    }
+}
+
+std::chrono::steady_clock::time_point AsyncFacade::next_timeout() const
+{
+    if (pending_.empty())
+        return std::chrono::steady_clock::time_point::max();
+    return pending_.begin()->second.deadline;
+}
+
+size_t AsyncFacade::pending() const
+{
+    return pending_.size();
+}
+
+const std::string &AsyncFacade::name() const
+{
+    return name_;
+}
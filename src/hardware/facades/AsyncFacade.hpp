@@ -0,0 +1,149 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <zmqpp/message.hpp>
+#include <zmqpp/reactor.hpp>
+#include <zmqpp/socket.hpp>
+
+namespace Leosac
+{
+namespace Hardware
+{
+
+/**
+* Base class for non-blocking facades.
+*
+* Synchronous facades (FGPIO, FLED, ...) use a REQ socket and wait for the
+* device's reply before returning, which stalls the caller's reactor for a
+* whole round trip. This class instead talks to the device through a DEALER
+* socket: commands are sent immediately, multiple commands can be in flight
+* at the same time, and the device's replies are correlated to their command
+* using a request id.
+*
+* Each command is sent as `[request id] [""] [command frames...]`. The empty
+* delimiter frame lets REP and ROUTER based device implementations process the
+* request unmodified; they echo the id back with their response.
+*
+* The facade must be registered in the reactor of its owner
+* (see register_sockets()), which then invokes completion callbacks from its
+* own thread. The owner must also call check_timeouts() regularly (typically
+* after each poll) so that commands whose reply never comes are completed
+* with a timeout.
+*/
+class AsyncFacade
+{
+  public:
+    /**
+    * Called with the device's reply, or with `nullptr` if the command timed out.
+    */
+    using ReplyCallback = std::function<void(zmqpp::message *reply)>;
+
+    /**
+    * Called with true if the device replied "OK", false if it replied
+    * something else or if the command timed out.
+    */
+    using CompletionCallback = std::function<void(bool success)>;
+
+    /**
+    * @param ctx ZMQ context.
+    * @param device_name name of the device to talk to.
+    * @param timeout how long to wait for a reply before giving up on a command.
+    */
+    AsyncFacade(zmqpp::context &ctx, const std::string &device_name,
+                std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+
+    virtual ~AsyncFacade() = default;
+
+    AsyncFacade(const AsyncFacade &) = delete;
+    AsyncFacade &operator=(const AsyncFacade &) = delete;
+
+    /**
+    * Send a command to the device, without waiting for its reply.
+    *
+    * @param cmd the command frames. The message is consumed.
+    * @param cb invoked when the reply arrives or when the command times out.
+    *        May be empty.
+    */
+    void send(zmqpp::message &cmd, ReplyCallback cb);
+
+    /**
+    * Send a command whose reply is a simple "OK" / "KO".
+    */
+    void send_command(zmqpp::message &cmd, CompletionCallback cb = nullptr);
+
+    /**
+    * Register the facade's socket into the owner's reactor.
+    */
+    void register_sockets(zmqpp::reactor *reactor);
+
+    /**
+    * Complete the commands whose deadline is reached with a timeout.
+    */
+    void check_timeouts(const std::chrono::steady_clock::time_point &now);
+
+    /**
+    * Deadline of the oldest command in flight, or `time_point::max()` if
+    * there is none.
+    */
+    std::chrono::steady_clock::time_point next_timeout() const;
+
+    /**
+    * Number of commands waiting for a reply.
+    */
+    size_t pending() const;
+
+    const std::string &name() const;
+
+  private:
+    /**
+    * Replies are available on the backend socket.
+    */
+    void handle_reply();
+
+    struct PendingCommand
+    {
+        std::chrono::steady_clock::time_point deadline;
+        ReplyCallback callback;
+    };
+
+    std::string name_;
+    std::chrono::milliseconds timeout_;
+
+    /**
+    * DEALER socket connected to the device.
+    */
+    zmqpp::socket backend_;
+
+    uint64_t next_id_;
+
+    /**
+    * Commands in flight, by request id. Ids are increasing, so the
+    * oldest command comes first.
+    */
+    std::map<uint64_t, PendingCommand> pending_;
+};
+}
+}
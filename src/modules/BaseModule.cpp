@@ -38,12 +38,22 @@ BaseModule::BaseModule(zmqpp::context &ctx, zmqpp::socket *pipe,
     , utils_(utils)
     , is_running_(true)
     , control_(ctx, zmqpp::socket_type::rep)
+    , timer_sock_(ctx, zmqpp::socket_type::pull)
+    , next_timer_id_(0)
 {
     name_ = cfg.get<std::string>("name");
     control_.bind("inproc://module-" + name_);
+    timer_sock_.bind("inproc://module-" + name_ + "-timers");
 
     reactor_.add(control_, std::bind(&BaseModule::handle_control, this));
     reactor_.add(pipe_, std::bind(&BaseModule::handle_pipe, this));
+    reactor_.add(timer_sock_, std::bind(&BaseModule::handle_timer, this));
+}
+
+BaseModule::~BaseModule()
+{
+    for (const auto &timer : timers_)
+        utils_->scheduler().cancel(timer.second.handle);
 }
 
 CoreUtilsPtr BaseModule::utils() const
@@ -130,6 +140,58 @@ void BaseModule::handle_control()
     }
 }
 
+uint64_t BaseModule::schedule_after(std::chrono::milliseconds delay,
+                                    std::function<void()> callback)
+{
+    uint64_t id          = next_timer_id_++;
+    zmqpp::context *ctx  = &ctx_;
+    std::string endpoint = "inproc://module-" + name_ + "-timers";
+
+    // The task runs on the pool, and only notifies the module's thread.
+    auto handle = utils_->scheduler().enqueue_after(
+        delay,
+        [ctx, endpoint, id]() {
+            zmqpp::socket sock(*ctx, zmqpp::socket_type::push);
+            // The module may be gone already.
+            sock.set(zmqpp::socket_option::linger, 0);
+            sock.connect(endpoint);
+            zmqpp::message msg;
+            msg << id;
+            return sock.send(msg, true);
+        },
+        TargetThread::POOL);
+    timers_[id] = ModuleTimer{handle, std::move(callback)};
+    return id;
+}
+
+bool BaseModule::cancel_timer(uint64_t timer_id)
+{
+    auto itr = timers_.find(timer_id);
+    if (itr == timers_.end())
+        return false;
+    // Even if the notification is already on its way, the callback won't
+    // be invoked once removed from the map.
+    utils_->scheduler().cancel(itr->second.handle);
+    timers_.erase(itr);
+    return true;
+}
+
+void BaseModule::handle_timer()
+{
+    zmqpp::message msg;
+    uint64_t id;
+
+    timer_sock_.receive(msg);
+    msg >> id;
+
+    auto itr = timers_.find(id);
+    if (itr == timers_.end())
+        return;
+    auto callback = std::move(itr->second.callback);
+    timers_.erase(itr);
+    callback();
+}
+
 void BaseModule::dump_additional_config(zmqpp::message *) const
 {
 }
@@ -22,6 +22,7 @@
 #include "LeosacFwd.hpp"
 #include "core/config/ConfigChecker.hpp"
 #include "core/config/ConfigManager.hpp"
+#include "core/Scheduler.hpp"
 #include "tools/ThreadUtils.hpp"
 #include "tools/log.hpp"
 #include <boost/property_tree/ptree.hpp>
@@ -116,7 +117,10 @@ class BaseModule
     BaseModule(zmqpp::context &ctx, zmqpp::socket *pipe,
                const boost::property_tree::ptree &cfg, CoreUtilsPtr utils);
 
-    virtual ~BaseModule() = default;
+    /**
+    * Cancel the timers that are still pending.
+    */
+    virtual ~BaseModule();
 
     /**
     * This is the main loop of the module. It should only exit when receiving
@@ -142,6 +146,25 @@ class BaseModule
     */
     virtual void handle_control();
 
+    /**
+    * Invoke `callback` from the module's thread once `delay` has elapsed.
+    *
+    * The delay is tracked by the Scheduler's timers, which wake the
+    * module's reactor up when the timer expires. This spares the module
+    * from polling periodically to check for its deadlines.
+    *
+    * @return an id that can be passed to cancel_timer().
+    */
+    uint64_t schedule_after(std::chrono::milliseconds delay,
+                            std::function<void()> callback);
+
+    /**
+    * Cancel a timer set by schedule_after().
+    *
+    * @return false if the timer already expired or was cancelled.
+    */
+    bool cancel_timer(uint64_t timer_id);
+
     /**
     * Dump additional configuration (for example module specific
     * config file).
@@ -216,6 +239,28 @@ class BaseModule
     zmqpp::reactor reactor_;
 
     std::string name_;
+
+  private:
+    /**
+    * A timer has expired.
+    */
+    void handle_timer();
+
+    struct ModuleTimer
+    {
+        TimerHandle handle;
+        std::function<void()> callback;
+    };
+
+    /**
+    * PULL socket bound to inproc://module-${MODULE_NAME}-timers, on which
+    * the scheduler notifies us of expired timers.
+    */
+    zmqpp::socket timer_sock_;
+
+    std::map<uint64_t, ModuleTimer> timers_;
+
+    uint64_t next_timer_id_;
 };
 }
 }
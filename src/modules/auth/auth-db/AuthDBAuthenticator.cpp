@@ -0,0 +1,127 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "modules/auth/auth-db/AuthDBAuthenticator.hpp"
+#include "core/CoreUtils.hpp"
+#include "core/SecurityContext.hpp"
+#include "core/audit/AsyncAuditWriter.hpp"
+#include "core/audit/AuditFactory.hpp"
+#include "core/audit/IAuthEvent.hpp"
+#include "core/auth/Auth.hpp"
+#include "core/auth/AuthSourceBuilder.hpp"
+#include "core/credentials/serializers/PolymorphicCredentialSerializer.hpp"
+#include "exception/ExceptionsTools.hpp"
+#include "tools/Colorize.hpp"
+#include "tools/log.hpp"
+#include "tools/service/ServiceRegistry.hpp"
+#include <boost/algorithm/string/join.hpp>
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+
+AuthDBAuthenticator::AuthDBAuthenticator(
+    zmqpp::context &ctx, const std::string &name,
+    const std::list<std::string> &auth_sources_names, const std::string &door_alias,
+    PolicyCachePtr policy_cache, CoreUtilsPtr core_utils)
+    : bus_push_(ctx, zmqpp::socket_type::push)
+    , bus_sub_(ctx, zmqpp::socket_type::sub)
+    , name_(name)
+    , door_alias_(door_alias)
+    , policy_cache_(policy_cache)
+    , core_utils_(core_utils)
+{
+    bus_push_.connect("inproc://zmq-bus-pull");
+    bus_sub_.connect("inproc://zmq-bus-pub");
+
+    INFO("AuthDB instance (" << name_ << ") subscribe to "
+                             << boost::algorithm::join(auth_sources_names, ", "));
+    for (const auto &auth_source : auth_sources_names)
+        bus_sub_.subscribe("S_" + auth_source);
+}
+
+zmqpp::socket &AuthDBAuthenticator::bus_sub()
+{
+    return bus_sub_;
+}
+
+void AuthDBAuthenticator::handle_bus_msg()
+{
+    zmqpp::message msg;
+    zmqpp::message auth_result_msg;
+
+    bus_sub_.receive(msg);
+
+    auth_result_msg << ("S_" + name_);
+    if (handle_auth(&msg))
+        auth_result_msg << Leosac::Auth::AccessStatus::GRANTED;
+    else
+        auth_result_msg << Leosac::Auth::AccessStatus::DENIED;
+    bus_push_.send(auth_result_msg);
+}
+
+bool AuthDBAuthenticator::handle_auth(zmqpp::message *msg) noexcept
+{
+    bool granted = false;
+    try
+    {
+        auto policy = policy_cache_->policy();
+
+        Leosac::Auth::AuthSourceBuilder build;
+        Cred::ICredentialPtr auth_source = build.create(msg);
+        ASSERT_LOG(auth_source, "Failed to build credential.");
+
+        auto door     = policy->door_id(door_alias_);
+        auto decision = policy->check(*auth_source, door,
+                                      std::chrono::system_clock::now());
+        granted       = decision.granted;
+        // The credential built from the message is not the one from the
+        // database. Give it the id of the matching credential so that the
+        // audit entry refers to it.
+        if (decision.credential)
+            auth_source->id(decision.credential);
+
+        if (!door)
+            WARN("AuthDB instance " << name_ << ": unknown door " << door_alias_);
+        auto status =
+            granted ? Colorize::green("GRANTED") : Colorize::red("DENIED");
+        INFO(Colorize::bold(name_)
+             << " " << status
+             << " access to door " << Colorize::underline(door_alias_)
+             << " for credential "
+             << PolymorphicCredentialJSONStringSerializer::serialize(
+                    *auth_source, SystemSecurityContext::instance())
+             << " (credential id " << decision.credential << ", user id "
+             << decision.user << ")");
+
+        auto writer =
+            core_utils_->service_registry().get_service<Audit::AsyncAuditWriter>();
+        ASSERT_LOG(writer, "No AsyncAuditWriter service.");
+        auto audit = Audit::Factory::DetachedAuthEvent(core_utils_->database(),
+                                                       auth_source, door_alias_);
+        audit->event_mask(granted ? Audit::EventType::AUTH_GRANTED
+                                  : Audit::EventType::AUTH_DENIED);
+        writer->enqueue(audit);
+    }
+    catch (std::exception &e)
+    {
+        WARN("Exception when handling authentication request.");
+        log_exception(e);
+    }
+    return granted;
+}
@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "LeosacFwd.hpp"
+#include "modules/auth/auth-db/PolicyCache.hpp"
+#include <list>
+#include <memory>
+#include <string>
+#include <zmqpp/zmqpp.hpp>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+/**
+ * Answers the authentication requests of some sources, for a door,
+ * using the policy compiled from the database.
+ *
+ * Requests are evaluated against the current snapshot of the policy
+ * (see PolicyCache), without querying the database.
+ *
+ * This class is for INTERNAL use only (by AuthDBModule).
+ */
+class AuthDBAuthenticator
+{
+  public:
+    /**
+     * @param ctx the ZeroMQ context
+     * @param name name of this authentication context.
+     * @param auth_sources_names names of the sources devices we watch
+     *        (ie wiegand reader).
+     * @param door_alias alias of the door, in the database, that
+     *        access is checked against.
+     * @param policy_cache the policy shared by all authenticators.
+     * @param core_utils Core utilities
+     */
+    AuthDBAuthenticator(zmqpp::context &ctx, const std::string &name,
+                        const std::list<std::string> &auth_sources_names,
+                        const std::string &door_alias, PolicyCachePtr policy_cache,
+                        CoreUtilsPtr core_utils);
+
+    AuthDBAuthenticator(const AuthDBAuthenticator &) = delete;
+    AuthDBAuthenticator &operator=(const AuthDBAuthenticator &) = delete;
+
+    /**
+     * Something happened on the bus that we have interest into.
+     */
+    void handle_bus_msg();
+
+    /**
+     * Returns the socket subscribed to the message bus.
+     */
+    zmqpp::socket &bus_sub();
+
+  private:
+    /**
+     * Build the credential from the message and check it.
+     *
+     * @note This is a `noexcept` method. Will return false in case
+     * something went wrong.
+     */
+    bool handle_auth(zmqpp::message *msg) noexcept;
+
+    zmqpp::socket bus_push_;
+    zmqpp::socket bus_sub_;
+
+    std::string name_;
+    std::string door_alias_;
+
+    PolicyCachePtr policy_cache_;
+    CoreUtilsPtr core_utils_;
+};
+using AuthDBAuthenticatorPtr = std::shared_ptr<AuthDBAuthenticator>;
+}
+}
+}
@@ -19,7 +19,9 @@
 
 #include "modules/auth/auth-db/AuthDBModule.hpp"
 #include "core/CoreUtils.hpp"
+#include "core/Scheduler.hpp"
 #include "core/kernel.hpp"
+#include "tools/log.hpp"
 #include <tools/db/database.hpp>
 
 using namespace Leosac;
@@ -29,14 +31,21 @@ AuthDBModule::AuthDBModule(zmqpp::context &ctx, zmqpp::socket *pipe,
                            const boost::property_tree::ptree &cfg,
                            CoreUtilsPtr utils)
     : AsioModule(ctx, pipe, cfg, utils)
+    , kernel_sub_(ctx, zmqpp::socket_type::sub)
+    , refresh_interval_(5000)
+    , refresh_timer_(io_service_)
 {
     process_config();
 
-    /*   for (auto authenticator : authenticators_)
-       {
-           reactor_.add(authenticator->bus_sub(),
-                        std::bind(&AuthDBInstance::handle_bus_msg, authenticator));
-       }*/
+    kernel_sub_.connect("inproc://zmq-bus-pub");
+    kernel_sub_.subscribe("KERNEL");
+    reactor_.add(kernel_sub_, std::bind(&AuthDBModule::handle_kernel_message, this));
+
+    for (auto authenticator : authenticators_)
+    {
+        reactor_.add(authenticator->bus_sub(),
+                     std::bind(&AuthDBAuthenticator::handle_bus_msg, authenticator));
+    }
 }
 
 AuthDBModule::~AuthDBModule()
@@ -46,6 +55,74 @@ AuthDBModule::~AuthDBModule()
 void AuthDBModule::process_config()
 {
     setup_database();
+
+    auto module_config = config_.get_child_optional("module_config");
+    if (!module_config)
+        return;
+
+    refresh_interval_ = std::chrono::milliseconds(
+        module_config->get<int>("refresh_interval", refresh_interval_.count()));
+
+    policy_cache_ = std::make_shared<PolicyCache>(utils_->database());
+    try
+    {
+        policy_cache_->refresh();
+    }
+    catch (const odb::exception &e)
+    {
+        WARN("Failed to load the AuthDB policy. Will retry in "
+             << refresh_interval_.count() << "ms. Error was: " << e.what());
+    }
+    schedule_refresh();
+
+    if (auto instances = module_config->get_child_optional("instances"))
+    {
+        for (auto &node : *instances)
+        {
+            const auto &auth_instance_cfg = node.second;
+            auto auth_ctx_name = auth_instance_cfg.get<std::string>("name");
+            auto door_alias    = auth_instance_cfg.get<std::string>("door");
+            std::list<std::string> auth_sources_names;
+
+            for (const auto &subnode : auth_instance_cfg)
+            {
+                if (subnode.first == "auth_source")
+                    auth_sources_names.push_back(subnode.second.data());
+            }
+
+            INFO("Creating AuthDB instance " << auth_ctx_name
+                                             << ". Target door = " << door_alias);
+            authenticators_.push_back(std::make_shared<AuthDBAuthenticator>(
+                ctx_, auth_ctx_name, auth_sources_names, door_alias, policy_cache_,
+                utils_));
+        }
+    }
+}
+
+void AuthDBModule::schedule_refresh()
+{
+    refresh_timer_.expires_from_now(refresh_interval_);
+    refresh_timer_.async_wait([this](const boost::system::error_code &ec) {
+        if (ec)
+            return;
+        // The database is queried on the scheduler's thread pool, so
+        // that authentication requests are not delayed.
+        policy_cache_->schedule_refresh(utils_->scheduler());
+        schedule_refresh();
+    });
+}
+
+void AuthDBModule::handle_kernel_message()
+{
+    zmqpp::message msg;
+    std::string tmp;
+
+    kernel_sub_.receive(msg);
+    msg >> tmp; // KERNEL
+    msg >> tmp;
+    // The policy is shared by all authenticators: refresh it once.
+    if (tmp == "SIGHUP" && policy_cache_)
+        policy_cache_->schedule_refresh(utils_->scheduler());
 }
 
 void AuthDBModule::on_service_event(const service_event::Event &)
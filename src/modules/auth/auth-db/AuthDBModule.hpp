@@ -20,7 +20,10 @@
 #pragma once
 
 #include "modules/AsioModule.hpp"
+#include "modules/auth/auth-db/AuthDBAuthenticator.hpp"
+#include "modules/auth/auth-db/PolicyCache.hpp"
 #include <boost/property_tree/ptree.hpp>
+#include <chrono>
 #include <vector>
 #include <zmqpp/zmqpp.hpp>
 
@@ -35,6 +38,9 @@ class AuthDBInstance;
 /**
 * This implements a authentication module that uses Leosac database
 * to validate access.
+*
+* Decisions are made from a policy compiled in memory (see PolicyCache),
+* that is periodically synchronized with the database.
 */
 class AuthDBModule : public AsioModule
 {
@@ -54,10 +60,32 @@ class AuthDBModule : public AsioModule
 
     void setup_database();
 
+    /**
+     * Schedule a refresh of the policy, and rearm the timer.
+     */
+    void schedule_refresh();
+
+    /**
+     * Refresh the policy when the kernel sends SIGHUP.
+     */
+    void handle_kernel_message();
+
+    PolicyCachePtr policy_cache_;
+
+    zmqpp::socket kernel_sub_;
+
     /**
     * Authenticator instance.
     */
-    // std::vector<AuthDBInstancePtr> authenticators_;
+    std::vector<AuthDBAuthenticatorPtr> authenticators_;
+
+    /**
+     * Delay between two synchronization of the policy with
+     * the database.
+     */
+    std::chrono::milliseconds refresh_interval_;
+
+    boost::asio::steady_timer refresh_timer_;
 };
 }
 }
@@ -0,0 +1,116 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "core/auth/AuthFwd.hpp"
+#include "core/credentials/CredentialFwd.hpp"
+#include "tools/ToolsFwd.hpp"
+#include <cstddef>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+/**
+ * Views that return the id and the optimistic concurrency version of
+ * every object the policy is compiled from.
+ *
+ * Every update of an object bumps its version, so comparing these
+ * against the versions that were loaded tells which objects must be
+ * reloaded, without loading them.
+ */
+
+#pragma db view object(Leosac::Auth::User)
+struct UserVersion
+{
+#pragma db column(Leosac::Auth::User::id_)
+    Leosac::Auth::UserId id;
+#pragma db column(Leosac::Auth::User::version_)
+    std::size_t version;
+};
+
+#pragma db view object(Leosac::Auth::UserGroupMembership)
+struct MembershipVersion
+{
+#pragma db column(Leosac::Auth::UserGroupMembership::id_)
+    Leosac::Auth::UserGroupMembershipId id;
+#pragma db column(Leosac::Auth::UserGroupMembership::version_)
+    std::size_t version;
+};
+
+#pragma db view object(Leosac::Cred::Credential)
+struct CredentialVersion
+{
+#pragma db column(Leosac::Cred::Credential::id_)
+    Leosac::Cred::CredentialId id;
+#pragma db column(Leosac::Cred::Credential::odb_version_)
+    std::size_t version;
+};
+
+#pragma db view object(Leosac::Tools::Schedule)
+struct ScheduleVersion
+{
+#pragma db column(Leosac::Tools::Schedule::id_)
+    Leosac::Tools::ScheduleId id;
+#pragma db column(Leosac::Tools::Schedule::odb_version_)
+    std::size_t version;
+};
+
+#pragma db view object(Leosac::Tools::ScheduleMapping)
+struct ScheduleMappingVersion
+{
+#pragma db column(Leosac::Tools::ScheduleMapping::id_)
+    Leosac::Tools::ScheduleMappingId id;
+#pragma db column(Leosac::Tools::ScheduleMapping::odb_version_)
+    std::size_t version;
+};
+
+#pragma db view object(Leosac::Auth::Door)
+struct DoorVersion
+{
+#pragma db column(Leosac::Auth::Door::id_)
+    Leosac::Auth::DoorId id;
+#pragma db column(Leosac::Auth::Door::version_)
+    std::size_t version;
+};
+
+#pragma db view object(Leosac::Auth::Zone)
+struct ZoneVersion
+{
+#pragma db column(Leosac::Auth::Zone::id_)
+    Leosac::Auth::ZoneId id;
+#pragma db column(Leosac::Auth::Zone::version_)
+    std::size_t version;
+};
+}
+}
+}
+
+#ifdef ODB_COMPILER
+#include "core/auth/Door.hpp"
+#include "core/auth/User.hpp"
+#include "core/auth/UserGroupMembership.hpp"
+#include "core/auth/Zone.hpp"
+#include "core/credentials/Credential.hpp"
+#include "tools/Schedule.hpp"
+#include "tools/ScheduleMapping.hpp"
+#endif
@@ -0,0 +1,250 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "modules/auth/auth-db/CompiledPolicy.hpp"
+#include "core/credentials/IPinCode.hpp"
+#include "core/credentials/IRFIDCard.hpp"
+#include "core/credentials/PinCode.hpp"
+#include "core/credentials/RFIDCard.hpp"
+#include "core/credentials/RFIDCardPin.hpp"
+#include "tools/ScheduleBitmap.hpp"
+#include <algorithm>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <iterator>
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+
+using Leosac::Auth::DoorId;
+using Leosac::Auth::UserId;
+using Leosac::Auth::ZoneId;
+
+namespace
+{
+template <typename T>
+std::vector<T> sorted(std::vector<T> v)
+{
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+template <typename T>
+bool contains(const std::vector<T> &sorted_vector, const T &value)
+{
+    return std::binary_search(sorted_vector.begin(), sorted_vector.end(), value);
+}
+
+bool is_valid_at(const Leosac::Auth::ValidityInfo &validity,
+                 const std::chrono::system_clock::time_point &tp)
+{
+    return validity.is_enabled() && tp >= validity.start() && tp <= validity.end();
+}
+
+/**
+ * Card ids are hexadecimal: ignore case.
+ */
+std::string normalize_card_id(const std::string &card_id)
+{
+    return boost::algorithm::to_lower_copy(card_id);
+}
+}
+
+CompiledPolicy::CompiledPolicy()
+{
+}
+
+CompiledPolicy::CompiledPolicy(const PolicyData &data)
+{
+    for (const auto &door : data.doors)
+    {
+        doors_[door.second] = door.first;
+        door_rules_[door.first];
+    }
+
+    for (const auto &user : data.users)
+        users_[user.first] = user.second.validity;
+
+    for (const auto &membership : data.memberships)
+        user_groups_[membership.second.user].push_back(membership.second.group);
+    for (auto &groups : user_groups_)
+        std::sort(groups.second.begin(), groups.second.end());
+
+    for (const auto &cred : data.credentials)
+    {
+        credentials_[cred.first] = {cred.second.owner, cred.second.validity};
+        if (!cred.second.card_id.empty())
+            cards_[{normalize_card_id(cred.second.card_id), cred.second.nb_bits}] =
+                cred.first;
+        if (!cred.second.pin_code.empty())
+            pins_.emplace(cred.second.pin_code, cred.first);
+    }
+
+    for (const auto &mapping : data.mappings)
+    {
+        auto rule     = std::make_shared<Rule>();
+        auto schedule = data.schedules.find(mapping.second.schedule);
+        if (schedule != data.schedules.end())
+            rule->schedule = schedule->second;
+        rule->users       = sorted(mapping.second.users);
+        rule->groups      = sorted(mapping.second.groups);
+        rule->credentials = sorted(mapping.second.credentials);
+
+        std::vector<DoorId> doors = mapping.second.doors;
+        std::vector<ZoneId> visited;
+        for (const auto &zone : mapping.second.zones)
+            zone_doors(data, zone, visited, doors);
+        std::sort(doors.begin(), doors.end());
+        doors.erase(std::unique(doors.begin(), doors.end()), doors.end());
+
+        for (const auto &door : doors)
+        {
+            auto itr = door_rules_.find(door);
+            if (itr != door_rules_.end())
+                itr->second.push_back(rule);
+        }
+    }
+}
+
+void CompiledPolicy::zone_doors(const PolicyData &data, ZoneId zone,
+                                std::vector<ZoneId> &visited,
+                                std::vector<DoorId> &doors)
+{
+    if (std::find(visited.begin(), visited.end(), zone) != visited.end())
+        return;
+    visited.push_back(zone);
+
+    auto itr = data.zones.find(zone);
+    if (itr == data.zones.end())
+        return;
+    doors.insert(doors.end(), itr->second.doors.begin(), itr->second.doors.end());
+    for (const auto &child : itr->second.children)
+        zone_doors(data, child, visited, doors);
+}
+
+DoorId CompiledPolicy::door_id(const std::string &alias) const
+{
+    auto itr = doors_.find(alias);
+    return itr != doors_.end() ? itr->second : 0;
+}
+
+CompiledPolicy::Decision
+CompiledPolicy::check(const Cred::ICredential &presented, DoorId door,
+                      const std::chrono::system_clock::time_point &tp) const
+{
+    Cred::CredentialId credential = 0;
+    if (auto card_pin = dynamic_cast<const Cred::RFIDCardPin *>(&presented))
+    {
+        const auto &card = card_pin->card();
+        credential       = find_card(card.card_id(), card.nb_bits());
+        auto owner       = credential ? credentials_.at(credential).owner : 0;
+        if (!owner || !find_pin(card_pin->pin().pin_code(), owner))
+            credential = 0;
+    }
+    else if (auto card = dynamic_cast<const Cred::IRFIDCard *>(&presented))
+        credential = find_card(card->card_id(), card->nb_bits());
+    else if (auto pin = dynamic_cast<const Cred::IPinCode *>(&presented))
+        credential = find_pin(pin->pin_code());
+
+    if (!credential)
+        return {false, 0, 0};
+    return {is_granted(credential, door, tp), credential,
+            credentials_.at(credential).owner};
+}
+
+bool CompiledPolicy::is_granted(
+    Cred::CredentialId credential, DoorId door,
+    const std::chrono::system_clock::time_point &tp) const
+{
+    auto cred  = credentials_.find(credential);
+    auto rules = door_rules_.find(door);
+    if (cred == credentials_.end() || rules == door_rules_.end())
+        return false;
+    if (!is_valid_at(cred->second.validity, tp))
+        return false;
+
+    UserId owner = cred->second.owner;
+    if (owner)
+    {
+        auto user = users_.find(owner);
+        if (user == users_.end() || !is_valid_at(user->second, tp))
+            return false;
+    }
+
+    auto minute = Tools::ScheduleBitmap::week_minute(tp);
+    for (const auto &rule : rules->second)
+    {
+        if (rule->schedule && rule->schedule->test(minute) &&
+            rule_matches(*rule, credential, owner))
+            return true;
+    }
+    return false;
+}
+
+bool CompiledPolicy::rule_matches(const Rule &rule, Cred::CredentialId credential,
+                                  UserId owner) const
+{
+    if (contains(rule.credentials, credential))
+        return true;
+    if (!owner)
+        return false;
+    if (contains(rule.users, owner))
+        return true;
+
+    auto groups = user_groups_.find(owner);
+    if (groups == user_groups_.end())
+        return false;
+    // Both lists are sorted.
+    auto r = rule.groups.begin();
+    auto u = groups->second.begin();
+    while (r != rule.groups.end() && u != groups->second.end())
+    {
+        if (*r == *u)
+            return true;
+        if (*r < *u)
+            ++r;
+        else
+            ++u;
+    }
+    return false;
+}
+
+Cred::CredentialId CompiledPolicy::find_card(const std::string &card_id,
+                                             int nb_bits) const
+{
+    auto itr = cards_.find({normalize_card_id(card_id), nb_bits});
+    return itr != cards_.end() ? itr->second : 0;
+}
+
+Cred::CredentialId CompiledPolicy::find_pin(const std::string &pin_code,
+                                            UserId owner) const
+{
+    auto range = pins_.equal_range(pin_code);
+    if (!owner)
+    {
+        if (range.first == range.second || std::next(range.first) != range.second)
+            return 0;
+        return range.first->second;
+    }
+    for (auto itr = range.first; itr != range.second; ++itr)
+    {
+        if (credentials_.at(itr->second).owner == owner)
+            return itr->second;
+    }
+    return 0;
+}
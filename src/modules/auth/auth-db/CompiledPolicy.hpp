@@ -0,0 +1,235 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "core/auth/AuthFwd.hpp"
+#include "core/auth/ValidityInfo.hpp"
+#include "core/credentials/CredentialFwd.hpp"
+#include "tools/ToolsFwd.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+/**
+ * The subset of the database objects that access decisions depend on.
+ *
+ * Objects are stored by id, as plain values. This is filled by
+ * PolicyCache, and compiled into a CompiledPolicy.
+ */
+struct PolicyData
+{
+    struct User
+    {
+        Leosac::Auth::ValidityInfo validity;
+    };
+
+    struct Membership
+    {
+        Leosac::Auth::UserId user;
+        Leosac::Auth::GroupId group;
+    };
+
+    struct Credential
+    {
+        /**
+         * 0 if the credential has no owner.
+         */
+        Leosac::Auth::UserId owner;
+        Leosac::Auth::ValidityInfo validity;
+
+        /**
+         * Set for RFID cards only.
+         */
+        std::string card_id;
+        int nb_bits;
+
+        /**
+         * Set for PIN codes only.
+         */
+        std::string pin_code;
+    };
+
+    struct Mapping
+    {
+        Tools::ScheduleId schedule;
+        std::vector<Leosac::Auth::UserId> users;
+        std::vector<Leosac::Auth::GroupId> groups;
+        std::vector<Cred::CredentialId> credentials;
+        std::vector<Leosac::Auth::DoorId> doors;
+        std::vector<Leosac::Auth::ZoneId> zones;
+    };
+
+    struct Zone
+    {
+        std::vector<Leosac::Auth::DoorId> doors;
+        std::vector<Leosac::Auth::ZoneId> children;
+    };
+
+    std::map<Leosac::Auth::UserId, User> users;
+    std::map<Leosac::Auth::UserGroupMembershipId, Membership> memberships;
+    std::map<Cred::CredentialId, Credential> credentials;
+    std::map<Tools::ScheduleId, std::shared_ptr<const Tools::ScheduleBitmap>>
+        schedules;
+    std::map<Tools::ScheduleMappingId, Mapping> mappings;
+
+    /**
+     * Alias of each door.
+     */
+    std::map<Leosac::Auth::DoorId, std::string> doors;
+    std::map<Leosac::Auth::ZoneId, Zone> zones;
+};
+
+/**
+ * An immutable, pre-computed, form of the access policy stored in
+ * the database.
+ *
+ * Schedule mappings are resolved per door (zones are expanded), and
+ * schedules are compiled to bitmaps. Checking a credential against a door
+ * is a handful of lookups, and never touches the database.
+ *
+ * Objects of this class can be shared between threads.
+ */
+class CompiledPolicy
+{
+  public:
+    struct Decision
+    {
+        bool granted;
+
+        /**
+         * The credential that was recognized, or 0.
+         */
+        Cred::CredentialId credential;
+
+        /**
+         * Owner of the credential, or 0.
+         */
+        Leosac::Auth::UserId user;
+    };
+
+    /**
+     * An empty policy, that denies everything.
+     */
+    CompiledPolicy();
+
+    explicit CompiledPolicy(const PolicyData &data);
+
+    /**
+     * Find a door by alias.
+     *
+     * @return the id of the door, or 0 if there is no such door.
+     */
+    Leosac::Auth::DoorId door_id(const std::string &alias) const;
+
+    /**
+     * Check whether a credential, as built by AuthSourceBuilder,
+     * grants access to a door at a given time.
+     *
+     * RFID cards are matched by card id and number of bits, PIN codes
+     * by value. For a card and PIN credential, the PIN code must belong
+     * to the owner of the card, and the card is checked.
+     */
+    Decision check(const Cred::ICredential &presented, Leosac::Auth::DoorId door,
+                   const std::chrono::system_clock::time_point &tp) const;
+
+    /**
+     * Check whether a credential from the database grants access to a
+     * door at a given time.
+     */
+    bool is_granted(Cred::CredentialId credential, Leosac::Auth::DoorId door,
+                    const std::chrono::system_clock::time_point &tp) const;
+
+    /**
+     * @return the id of the RFID card, or 0 if unknown.
+     */
+    Cred::CredentialId find_card(const std::string &card_id, int nb_bits) const;
+
+    /**
+     * Find a PIN code credential.
+     *
+     * If `owner` is 0, the PIN code must be unique: a bare PIN code
+     * shared by several credentials doesn't identify anyone.
+     *
+     * @return the id of the PIN code, or 0 if unknown.
+     */
+    Cred::CredentialId find_pin(const std::string &pin_code,
+                                Leosac::Auth::UserId owner = 0) const;
+
+  private:
+    /**
+     * A schedule mapping, as it applies to a door.
+     */
+    struct Rule
+    {
+        std::shared_ptr<const Tools::ScheduleBitmap> schedule;
+
+        /**
+         * Sorted.
+         */
+        std::vector<Leosac::Auth::UserId> users;
+        std::vector<Leosac::Auth::GroupId> groups;
+        std::vector<Cred::CredentialId> credentials;
+    };
+    using RuleCPtr = std::shared_ptr<const Rule>;
+
+    struct CompiledCredential
+    {
+        Leosac::Auth::UserId owner;
+        Leosac::Auth::ValidityInfo validity;
+    };
+
+    /**
+     * Collect the doors of a zone and of its children, recursively.
+     */
+    static void zone_doors(const PolicyData &data, Leosac::Auth::ZoneId zone,
+                           std::vector<Leosac::Auth::ZoneId> &visited,
+                           std::vector<Leosac::Auth::DoorId> &doors);
+
+    bool rule_matches(const Rule &rule, Cred::CredentialId credential,
+                      Leosac::Auth::UserId owner) const;
+
+    std::map<std::string, Leosac::Auth::DoorId> doors_;
+    std::map<Leosac::Auth::DoorId, std::vector<RuleCPtr>> door_rules_;
+
+    std::map<Cred::CredentialId, CompiledCredential> credentials_;
+    std::map<std::pair<std::string, int>, Cred::CredentialId> cards_;
+    std::multimap<std::string, Cred::CredentialId> pins_;
+
+    std::map<Leosac::Auth::UserId, Leosac::Auth::ValidityInfo> users_;
+
+    /**
+     * Sorted groups of each user.
+     */
+    std::map<Leosac::Auth::UserId, std::vector<Leosac::Auth::GroupId>>
+        user_groups_;
+};
+using CompiledPolicyCPtr = std::shared_ptr<const CompiledPolicy>;
+}
+}
+}
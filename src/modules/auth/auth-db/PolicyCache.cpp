@@ -0,0 +1,227 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "modules/auth/auth-db/PolicyCache.hpp"
+#include "core/Scheduler.hpp"
+#include "core/auth/Door.hpp"
+#include "core/auth/Door_odb.h"
+#include "core/auth/User.hpp"
+#include "core/auth/UserGroupMembership.hpp"
+#include "core/auth/UserGroupMembership_odb.h"
+#include "core/auth/User_odb.h"
+#include "core/auth/Zone.hpp"
+#include "core/auth/Zone_odb.h"
+#include "core/credentials/Credential.hpp"
+#include "core/credentials/Credential_odb.h"
+#include "core/credentials/IPinCode.hpp"
+#include "core/credentials/IRFIDCard.hpp"
+#include "modules/auth/auth-db/AuthDBViews.hpp"
+#include "modules/auth/auth-db/AuthDBViews_odb.h"
+#include "tools/Schedule.hpp"
+#include "tools/ScheduleBitmap.hpp"
+#include "tools/ScheduleMapping.hpp"
+#include "tools/ScheduleMapping_odb.h"
+#include "tools/Schedule_odb.h"
+#include "tools/db/database.hpp"
+#include "tools/log.hpp"
+#include <algorithm>
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+
+/**
+ * Maximum number of ids in the IN clause used to reload objects.
+ * This stays below SQLite's default limit on the number of
+ * host parameters.
+ */
+static constexpr size_t MAX_IDS_PER_QUERY = 500;
+
+PolicyCache::PolicyCache(DBPtr database)
+    : database_(database)
+    , refresh_pending_(false)
+    , publish_pending_(false)
+    , policy_(std::make_shared<const CompiledPolicy>())
+{
+    ASSERT_LOG(database_, "PolicyCache requires a database.");
+}
+
+CompiledPolicyCPtr PolicyCache::policy() const
+{
+    return std::atomic_load(&policy_);
+}
+
+template <typename Object, typename VersionView, typename Record, typename Compile>
+void PolicyCache::sync(VersionMap &versions,
+                       std::map<unsigned long, Record> &records,
+                       const Compile &compile)
+{
+    using Query = odb::query<Object>;
+
+    VersionMap current;
+    for (const auto &row : database_->query<VersionView>())
+        current[row.id] = row.version;
+
+    for (auto itr = records.begin(); itr != records.end();)
+    {
+        if (current.count(itr->first))
+        {
+            ++itr;
+            continue;
+        }
+        publish_pending_ = true;
+        itr              = records.erase(itr);
+    }
+
+    std::vector<unsigned long> stale;
+    for (const auto &entry : current)
+    {
+        auto itr = versions.find(entry.first);
+        if (itr == versions.end() || itr->second != entry.second)
+            stale.push_back(entry.first);
+    }
+
+    if (!stale.empty())
+        publish_pending_ = true;
+    auto load = [&](odb::result<Object> result) {
+        for (auto itr = result.begin(); itr != result.end(); ++itr)
+        {
+            auto object           = itr.load();
+            records[object->id()] = compile(*object);
+        }
+    };
+    if (!stale.empty() && stale.size() == current.size())
+    {
+        load(database_->query<Object>());
+    }
+    else
+    {
+        for (size_t i = 0; i < stale.size(); i += MAX_IDS_PER_QUERY)
+        {
+            auto end = std::min(i + MAX_IDS_PER_QUERY, stale.size());
+            load(database_->query<Object>(
+                Query::id.in_range(stale.begin() + i, stale.begin() + end)));
+        }
+    }
+
+    versions = std::move(current);
+}
+
+bool PolicyCache::refresh()
+{
+    using namespace Leosac::Auth;
+    std::lock_guard<std::mutex> lg(refresh_mutex_);
+
+    {
+        odb::transaction t(database_->begin());
+
+        sync<User, UserVersion>(user_versions_, data_.users, [](const User &u) {
+            return PolicyData::User{u.validity()};
+        });
+
+        sync<UserGroupMembership, MembershipVersion>(
+            membership_versions_, data_.memberships,
+            [](const UserGroupMembership &m) {
+                return PolicyData::Membership{m.user_id(), m.group_id()};
+            });
+
+        sync<Cred::Credential, CredentialVersion>(
+            credential_versions_, data_.credentials, [](const Cred::Credential &c) {
+                PolicyData::Credential cred{c.owner_id(), c.validity(), "", 0, ""};
+                if (auto card = dynamic_cast<const Cred::IRFIDCard *>(&c))
+                {
+                    cred.card_id = card->card_id();
+                    cred.nb_bits = card->nb_bits();
+                }
+                if (auto pin = dynamic_cast<const Cred::IPinCode *>(&c))
+                    cred.pin_code = pin->pin_code();
+                return cred;
+            });
+
+        sync<Tools::Schedule, ScheduleVersion>(
+            schedule_versions_, data_.schedules, [](const Tools::Schedule &s) {
+                return std::make_shared<const Tools::ScheduleBitmap>(s.timeframes());
+            });
+
+        sync<Tools::ScheduleMapping, ScheduleMappingVersion>(
+            mapping_versions_, data_.mappings, [](const Tools::ScheduleMapping &sm) {
+                PolicyData::Mapping mapping;
+                mapping.schedule = sm.schedule_id();
+                for (const auto &user : sm.users())
+                    mapping.users.push_back(user.object_id());
+                for (const auto &group : sm.groups())
+                    mapping.groups.push_back(group.object_id());
+                for (const auto &cred : sm.credentials())
+                    mapping.credentials.push_back(cred.object_id());
+                for (const auto &door : sm.doors())
+                    mapping.doors.push_back(door.object_id());
+                for (const auto &zone : sm.zones())
+                    mapping.zones.push_back(zone.object_id());
+                return mapping;
+            });
+
+        sync<Door, DoorVersion>(door_versions_, data_.doors,
+                                [](const Door &d) { return d.alias(); });
+
+        sync<Zone, ZoneVersion>(zone_versions_, data_.zones, [](const Zone &z) {
+            PolicyData::Zone zone;
+            for (const auto &door : z.doors())
+                zone.doors.push_back(door.object_id());
+            for (const auto &child : z.children())
+                zone.children.push_back(child.object_id());
+            return zone;
+        });
+
+        t.commit();
+    }
+
+    if (!publish_pending_)
+        return false;
+
+    std::atomic_store(&policy_, std::make_shared<const CompiledPolicy>(data_));
+    publish_pending_ = false;
+    INFO("AuthDB policy compiled: " << data_.credentials.size() << " credentials, "
+                                    << data_.doors.size() << " doors, "
+                                    << data_.mappings.size()
+                                    << " schedule mappings.");
+    return true;
+}
+
+void PolicyCache::schedule_refresh(Scheduler &scheduler)
+{
+    if (refresh_pending_.exchange(true))
+        return;
+
+    auto self = shared_from_this();
+    scheduler.enqueue(
+        [self]() {
+            bool ret = true;
+            try
+            {
+                self->refresh();
+            }
+            catch (const std::exception &e)
+            {
+                WARN("Failed to refresh the AuthDB policy: " << e.what());
+                ret = false;
+            }
+            self->refresh_pending_ = false;
+            return ret;
+        },
+        TargetThread::POOL);
+}
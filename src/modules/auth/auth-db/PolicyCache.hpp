@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "LeosacFwd.hpp"
+#include "modules/auth/auth-db/CompiledPolicy.hpp"
+#include "tools/db/db_fwd.hpp"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+/**
+ * Maintains a CompiledPolicy in sync with the database.
+ *
+ * The objects the policy depends on are loaded once. Afterwards, a
+ * refresh only fetches the id and version of every object (see
+ * AuthDBViews.hpp), and reloads the objects that were created or
+ * updated since the last refresh. The policy is recompiled, in
+ * memory, only if something changed.
+ *
+ * The current policy is published as an immutable snapshot: readers are
+ * never blocked by a refresh, and keep using the previous snapshot until
+ * the new one is ready.
+ */
+class PolicyCache : public std::enable_shared_from_this<PolicyCache>
+{
+  public:
+    explicit PolicyCache(DBPtr database);
+
+    PolicyCache(const PolicyCache &) = delete;
+    PolicyCache &operator=(const PolicyCache &) = delete;
+
+    /**
+     * The current policy. It is empty, and denies everything,
+     * until the first successful refresh.
+     *
+     * The policy is immutable: a refresh publishes a new one, and
+     * doesn't affect callers that hold the previous one.
+     */
+    CompiledPolicyCPtr policy() const;
+
+    /**
+     * Bring the policy up to date with the database.
+     *
+     * Concurrent calls are serialized.
+     *
+     * @return true if the policy changed.
+     * @throws odb::exception if the database cannot be queried.
+     */
+    bool refresh();
+
+    /**
+     * Call refresh() on the scheduler's thread pool, unless a refresh
+     * scheduled this way is still pending. Errors are logged.
+     */
+    void schedule_refresh(Scheduler &scheduler);
+
+  private:
+    using VersionMap = std::map<unsigned long, size_t>;
+
+    /**
+     * Synchronize the records of one type of object.
+     *
+     * Sets `publish_pending_` before a record is added, updated or
+     * removed.
+     *
+     * @param versions the version of each record, updated on success.
+     * @param records the records, by object id.
+     * @param compile build a record from a database object.
+     */
+    template <typename Object, typename VersionView, typename Record,
+              typename Compile>
+    void sync(VersionMap &versions, std::map<unsigned long, Record> &records,
+              const Compile &compile);
+
+    DBPtr database_;
+
+    std::mutex refresh_mutex_;
+    std::atomic<bool> refresh_pending_;
+
+    PolicyData data_;
+
+    /**
+     * `data_` changed since the policy was last published.
+     *
+     * This survives a failed refresh, whose partial changes are
+     * published by the next successful one.
+     */
+    bool publish_pending_;
+
+    VersionMap user_versions_;
+    VersionMap membership_versions_;
+    VersionMap credential_versions_;
+    VersionMap schedule_versions_;
+    VersionMap mapping_versions_;
+    VersionMap door_versions_;
+    VersionMap zone_versions_;
+
+    /**
+     * Must only be accessed through std::atomic_load() and
+     * std::atomic_store().
+     */
+    CompiledPolicyCPtr policy_;
+};
+using PolicyCachePtr = std::shared_ptr<PolicyCache>;
+}
+}
+}
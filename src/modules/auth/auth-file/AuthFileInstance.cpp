@@ -19,6 +19,7 @@
 
 #include "AuthFileInstance.hpp"
 #include "FileAuthSourceMapper.hpp"
+#include "ImageAuthSourceMapper.hpp"
 #include "core/CoreUtils.hpp"
 #include "core/Scheduler.hpp"
 #include "core/SecurityContext.hpp"
@@ -27,10 +28,12 @@
 #include "core/auth/User.hpp"
 #include "core/credentials/serializers/PolymorphicCredentialSerializer.hpp"
 #include "exception/ExceptionsTools.hpp"
+#include "core/audit/AsyncAuditWriter.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/IAuthEvent.hpp"
 #include "tools/Colorize.hpp"
 #include "tools/log.hpp"
+#include "tools/service/ServiceRegistry.hpp"
 #include <boost/algorithm/string/join.hpp>
 
 using namespace Leosac::Module::Auth;
@@ -41,14 +44,22 @@ AuthFileInstance::AuthFileInstance(zmqpp::context &ctx,
                                    const std::list<std::string> &auth_sources_names,
                                    std::string const &auth_target_name,
                                    std::string const &input_file,
-                                   CoreUtilsPtr core_utils)
-    : mapper_(std::make_shared<FileAuthSourceMapper>(input_file))
+                                   std::string const &compiled_file,
+                                   CoreUtilsPtr core_utils,
+                                   const UnknownCredentialFilter::Config &unknown_creds_cfg,
+                                   bool watch_config_file)
+    : mapper_(load_mapper(input_file, compiled_file))
+    , reload_pending_(false)
     , bus_push_(ctx, zmqpp::socket_type::push)
     , bus_sub_(ctx, zmqpp::socket_type::sub)
     , name_(auth_ctx_name)
     , target_name_(auth_target_name)
+    , target_(auth_target_name.empty()
+                  ? nullptr
+                  : std::make_shared<AuthTarget>(auth_target_name))
     , file_path_(input_file)
     , core_utils_(core_utils)
+    , unknown_creds_(unknown_creds_cfg)
 {
     bus_push_.connect("inproc://zmq-bus-pull");
     bus_sub_.connect("inproc://zmq-bus-pub");
@@ -59,10 +70,39 @@ AuthFileInstance::AuthFileInstance(zmqpp::context &ctx,
                            << boost::algorithm::join(auth_sources_names, ", "));
     for (const auto &auth_source : auth_sources_names)
         bus_sub_.subscribe("S_" + auth_source);
+
+    if (watch_config_file)
+    {
+        watcher_ = std::make_unique<Tools::UnixFileWatcher>();
+        watcher_->watchFile(file_path_, [this](const std::string &path) {
+            INFO("Auth file " << path << " was modified. Will reload.");
+            try
+            {
+                reload_auth_config();
+            }
+            catch (const std::bad_weak_ptr &)
+            {
+                // The instance is going down.
+            }
+        });
+        watcher_->start();
+    }
 }
 
 AuthFileInstance::~AuthFileInstance()
 {
+    if (watcher_)
+    {
+        try
+        {
+            watcher_->stop();
+        }
+        catch (const std::exception &e)
+        {
+            WARN("Failed to stop watching " << file_path_ << ": " << e.what());
+        }
+    }
+    report_denials(true);
     INFO("AuthFileInstance down");
 }
 
@@ -86,7 +126,16 @@ void AuthFileInstance::handle_bus_msg()
     else
         log_user = Colorize::red("UNKNOWN_USER");
 
-    if (auth_result.success)
+    if (auth_result.filtered)
+    {
+        // Do not flood the log: those denials are reported in bulk.
+        auth_result_msg << Leosac::Auth::AccessStatus::DENIED;
+        DEBUG(Colorize::bold(name_)
+              << " " << Colorize::red("DENIED") << " access to target "
+              << Colorize::underline(target_name_)
+              << " for a filtered unknown credential");
+    }
+    else if (auth_result.success)
     {
         auth_result_msg << Leosac::Auth::AccessStatus::GRANTED;
         INFO(Colorize::bold(name_)
@@ -113,43 +162,60 @@ AuthResult AuthFileInstance::handle_auth(zmqpp::message *msg) noexcept
   AuthResult authres(false, nullptr, nullptr);
   try
   {
-    std::lock_guard<std::mutex> guard(mutex_);
+    // The filter generation is read first: if a reload clears the
+    // filter after we took an outdated snapshot, the filter won't
+    // remember what that snapshot didn't know.
+    auto generation = unknown_creds_.generation();
+    auto mapper     = std::atomic_load(&mapper_);
 
     AuthSourceBuilder build;
     Cred::ICredentialPtr auth_source = build.create(msg);
     DEBUG("Auth source OK... will map");
-    mapper_->mapToUser(auth_source);
+    mapper->mapToUser(auth_source);
     DEBUG("Mapping done");
     assert(auth_source);
 
+    // Credentials known to the mapper always have an id. Unknown ones
+    // are denied, and the filter decides whether that is logged and
+    // audited now or in bulk. Known credentials are never filtered.
+    if (!auth_source->id())
+    {
+      std::string reader;
+      build.extract_source_name(msg->get(0), &reader);
+      if (unknown_creds_.check(reader, UnknownCredentialFilter::make_key(*msg),
+                               auth_source, generation,
+                               UnknownCredentialFilter::Clock::now()) !=
+          UnknownCredentialFilter::Verdict::REPORT)
+      {
+        authres.filtered = true;
+        return authres;
+      }
+    }
+
     auto cred_serialized = PolymorphicCredentialJSONStringSerializer::serialize(
         *auth_source, SystemSecurityContext::instance());
     INFO("Using Credential: " << cred_serialized);
-    auto profile = mapper_->buildProfile(auth_source);
+    auto profile = mapper->buildProfile(auth_source);
 
     if (!profile)
     {
       INFO("No profile was created from this auth source message.");
     }
-    else if (target_name_.empty())
-    {
-      // check against default target
-      authres = AuthResult(profile->isAccessGranted(std::chrono::system_clock::now(), nullptr),
-          profile, auth_source->owner().get_eager());
-    }
     else
     {
-      AuthTargetPtr t(new AuthTarget(target_name_));
-      authres = AuthResult(profile->isAccessGranted(std::chrono::system_clock::now(), t),
+      // A null target checks against the default target.
+      authres = AuthResult(profile->isAccessGranted(std::chrono::system_clock::now(), target_),
           profile, auth_source->owner().get_eager());
     }
 
     auto db = core_utils_->database();
     if (db)
     {
-      auto audit = Audit::Factory::AuthEvent(db, auth_source, target_name_);
+      auto writer = core_utils_->service_registry().get_service<Audit::AsyncAuditWriter>();
+      ASSERT_LOG(writer, "No AsyncAuditWriter service.");
+      auto audit = Audit::Factory::DetachedAuthEvent(db, auth_source, target_name_);
       audit->event_mask(authres.success ? Audit::EventType::AUTH_GRANTED : Audit::EventType::AUTH_DENIED);
-      audit->finalize();
+      writer->enqueue(audit);
     }
   }
   catch (std::exception &e)
@@ -161,6 +227,50 @@ AuthResult AuthFileInstance::handle_auth(zmqpp::message *msg) noexcept
   return authres;
 }
 
+void AuthFileInstance::report_denials(bool all)
+{
+    auto reports =
+        unknown_creds_.collect_reports(UnknownCredentialFilter::Clock::now(), all);
+    if (reports.empty())
+        return;
+
+    auto db     = core_utils_->database();
+    auto writer = core_utils_->service_registry().get_service<Audit::AsyncAuditWriter>();
+    for (const auto &report : reports)
+    {
+        auto period = std::chrono::duration_cast<std::chrono::seconds>(
+            report.last - report.first);
+        if (!report.credential)
+        {
+            WARN(name_ << ": ignored " << report.count
+                       << " requests from reader " << report.reader << " in "
+                       << period.count()
+                       << " seconds: too many unknown credentials.");
+            continue;
+        }
+
+        INFO(name_ << ": denied " << report.count
+                   << " requests for unknown credential "
+                   << PolymorphicCredentialJSONStringSerializer::serialize(
+                          *report.credential, SystemSecurityContext::instance())
+                   << " from reader " << report.reader << " in "
+                   << period.count() << " seconds.");
+        if (db && writer)
+        {
+            auto audit = Audit::Factory::DetachedAuthEvent(db, report.credential,
+                                                           target_name_);
+            audit->event_mask(Audit::EventType::AUTH_DENIED);
+            audit->repeated(report.count, period);
+            writer->enqueue(audit);
+        }
+    }
+}
+
+bool AuthFileInstance::has_pending_denials() const
+{
+    return unknown_creds_.has_pending_reports();
+}
+
 std::string AuthFileInstance::auth_file_content() const
 {
     std::ifstream t(file_path_);
@@ -181,20 +291,36 @@ void AuthFileInstance::reload_auth_config()
     // and swap it with the current mapper once it is built.
     // This is because building a new mapper can take a while.
 
+    // A reload is already queued: it will see the latest file content.
+    if (reload_pending_.exchange(true))
+        return;
+
     // We keep a shared_ptr to "this" in order to avoid dangling pointer to
     // a non-existent instance (for example if the module was shutdown between
     // the scheduling of the task and its execution).
     auto self      = shared_from_this();
     auto file_path = file_path_;
     auto task      = Tasks::GenericTask::build([self, file_path]() {
+        std::lock_guard<std::mutex> lg(self->reload_mutex_);
+        // Changes made from now on require another reload.
+        self->reload_pending_ = false;
         try
         {
-            auto mapper = std::make_shared<FileAuthSourceMapper>(file_path);
-            {
-                std::lock_guard<std::mutex> guard(self->mutex_);
-                self->mapper_ = mapper;
-                INFO("AuthFileInstance config reloaded.");
-            }
+            // Only what changed since the current mapper was loaded
+            // is rebuilt.
+            // A mapper built from a compiled image has nothing to share.
+            auto previous = std::dynamic_pointer_cast<FileAuthSourceMapper>(
+                std::atomic_load(&self->mapper_));
+            auto mapper =
+                previous
+                    ? std::make_shared<FileAuthSourceMapper>(file_path, *previous)
+                    : std::make_shared<FileAuthSourceMapper>(file_path);
+            std::atomic_store(&self->mapper_, mapper);
+            // Credentials that were unknown may be known now. Requests
+            // still using the previous mapper won't fill the cache again
+            // (see handle_auth()).
+            self->unknown_creds_.clear();
+            INFO("AuthFileInstance config reloaded.");
             return true;
         }
         catch (const std::exception &e)
@@ -207,6 +333,30 @@ void AuthFileInstance::reload_auth_config()
     core_utils_->scheduler().enqueue(task, TargetThread::POOL);
 }
 
+IAuthSourceMapperPtr
+AuthFileInstance::load_mapper(const std::string &input_file,
+                              const std::string &compiled_file)
+{
+    if (!compiled_file.empty())
+    {
+        try
+        {
+            auto mapper = std::make_shared<ImageAuthSourceMapper>(compiled_file);
+            if (mapper->is_up_to_date(input_file))
+                return mapper;
+            WARN("Auth image " << compiled_file << " is out of date. Loading "
+                               << input_file << " instead.");
+        }
+        catch (const std::exception &e)
+        {
+            WARN("Cannot use auth image " << compiled_file << ": " << e.what()
+                                          << ". Loading " << input_file
+                                          << " instead.");
+        }
+    }
+    return std::make_shared<FileAuthSourceMapper>(input_file);
+}
+
 bool AuthFileInstance::handle_kernel_message(const zmqpp::message &msg)
 {
     auto cp = msg.copy();
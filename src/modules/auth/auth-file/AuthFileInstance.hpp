@@ -20,10 +20,15 @@
 #pragma once
 
 #include "FileAuthSourceMapper.hpp"
+#include "UnknownCredentialFilter.hpp"
 #include "LeosacFwd.hpp"
 #include "core/auth/AuthFwd.hpp"
 #include "core/tasks/Task.hpp"
+#include "tools/unixfilewatcher.hpp"
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <zmqpp/zmqpp.hpp>
 
 namespace Leosac
@@ -43,6 +48,7 @@ struct AuthResult
         : success(s)
         , profile(p)
         , user(u)
+        , filtered(false)
     {
     }
 
@@ -61,6 +67,12 @@ struct AuthResult
      * attempt.
      */
     ::Leosac::Auth::UserPtr user;
+
+    /**
+     * Whether the request was for an unknown credential whose denial
+     * is reported in bulk by the UnknownCredentialFilter.
+     */
+    bool filtered;
 };
 
 /**
@@ -79,13 +91,25 @@ class AuthFileInstance : public std::enable_shared_from_this<AuthFileInstance>
     * reader).
     * @param auth_target_name name of the target (ie door) we auth against.
     * @param input_file path to file contain auth configuration
+    * @param compiled_file path to an image compiled from `input_file`
+    * (see AuthImageWriter), used at startup if it is up to date. May be empty.
     * @param core_utils Core utilities
+    * @param unknown_creds_cfg Configuration of the unknown credentials filter.
+    * @param watch_config_file Reload the configuration whenever `input_file`
+    * is written.
     */
     AuthFileInstance(zmqpp::context &ctx, const std::string &auth_ctx_name,
                      const std::list<std::string> &auth_sources_names,
                      const std::string &auth_target_name,
-                     const std::string &input_file, CoreUtilsPtr core_utils);
+                     const std::string &input_file,
+                     const std::string &compiled_file, CoreUtilsPtr core_utils,
+                     const UnknownCredentialFilter::Config &unknown_creds_cfg,
+                     bool watch_config_file);
 
+    /**
+    * Stops watching the configuration file, and reports pending
+    * denials before going down.
+    */
     ~AuthFileInstance();
 
     AuthFileInstance(const AuthFileInstance &) = delete;
@@ -113,6 +137,22 @@ class AuthFileInstance : public std::enable_shared_from_this<AuthFileInstance>
     */
     std::string auth_file_content() const;
 
+    /**
+    * Report the denials that were not evaluated (see UnknownCredentialFilter)
+    * and whose coalescing window elapsed.
+    *
+    * Denials of a known unknown credential produce one audit entry
+    * per credential. Throttled requests are summarized in the log.
+    *
+    * @param all Report all pending denials, regardless of their window.
+    */
+    void report_denials(bool all = false);
+
+    /**
+    * Are there denials waiting to be reported by report_denials()?
+    */
+    bool has_pending_denials() const;
+
   private:
     /**
      * Handle the message if its from Leosac's kernel, or
@@ -122,8 +162,21 @@ class AuthFileInstance : public std::enable_shared_from_this<AuthFileInstance>
      */
     bool handle_kernel_message(const zmqpp::message &msg);
 
+    /**
+     * Build the mapper used at startup.
+     *
+     * The compiled image is mapped if it was compiled from the current
+     * version of `input_file`. Otherwise, `input_file` is parsed.
+     */
+    static ::Leosac::Auth::IAuthSourceMapperPtr
+    load_mapper(const std::string &input_file, const std::string &compiled_file);
+
     /**
      * Schedule an asynchronous reload of the module configuration file.
+     *
+     * The new mapper reuses the objects of the current one that
+     * didn't change. Requests made while a reload is queued are merged
+     * with it.
      */
     void reload_auth_config();
 
@@ -140,17 +193,33 @@ class AuthFileInstance : public std::enable_shared_from_this<AuthFileInstance>
     AuthResult handle_auth(zmqpp::message *msg) noexcept;
 
     /**
-     * A mutex used only internally.
-     *
-     * It's needed in order to safely replace the mapper_ when
-     * reloading the configuration.
-     */
-    std::mutex mutex_;
+    * Authentication config file parser.
+    *
+    * The mapper is immutable once built: it is published as a snapshot
+    * and must only be accessed through std::atomic_load() and
+    * std::atomic_store(). This allows the configuration to be reloaded
+    * without blocking threads that are evaluating an access request.
+    *
+    * This is an ImageAuthSourceMapper if the instance started from a
+    * compiled image, until the first reload.
+    */
+    ::Leosac::Auth::IAuthSourceMapperPtr mapper_;
 
     /**
-    * Authentication config file parser.
+    * Whether a reload task is queued and has not started yet.
+    */
+    std::atomic<bool> reload_pending_;
+
+    /**
+    * Serializes reloads, so that each one builds upon the mapper
+    * produced by the previous one.
     */
-    FileAuthSourceMapperPtr mapper_;
+    std::mutex reload_mutex_;
+
+    /**
+    * Watches the configuration file, if enabled. Null otherwise.
+    */
+    std::unique_ptr<Tools::UnixFileWatcher> watcher_;
 
     /**
     * Socket to write to the bus.
@@ -172,12 +241,24 @@ class AuthFileInstance : public std::enable_shared_from_this<AuthFileInstance>
     */
     std::string target_name_;
 
+    /**
+    * Target we auth against, built once from `target_name_`.
+    * Null if the instance has no target.
+    */
+    ::Leosac::Auth::AuthTargetPtr target_;
+
     /**
     * Path to the auth data file.
     */
     std::string file_path_;
 
     CoreUtilsPtr core_utils_;
+
+    /**
+    * Short-circuits requests carrying recently seen unknown credentials,
+    * and rate limits readers that submit unknown credentials.
+    */
+    UnknownCredentialFilter unknown_creds_;
 };
 }
 }
@@ -20,6 +20,7 @@
 #include "AuthFileModule.hpp"
 #include "core/CoreUtils.hpp"
 #include "core/kernel.hpp"
+#include "exception/configexception.hpp"
 
 using namespace Leosac;
 using namespace Leosac::Module::Auth;
@@ -28,13 +29,17 @@ AuthFileModule::AuthFileModule(zmqpp::context &ctx, zmqpp::socket *pipe,
                                const boost::property_tree::ptree &cfg,
                                CoreUtilsPtr utils)
     : BaseModule(ctx, pipe, cfg, utils)
+    , denials_timer_armed_(false)
 {
     process_config();
 
     for (auto authenticator : authenticators_)
     {
-        reactor_.add(authenticator->bus_sub(),
-                     std::bind(&AuthFileInstance::handle_bus_msg, authenticator));
+        reactor_.add(authenticator->bus_sub(), [this, authenticator]() {
+            authenticator->handle_bus_msg();
+            if (authenticator->has_pending_denials())
+                arm_denials_timer();
+        });
     }
 }
 
@@ -53,7 +58,31 @@ void AuthFileModule::process_config()
         std::string config_file = auth_instance_cfg.get_child("config_file").data();
         std::string auth_target_name =
             auth_instance_cfg.get<std::string>("target", "");
+        std::string compiled_file =
+            auth_instance_cfg.get<std::string>("compiled_file", "");
+        bool watch_config_file =
+            auth_instance_cfg.get<bool>("watch_config_file", false);
         std::list<std::string> auth_sources_names;
+        UnknownCredentialFilter::Config unknown_creds_cfg;
+        if (auto filter_cfg =
+                auth_instance_cfg.get_child_optional("unknown_credentials"))
+        {
+            auto &c      = unknown_creds_cfg;
+            c.cache_size = filter_cfg->get<size_t>("cache_size", c.cache_size);
+            c.cache_ttl  = std::chrono::seconds(
+                filter_cfg->get<size_t>("cache_ttl", c.cache_ttl.count()));
+            c.rate         = filter_cfg->get<double>("rate", c.rate);
+            c.burst        = filter_cfg->get<size_t>("burst", c.burst);
+            c.audit_window = std::chrono::seconds(
+                filter_cfg->get<size_t>("audit_window", c.audit_window.count()));
+
+            if (c.rate < 0)
+                throw Ex::Config("unknown_credentials", "rate", false);
+            if (c.rate > 0 && !c.burst)
+                throw Ex::Config("unknown_credentials", "burst", false);
+            if (!c.audit_window.count())
+                throw Ex::Config("unknown_credentials", "audit_window", false);
+        }
 
         for (const auto &subnode : auth_instance_cfg)
         {
@@ -69,10 +98,29 @@ void AuthFileModule::process_config()
              << auth_ctx_name << ". Target door = " << auth_target_name);
         authenticators_.push_back(AuthFileInstancePtr(
             new AuthFileInstance(ctx_, auth_ctx_name, auth_sources_names,
-                                 auth_target_name, config_file, utils_)));
+                                 auth_target_name, config_file, compiled_file,
+                                 utils_, unknown_creds_cfg, watch_config_file)));
     }
 }
 
+void AuthFileModule::arm_denials_timer()
+{
+    if (denials_timer_armed_)
+        return;
+    denials_timer_armed_ = true;
+    schedule_after(std::chrono::seconds(1), [this]() {
+        denials_timer_armed_ = false;
+        bool pending         = false;
+        for (auto &authenticator : authenticators_)
+        {
+            authenticator->report_denials();
+            pending |= authenticator->has_pending_denials();
+        }
+        if (pending)
+            arm_denials_timer();
+    });
+}
+
 void AuthFileModule::dump_additional_config(zmqpp::message *out) const
 {
     assert(out);
@@ -63,10 +63,20 @@ class AuthFileModule : public BaseModule
     */
     void process_config();
 
+    /**
+    * Make sure denials filtered by the authenticators are
+    * reported once their coalescing window elapses.
+    *
+    * The timer is re-armed as long as there are pending denials.
+    */
+    void arm_denials_timer();
+
     /**
     * Authenticator instance.
     */
     std::vector<AuthFileInstancePtr> authenticators_;
+
+    bool denials_timer_armed_;
 };
 }
 }
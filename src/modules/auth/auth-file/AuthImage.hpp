@@ -0,0 +1,246 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+#include <type_traits>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+/**
+ * Layout of a compiled auth file image.
+ *
+ * An image is produced offline from an auth file (see AuthImageWriter)
+ * and mapped in memory at startup (see ImageAuthSourceMapper).
+ *
+ * The image starts with a Header, followed by sections of fixed size
+ * records. Sections are referenced by their offset from the start of the
+ * image, and records reference each other by index, so the image can
+ * be mapped anywhere. Strings are stored, null terminated, in the
+ * `strings` section and referenced by offset in that section. Offset 0
+ * is the empty string.
+ *
+ * Credentials are indexed by a perfect hash of their key (see
+ * credential_key()): the key is hashed with seed 0 to select a bucket,
+ * then with the bucket's displacement to select a slot, which holds the
+ * credential's index.
+ *
+ * Numbers are stored in the byte order of the machine that compiled the
+ * image. An image is rejected if that order doesn't match.
+ */
+namespace AuthImage
+{
+constexpr char MAGIC[8]            = {'L', 'E', 'O', 'S', 'A', 'C', 'A', 'F'};
+constexpr uint32_t VERSION         = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/**
+ * Marks an absent reference.
+ */
+constexpr uint32_t NO_ENTRY = 0xFFFFFFFF;
+
+/**
+ * Sections offsets are aligned on this boundary.
+ */
+constexpr size_t ALIGNMENT = 8;
+
+struct Section
+{
+    uint64_t offset;
+    /**
+     * Number of records (bytes for the `strings` section).
+     */
+    uint64_t count;
+};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t image_size;
+
+    /**
+     * checksum() of everything that follows the header.
+     */
+    uint64_t checksum;
+
+    /**
+     * Size and modification time (see source_mtime()) of the auth
+     * file the image was compiled from.
+     */
+    uint64_t source_size;
+    int64_t source_mtime;
+
+    Section strings;
+    Section users;
+    /**
+     * Schedule bitmaps, ScheduleBitmap::PACKED_SIZE bytes each.
+     */
+    Section bitmaps;
+    Section grants;
+    Section profiles;
+    Section credentials;
+    /**
+     * Displacement (uint32_t) of each bucket of the credential index.
+     */
+    Section buckets;
+    /**
+     * Credential index (uint32_t) of each slot, or NO_ENTRY.
+     */
+    Section slots;
+};
+
+/**
+ * Validity dates are stored as nanoseconds since epoch.
+ */
+struct UserRecord
+{
+    uint64_t id;
+    uint32_t name;
+    uint32_t firstname;
+    uint32_t lastname;
+    uint32_t email;
+    int64_t validity_start;
+    int64_t validity_end;
+    uint32_t enabled;
+    uint32_t padding;
+};
+
+/**
+ * Grants access during a schedule, either to a door or,
+ * if `door` is 0, to any door.
+ */
+struct GrantRecord
+{
+    uint32_t door;
+    uint32_t bitmap;
+    /**
+     * Name of the schedule, for logging.
+     */
+    uint32_t schedule;
+    uint32_t padding;
+};
+
+/**
+ * A profile is a contiguous range of grants. Identical profiles
+ * are stored once.
+ */
+struct ProfileRecord
+{
+    uint32_t first_grant;
+    uint32_t grant_count;
+};
+
+enum CredentialType : uint32_t
+{
+    RFID_CARD     = 1,
+    PIN_CODE      = 2,
+    RFID_CARD_PIN = 3
+};
+
+struct CredentialRecord
+{
+    uint64_t id;
+    uint32_t type;
+    uint32_t bits;
+    uint32_t card_id;
+    uint32_t pin;
+    uint32_t alias;
+    uint32_t user;
+    /**
+     * NO_ENTRY if the credential has no profile.
+     */
+    uint32_t profile;
+    uint32_t enabled;
+    int64_t validity_start;
+    int64_t validity_end;
+};
+
+static_assert(std::is_trivially_copyable<Header>::value, "Header must be POD");
+static_assert(sizeof(Header) % ALIGNMENT == 0, "Header size must be aligned");
+static_assert(sizeof(UserRecord) % ALIGNMENT == 0, "UserRecord size must be aligned");
+static_assert(sizeof(CredentialRecord) % ALIGNMENT == 0,
+              "CredentialRecord size must be aligned");
+
+/**
+ * Modification time of a file, in nanoseconds.
+ */
+inline int64_t source_mtime(const struct stat &st)
+{
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+           st.st_mtim.tv_nsec;
+}
+
+/**
+ * Key identifying a credential in the index.
+ */
+inline std::string credential_key(uint32_t type, const std::string &card_id,
+                                  const std::string &pin)
+{
+    std::string key(1, static_cast<char>(type));
+    key += card_id;
+    key.push_back('\0');
+    key += pin;
+    return key;
+}
+
+/**
+ * Seeded hash used by the credential index.
+ */
+inline uint64_t hash(const std::string &key, uint64_t seed)
+{
+    // FNV-1a, followed by a final mix because its low bits are weak.
+    uint64_t h = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+    for (unsigned char c : key)
+    {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * FNV-1a hash of `size` bytes.
+ */
+inline uint64_t checksum(const uint8_t *data, size_t size)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+}
+}
+}
+}
@@ -0,0 +1,336 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AuthImageWriter.hpp"
+#include "FileAuthSourceMapper.hpp"
+#include "core/auth/SimpleAccessProfile.hpp"
+#include "core/auth/User.hpp"
+#include "core/credentials/PinCode.hpp"
+#include "core/credentials/RFIDCard.hpp"
+#include "core/credentials/RFIDCardPin.hpp"
+#include "exception/fsexception.hpp"
+#include "tools/ScheduleBitmap.hpp"
+#include "tools/enforce.hpp"
+#include "tools/unixsyscall.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+using namespace Leosac::Module::Auth::AuthImage;
+
+static int64_t to_nanoseconds(const std::chrono::system_clock::time_point &tp)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch())
+        .count();
+}
+
+AuthImageWriter::AuthImageWriter(const FileAuthSourceMapper &mapper)
+    : strings_(1, '\0')
+{
+    for (const auto &user_entry : mapper.users_)
+    {
+        if (user_entry.second)
+            add_user(user_entry.second);
+    }
+
+    auto profile_of = [&](const Cred::ICredentialPtr &cred) {
+        auto itr = mapper.profiles_.find(cred->id());
+        return itr != mapper.profiles_.end() ? itr->second : nullptr;
+    };
+
+    for (const auto &card_entry : mapper.rfid_cards_)
+    {
+        const auto &card = card_entry.second;
+        add_credential(card, RFID_CARD, card->card_id(), "", card->nb_bits(),
+                       profile_of(card));
+    }
+    for (const auto &pin_entry : mapper.pin_codes_)
+    {
+        const auto &pin = pin_entry.second;
+        add_credential(pin, PIN_CODE, "", pin->pin_code(), 0, profile_of(pin));
+    }
+    for (const auto &card_pin_entry : mapper.rfid_cards_pin)
+    {
+        const auto &card_pin = card_pin_entry.second;
+        add_credential(card_pin, RFID_CARD_PIN, card_pin->card().card_id(),
+                       card_pin->pin().pin_code(), card_pin->card().nb_bits(),
+                       profile_of(card_pin));
+    }
+}
+
+uint32_t AuthImageWriter::add_string(const std::string &str)
+{
+    if (str.empty())
+        return 0;
+
+    auto itr = string_offsets_.find(str);
+    if (itr != string_offsets_.end())
+        return itr->second;
+
+    auto offset = static_cast<uint32_t>(strings_.size());
+    strings_.append(str);
+    strings_.push_back('\0');
+    string_offsets_[str] = offset;
+    return offset;
+}
+
+uint32_t AuthImageWriter::add_user(const ::Leosac::Auth::UserPtr &user)
+{
+    auto itr = user_indexes_.find(user.get());
+    if (itr != user_indexes_.end())
+        return itr->second;
+
+    UserRecord record{};
+    record.id             = user->id();
+    record.name           = add_string(user->username());
+    record.firstname      = add_string(user->firstname());
+    record.lastname       = add_string(user->lastname());
+    record.email          = add_string(user->email());
+    record.validity_start = to_nanoseconds(user->validity().start());
+    record.validity_end   = to_nanoseconds(user->validity().end());
+    record.enabled        = user->validity().is_enabled();
+
+    auto index = static_cast<uint32_t>(users_.size());
+    users_.push_back(record);
+    user_indexes_[user.get()] = index;
+    return index;
+}
+
+uint32_t AuthImageWriter::add_bitmap(const Tools::IScheduleCPtr &schedule)
+{
+    auto itr = bitmap_indexes_.find(schedule.get());
+    if (itr != bitmap_indexes_.end())
+        return itr->second;
+
+    auto index = static_cast<uint32_t>(bitmaps_.size() /
+                                       Tools::ScheduleBitmap::PACKED_SIZE);
+    bitmaps_.resize(bitmaps_.size() + Tools::ScheduleBitmap::PACKED_SIZE);
+    Tools::ScheduleBitmap(schedule->timeframes())
+        .pack(&bitmaps_[index * Tools::ScheduleBitmap::PACKED_SIZE]);
+    bitmap_indexes_[schedule.get()] = index;
+    return index;
+}
+
+uint32_t
+AuthImageWriter::add_profile(const ::Leosac::Auth::IAccessProfilePtr &profile)
+{
+    if (!profile)
+        return NO_ENTRY;
+    auto simple_profile =
+        std::dynamic_pointer_cast<::Leosac::Auth::SimpleAccessProfile>(profile);
+    LEOSAC_ENFORCE(simple_profile, "Profile cannot be compiled.");
+
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> grants;
+    for (const auto &sched : simple_profile->defaultSchedules())
+        grants.emplace_back(0, add_bitmap(sched), add_string(sched->name()));
+    for (const auto &door_schedules : simple_profile->schedules())
+    {
+        auto door = add_string(door_schedules.first);
+        for (const auto &sched : door_schedules.second)
+            grants.emplace_back(door, add_bitmap(sched), add_string(sched->name()));
+    }
+    std::sort(grants.begin(), grants.end());
+    grants.erase(std::unique(grants.begin(), grants.end()), grants.end());
+
+    // Most credentials share their profile with many others.
+    auto itr = profile_indexes_.find(grants);
+    if (itr != profile_indexes_.end())
+        return itr->second;
+
+    ProfileRecord record{};
+    record.first_grant = static_cast<uint32_t>(grants_.size());
+    record.grant_count = static_cast<uint32_t>(grants.size());
+    for (const auto &grant : grants)
+    {
+        grants_.push_back(GrantRecord{std::get<0>(grant), std::get<1>(grant),
+                                      std::get<2>(grant), 0});
+    }
+
+    auto index = static_cast<uint32_t>(profiles_.size());
+    profiles_.push_back(record);
+    profile_indexes_[grants] = index;
+    return index;
+}
+
+void AuthImageWriter::add_credential(
+    const Cred::ICredentialPtr &cred, uint32_t type, const std::string &card_id,
+    const std::string &pin, int bits,
+    const ::Leosac::Auth::IAccessProfilePtr &profile)
+{
+    auto owner = cred->owner().get_eager();
+
+    CredentialRecord record{};
+    record.id             = cred->id();
+    record.type           = type;
+    record.bits           = static_cast<uint32_t>(bits);
+    record.card_id        = add_string(card_id);
+    record.pin            = add_string(pin);
+    record.alias          = add_string(cred->alias());
+    record.user           = owner ? add_user(owner) : NO_ENTRY;
+    record.profile        = add_profile(profile);
+    record.enabled        = cred->validity().is_enabled();
+    record.validity_start = to_nanoseconds(cred->validity().start());
+    record.validity_end   = to_nanoseconds(cred->validity().end());
+
+    credentials_.push_back(record);
+    keys_.push_back(credential_key(type, card_id, pin));
+}
+
+void AuthImageWriter::build_index(std::vector<uint32_t> &buckets,
+                                  std::vector<uint32_t> &slots) const
+{
+    // Hash and displace: keys are spread into buckets of a few keys.
+    // Starting with the largest buckets, we look for a displacement that
+    // sends every key of the bucket to a free slot.
+    size_t nb_keys = keys_.size();
+    std::vector<std::vector<uint32_t>> bucket_keys(std::max<size_t>(1, nb_keys / 4));
+    for (uint32_t i = 0; i < nb_keys; ++i)
+        bucket_keys[hash(keys_[i], 0) % bucket_keys.size()].push_back(i);
+
+    std::vector<uint32_t> order(bucket_keys.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return bucket_keys[lhs].size() > bucket_keys[rhs].size();
+    });
+
+    buckets.assign(bucket_keys.size(), 0);
+    slots.assign(nb_keys + nb_keys / 4 + 1, NO_ENTRY);
+    std::vector<size_t> candidates;
+    for (auto bucket : order)
+    {
+        if (bucket_keys[bucket].empty())
+            break;
+        for (uint32_t displacement = 1;; ++displacement)
+        {
+            LEOSAC_ENFORCE(displacement < 1000000,
+                           "Cannot build the credential index.");
+            candidates.clear();
+            for (auto key : bucket_keys[bucket])
+            {
+                size_t slot = hash(keys_[key], displacement) % slots.size();
+                if (slots[slot] != NO_ENTRY ||
+                    std::find(candidates.begin(), candidates.end(), slot) !=
+                        candidates.end())
+                    break;
+                candidates.push_back(slot);
+            }
+            if (candidates.size() != bucket_keys[bucket].size())
+                continue;
+
+            for (size_t i = 0; i < candidates.size(); ++i)
+                slots[candidates[i]] = bucket_keys[bucket][i];
+            buckets[bucket] = displacement;
+            break;
+        }
+    }
+}
+
+struct stat AuthImageWriter::stat_source(const std::string &source_file)
+{
+    struct stat st;
+    if (stat(source_file.c_str(), &st) == -1)
+        throw FsException(Tools::UnixSyscall::getErrorString("stat", errno));
+    return st;
+}
+
+std::vector<uint8_t> AuthImageWriter::build(const struct stat &source_stat) const
+{
+    std::vector<uint32_t> buckets;
+    std::vector<uint32_t> slots;
+    build_index(buckets, slots);
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version      = VERSION;
+    header.byte_order   = BYTE_ORDER_MARK;
+    header.source_size  = static_cast<uint64_t>(source_stat.st_size);
+    header.source_mtime = source_mtime(source_stat);
+
+    std::vector<uint8_t> image(sizeof(Header));
+    auto append = [&](Section &section, const void *data, size_t size,
+                      size_t count) {
+        image.resize((image.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+        section.offset = image.size();
+        section.count  = count;
+        if (size)
+        {
+            image.resize(image.size() + size);
+            std::memcpy(&image[section.offset], data, size);
+        }
+    };
+
+    append(header.strings, strings_.data(), strings_.size(), strings_.size());
+    append(header.users, users_.data(), users_.size() * sizeof(UserRecord),
+           users_.size());
+    append(header.bitmaps, bitmaps_.data(), bitmaps_.size(),
+           bitmaps_.size() / Tools::ScheduleBitmap::PACKED_SIZE);
+    append(header.grants, grants_.data(), grants_.size() * sizeof(GrantRecord),
+           grants_.size());
+    append(header.profiles, profiles_.data(),
+           profiles_.size() * sizeof(ProfileRecord), profiles_.size());
+    append(header.credentials, credentials_.data(),
+           credentials_.size() * sizeof(CredentialRecord), credentials_.size());
+    append(header.buckets, buckets.data(), buckets.size() * sizeof(uint32_t),
+           buckets.size());
+    append(header.slots, slots.data(), slots.size() * sizeof(uint32_t),
+           slots.size());
+
+    header.image_size = image.size();
+    header.checksum =
+        checksum(image.data() + sizeof(Header), image.size() - sizeof(Header));
+    std::memcpy(image.data(), &header, sizeof(Header));
+    return image;
+}
+
+void AuthImageWriter::write(const std::string &source_file,
+                            const struct stat &source_stat,
+                            const std::string &path) const
+{
+    auto image = build(source_stat);
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(image.data()), image.size());
+        out.close();
+        if (!out)
+            throw FsException("Cannot write " + tmp_path);
+    }
+
+    // The file may have been modified while it was parsed: the image
+    // content would not match the size and mtime it records.
+    struct stat current;
+    if (stat(source_file.c_str(), &current) == -1 ||
+        current.st_dev != source_stat.st_dev ||
+        current.st_ino != source_stat.st_ino ||
+        current.st_size != source_stat.st_size ||
+        source_mtime(current) != source_mtime(source_stat))
+    {
+        unlink(tmp_path.c_str());
+        throw FsException(source_file + " was modified while being compiled.");
+    }
+    if (rename(tmp_path.c_str(), path.c_str()) == -1)
+        throw FsException(Tools::UnixSyscall::getErrorString("rename", errno));
+}
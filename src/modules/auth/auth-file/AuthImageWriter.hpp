@@ -0,0 +1,133 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AuthImage.hpp"
+#include "core/auth/AuthFwd.hpp"
+#include "core/credentials/CredentialFwd.hpp"
+#include "tools/ISchedule.hpp"
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+class FileAuthSourceMapper;
+
+/**
+ * Compile the content of a FileAuthSourceMapper into an image
+ * that ImageAuthSourceMapper can map in memory.
+ *
+ * See AuthImage for a description of the format.
+ */
+class AuthImageWriter
+{
+  public:
+    /**
+     * Collect users, credentials and compiled profiles from `mapper`.
+     */
+    explicit AuthImageWriter(const FileAuthSourceMapper &mapper);
+
+    /**
+     * Stat the auth file an image is about to be compiled from.
+     *
+     * Call this before loading the FileAuthSourceMapper, so that a
+     * modification made while the file is parsed is detected by write().
+     *
+     * @throws FsException if the file cannot be stat'ed.
+     */
+    static struct stat stat_source(const std::string &source_file);
+
+    /**
+     * Build the image.
+     *
+     * @param source_stat Stat of the auth file `mapper` was loaded from, taken
+     * before it was loaded. Its size and modification time are recorded in
+     * the image.
+     */
+    std::vector<uint8_t> build(const struct stat &source_stat) const;
+
+    /**
+     * Build the image and write it to `path`.
+     *
+     * The image is written to a temporary file first, then renamed, so that
+     * a process mapping `path` never sees a partial image.
+     *
+     * If `source_file` no longer matches `source_stat` once the image is
+     * written, the image may not describe the file it claims to be compiled
+     * from: it is discarded and FsException is thrown.
+     */
+    void write(const std::string &source_file, const struct stat &source_stat,
+               const std::string &path) const;
+
+  private:
+    uint32_t add_string(const std::string &str);
+
+    uint32_t add_user(const ::Leosac::Auth::UserPtr &user);
+
+    uint32_t add_bitmap(const Tools::IScheduleCPtr &schedule);
+
+    uint32_t add_profile(const ::Leosac::Auth::IAccessProfilePtr &profile);
+
+    void add_credential(const Cred::ICredentialPtr &cred, uint32_t type,
+                        const std::string &card_id, const std::string &pin,
+                        int bits, const ::Leosac::Auth::IAccessProfilePtr &profile);
+
+    /**
+     * Compute the perfect hash index of the credentials.
+     */
+    void build_index(std::vector<uint32_t> &buckets,
+                     std::vector<uint32_t> &slots) const;
+
+    std::string strings_;
+    std::unordered_map<std::string, uint32_t> string_offsets_;
+
+    std::vector<AuthImage::UserRecord> users_;
+    std::map<const ::Leosac::Auth::User *, uint32_t> user_indexes_;
+
+    std::vector<uint8_t> bitmaps_;
+    std::map<const Tools::ISchedule *, uint32_t> bitmap_indexes_;
+
+    std::vector<AuthImage::GrantRecord> grants_;
+    std::vector<AuthImage::ProfileRecord> profiles_;
+    /**
+     * Maps the (door, bitmap, schedule name) grants of a profile
+     * to the profile's index.
+     */
+    std::map<std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>, uint32_t>
+        profile_indexes_;
+
+    std::vector<AuthImage::CredentialRecord> credentials_;
+
+    /**
+     * Index key of each credential.
+     */
+    std::vector<std::string> keys_;
+};
+}
+}
+}
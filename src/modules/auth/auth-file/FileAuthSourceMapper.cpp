@@ -23,7 +23,6 @@
 #include "core/auth/Zone.hpp"
 #include "core/auth/Group.hpp"
 #include "core/auth/Interfaces/IAuthenticationSource.hpp"
-#include "core/auth/ProfileMerger.hpp"
 #include "core/auth/User.hpp"
 #include "core/credentials/ICredential.hpp"
 #include "core/credentials/PinCode.hpp"
@@ -34,15 +33,51 @@
 #include "tools/Schedule.hpp"
 #include "tools/XmlPropertyTree.hpp"
 #include "tools/log.hpp"
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <boost/functional/hash.hpp>
 #include <tools/enforce.hpp>
 
 using namespace Leosac::Module::Auth;
 using namespace Leosac::Auth;
 
+/**
+ * Hash a configuration subtree: key and data of every node, in order.
+ */
+static size_t fingerprint(const boost::property_tree::ptree &node)
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, node.data());
+    for (const auto &child : node)
+    {
+        boost::hash_combine(seed, child.first);
+        boost::hash_combine(seed, fingerprint(child.second));
+    }
+    return seed;
+}
+
 FileAuthSourceMapper::FileAuthSourceMapper(const std::string &auth_file)
     : config_file_(auth_file)
     , xmlnne_(config_file_)
+    , next_user_id_(1)
+    , next_cred_id_(1)
+    , policy_fingerprint_(0)
+{
+    load(nullptr);
+}
+
+FileAuthSourceMapper::FileAuthSourceMapper(const std::string &auth_file,
+                                           const FileAuthSourceMapper &previous)
+    : config_file_(auth_file)
+    , xmlnne_(config_file_)
+    , next_user_id_(previous.next_user_id_)
+    , next_cred_id_(previous.next_cred_id_)
+    , policy_fingerprint_(0)
+{
+    load(&previous);
+}
+
+void FileAuthSourceMapper::load(const FileAuthSourceMapper *previous)
 {
     try
     {
@@ -53,13 +88,13 @@ FileAuthSourceMapper::FileAuthSourceMapper(const std::string &auth_file)
         //          - Schedule, and schedule mapping
 
         DEBUG("Will load tree");
-        auto &&additional_config = Tools::propertyTreeFromXmlFile(auth_file);
+        auto &&additional_config = Tools::propertyTreeFromXmlFile(config_file_);
         additional_config        = additional_config.get_child("root");
         DEBUG("Tree loaded");
 
         const auto &users_tree = additional_config.get_child_optional("users");
         if (users_tree)
-            load_users(*users_tree);
+            load_users(*users_tree, previous);
 
         const auto &groups_tree =
             additional_config.get_child_optional("group_mapping");
@@ -69,7 +104,7 @@ FileAuthSourceMapper::FileAuthSourceMapper(const std::string &auth_file)
         const auto &credentials_tree =
             additional_config.get_child_optional("credentials");
         if (credentials_tree)
-            load_credentials(*credentials_tree);
+            load_credentials(*credentials_tree, previous);
 
         const auto &schedules_tree =
             additional_config.get_child_optional("schedules");
@@ -81,6 +116,12 @@ FileAuthSourceMapper::FileAuthSourceMapper(const std::string &auth_file)
         if (schedule_mapping_tree)
             map_schedules(*schedule_mapping_tree);
 
+        for (const auto &section : {"group_mapping", "schedules", "schedules_mapping"})
+        {
+            const auto &tree = additional_config.get_child_optional(section);
+            boost::hash_combine(policy_fingerprint_, tree ? fingerprint(*tree) : 0);
+        }
+        compile_profiles(previous);
         DEBUG("Ready");
     }
     catch (std::exception &e)
@@ -179,6 +220,20 @@ void FileAuthSourceMapper::load_groups(
             grp->member_add(user);
         }
     }
+
+    // Index memberships once all groups are known: a group defined twice
+    // replaces the previous definition.
+    for (const auto &grp_map : groups_)
+    {
+        const auto &grp = grp_map.second;
+        for (const auto &member : grp->members())
+        {
+            auto &user_groups = user_groups_[member->id()];
+            if (std::find(user_groups.begin(), user_groups.end(), grp) ==
+                user_groups.end())
+                user_groups.push_back(grp);
+        }
+    }
 }
 
 std::vector<GroupPtr> FileAuthSourceMapper::groups() const
@@ -193,48 +248,23 @@ std::vector<GroupPtr> FileAuthSourceMapper::groups() const
     return ret;
 }
 
-std::vector<GroupPtr> FileAuthSourceMapper::get_user_groups(Leosac::Auth::UserPtr u)
+const std::vector<GroupPtr> &
+FileAuthSourceMapper::get_user_groups(const Leosac::Auth::UserPtr &u) const
 {
+    static const std::vector<GroupPtr> no_groups;
     assert(u);
-    std::vector<GroupPtr> grps;
-    auto lambda_cmp = [&](UserPtr user) -> bool {
-        return user->username() == u->username();
-    };
-
-    for (const auto &grp_map : groups_)
-    {
-        GroupPtr grp;
-        std::tie(std::ignore, grp) = grp_map;
-
-        if (std::find_if(grp->members().begin(), grp->members().end(), lambda_cmp) !=
-            grp->members().end())
-        {
-            grps.push_back(grp);
-        }
-    }
-    return grps;
-}
-
-IAccessProfilePtr
-FileAuthSourceMapper::merge_profiles(const std::vector<IAccessProfilePtr> profiles)
-{
-    ProfileMerger merger;
-    IAccessProfilePtr result(new SimpleAccessProfile());
 
-    for (auto &profile : profiles)
-    {
-        if (profile)
-            result = merger.merge(result, profile);
-    }
-    if (result->schedule_count())
-        return result;
-    return nullptr;
+    auto itr = user_groups_.find(u->id());
+    if (itr != user_groups_.end())
+        return itr->second;
+    return no_groups;
 }
 
 void FileAuthSourceMapper::load_credentials(
-    const boost::property_tree::ptree &credentials)
+    const boost::property_tree::ptree &credentials,
+    const FileAuthSourceMapper *previous)
 {
-    Cred::CredentialId cred_id = 1;
+    size_t reused = 0;
     for (const auto &mapping : credentials)
     {
         const std::string &node_name            = mapping.first;
@@ -250,6 +280,9 @@ void FileAuthSourceMapper::load_credentials(
         assert(user);
 
         Cred::ICredentialPtr credential;
+        // Credentials whose definition didn't change are shared with the
+        // previous mapper. Their owner must have been reused too.
+        size_t fp = fingerprint(node);
 
         // does this entry map a wiegand card?
         auto opt_child = node.get_child_optional("WiegandCard");
@@ -258,9 +291,15 @@ void FileAuthSourceMapper::load_credentials(
             std::string card_id = opt_child->get<std::string>("card_id");
             int bits            = opt_child->get<int>("bits");
 
-            Cred::RFIDCardPtr c = std::make_shared<Cred::RFIDCard>();
-            c->card_id(card_id);
-            c->nb_bits(bits);
+            Cred::RFIDCardPtr c;
+            if (previous)
+                c = previous->reusable_cred(previous->rfid_cards_, card_id, fp, user);
+            if (!c)
+            {
+                c = std::make_shared<Cred::RFIDCard>();
+                c->card_id(card_id);
+                c->nb_bits(bits);
+            }
             rfid_cards_[card_id] = c;
             credential           = c;
         }
@@ -269,8 +308,14 @@ void FileAuthSourceMapper::load_credentials(
             // or to a PIN code ?
             std::string pin = opt_child->get<std::string>("pin");
 
-            Cred::PinCodePtr p = std::make_shared<Cred::PinCode>();
-            p->pin_code(pin);
+            Cred::PinCodePtr p;
+            if (previous)
+                p = previous->reusable_cred(previous->pin_codes_, pin, fp, user);
+            if (!p)
+            {
+                p = std::make_shared<Cred::PinCode>();
+                p->pin_code(pin);
+            }
             pin_codes_[pin] = p;
             credential      = p;
         }
@@ -279,29 +324,75 @@ void FileAuthSourceMapper::load_credentials(
             std::string card_id = opt_child->get<std::string>("card_id");
             std::string pin     = opt_child->get<std::string>("pin");
             int bits            = opt_child->get<int>("bits");
+            auto key            = std::make_pair(card_id, pin);
 
-            auto c = std::make_shared<Cred::RFIDCard>();
-            c->id(cred_id++);
-            c->card_id(card_id);
-            c->nb_bits(bits);
-
-            auto p = std::make_shared<Cred::PinCode>();
-            p->id(cred_id++);
-            p->pin_code(pin);
-            credential = std::make_shared<Cred::RFIDCardPin>(c, p);
-            rfid_cards_pin[std::make_pair(card_id, pin)] =
-                assert_cast<Cred::RFIDCardPinPtr>(credential);
+            Cred::RFIDCardPinPtr cp;
+            if (previous)
+                cp = previous->reusable_cred(previous->rfid_cards_pin, key, fp, user);
+            if (!cp)
+            {
+                auto c = std::make_shared<Cred::RFIDCard>();
+                c->id(next_cred_id_++);
+                c->card_id(card_id);
+                c->nb_bits(bits);
+
+                auto p = std::make_shared<Cred::PinCode>();
+                p->id(next_cred_id_++);
+                p->pin_code(pin);
+                cp = std::make_shared<Cred::RFIDCardPin>(c, p);
+            }
+            rfid_cards_pin[key] = cp;
+            credential          = cp;
         }
         assert(opt_child);
-        credential->id(cred_id++);
-        credential->validity(extract_credentials_validity(*opt_child));
-        credential->owner(user);
+        if (credential->id())
+        {
+            reused++;
+        }
+        else
+        {
+            credential->id(next_cred_id_++);
+            credential->validity(extract_credentials_validity(*opt_child));
+            credential->owner(user);
 
-        // Alias in place of id, so that it can be a string (making it easier to
-        // configure from the a XML file)
-        credential->alias(opt_child->get<std::string>("id", ""));
+            // Alias in place of id, so that it can be a string (making it easier
+            // to configure from the a XML file)
+            credential->alias(opt_child->get<std::string>("id", ""));
+        }
+        cred_fingerprints_[credential->id()] = fp;
         add_cred_to_id_map(credential);
     }
+    if (previous)
+        DEBUG("Reused " << reused << " unchanged credentials.");
+}
+
+UserPtr FileAuthSourceMapper::reusable_user(const std::string &name,
+                                            size_t fp) const
+{
+    auto itr = users_.find(name);
+    if (itr == users_.end() || !itr->second)
+        return nullptr;
+
+    auto fp_itr = user_fingerprints_.find(itr->second->id());
+    if (fp_itr == user_fingerprints_.end() || fp_itr->second != fp)
+        return nullptr;
+    return itr->second;
+}
+
+template <typename CredMap, typename Key>
+typename CredMap::mapped_type
+FileAuthSourceMapper::reusable_cred(const CredMap &creds, const Key &key, size_t fp,
+                                    const UserPtr &owner) const
+{
+    auto itr = creds.find(key);
+    if (itr == creds.end())
+        return nullptr;
+
+    auto fp_itr = cred_fingerprints_.find(itr->second->id());
+    if (fp_itr == cred_fingerprints_.end() || fp_itr->second != fp ||
+        itr->second->owner().get_eager() != owner)
+        return nullptr;
+    return itr->second;
 }
 
 void FileAuthSourceMapper::load_schedules(
@@ -388,15 +479,61 @@ void FileAuthSourceMapper::map_schedules(
           }
 
           mappings_.push_back(sm);
+          index_mapping(mappings_.size() - 1);
         }
     }
 }
 
-void FileAuthSourceMapper::load_users(const boost::property_tree::ptree &users)
+template <typename Id>
+std::vector<Tools::ScheduleMappingPtr>
+FileAuthSourceMapper::indexed_mappings(const MappingIndex<Id> &index,
+                                       const Id &id) const
+{
+    std::vector<Tools::ScheduleMappingPtr> ret;
+    auto itr = index.find(id);
+    if (itr != index.end())
+    {
+        for (auto mapping_idx : itr->second)
+            ret.push_back(mappings_[mapping_idx]);
+    }
+    return ret;
+}
+
+std::vector<Tools::ScheduleMappingPtr>
+FileAuthSourceMapper::user_mappings(Leosac::Auth::UserId id) const
+{
+    return indexed_mappings(user_mappings_, id);
+}
+
+std::vector<Tools::ScheduleMappingPtr>
+FileAuthSourceMapper::group_mappings(Leosac::Auth::GroupId id) const
+{
+    return indexed_mappings(group_mappings_, id);
+}
+
+std::vector<Tools::ScheduleMappingPtr>
+FileAuthSourceMapper::credential_mappings(Cred::CredentialId id) const
+{
+    return indexed_mappings(cred_mappings_, id);
+}
+
+void FileAuthSourceMapper::index_mapping(size_t mapping_idx)
+{
+    const auto &mapping = mappings_[mapping_idx];
+
+    for (const auto &lazy_weak_user : mapping->users())
+        user_mappings_[lazy_weak_user.object_id()].push_back(mapping_idx);
+    for (const auto &lazy_weak_group : mapping->groups())
+        group_mappings_[lazy_weak_group.object_id()].push_back(mapping_idx);
+    for (const auto &lazy_weak_cred : mapping->credentials())
+        cred_mappings_[lazy_weak_cred.object_id()].push_back(mapping_idx);
+}
+
+void FileAuthSourceMapper::load_users(const boost::property_tree::ptree &users,
+                                      const FileAuthSourceMapper *previous)
 {
     // We use the user id internally to uniquely identify user
     // through ScheduleMapping.
-    UserId user_id = 1;
     for (const auto &user : users)
     {
         const std::string &node_name            = user.first;
@@ -405,23 +542,29 @@ void FileAuthSourceMapper::load_users(const boost::property_tree::ptree &users)
         xmlnne_("user", node_name);
 
         std::string username  = node.get<std::string>("name");
-        std::string firstname = node.get<std::string>("firstname", "");
-        std::string lastname  = node.get<std::string>("lastname", "");
-        std::string email     = node.get<std::string>("email", "");
-
         if (username == "UNKNOWN_USER") // reserved username
             throw ConfigException(config_file_,
                                   "'UNKNOWN_USER' is a reserved name. Do not use.");
 
-        UserPtr uptr(std::make_unique<User>(user_id++));
-        uptr->username(username);
-        uptr->firstname(firstname);
-        uptr->lastname(lastname);
-        uptr->email(email);
-        uptr->validity(extract_credentials_validity(node));
-
-        // create an empty profile
-        uptr->profile(SimpleAccessProfilePtr(new SimpleAccessProfile()));
+        // Users whose definition didn't change are shared with the
+        // previous mapper.
+        size_t fp = fingerprint(node);
+        UserPtr uptr;
+        if (previous)
+            uptr = previous->reusable_user(username, fp);
+        if (!uptr)
+        {
+            uptr = std::make_shared<User>(next_user_id_++);
+            uptr->username(username);
+            uptr->firstname(node.get<std::string>("firstname", ""));
+            uptr->lastname(node.get<std::string>("lastname", ""));
+            uptr->email(node.get<std::string>("email", ""));
+            uptr->validity(extract_credentials_validity(node));
+
+            // create an empty profile
+            uptr->profile(SimpleAccessProfilePtr(new SimpleAccessProfile()));
+        }
+        user_fingerprints_[uptr->id()] = fp;
 
         if (users_.count(username))
         {
@@ -471,8 +614,6 @@ Leosac::Auth::IAccessProfilePtr
 FileAuthSourceMapper::buildProfile(Leosac::Cred::ICredentialPtr cred)
 {
     assert(cred);
-    std::vector<GroupPtr> grps;
-    std::vector<IAccessProfilePtr> profiles; // profiles that apply to the user.
 
     // Sanity check
     if (cred->owner())
@@ -493,20 +634,13 @@ FileAuthSourceMapper::buildProfile(Leosac::Cred::ICredentialPtr cred)
         return nullptr;
     }
 
-    // First, create the profile for the user, if any
-    if (cred_owner)
-    {
-        profiles.push_back(build_user_profile(cred_owner));
-
-        // Profile for user's groups.
-        grps = get_user_groups(cred_owner);
-        for (auto &grp : grps)
-            profiles.push_back(build_group_profile(grp));
-    }
-
-    profiles.push_back(build_cred_profile(cred));
-
-    return merge_profiles(profiles);
+    // Profiles are compiled at load time. Credentials that are not
+    // known to this mapper were not touched by `mapToUser()` and
+    // therefore have no matching entry.
+    auto itr = profiles_.find(cred->id());
+    if (itr != profiles_.end())
+        return itr->second;
+    return nullptr;
 }
 
 static void
@@ -557,48 +691,71 @@ add_schedule_from_mapping_to_profile(Leosac::Tools::ScheduleMappingPtr mapping,
     }
 }
 
-SimpleAccessProfilePtr FileAuthSourceMapper::build_user_profile(UserPtr u)
+void FileAuthSourceMapper::compile_profiles(const FileAuthSourceMapper *previous)
 {
-    ASSERT_LOG(u, "User is null");
-
-    auto profile(std::make_shared<SimpleAccessProfile>());
-    for (const auto &mapping : mappings_)
-    {
-        if (mapping->has_user(u->id()))
+    // A credential is reused only if it is unchanged and owned by an
+    // unchanged user. Its profile is the same, unless access rights
+    // definitions changed.
+    bool reuse_profiles =
+        previous && previous->policy_fingerprint_ == policy_fingerprint_;
+    size_t reused = 0;
+
+    auto compile = [&](const Cred::ICredentialPtr &cred) {
+        if (reuse_profiles)
         {
-            add_schedule_from_mapping_to_profile(mapping, profile);
+            auto itr = previous->profiles_.find(cred->id());
+            if (itr != previous->profiles_.end())
+            {
+                profiles_[cred->id()] = itr->second;
+                reused++;
+                return;
+            }
         }
-    }
-    return profile;
-}
-
-SimpleAccessProfilePtr FileAuthSourceMapper::build_group_profile(GroupPtr g)
-{
-    ASSERT_LOG(g, "Group is null");
+        profiles_[cred->id()] =
+            compile_cred_profile(cred, cred->owner().get_eager());
+    };
 
-    auto profile(std::make_shared<SimpleAccessProfile>());
-    for (const auto &mapping : mappings_)
-    {
-        if (mapping->has_group(g->id()))
-        {
-            add_schedule_from_mapping_to_profile(mapping, profile);
-        }
-    }
-    return profile;
+    for (const auto &card_entry : rfid_cards_)
+        compile(card_entry.second);
+    for (const auto &pin_entry : pin_codes_)
+        compile(pin_entry.second);
+    for (const auto &card_pin_entry : rfid_cards_pin)
+        compile(card_pin_entry.second);
+    DEBUG("Compiled " << profiles_.size() - reused << " access profiles, reused "
+                      << reused << ".");
 }
 
-Leosac::Auth::SimpleAccessProfilePtr
-FileAuthSourceMapper::build_cred_profile(Leosac::Cred::ICredentialPtr c)
+Leosac::Auth::IAccessProfilePtr FileAuthSourceMapper::compile_cred_profile(
+    const Leosac::Cred::ICredentialPtr &c, const Leosac::Auth::UserPtr &owner)
 {
     ASSERT_LOG(c, "Credential is null");
 
-    auto profile(std::make_shared<SimpleAccessProfile>());
-    for (const auto &mapping : mappings_)
+    // Positions of the mappings that apply. A mapping may be reached
+    // through several objects but must be applied once.
+    std::vector<size_t> applicable;
+    auto collect = [&](const auto &index, const auto &object_id) {
+        auto itr = index.find(object_id);
+        if (itr != index.end())
+            applicable.insert(applicable.end(), itr->second.begin(),
+                              itr->second.end());
+    };
+
+    collect(cred_mappings_, c->id());
+    if (owner)
     {
-        if (mapping->has_cred(c->id()))
-        {
-            add_schedule_from_mapping_to_profile(mapping, profile);
-        }
+        collect(user_mappings_, owner->id());
+        for (const auto &grp : get_user_groups(owner))
+            collect(group_mappings_, grp->id());
     }
-    return profile;
+    std::sort(applicable.begin(), applicable.end());
+    applicable.erase(std::unique(applicable.begin(), applicable.end()),
+                     applicable.end());
+
+    auto profile(std::make_shared<SimpleAccessProfile>());
+    for (auto mapping_idx : applicable)
+        add_schedule_from_mapping_to_profile(mappings_[mapping_idx], profile);
+
+    if (profile->schedule_count())
+        return profile;
+    return nullptr;
 }
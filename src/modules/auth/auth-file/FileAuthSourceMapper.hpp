@@ -43,6 +43,9 @@ namespace Auth
 {
 /**
 * Use a file to map auth source (card, PIN, etc) to user.
+*
+* The object is not modified once constructed: `mapToUser()` and
+* `buildProfile()` can be called concurrently from multiple threads.
 */
 class FileAuthSourceMapper
     : public ::Leosac::Auth::IAuthSourceMapper,
@@ -53,6 +56,21 @@ class FileAuthSourceMapper
   public:
     FileAuthSourceMapper(const std::string &auth_file);
 
+    /**
+    * Load `auth_file`, reusing what didn't change since `previous`
+    * was loaded.
+    *
+    * Users and credentials whose definition is unchanged are shared with
+    * `previous`, and keep their id. If groups, schedules and schedules
+    * mapping are unchanged as well, the compiled profiles of those
+    * credentials are shared too, so that only new or modified
+    * credentials are compiled.
+    *
+    * `previous` is not modified and can keep serving requests.
+    */
+    FileAuthSourceMapper(const std::string &auth_file,
+                         const FileAuthSourceMapper &previous);
+
     /**
     * Try to map a wiegand card_id to a user.
     */
@@ -75,25 +93,72 @@ class FileAuthSourceMapper
 
     std::vector<Leosac::Auth::GroupPtr> groups() const override;
 
+    /**
+    * Schedule mappings that reference the user, the group or the
+    * credential `id`, as found in the reverse indexes.
+    */
+    std::vector<Tools::ScheduleMappingPtr>
+    user_mappings(Leosac::Auth::UserId id) const;
+    std::vector<Tools::ScheduleMappingPtr>
+    group_mappings(Leosac::Auth::GroupId id) const;
+    std::vector<Tools::ScheduleMappingPtr>
+    credential_mappings(Cred::CredentialId id) const;
+
   private:
+    /**
+    * Reverse index from an object id to the position, in `mappings_`,
+    * of the mappings that reference the object.
+    */
+    template <typename Id>
+    using MappingIndex = std::unordered_map<Id, std::vector<size_t>>;
+
+    template <typename Id>
+    std::vector<Tools::ScheduleMappingPtr>
+    indexed_mappings(const MappingIndex<Id> &index, const Id &id) const;
+
+    /**
+    * Compiles the loaded users, credentials and profiles into an image.
+    */
+    friend class AuthImageWriter;
+
+    /**
+    * Load the configuration file.
+    *
+    * @param previous A previously loaded mapper whose objects can be
+    * reused. May be null.
+    */
+    void load(const FileAuthSourceMapper *previous);
+
     /**
     * Lookup a credentials by ID.
     */
     Cred::ICredentialPtr find_cred_by_alias(const std::string &alias);
 
     /**
-     * Build an access for a user.
+     * Compile the access profile of every known credential.
      *
-     * This simply check for mapping which are linked directly to
-     * the given user.
+     * This is done once, after the configuration file has been
+     * loaded, so that `buildProfile()` is reduced to a lookup.
+     *
+     * @param previous Mapper whose profiles can be reused. May be null.
      */
-    Leosac::Auth::SimpleAccessProfilePtr build_user_profile(Leosac::Auth::UserPtr u);
-
-    Leosac::Auth::SimpleAccessProfilePtr
-    build_group_profile(Leosac::Auth::GroupPtr g);
+    void compile_profiles(const FileAuthSourceMapper *previous);
 
-    Leosac::Auth::SimpleAccessProfilePtr
-    build_cred_profile(Leosac::Cred::ICredentialPtr c);
+    /**
+     * Build the profile for a credential by gathering the schedules of
+     * the mappings that apply either to the credential, to its owner, or
+     * to one of the owner's groups.
+     *
+     * Only the relevant mappings are visited, thanks to the reverse
+     * indexes built at load time.
+     *
+     * @param c The credential.
+     * @param owner The owner of the credential. May be null.
+     * @return The profile, or nullptr if it would contain no schedule.
+     */
+    Leosac::Auth::IAccessProfilePtr
+    compile_cred_profile(const Leosac::Cred::ICredentialPtr &c,
+                         const Leosac::Auth::UserPtr &owner);
 
     /**
     * Store the credential to the id <-> credential map if the id is
@@ -104,8 +169,11 @@ class FileAuthSourceMapper
     /**
     * Load users from configuration tree, storing them
     * in the `users_` map.
+    *
+    * @param previous Mapper whose users can be reused. May be null.
     */
-    void load_users(const boost::property_tree::ptree &users);
+    void load_users(const boost::property_tree::ptree &users,
+                    const FileAuthSourceMapper *previous);
 
     /**
     * Load the schedules information from the config tree.
@@ -121,32 +189,52 @@ class FileAuthSourceMapper
 
     /**
     * Extract group membership.
+    *
+    * This also builds the user -> groups index.
     */
     void load_groups(const boost::property_tree::ptree &group_mapping);
 
     /**
     * Eager loading of credentials to avoid walking through the
     * ptree whenever we have to grant/deny an access.
+    *
+    * @param previous Mapper whose credentials can be reused. May be null.
     */
-    void load_credentials(const boost::property_tree::ptree &credentials);
+    void load_credentials(const boost::property_tree::ptree &credentials,
+                          const FileAuthSourceMapper *previous);
 
     /**
-    * Naive method that bruteforce groups to try to find
-    * membership for an user.
+    * Retrieve the user `name` if its definition had fingerprint
+    * `fp`, or nullptr.
+    */
+    Leosac::Auth::UserPtr reusable_user(const std::string &name, size_t fp) const;
+
+    /**
+    * Retrieve the credential stored under `key` in `creds` if its
+    * definition had fingerprint `fp` and if it is owned by `owner`,
+    * or nullptr.
+    */
+    template <typename CredMap, typename Key>
+    typename CredMap::mapped_type
+    reusable_cred(const CredMap &creds, const Key &key, size_t fp,
+                  const Leosac::Auth::UserPtr &owner) const;
+
+    /**
+    * Retrieve the groups an user is a member of, from the
+    * user -> groups index.
     *
     * @param u a non-null pointer to user.
     * @return all group the user is a member of.
     */
-    std::vector<Leosac::Auth::GroupPtr> get_user_groups(Leosac::Auth::UserPtr u);
+    const std::vector<Leosac::Auth::GroupPtr> &
+    get_user_groups(const Leosac::Auth::UserPtr &u) const;
 
     /**
-    * Merge a bunch of profiles together and returns a new profile.
-     *
-     * If the resulting profile contains the schedule, this method
-     * will return nullptr.
+    * Reference the mapping at position `mapping_idx` in `mappings_`
+    * from the reverse indexes of the users, groups and credentials
+    * it applies to.
     */
-    Leosac::Auth::IAccessProfilePtr
-    merge_profiles(const std::vector<Leosac::Auth::IAccessProfilePtr> profiles);
+    void index_mapping(size_t mapping_idx);
 
     Leosac::Auth::ValidityInfo
     extract_credentials_validity(const boost::property_tree::ptree &node);
@@ -196,7 +284,51 @@ class FileAuthSourceMapper
      */
     std::vector<Tools::ScheduleMappingPtr> mappings_;
 
+    /**
+     * Maps user id to the groups the user is a member of.
+     */
+    std::unordered_map<Leosac::Auth::UserId, std::vector<Leosac::Auth::GroupPtr>>
+        user_groups_;
+
+    /**
+     * Reverse indexes of the mappings, by user id, group id and
+     * credential id.
+     */
+    MappingIndex<Leosac::Auth::UserId> user_mappings_;
+    MappingIndex<Leosac::Auth::GroupId> group_mappings_;
+    MappingIndex<Cred::CredentialId> cred_mappings_;
+
     Tools::XmlNodeNameEnforcer xmlnne_;
+
+    /**
+     * Ids given to the next new user and credential.
+     *
+     * When reloading, numbering continues from the previous mapper's
+     * so that new objects never share the id of a reused one.
+     */
+    Leosac::Auth::UserId next_user_id_;
+    Cred::CredentialId next_cred_id_;
+
+    /**
+     * Fingerprint of the definition of each user, and of each credential.
+     */
+    std::unordered_map<Leosac::Auth::UserId, size_t> user_fingerprints_;
+    std::unordered_map<Cred::CredentialId, size_t> cred_fingerprints_;
+
+    /**
+     * Fingerprint of the sections that define access rights: groups,
+     * schedules and schedules mapping.
+     */
+    size_t policy_fingerprint_;
+
+    /**
+     * Maps credential id to its precompiled access profile.
+     *
+     * The table is built at load time and never modified afterward.
+     * Credentials without any schedule are mapped to nullptr.
+     */
+    std::unordered_map<Cred::CredentialId, Leosac::Auth::IAccessProfilePtr>
+        profiles_;
 };
 using FileAuthSourceMapperPtr = std::shared_ptr<FileAuthSourceMapper>;
 }
@@ -0,0 +1,408 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ImageAuthSourceMapper.hpp"
+#include "core/auth/AuthTarget.hpp"
+#include "core/auth/Interfaces/IAccessProfile.hpp"
+#include "core/auth/User.hpp"
+#include "core/credentials/PinCode.hpp"
+#include "core/credentials/RFIDCard.hpp"
+#include "core/credentials/RFIDCardPin.hpp"
+#include "exception/moduleexception.hpp"
+#include "tools/ScheduleBitmap.hpp"
+#include "tools/log.hpp"
+#include "tools/unixsyscall.hpp"
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+using namespace Leosac::Module::Auth::AuthImage;
+using namespace Leosac::Auth;
+
+struct ImageAuthSourceMapper::MappedImage
+{
+    MappedImage(const std::string &image_file)
+        : data(nullptr)
+        , size(0)
+    {
+        int fd = open(image_file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            throw ModuleException(Tools::UnixSyscall::getErrorString("open", errno));
+
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+        {
+            int err = errno;
+            close(fd);
+            throw ModuleException(Tools::UnixSyscall::getErrorString("fstat", err));
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size < sizeof(Header))
+        {
+            close(fd);
+            throw ModuleException("Auth image " + image_file + " is truncated.");
+        }
+
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        int err    = errno;
+        close(fd);
+        if (addr == MAP_FAILED)
+            throw ModuleException(Tools::UnixSyscall::getErrorString("mmap", err));
+        data = static_cast<const uint8_t *>(addr);
+    }
+
+    ~MappedImage()
+    {
+        munmap(const_cast<uint8_t *>(data), size);
+    }
+
+    MappedImage(const MappedImage &) = delete;
+    MappedImage &operator=(const MappedImage &) = delete;
+
+    const Header &header() const
+    {
+        return *reinterpret_cast<const Header *>(data);
+    }
+
+    template <typename T>
+    const T *section(const Section &s) const
+    {
+        return reinterpret_cast<const T *>(data + s.offset);
+    }
+
+    const char *string(uint32_t offset) const
+    {
+        return section<char>(header().strings) + offset;
+    }
+
+    const uint8_t *data;
+    size_t size;
+};
+
+namespace
+{
+/**
+ * Access profile backed by the grants of a mapped image.
+ */
+class ImageAccessProfile : public IAccessProfile
+{
+  public:
+    using MappedImagePtr = std::shared_ptr<const ImageAuthSourceMapper::MappedImage>;
+
+    ImageAccessProfile(MappedImagePtr image, const ProfileRecord &profile)
+        : image_(std::move(image))
+        , grants_(image_->section<GrantRecord>(image_->header().grants) +
+                  profile.first_grant)
+        , grant_count_(profile.grant_count)
+    {
+    }
+
+    bool isAccessGranted(const std::chrono::system_clock::time_point &date,
+                         AuthTargetPtr target) override
+    {
+        auto minute  = Tools::ScheduleBitmap::week_minute(date);
+        auto bitmaps = image_->section<uint8_t>(image_->header().bitmaps);
+
+        // Same rules as SimpleAccessProfile: schedules that apply
+        // to all doors, then those specific to the target.
+        for (size_t i = 0; i < grant_count_; ++i)
+        {
+            const auto &grant = grants_[i];
+            if (grant.door &&
+                (!target || target->name() != image_->string(grant.door)))
+                continue;
+            if (Tools::ScheduleBitmap::test_packed(
+                    bitmaps + grant.bitmap * Tools::ScheduleBitmap::PACKED_SIZE,
+                    minute))
+            {
+                INFO("Access is granted through schedule '"
+                     << image_->string(grant.schedule) << "'");
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t schedule_count() const override
+    {
+        return grant_count_;
+    }
+
+  private:
+    MappedImagePtr image_;
+    const GrantRecord *grants_;
+    size_t grant_count_;
+};
+
+std::chrono::system_clock::time_point from_nanoseconds(int64_t ns)
+{
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(ns)));
+}
+
+ValidityInfo make_validity(uint32_t enabled, int64_t start, int64_t end)
+{
+    ValidityInfo validity;
+    validity.set_enabled(enabled);
+    validity.start(from_nanoseconds(start));
+    validity.end(from_nanoseconds(end));
+    return validity;
+}
+
+bool section_fits(const Section &s, size_t record_size, size_t image_size)
+{
+    return s.offset % ALIGNMENT == 0 && s.offset <= image_size &&
+           s.count <= (image_size - s.offset) / record_size;
+}
+}
+
+ImageAuthSourceMapper::ImageAuthSourceMapper(const std::string &image_file)
+    : image_(std::make_shared<MappedImage>(image_file))
+{
+    const auto &header = image_->header();
+    auto invalid       = [&](const std::string &reason) {
+        return ModuleException("Auth image " + image_file + " is invalid: " +
+                               reason);
+    };
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)))
+        throw invalid("bad magic");
+    if (header.version != VERSION)
+        throw invalid("unsupported version " + std::to_string(header.version));
+    if (header.byte_order != BYTE_ORDER_MARK)
+        throw invalid("compiled for another byte order");
+    if (header.image_size != image_->size)
+        throw invalid("bad size");
+
+    // Records are trusted once the image has been validated, so that
+    // lookups need no bound check.
+    const size_t size = image_->size;
+    if (!section_fits(header.strings, 1, size) ||
+        !section_fits(header.users, sizeof(UserRecord), size) ||
+        !section_fits(header.bitmaps, Tools::ScheduleBitmap::PACKED_SIZE, size) ||
+        !section_fits(header.grants, sizeof(GrantRecord), size) ||
+        !section_fits(header.profiles, sizeof(ProfileRecord), size) ||
+        !section_fits(header.credentials, sizeof(CredentialRecord), size) ||
+        !section_fits(header.buckets, sizeof(uint32_t), size) ||
+        !section_fits(header.slots, sizeof(uint32_t), size) ||
+        !header.buckets.count || !header.slots.count)
+        throw invalid("section out of bounds");
+    if (header.checksum !=
+        checksum(image_->data + sizeof(Header), size - sizeof(Header)))
+        throw invalid("bad checksum");
+
+    auto strings = image_->section<char>(header.strings);
+    if (!header.strings.count || strings[header.strings.count - 1] != '\0')
+        throw invalid("bad string table");
+
+    auto check_string = [&](uint32_t offset) {
+        if (offset >= header.strings.count)
+            throw invalid("string out of bounds");
+    };
+    auto users = image_->section<UserRecord>(header.users);
+    for (size_t i = 0; i < header.users.count; ++i)
+    {
+        check_string(users[i].name);
+        check_string(users[i].firstname);
+        check_string(users[i].lastname);
+        check_string(users[i].email);
+    }
+    auto grants = image_->section<GrantRecord>(header.grants);
+    for (size_t i = 0; i < header.grants.count; ++i)
+    {
+        check_string(grants[i].door);
+        check_string(grants[i].schedule);
+        if (grants[i].bitmap >= header.bitmaps.count)
+            throw invalid("bitmap out of bounds");
+    }
+    auto profiles = image_->section<ProfileRecord>(header.profiles);
+    for (size_t i = 0; i < header.profiles.count; ++i)
+    {
+        if (profiles[i].first_grant > header.grants.count ||
+            profiles[i].grant_count > header.grants.count - profiles[i].first_grant)
+            throw invalid("grant out of bounds");
+    }
+    auto creds = image_->section<CredentialRecord>(header.credentials);
+    for (size_t i = 0; i < header.credentials.count; ++i)
+    {
+        check_string(creds[i].card_id);
+        check_string(creds[i].pin);
+        check_string(creds[i].alias);
+        if ((creds[i].user != NO_ENTRY && creds[i].user >= header.users.count) ||
+            (creds[i].profile != NO_ENTRY &&
+             creds[i].profile >= header.profiles.count))
+            throw invalid("reference out of bounds");
+    }
+    auto slots = image_->section<uint32_t>(header.slots);
+    for (size_t i = 0; i < header.slots.count; ++i)
+    {
+        if (slots[i] != NO_ENTRY && slots[i] >= header.credentials.count)
+            throw invalid("credential out of bounds");
+    }
+
+    INFO("Mapped auth image " << image_file << " (" << header.credentials.count
+                              << " credentials, " << header.users.count
+                              << " users).");
+}
+
+bool ImageAuthSourceMapper::is_up_to_date(const std::string &source_file) const
+{
+    struct stat st;
+    if (stat(source_file.c_str(), &st) == -1)
+        return false;
+    const auto &header = image_->header();
+    return header.source_size == static_cast<uint64_t>(st.st_size) &&
+           header.source_mtime == source_mtime(st);
+}
+
+const CredentialRecord *ImageAuthSourceMapper::find(uint32_t type,
+                                                    const std::string &card_id,
+                                                    const std::string &pin) const
+{
+    const auto &header = image_->header();
+    auto key           = credential_key(type, card_id, pin);
+
+    auto buckets = image_->section<uint32_t>(header.buckets);
+    auto slots   = image_->section<uint32_t>(header.slots);
+    auto displacement = buckets[hash(key, 0) % header.buckets.count];
+    auto index        = slots[hash(key, displacement) % header.slots.count];
+    if (index == NO_ENTRY)
+        return nullptr;
+
+    // The hash is perfect for the keys in the image only: make sure
+    // this is one of them.
+    const auto &record =
+        image_->section<CredentialRecord>(header.credentials)[index];
+    if (record.type != type || card_id != image_->string(record.card_id) ||
+        pin != image_->string(record.pin))
+        return nullptr;
+    return &record;
+}
+
+const CredentialRecord *
+ImageAuthSourceMapper::find(const Cred::ICredential &cred) const
+{
+    if (auto card_pin = dynamic_cast<const Cred::RFIDCardPin *>(&cred))
+        return find(RFID_CARD_PIN, card_pin->card().card_id(),
+                    card_pin->pin().pin_code());
+    if (auto card = dynamic_cast<const Cred::RFIDCard *>(&cred))
+        return find(RFID_CARD, card->card_id(), "");
+    if (auto pin = dynamic_cast<const Cred::PinCode *>(&cred))
+        return find(PIN_CODE, "", pin->pin_code());
+    return nullptr;
+}
+
+void ImageAuthSourceMapper::fill_credential(const CredentialRecord &record,
+                                            Cred::ICredential &cred) const
+{
+    cred.id(record.id);
+    cred.alias(image_->string(record.alias));
+    cred.validity(make_validity(record.enabled, record.validity_start,
+                                record.validity_end));
+
+    if (record.user == NO_ENTRY)
+        return;
+    const auto &u =
+        image_->section<UserRecord>(image_->header().users)[record.user];
+    auto user = std::make_shared<User>(u.id);
+    user->username(image_->string(u.name));
+    user->firstname(image_->string(u.firstname));
+    user->lastname(image_->string(u.lastname));
+    user->email(image_->string(u.email));
+    user->validity(make_validity(u.enabled, u.validity_start, u.validity_end));
+    cred.owner(user);
+}
+
+void ImageAuthSourceMapper::visit(Cred::RFIDCard &src)
+{
+    if (auto record = find(RFID_CARD, src.card_id(), ""))
+    {
+        src.nb_bits(record->bits);
+        fill_credential(*record, src);
+    }
+}
+
+void ImageAuthSourceMapper::visit(Cred::PinCode &src)
+{
+    if (auto record = find(PIN_CODE, "", src.pin_code()))
+        fill_credential(*record, src);
+}
+
+void ImageAuthSourceMapper::visit(Cred::RFIDCardPin &src)
+{
+    if (auto record =
+            find(RFID_CARD_PIN, src.card().card_id(), src.pin().pin_code()))
+    {
+        src.card().nb_bits(record->bits);
+        fill_credential(*record, src);
+    }
+}
+
+void ImageAuthSourceMapper::mapToUser(Cred::ICredentialPtr cred)
+{
+    ASSERT_LOG(cred, "Credential is null.");
+    try
+    {
+        cred->accept(*this);
+    }
+    catch (...)
+    {
+        std::throw_with_nested(
+            ModuleException("AuthFile failed to map auth_source to user"));
+    }
+}
+
+IAccessProfilePtr ImageAuthSourceMapper::buildProfile(Cred::ICredentialPtr cred)
+{
+    assert(cred);
+
+    auto cred_owner = cred->owner().get_eager();
+    if (!cred->validity().is_valid())
+    {
+        INFO("Credentials is invalid. It was disabled or out of its validity "
+             "period.");
+        return nullptr;
+    }
+
+    if (cred_owner && !cred_owner->is_valid())
+    {
+        INFO("The user (" << cred_owner->username()
+                          << ") is disabled or out of its validity period.");
+        return nullptr;
+    }
+
+    // Credentials that are not known to this mapper were not
+    // touched by `mapToUser()` and have no id.
+    auto record = find(*cred);
+    if (!record || record->id != cred->id() || record->profile == NO_ENTRY)
+        return nullptr;
+    return std::make_shared<ImageAccessProfile>(
+        image_, image_->section<ProfileRecord>(
+                    image_->header().profiles)[record->profile]);
+}
+
+std::vector<GroupPtr> ImageAuthSourceMapper::groups() const
+{
+    return {};
+}
@@ -0,0 +1,119 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AuthImage.hpp"
+#include "core/auth/AuthFwd.hpp"
+#include "core/auth/Interfaces/IAuthSourceMapper.hpp"
+#include "core/credentials/CredentialFwd.hpp"
+#include <memory>
+#include <string>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+/**
+* Map auth source to user using a compiled auth file image
+* (see AuthImage and AuthImageWriter).
+*
+* The image is mapped in memory and used in place: nothing is parsed
+* or built at startup. Users are built on demand, when a credential
+* is mapped.
+*
+* Like FileAuthSourceMapper, the object is not modified once
+* constructed and can be used from multiple threads.
+*/
+class ImageAuthSourceMapper
+    : public ::Leosac::Auth::IAuthSourceMapper,
+      public ::Leosac::Tools::Visitor<::Leosac::Cred::RFIDCard>,
+      public ::Leosac::Tools::Visitor<::Leosac::Cred::PinCode>,
+      public ::Leosac::Tools::Visitor<::Leosac::Cred::RFIDCardPin>
+{
+  public:
+    /**
+    * Map and validate the image stored in `image_file`.
+    *
+    * @throws ModuleException if the file cannot be mapped, or is not
+    * a valid image for this version of Leosac.
+    */
+    explicit ImageAuthSourceMapper(const std::string &image_file);
+
+    /**
+    * Was the image compiled from the current version of `source_file`?
+    *
+    * The size and modification time of the file are compared to those
+    * recorded in the image.
+    */
+    bool is_up_to_date(const std::string &source_file) const;
+
+    virtual void visit(::Leosac::Cred::RFIDCard &src) override;
+
+    virtual void visit(::Leosac::Cred::PinCode &src) override;
+
+    virtual void visit(::Leosac::Cred::RFIDCardPin &src) override;
+
+    virtual void mapToUser(Leosac::Cred::ICredentialPtr auth_source) override;
+
+    virtual Leosac::Auth::IAccessProfilePtr
+    buildProfile(Leosac::Cred::ICredentialPtr cred) override;
+
+    /**
+    * Groups are not part of the image.
+    */
+    std::vector<Leosac::Auth::GroupPtr> groups() const override;
+
+    /**
+    * A mapped image.
+    *
+    * It is shared with the profiles built from it, which may outlive
+    * the mapper.
+    */
+    struct MappedImage;
+
+  private:
+    /**
+    * Lookup a credential record in the index.
+    *
+    * @return The record, or nullptr if there is none.
+    */
+    const AuthImage::CredentialRecord *find(uint32_t type,
+                                            const std::string &card_id,
+                                            const std::string &pin) const;
+
+    /**
+    * Lookup the credential record matching `cred`, whatever its type.
+    */
+    const AuthImage::CredentialRecord *
+    find(const Leosac::Cred::ICredential &cred) const;
+
+    /**
+    * Copy the information stored in `record` to `cred`.
+    */
+    void fill_credential(const AuthImage::CredentialRecord &record,
+                         Leosac::Cred::ICredential &cred) const;
+
+    std::shared_ptr<const MappedImage> image_;
+};
+}
+}
+}
@@ -0,0 +1,182 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "UnknownCredentialFilter.hpp"
+#include <algorithm>
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+
+UnknownCredentialFilter::Config::Config()
+    : cache_size(1024)
+    , cache_ttl(60)
+    , rate(1)
+    , burst(10)
+    , audit_window(60)
+{
+}
+
+UnknownCredentialFilter::UnknownCredentialFilter(const Config &cfg)
+    : config_(cfg)
+    , generation_(0)
+{
+}
+
+std::string UnknownCredentialFilter::make_key(const zmqpp::message &msg)
+{
+    std::string key;
+    for (size_t i = 0; i < msg.parts(); ++i)
+    {
+        key.append(msg.get(i));
+        key.push_back('\0');
+    }
+    return key;
+}
+
+UnknownCredentialFilter::Verdict
+UnknownCredentialFilter::check(const std::string &reader, const std::string &key,
+                               Cred::ICredentialPtr cred, uint64_t generation,
+                               Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    bool stale = generation != generation_;
+
+    auto itr = stale ? cache_.end() : cache_.find(key);
+    if (itr != cache_.end())
+    {
+        if (itr->second.expiry > now)
+        {
+            lru_.splice(lru_.begin(), lru_, itr->second.lru_position);
+            account_denial(key, reader, itr->second.credential, now);
+            return Verdict::KNOWN_UNKNOWN;
+        }
+        lru_.erase(itr->second.lru_position);
+        cache_.erase(itr);
+    }
+
+    if (config_.rate > 0)
+    {
+        auto &bucket = refill_bucket(reader, now);
+        if (bucket.tokens < 1)
+        {
+            account_denial(reader, reader, nullptr, now);
+            return Verdict::THROTTLED;
+        }
+        bucket.tokens -= 1;
+    }
+
+    if (config_.cache_size && !stale)
+    {
+        if (cache_.size() >= config_.cache_size)
+        {
+            cache_.erase(lru_.back());
+            lru_.pop_back();
+        }
+        lru_.push_front(key);
+        cache_[key] = CacheEntry{lru_.begin(), cred, now + config_.cache_ttl};
+    }
+    return Verdict::REPORT;
+}
+
+void UnknownCredentialFilter::clear()
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    cache_.clear();
+    lru_.clear();
+    ++generation_;
+}
+
+uint64_t UnknownCredentialFilter::generation() const
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    return generation_;
+}
+
+std::vector<UnknownCredentialFilter::DenialReport>
+UnknownCredentialFilter::collect_reports(Clock::time_point now, bool all)
+{
+    std::vector<DenialReport> ret;
+    std::lock_guard<std::mutex> lg(mutex_);
+
+    for (auto itr = reports_.begin(); itr != reports_.end();)
+    {
+        if (all || now - itr->second.first >= config_.audit_window)
+        {
+            ret.push_back(std::move(itr->second));
+            itr = reports_.erase(itr);
+        }
+        else
+            ++itr;
+    }
+    return ret;
+}
+
+bool UnknownCredentialFilter::has_pending_reports() const
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    return !reports_.empty();
+}
+
+size_t UnknownCredentialFilter::cache_size() const
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    return cache_.size();
+}
+
+const UnknownCredentialFilter::Config &UnknownCredentialFilter::config() const
+{
+    return config_;
+}
+
+UnknownCredentialFilter::Bucket &
+UnknownCredentialFilter::refill_bucket(const std::string &reader,
+                                       Clock::time_point now)
+{
+    auto itr = buckets_.find(reader);
+    if (itr == buckets_.end())
+    {
+        return buckets_[reader] =
+                   Bucket{static_cast<double>(config_.burst), now};
+    }
+
+    auto &bucket = itr->second;
+    std::chrono::duration<double> elapsed = now - bucket.last_refill;
+    if (elapsed.count() > 0)
+    {
+        bucket.tokens = std::min(static_cast<double>(config_.burst),
+                                 bucket.tokens + elapsed.count() * config_.rate);
+        bucket.last_refill = now;
+    }
+    return bucket;
+}
+
+void UnknownCredentialFilter::account_denial(const std::string &report_key,
+                                             const std::string &reader,
+                                             const Cred::ICredentialPtr &cred,
+                                             Clock::time_point now)
+{
+    auto itr = reports_.find(report_key);
+    if (itr == reports_.end())
+    {
+        reports_[report_key] = DenialReport{reader, cred, 1, now, now};
+        return;
+    }
+    itr->second.count++;
+    itr->second.last = now;
+}
@@ -0,0 +1,241 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "core/credentials/CredentialFwd.hpp"
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <zmqpp/message.hpp>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace Auth
+{
+/**
+ * Protects an AuthFileInstance against readers that submit many
+ * unknown credentials (a reader being probed, or a faulty reader
+ * sending garbage frames).
+ *
+ * Unknown credentials are always denied. The filter only decides
+ * whether a denial is logged and audited on its own, which is the
+ * expensive part. Credentials that map to a user never go through it.
+ *
+ *    + Credentials that recently failed to map to a user are kept
+ *      in a bounded LRU cache. Denials of those credentials are not
+ *      reported on their own.
+ *    + Each reader has a token bucket. Every unknown credential reported
+ *      takes a token. Once the bucket is empty, denials of unknown
+ *      credentials from that reader are not reported on their own until
+ *      tokens are refilled.
+ *    + Denials that were not reported on their own are counted, and
+ *      reported once per `audit_window`.
+ *
+ * The object is thread safe.
+ */
+class UnknownCredentialFilter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        Config();
+
+        /**
+         * Maximum number of unknown credentials remembered.
+         * 0 disables the cache.
+         */
+        size_t cache_size;
+
+        /**
+         * How long an unknown credential is remembered.
+         */
+        std::chrono::seconds cache_ttl;
+
+        /**
+         * Number of tokens refilled per second in each reader's bucket.
+         * 0 disables rate limiting.
+         */
+        double rate;
+
+        /**
+         * Capacity of each reader's bucket.
+         */
+        size_t burst;
+
+        /**
+         * Period over which denials that were not evaluated are
+         * coalesced into a single report.
+         */
+        std::chrono::seconds audit_window;
+    };
+
+    enum class Verdict
+    {
+        /**
+         * The denial shall be logged and audited on its own.
+         */
+        REPORT,
+        /**
+         * The credential is a recently seen unknown credential.
+         */
+        KNOWN_UNKNOWN,
+        /**
+         * The reader submitted too many unknown credentials.
+         */
+        THROTTLED
+    };
+
+    /**
+     * Denials that were not reported on their own, coalesced.
+     */
+    struct DenialReport
+    {
+        /**
+         * Name of the reader (auth source).
+         */
+        std::string reader;
+
+        /**
+         * The denied credential, or null for requests that were
+         * throttled.
+         */
+        Cred::ICredentialPtr credential;
+
+        size_t count;
+
+        Clock::time_point first;
+
+        Clock::time_point last;
+    };
+
+    explicit UnknownCredentialFilter(const Config &cfg);
+
+    /**
+     * Build the key identifying the credential carried by an
+     * authentication message, without decoding it.
+     *
+     * The key covers every frame of the message: source name,
+     * credential type and credential data.
+     */
+    static std::string make_key(const zmqpp::message &msg);
+
+    /**
+     * Account for the credential identified by `key`, that didn't map
+     * to any user, and decide whether its denial should be reported
+     * on its own.
+     *
+     * If so, the credential is remembered and takes a token from the
+     * reader's bucket. Otherwise, the denial is accounted for the next
+     * report (see collect_reports()).
+     *
+     * @param cred The credential, as built from the request. It is
+     * used to generate the coalesced audit entries.
+     * @param generation The generation() read before the credential was
+     * looked up. If the filter was cleared since, the lookup used outdated
+     * credentials: the credential is reported but not remembered.
+     */
+    Verdict check(const std::string &reader, const std::string &key,
+                  Cred::ICredentialPtr cred, uint64_t generation,
+                  Clock::time_point now);
+
+    /**
+     * Forget about all unknown credentials, and start a new generation.
+     *
+     * This must be called once the credentials database has changed.
+     * Buckets and pending reports are kept.
+     */
+    void clear();
+
+    /**
+     * Number of times the filter was cleared.
+     */
+    uint64_t generation() const;
+
+    /**
+     * Extract the reports whose window elapsed at `now`.
+     *
+     * @param all Extract all reports, regardless of their window.
+     */
+    std::vector<DenialReport> collect_reports(Clock::time_point now,
+                                              bool all = false);
+
+    /**
+     * Are there denials waiting to be reported?
+     */
+    bool has_pending_reports() const;
+
+    /**
+     * Number of unknown credentials currently remembered.
+     */
+    size_t cache_size() const;
+
+    const Config &config() const;
+
+  private:
+    struct CacheEntry
+    {
+        std::list<std::string>::iterator lru_position;
+        Cred::ICredentialPtr credential;
+        Clock::time_point expiry;
+    };
+
+    struct Bucket
+    {
+        double tokens;
+        Clock::time_point last_refill;
+    };
+
+    Bucket &refill_bucket(const std::string &reader, Clock::time_point now);
+
+    void account_denial(const std::string &report_key, const std::string &reader,
+                        const Cred::ICredentialPtr &cred, Clock::time_point now);
+
+    const Config config_;
+
+    mutable std::mutex mutex_;
+
+    uint64_t generation_;
+
+    /**
+     * Keys of the cached credentials, most recently used first.
+     */
+    std::list<std::string> lru_;
+
+    std::unordered_map<std::string, CacheEntry> cache_;
+
+    std::map<std::string, Bucket> buckets_;
+
+    /**
+     * Pending reports, indexed by credential key (or reader name
+     * for throttled credentials).
+     */
+    std::unordered_map<std::string, DenialReport> reports_;
+};
+}
+}
+}
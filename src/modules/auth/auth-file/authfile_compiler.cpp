@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* \file authfile_compiler.cpp
+* \brief Offline compiler of auth-file configuration files.
+*
+* Turns an auth file into an image that the auth-file module maps
+* at startup (see the `compiled_file` option).
+*/
+
+#include "AuthImageWriter.hpp"
+#include "FileAuthSourceMapper.hpp"
+#include "exception/ExceptionsTools.hpp"
+#include "tools/version.hpp"
+#include <iostream>
+#include <tclap/CmdLine.h>
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+
+int main(int argc, const char **argv)
+{
+    std::string input_file;
+    std::string output_file;
+    try
+    {
+        TCLAP::CmdLine cmd("Compile an auth-file configuration file", ' ',
+                           Version::get_full_version());
+        TCLAP::UnlabeledValueArg<std::string> input(
+            "auth_file", "Auth file to compile", true, "", "auth_file");
+        TCLAP::UnlabeledValueArg<std::string> output(
+            "image", "Path of the compiled image", true, "", "image");
+
+        cmd.add(input);
+        cmd.add(output);
+        cmd.parse(argc, argv);
+        input_file  = input.getValue();
+        output_file = output.getValue();
+    }
+    catch (const TCLAP::ArgException &e)
+    {
+        Leosac::print_exception(e);
+        return 1;
+    }
+
+    try
+    {
+        auto source_stat = AuthImageWriter::stat_source(input_file);
+        FileAuthSourceMapper mapper(input_file);
+        AuthImageWriter(mapper).write(input_file, source_stat, output_file);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Failed to compile " << input_file << "." << std::endl;
+        Leosac::print_exception(e);
+        return 1;
+    }
+    std::cout << "Compiled " << input_file << " to " << output_file << std::endl;
+    return 0;
+}
@@ -43,12 +43,11 @@ DoormanInstance::DoormanInstance(DoormanModule &module, zmqpp::context &ctx,
     for (auto &action : actions_)
     {
       if (targets_.count(action.target_))
-        continue; // already have a socket to this target.
+        continue; // already have a facade to this target.
 
-      // create socket (and connect them) to target
-      zmqpp::socket target_socket(ctx, zmqpp::socket_type::req);
-      target_socket.connect("inproc://" + action.target_);
-      targets_.insert(std::make_pair(action.target_, std::move(target_socket)));
+      targets_.insert(std::make_pair(
+          action.target_,
+          std::make_unique<Hardware::AsyncFacade>(ctx, action.target_)));
     }
 
     for (auto &d : module.doors())
@@ -63,6 +62,27 @@ zmqpp::socket &DoormanInstance::bus_sub()
     return bus_sub_;
 }
 
+void DoormanInstance::register_sockets(zmqpp::reactor *reactor)
+{
+    for (auto &target : targets_)
+        target.second->register_sockets(reactor);
+}
+
+std::chrono::steady_clock::time_point DoormanInstance::next_command_timeout() const
+{
+    auto next = std::chrono::steady_clock::time_point::max();
+    for (const auto &target : targets_)
+        next = std::min(next, target.second->next_timeout());
+    return next;
+}
+
+void DoormanInstance::expire_commands(
+    const std::chrono::steady_clock::time_point &now)
+{
+    for (auto &target : targets_)
+        target.second->check_timeouts(now);
+}
+
 void DoormanInstance::handle_bus_msg()
 {
     zmqpp::message bus_msg;
@@ -101,26 +121,21 @@ void DoormanInstance::handle_bus_msg()
                 msg << static_cast<int64_t>(v);
             DEBUG("would do : " << frame << " to target: " << action.target_);
         }
-        command_send_recv(action.target_, std::move(msg));
+        command_send(action.target_, std::move(msg));
     }
 }
 
-void DoormanInstance::command_send_recv(std::string const &target_name,
-                                        zmqpp::message msg)
+void DoormanInstance::command_send(std::string const &target_name,
+                                   zmqpp::message msg)
 {
-    zmqpp::socket &target_socket = targets_.at(target_name);
-    zmqpp::message response;
-
-    target_socket.send(msg);
-    target_socket.receive(response);
-
-    std::string req_status;
-    response >> req_status;
-
-    if (req_status != "OK")
-    {
-        WARN("Command failed :(");
-    }
+    auto &target = targets_.at(target_name);
+
+    // Actions on other targets, and on other doormen, are not delayed
+    // while this one is being processed.
+    target->send_command(msg, [target_name](bool ok) {
+        if (!ok)
+            WARN("Command to " << target_name << " failed or timed out.");
+    });
 }
 
 Leosac::Auth::AuthTargetPtr
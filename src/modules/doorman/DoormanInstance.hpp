@@ -22,6 +22,7 @@
 #include "core/auth/Auth.hpp"
 #include "core/auth/AuthFwd.hpp"
 #include "DoormanDoor.hpp"
+#include "hardware/facades/AsyncFacade.hpp"
 #include <map>
 #include <zmqpp/zmqpp.hpp>
 
@@ -84,6 +85,23 @@ class DoormanInstance
 
     zmqpp::socket &bus_sub();
 
+    /**
+    * Register the sockets used to talk to the targets into the module's
+    * reactor.
+    */
+    void register_sockets(zmqpp::reactor *reactor);
+
+    /**
+    * Give up on commands whose target didn't reply in time.
+    */
+    void expire_commands(const std::chrono::steady_clock::time_point &now);
+
+    /**
+    * Deadline of the oldest command waiting for a reply, or
+    * `time_point::max()`.
+    */
+    std::chrono::steady_clock::time_point next_command_timeout() const;
+
     /**
     * Activity we care about happened on the bus.
     */
@@ -107,12 +125,15 @@ class DoormanInstance
     std::vector<std::shared_ptr<DoormanDoor>> doors_;
 
     /**
-    * Send a command to a target and wait for response.
+    * Send a command to a target.
+    *
+    * This doesn't wait for the target's response: a failure or a
+    * timeout is logged when detected.
     *
     * @param target_name name of target object
     * @param msg message containing command (and command parameter) to send
     */
-    void command_send_recv(const std::string &target_name, zmqpp::message msg);
+    void command_send(const std::string &target_name, zmqpp::message msg);
 
     std::string name_;
 
@@ -121,9 +142,9 @@ class DoormanInstance
     zmqpp::socket bus_sub_;
 
     /**
-    * Socket (REP) connected to each target this doorman may have
+    * Non-blocking facade to each target this doorman may have
     */
-    std::map<std::string, zmqpp::socket> targets_;
+    std::map<std::string, std::unique_ptr<Hardware::AsyncFacade>> targets_;
 };
 }
 }
@@ -24,6 +24,8 @@
 #include "core/kernel.hpp"
 #include "hardware/facades/FAlarm.hpp"
 #include "tools/log.hpp"
+#include "tools/timeout.hpp"
+#include <boost/iterator/transform_iterator.hpp>
 
 using namespace Leosac::Module::Doorman;
 using namespace Leosac::Auth;
@@ -47,6 +49,7 @@ DoormanModule::DoormanModule(zmqpp::context &ctx, zmqpp::socket *pipe,
     {
         reactor_.add(doorman->bus_sub(),
                      std::bind(&DoormanInstance::handle_bus_msg, doorman));
+        doorman->register_sockets(&reactor_);
 
         for (auto &&door : doorman->doors())
         {
@@ -112,13 +115,34 @@ void DoormanModule::process_config()
 
 void DoormanModule::run()
 {
+    auto next_timeout = [](const std::shared_ptr<DoormanInstance> &doorman) {
+        return doorman->next_command_timeout();
+    };
+
+    update();
+    schedule_update();
     while (is_running_)
     {
-        update();
-        reactor_.poll(2000);
+        // Only wake up if a command to a target may time out.
+        // Doors are updated whenever something happens, including the
+        // periodic update timer.
+        if (reactor_.poll(Tools::compute_timeout(
+                boost::make_transform_iterator(doormen_.begin(), next_timeout),
+                boost::make_transform_iterator(doormen_.end(), next_timeout))))
+            update();
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto &&doorman : doormen_)
+            doorman->expire_commands(now);
     }
 }
 
+void DoormanModule::schedule_update()
+{
+    schedule_after(std::chrono::seconds(2),
+                   std::bind(&DoormanModule::schedule_update, this));
+}
+
 void DoormanModule::process_doors_config(
     const boost::property_tree::ptree &doors_cfg)
 {
@@ -68,6 +68,12 @@ class DoormanModule : public BaseModule
   private:
     void update();
 
+    /**
+    * Arm a timer so that doors are updated at least every 2 seconds,
+    * even when nothing happens.
+    */
+    void schedule_update();
+
     /**
     * Processing the configuration tree, spawning AuthFileInstance object as
     * described in the
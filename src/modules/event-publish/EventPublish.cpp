@@ -55,35 +55,21 @@ void EventPublish::handle_msg_bus()
         return;
     }
 
-    // Hack Alert! Hack Alert!
     // For this use case, we read 35bits wiegand frame CP1000 encoded.
-    // We want to extract the identifier: the 20 second-to-last bits (14 first bit
-    // ignored).
+    // We want to extract the card number.
     // In case this is not a 35 bits tram, do nothing
-    if (bits == 35)
+    if (bits != 35)
+        return;
+
+    uint64_t frame;
+    Tools::WiegandCardData data;
+    if (!Tools::WiegandFormat::pack(card, bits, frame) ||
+        !formats_.decode(frame, bits, data))
     {
-        std::stringstream ss;
-        ss << std::hex << "0x";
-        for (auto c : card)
-        {
-            if (c == ':')
-                continue;
-            ss << std::hex << c;
-        }
-        INFO("Bla: {" << ss.str() << "}");
-        // n has 40 "meaningful" bits because the hex string was 5 bytes.
-        uint64_t n;
-        ss >> n;
-        INFO(" n = " << n);
-        n = (n >> 6); // remove last 6bits. parity bit + 5bits;
-        n &= 0xFFFFF; // keep 20 bits.
-        INFO(" n2 = " << n);
-        std::stringstream ss2;
-        ss2 << n;
-        ss2 >> card;
-    }
-    else
+        WARN("Cannot decode card id {" << card << "}. Not publishing it.");
         return;
+    }
+    card = std::to_string(data.card_number);
 
     if (publish_source_)
         network_pub_.send(zmqpp::message() << card << src);
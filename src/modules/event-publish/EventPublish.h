@@ -27,6 +27,7 @@
 #include "hardware/facades/FGPIO.hpp"
 #include "tools/XmlScheduleLoader.hpp"
 #include "core/auth/AuthTarget.hpp"
+#include "tools/WiegandFormat.hpp"
 
 namespace Leosac
 {
@@ -79,6 +80,11 @@ namespace Leosac
                 zmqpp::socket network_pub_;
 
                 bool publish_source_;
+
+                /**
+                 * Used to extract the card number from the frame.
+                 */
+                Tools::WiegandFormatRegistry formats_;
             };
 
         }
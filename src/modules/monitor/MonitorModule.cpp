@@ -19,7 +19,9 @@
 
 #include "MonitorModule.hpp"
 #include "tools/log.hpp"
+#include "tools/timeout.hpp"
 #include "tools/unixshellscript.hpp"
+#include <boost/iterator/transform_iterator.hpp>
 #include <zmqpp/z85.hpp>
 
 using namespace Leosac::Module::Monitor;
@@ -39,7 +41,6 @@ MonitorModule::MonitorModule(zmqpp::context &ctx, zmqpp::socket *pipe,
     : BaseModule(ctx, pipe, cfg, utils)
     , bus_(ctx, zmqpp::socket_type::sub)
     , verbose_(false)
-    , last_ping_(TimePoint::max())
     , kernel_(ctx, zmqpp::socket_type::req)
 {
     kernel_.connect("inproc://leosac-kernel");
@@ -51,20 +52,39 @@ MonitorModule::MonitorModule(zmqpp::context &ctx, zmqpp::socket *pipe,
 
 void MonitorModule::run()
 {
+    if (!addr_to_ping_.empty())
+        ping_and_reschedule();
+
+    std::vector<Leosac::Hardware::AsyncFLED *> leds;
+    for (auto led : {network_led_.get(), reader_led_.get(), system_led_.get()})
+    {
+        if (led)
+            leds.push_back(led);
+    }
+    auto next_timeout = [](const Leosac::Hardware::AsyncFLED *led) {
+        return led->next_timeout();
+    };
+
     while (is_running_)
     {
-        reactor_.poll(1000);
-        if (last_ping_ == TimePoint::max() ||
-            std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now() - last_ping_)
-                    .count() > 3)
-        {
-            test_ping();
-            last_ping_ = std::chrono::system_clock::now();
-        }
+        // Only wake up if a command to a LED may time out.
+        reactor_.poll(Tools::compute_timeout(
+            boost::make_transform_iterator(leds.begin(), next_timeout),
+            boost::make_transform_iterator(leds.end(), next_timeout)));
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto led : leds)
+            led->check_timeouts(now);
     }
 }
 
+void MonitorModule::ping_and_reschedule()
+{
+    test_ping();
+    schedule_after(std::chrono::seconds(4),
+                   std::bind(&MonitorModule::ping_and_reschedule, this));
+}
+
 void MonitorModule::log_system_bus()
 {
     auto system_bus_logger = spdlog::get("system_bus_event");
@@ -106,7 +126,7 @@ void MonitorModule::log_system_bus()
     // reader activity check
     if (src == ("S_" + reader_to_watch_) && reader_led_)
     {
-        reader_led_->turnOn(500);
+        reader_led_->turnOn(std::chrono::milliseconds(500));
     }
 
     // system readiness check
@@ -137,6 +157,14 @@ void MonitorModule::test_ping()
     }
 }
 
+std::unique_ptr<Leosac::Hardware::AsyncFLED>
+MonitorModule::make_led(const std::string &name)
+{
+    auto led = std::make_unique<Leosac::Hardware::AsyncFLED>(ctx_, name);
+    led->register_sockets(&reactor_);
+    return led;
+}
+
 std::string MonitorModule::req_scripts_dir()
 {
     std::string ret;
@@ -172,8 +200,7 @@ void MonitorModule::process_config()
         config_.get_child("module_config").get<std::string>("system_ok", "");
     if (!system_led_name.empty())
     {
-        system_led_ =
-            std::make_unique<Leosac::Hardware::FLED>(ctx_, system_led_name);
+        system_led_ = make_led(system_led_name);
     }
 
     process_network_config();
@@ -187,8 +214,7 @@ void MonitorModule::process_network_config()
     {
         addr_to_ping_                = ping_node->get<std::string>("ip");
         std::string network_led_name = ping_node->get<std::string>("led");
-        network_led_ =
-            std::make_unique<Leosac::Hardware::FLED>(ctx_, network_led_name);
+        network_led_ = make_led(network_led_name);
     }
 }
 
@@ -201,7 +227,6 @@ void MonitorModule::process_reader_config()
         reader_to_watch_ = reader_node->get<std::string>("name");
         bus_.subscribe("S_" + reader_to_watch_);
         std::string reader_led_name = reader_node->get<std::string>("led");
-        reader_led_ =
-            std::make_unique<Leosac::Hardware::FLED>(ctx_, reader_led_name);
+        reader_led_ = make_led(reader_led_name);
     }
 }
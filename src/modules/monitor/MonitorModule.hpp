@@ -19,7 +19,7 @@
 
 #pragma once
 
-#include "hardware/facades/FLED.hpp"
+#include "hardware/facades/AsyncFLED.hpp"
 #include "modules/BaseModule.hpp"
 
 namespace Leosac
@@ -53,7 +53,6 @@ class MonitorModule : public BaseModule
     virtual void run() override;
 
   private:
-    using TimePoint = std::chrono::system_clock::time_point;
 
     void process_config();
 
@@ -80,6 +79,16 @@ class MonitorModule : public BaseModule
 
     void test_ping();
 
+    /**
+    * Test the network, then schedule the next test.
+    */
+    void ping_and_reschedule();
+
+    /**
+    * Create a facade to a LED and register it into the reactor.
+    */
+    std::unique_ptr<Leosac::Hardware::AsyncFLED> make_led(const std::string &name);
+
     zmqpp::socket bus_;
 
     bool verbose_;
@@ -91,19 +100,17 @@ class MonitorModule : public BaseModule
     /**
     * Led for feedback about network availability
     */
-    std::unique_ptr<Leosac::Hardware::FLED> network_led_;
+    std::unique_ptr<Leosac::Hardware::AsyncFLED> network_led_;
 
     /**
     * Led for feedback about reader activity
     */
-    std::unique_ptr<Leosac::Hardware::FLED> reader_led_;
+    std::unique_ptr<Leosac::Hardware::AsyncFLED> reader_led_;
 
     /**
     * Led for feedback about system readiness
     */
-    std::unique_ptr<Leosac::Hardware::FLED> system_led_;
-
-    TimePoint last_ping_;
+    std::unique_ptr<Leosac::Hardware::AsyncFLED> system_led_;
 
     zmqpp::socket kernel_;
 };
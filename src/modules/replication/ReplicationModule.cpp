@@ -32,25 +32,21 @@ ReplicationModule::ReplicationModule(zmqpp::context &ctx, zmqpp::socket *pipe,
                                      const boost::property_tree::ptree &cfg,
                                      CoreUtilsPtr utils)
     : BaseModule(ctx, pipe, cfg, utils)
-    , last_sync_(TimePoint::max())
 {
     process_config();
 }
 
 void ReplicationModule::run()
 {
-    while (is_running_)
-    {
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                           std::chrono::system_clock::now() - last_sync_)
-                           .count();
-        if (last_sync_ == TimePoint::max() || elapsed > delay_)
-        {
-            replicate();
-            last_sync_ = std::chrono::system_clock::now();
-        }
-        reactor_.poll(25);
-    }
+    replicate_and_reschedule();
+    BaseModule::run();
+}
+
+void ReplicationModule::replicate_and_reschedule()
+{
+    replicate();
+    schedule_after(std::chrono::seconds(delay_),
+                   std::bind(&ReplicationModule::replicate_and_reschedule, this));
 }
 
 void ReplicationModule::process_config()
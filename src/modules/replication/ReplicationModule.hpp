@@ -51,9 +51,14 @@ class ReplicationModule : public BaseModule
     virtual void run() override;
 
   private:
-    using TimePoint = std::chrono::system_clock::time_point;
     void process_config();
 
+    /**
+     * Replicate, then schedule the next replication `delay_`
+     * seconds from now.
+     */
+    void replicate_and_reschedule();
+
     /**
      * Start the replication process.
      *
@@ -93,8 +98,6 @@ class ReplicationModule : public BaseModule
      * Master server's public key.
      */
     std::string pubkey_;
-
-    TimePoint last_sync_;
 };
 }
 }
@@ -52,8 +52,10 @@ SMTPAuditPtr SMTPAudit::create(const DBPtr &database, Audit::IAuditEntryPtr pare
 
     if (parent)
     {
-        ASSERT_LOG(parent->id(), "Parent must be already persisted.");
         Audit::AuditEntryPtr parent_odb = assert_cast<Audit::AuditEntryPtr>(parent);
+        // The parent may have been built in memory.
+        if (!parent_odb->id())
+            parent_odb->persist_detached();
         audit->set_parent(parent_odb);
         database->update(*audit);
     }
@@ -29,7 +29,8 @@ using Leosac::Tools::UnixFs;
 SysFsGpioPin::SysFsGpioPin(zmqpp::context &ctx, const std::string &name, int gpio_no,
                            Direction direction, InterruptMode interrupt_mode,
                            bool initial_value, SysFsGpioModule &module)
-    : gpio_no_(gpio_no)
+    : file_fd_(-1)
+    , gpio_no_(gpio_no)
     , sock_(ctx, zmqpp::socket_type::rep)
     , name_(name)
     , direction_(direction)
@@ -42,7 +43,11 @@ SysFsGpioPin::SysFsGpioPin(zmqpp::context &ctx, const std::string &name, int gpi
 
     set_direction(direction);
     set_interrupt(interrupt_mode);
-    std::string full_path = path_cfg_.value_path(gpio_no);
+
+    // The value file is kept open for the lifetime of the pin: it is
+    // used to watch for interrupts, and to read / write the value without
+    // reopening it each time.
+    file_fd_ = UnixFs::openSysFsFile(path_cfg_.value_path(gpio_no), value_flags());
 
     if (direction == Direction::Out)
     {
@@ -51,9 +56,6 @@ SysFsGpioPin::SysFsGpioPin(zmqpp::context &ctx, const std::string &name, int gpi
         else
             turn_off();
     }
-
-    file_fd_ = open(full_path.c_str(), O_RDONLY | O_NONBLOCK);
-    assert(file_fd_ != -1);
 }
 
 SysFsGpioPin::~SysFsGpioPin()
@@ -73,9 +75,13 @@ SysFsGpioPin::~SysFsGpioPin()
         }
     }
 
-    if (file_fd_ != -1 && ::close(file_fd_) != 0)
+    try
+    {
+        UnixFs::closeSysFsFile(file_fd_);
+    }
+    catch (FsException &e)
     {
-        ERROR("fail to close fd " << file_fd_);
+        ERROR("fail to close fd " << file_fd_ << ": " << e.what());
     }
     try
     {
@@ -147,26 +153,60 @@ bool SysFsGpioPin::turn_on(zmqpp::message *msg /* = nullptr */)
         WARN("Called with unexpected number of arguments: " << msg->remaining());
     }
 
-    UnixFs::writeSysFsValue(path_cfg_.value_path(gpio_no_), 1);
+    write_value(true);
     return true;
 }
 
 bool SysFsGpioPin::turn_off()
 {
-    UnixFs::writeSysFsValue(path_cfg_.value_path(gpio_no_), 0);
+    write_value(false);
     return true;
 }
 
 bool SysFsGpioPin::toggle()
 {
-    int v = UnixFs::readSysFsValue<int>(path_cfg_.value_path(gpio_no_));
-    UnixFs::writeSysFsValue(path_cfg_.value_path(gpio_no_), v == 1 ? 0 : 1);
+    write_value(!read_value());
     return true;
 }
 
+int SysFsGpioPin::value_flags() const
+{
+    return direction_ == Direction::Out ? O_RDWR : O_RDONLY | O_NONBLOCK;
+}
+
+template <typename Operation>
+auto SysFsGpioPin::with_value_file(Operation op) -> decltype(op())
+{
+    try
+    {
+        return op();
+    }
+    catch (const FsException &e)
+    {
+        // The GPIO may have been unexported and exported again.
+        WARN("Access to the value of GPIO " << gpio_no_ << " failed (" << e.what()
+                                            << "). Reopening it.");
+        UnixFs::reopenSysFsFile(file_fd_, path_cfg_.value_path(gpio_no_),
+                                value_flags());
+        return op();
+    }
+}
+
 bool SysFsGpioPin::read_value()
 {
-    return UnixFs::readSysFsValue<bool>(path_cfg_.value_path(gpio_no_));
+    return with_value_file([&]() {
+        char value;
+        if (UnixFs::readSysFsValue(file_fd_, &value, 1) != 1)
+            throw FsException("could not read value of GPIO " +
+                              std::to_string(gpio_no_));
+        return value == '1';
+    });
+}
+
+void SysFsGpioPin::write_value(bool value)
+{
+    with_value_file(
+        [&]() { UnixFs::writeSysFsValue(file_fd_, value ? "1" : "0", 1); });
 }
 
 void SysFsGpioPin::handle_interrupt()
@@ -176,10 +216,8 @@ void SysFsGpioPin::handle_interrupt()
 
     // flush interrupt by reading.
     // if we fail we cant recover, this means hardware failure.
-    ret = ::read(file_fd_, &buffer[0], buffer.size());
+    ret = ::pread(file_fd_, &buffer[0], buffer.size(), 0);
     ASSERT_LOG(ret >= 0, "Read failed on GPIO pin.");
-    ret = ::lseek(file_fd_, 0, SEEK_SET);
-    ASSERT_LOG(ret >= 0, "Lseek failed on GPIO pin.");
 
     module_.publish_on_bus(zmqpp::message() << "S_INT:" + name_);
 }
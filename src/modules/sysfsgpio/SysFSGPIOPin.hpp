@@ -96,6 +96,23 @@ class SysFsGpioPin
     */
     bool read_value();
 
+    /**
+    * Write a value to the `value` file.
+    */
+    void write_value(bool value);
+
+    /**
+    * open(2) flags of the `value` file.
+    */
+    int value_flags() const;
+
+    /**
+    * Run an operation on the `value` file. If it fails, the file is
+    * reopened and the operation retried once.
+    */
+    template <typename Operation>
+    auto with_value_file(Operation op) -> decltype(op());
+
     /**
     * Write to sysfs to turn the gpio on.
     */
@@ -128,7 +145,9 @@ class SysFsGpioPin
     void set_interrupt(InterruptMode mode);
 
     /**
-    * File descriptor of the GPIO in sysfs.
+    * File descriptor of the GPIO's `value` file in sysfs. It is
+    * open for the lifetime of the pin, and keeps its number when
+    * the file is reopened.
     */
     int file_fd_;
 
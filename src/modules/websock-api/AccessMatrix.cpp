@@ -0,0 +1,197 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AccessMatrix.hpp"
+#include "core/auth/Door.hpp"
+#include "core/auth/Door_odb.h"
+#include "core/auth/Group.hpp"
+#include "core/auth/Group_odb.h"
+#include "core/credentials/Credential.hpp"
+#include "core/credentials/Credential_odb.h"
+#include "tools/ScheduleMapping.hpp"
+#include "tools/ScheduleMapping_odb.h"
+#include "tools/log.hpp"
+#include <algorithm>
+
+using namespace Leosac;
+using namespace Leosac::Module;
+using namespace Leosac::Module::WebSockAPI;
+
+AccessMatrix::AccessMatrix()
+    : mappings_dirty_(true)
+{
+}
+
+void AccessMatrix::group_changed(Auth::GroupId gid)
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    dirty_groups_.insert(gid);
+}
+
+void AccessMatrix::credential_changed(Cred::CredentialId cid)
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    dirty_credentials_.insert(cid);
+}
+
+void AccessMatrix::mappings_changed()
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    mappings_dirty_ = true;
+}
+
+nlohmann::json AccessMatrix::serialize(const DBPtr &db)
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (mappings_dirty_)
+    {
+        load_mappings(db);
+        mappings_dirty_ = false;
+        for (const auto &door : door_mappings_)
+            dirty_doors_.insert(door.first);
+    }
+
+    // Find the doors affected by changed groups or credentials.
+    auto references = [](const auto &ids, const auto &dirty) {
+        return std::any_of(ids.begin(), ids.end(),
+                           [&](auto id) { return dirty.count(id) != 0; });
+    };
+    for (const auto &door : door_mappings_)
+    {
+        for (const auto &mid : door.second)
+        {
+            const auto &mapping = mappings_.at(mid);
+            if (references(mapping.groups, dirty_groups_) ||
+                references(mapping.credentials, dirty_credentials_))
+            {
+                dirty_doors_.insert(door.first);
+                break;
+            }
+        }
+    }
+    for (const auto &gid : dirty_groups_)
+        group_members_.erase(gid);
+    for (const auto &cid : dirty_credentials_)
+        credential_owner_.erase(cid);
+    dirty_groups_.clear();
+    dirty_credentials_.clear();
+
+    load_missing(db);
+    for (const auto &did : dirty_doors_)
+        compute_door(did);
+    dirty_doors_.clear();
+
+    nlohmann::json rep = nlohmann::json::array();
+    for (const auto &door : door_mappings_)
+    {
+        nlohmann::json user_ids = nlohmann::json::array();
+        const auto &users       = access_[door.first];
+        for (auto uid = users.find_first(); uid != users.npos;
+             uid      = users.find_next(uid))
+        {
+            user_ids.push_back(uid);
+        }
+        rep.push_back({{"door_id", door.first}, {"user_ids", user_ids}});
+    }
+    return rep;
+}
+
+void AccessMatrix::load_mappings(const DBPtr &db)
+{
+    door_mappings_.clear();
+    mappings_.clear();
+    access_.clear();
+
+    auto doors = db->query<Auth::Door>();
+    for (const auto &door : doors)
+        door_mappings_[door.id()];
+
+    auto mappings = db->query<Tools::ScheduleMapping>();
+    for (const auto &mapping : mappings)
+    {
+        auto &compiled = mappings_[mapping.id()];
+        for (const auto &user : mapping.users())
+            compiled.users.push_back(user.object_id());
+        for (const auto &group : mapping.groups())
+            compiled.groups.push_back(group.object_id());
+        for (const auto &cred : mapping.credentials())
+            compiled.credentials.push_back(cred.object_id());
+
+        for (const auto &door : mapping.doors())
+        {
+            auto itr = door_mappings_.find(door.object_id());
+            if (itr != door_mappings_.end())
+                itr->second.push_back(mapping.id());
+        }
+    }
+    DEBUG("Access matrix: loaded " << mappings_.size() << " mappings for "
+                                   << door_mappings_.size() << " doors.");
+}
+
+void AccessMatrix::load_missing(const DBPtr &db)
+{
+    for (const auto &mapping : mappings_)
+    {
+        for (const auto &gid : mapping.second.groups)
+        {
+            if (group_members_.count(gid))
+                continue;
+            auto &members = group_members_[gid];
+            if (Auth::GroupPtr group = db->find<Auth::Group>(gid))
+            {
+                for (const auto &membership : group->user_memberships())
+                    members.push_back(membership->user_id());
+            }
+        }
+        for (const auto &cid : mapping.second.credentials)
+        {
+            if (credential_owner_.count(cid))
+                continue;
+            Cred::CredentialPtr cred = db->find<Cred::Credential>(cid);
+            credential_owner_[cid]   = cred ? cred->owner_id() : 0;
+        }
+    }
+}
+
+void AccessMatrix::compute_door(Auth::DoorId did)
+{
+    auto &users = access_[did];
+    users.clear();
+    auto grant = [&](Auth::UserId uid) {
+        if (!uid)
+            return;
+        if (uid >= users.size())
+            users.resize(uid + 1);
+        users.set(uid);
+    };
+
+    for (const auto &mid : door_mappings_.at(did))
+    {
+        const auto &mapping = mappings_.at(mid);
+        for (const auto &uid : mapping.users)
+            grant(uid);
+        for (const auto &gid : mapping.groups)
+        {
+            for (const auto &uid : group_members_.at(gid))
+                grant(uid);
+        }
+        for (const auto &cid : mapping.credentials)
+            grant(credential_owner_.at(cid));
+    }
+}
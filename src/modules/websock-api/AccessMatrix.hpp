@@ -0,0 +1,142 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "core/auth/AuthFwd.hpp"
+#include "core/credentials/CredentialFwd.hpp"
+#include "tools/ToolsFwd.hpp"
+#include "tools/db/db_fwd.hpp"
+#include <boost/dynamic_bitset.hpp>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <vector>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace WebSockAPI
+{
+/**
+ * A materialized view of which users can access which doors, as
+ * returned by the `access_overview` API call.
+ *
+ * A user can access a door if one of the door's ScheduleMapping
+ * maps the user directly, one of their groups, or one of their
+ * credentials (see ScheduleMapping::has_user_indirect()).
+ *
+ * The matrix is built from a compiled copy of the mappings, group
+ * memberships and credential owners, and stores one user bitmap per
+ * door. Handlers that modify those objects report their changes
+ * through the `*_changed()` methods. Changes are cheap to report:
+ * the stale part of the compiled data is reloaded, and the affected
+ * doors recomputed, the next time the matrix is serialized.
+ *
+ * This class is thread safe.
+ */
+class AccessMatrix
+{
+  public:
+    AccessMatrix();
+
+    /**
+     * The members of a group changed, or the group was deleted.
+     */
+    void group_changed(Auth::GroupId gid);
+
+    /**
+     * The owner of a credential changed, or the credential was deleted.
+     */
+    void credential_changed(Cred::CredentialId cid);
+
+    /**
+     * Doors, schedules or schedule mappings changed.
+     */
+    void mappings_changed();
+
+    /**
+     * Bring the matrix up to date, and serialize it.
+     *
+     * The result is an array of `{"door_id": ..., "user_ids": [...]}`
+     * objects, one per door, ordered by door id.
+     *
+     * @note This must be called while a database transaction is active.
+     */
+    nlohmann::json serialize(const DBPtr &db);
+
+  private:
+    /**
+     * The part of a ScheduleMapping that grants access.
+     */
+    struct CompiledMapping
+    {
+        std::vector<Auth::UserId> users;
+        std::vector<Auth::GroupId> groups;
+        std::vector<Cred::CredentialId> credentials;
+    };
+
+    void load_mappings(const DBPtr &db);
+
+    /**
+     * Load the members of groups, and the owner of credentials,
+     * referenced by mappings but missing from the cache.
+     */
+    void load_missing(const DBPtr &db);
+
+    void compute_door(Auth::DoorId did);
+
+    std::mutex mutex_;
+
+    bool mappings_dirty_;
+
+    /**
+     * Doors whose bitmap must be recomputed.
+     */
+    std::set<Auth::DoorId> dirty_doors_;
+
+    std::set<Auth::GroupId> dirty_groups_;
+    std::set<Cred::CredentialId> dirty_credentials_;
+
+    std::map<Tools::ScheduleMappingId, CompiledMapping> mappings_;
+
+    /**
+     * Mappings of each door. Every door has an entry, even
+     * if it is not mapped.
+     */
+    std::map<Auth::DoorId, std::vector<Tools::ScheduleMappingId>> door_mappings_;
+
+    std::map<Auth::GroupId, std::vector<Auth::UserId>> group_members_;
+
+    /**
+     * Owner of credentials. Credentials without owner map to 0.
+     */
+    std::map<Cred::CredentialId, Auth::UserId> credential_owner_;
+
+    /**
+     * For each door, the set of users who can access it, indexed
+     * by user id.
+     */
+    std::map<Auth::DoorId, boost::dynamic_bitset<>> access_;
+};
+}
+}
+}
@@ -84,6 +84,11 @@ ServerMessage ExceptionConverter::convert_impl(const std::exception_ptr &ptr)
         response.status_code   = APIStatusCode::MALFORMED;
         response.status_string = e.what();
     }
+    catch (const RateLimited &e)
+    {
+        response.status_code   = APIStatusCode::RATE_LIMITED;
+        response.status_string = e.what();
+    }
     catch (const SessionAborted &e)
     {
         response.status_code   = APIStatusCode::SESSION_ABORTED;
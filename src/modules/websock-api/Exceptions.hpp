@@ -45,6 +45,17 @@ class InvalidCall : public LEOSACException
         : LEOSACException("Unknown message type."){};
 };
 
+/**
+ * The request cannot be processed right now because the server
+ * is overloaded. The client may retry later.
+ */
+class RateLimited : public LEOSACException
+{
+  public:
+    RateLimited()
+        : LEOSACException("Server is busy. Try again later."){};
+};
+
 class SessionAborted : public LEOSACException
 {
   public:
@@ -48,9 +48,10 @@ struct RequestContext
 
     /**
      * The initial audit trail for the request.
-     * It is guaranteed that this audit object is:
-     *     + Non null
-     *     + Already persisted
+     * It is guaranteed that this audit object is non null.
+     *
+     * It may not be persisted yet: it is persisted when it becomes
+     * the parent of another entry (see Audit::Factory).
      */
     Audit::IAuditEntryPtr audit;
 };
@@ -0,0 +1,148 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TokenCache.hpp"
+#include "core/auth/Token.hpp"
+#include "core/auth/Token_odb.h"
+#include "core/auth/User.hpp"
+#include "core/auth/User_odb.h"
+#include "tools/db/MultiplexedSession.hpp"
+#include "tools/log.hpp"
+#include <boost/optional.hpp>
+
+using namespace Leosac;
+using namespace Leosac::Module;
+using namespace Leosac::Module::WebSockAPI;
+
+TokenCache::TokenCache(DBPtr database, std::chrono::seconds validity,
+                       std::chrono::steady_clock::duration flush_interval)
+    : database_(database)
+    , validity_(validity)
+    , flush_interval_(flush_interval)
+{
+    ASSERT_LOG(database_, "No database object passed into TokenCache.");
+}
+
+void TokenCache::insert(const Auth::Token &token)
+{
+    auto now = boost::posix_time::second_clock::local_time();
+    std::lock_guard<std::mutex> lg(mutex_);
+    for (auto itr = tokens_.begin(); itr != tokens_.end();)
+    {
+        if (itr->second.expiration < now)
+            itr = tokens_.erase(itr);
+        else
+            ++itr;
+    }
+    tokens_[token.token()] = CachedToken{token.owner()->id(), token.expiration(),
+                                         std::chrono::steady_clock::now()};
+}
+
+bool TokenCache::refresh(Auth::TokenPtr token)
+{
+    ASSERT_LOG(token, "nullptr passed when excepting non-null token.");
+    auto now = boost::posix_time::second_clock::local_time();
+    boost::optional<CachedToken> cached;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        auto itr = tokens_.find(token->token());
+        if (itr != tokens_.end())
+        {
+            if (itr->second.expiration < now)
+            {
+                tokens_.erase(itr);
+                return false;
+            }
+            if (std::chrono::steady_clock::now() - itr->second.flushed_at <
+                flush_interval_)
+            {
+                token->expire_in(validity_);
+                itr->second.expiration = token->expiration();
+                return true;
+            }
+            cached = itr->second;
+        }
+    }
+
+    // Not cached, or the database copy is stale: reload and write back.
+    odb::transaction t(database_->begin());
+    db::MultiplexedSession s;
+    bool exists = true;
+    try
+    {
+        database_->reload(token);
+    }
+    catch (const odb::object_not_persistent &)
+    {
+        exists = false;
+    }
+    catch (const odb::object_changed &)
+    {
+        exists = false;
+    }
+    if (!exists)
+    {
+        // Token doesn't exist anymore.
+        std::lock_guard<std::mutex> lg(mutex_);
+        tokens_.erase(token->token());
+        return false;
+    }
+
+    // The cached expiration date is more recent than the database's.
+    if (cached ? cached->expiration < now : !token->is_valid())
+        return false;
+
+    token->expire_in(validity_);
+    database_->update(*token);
+    t.commit();
+    insert(*token);
+    return true;
+}
+
+void TokenCache::invalidate(Auth::TokenPtr token)
+{
+    ASSERT_LOG(token, "nullptr passed when excepting non-null token.");
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        tokens_.erase(token->token());
+    }
+
+    odb::transaction t(database_->begin());
+    database_->erase<Auth::Token>(token->id());
+    t.commit();
+}
+
+void TokenCache::revoke_user_tokens(Auth::UserId user_id)
+{
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        for (auto itr = tokens_.begin(); itr != tokens_.end();)
+        {
+            if (itr->second.owner == user_id)
+                itr = tokens_.erase(itr);
+            else
+                ++itr;
+        }
+    }
+
+    using Query = odb::query<Auth::Token>;
+    odb::transaction t(database_->begin());
+    database_->erase_query<Auth::Token>(Query::owner == user_id);
+    t.commit();
+}
@@ -0,0 +1,116 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "core/auth/AuthFwd.hpp"
+#include "tools/db/db_fwd.hpp"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace Leosac
+{
+namespace Module
+{
+namespace WebSockAPI
+{
+/**
+ * Keeps the expiration date of the authentication tokens in use
+ * in memory.
+ *
+ * Refreshing a cached token extends its expiration date in memory
+ * only. The token is reloaded, and its expiration date written to
+ * the database, at most once every `flush_interval`.
+ *
+ * Tokens revoked by Leosac must be revoked through invalidate() or
+ * revoke_user_tokens(), which drop them from the cache. A token deleted
+ * from the database by other means remains usable until its next reload.
+ *
+ * This class is thread safe.
+ */
+class TokenCache
+{
+  public:
+    /**
+     * @param validity How long a token remains valid after its last use.
+     * @param flush_interval Maximum delay between two reloads of a token.
+     */
+    TokenCache(DBPtr database, std::chrono::seconds validity,
+               std::chrono::steady_clock::duration flush_interval);
+
+    /**
+     * Record a token that was just written to the database.
+     * Expired tokens are evicted from the cache.
+     */
+    void insert(const Auth::Token &token);
+
+    /**
+     * Make sure a token is still valid, and extend its expiration date.
+     *
+     * @return false if the token expired or doesn't exist anymore.
+     */
+    bool refresh(Auth::TokenPtr token);
+
+    /**
+     * Remove a token from the database and from the cache.
+     */
+    void invalidate(Auth::TokenPtr token);
+
+    /**
+     * Remove all tokens of a user from the database and from the cache.
+     */
+    void revoke_user_tokens(Auth::UserId user_id);
+
+  private:
+    /**
+     * Cached state of a token.
+     */
+    struct CachedToken
+    {
+        Auth::UserId owner;
+
+        /**
+         * Expiration date, which may be more recent than
+         * the one stored in the database.
+         */
+        boost::posix_time::ptime expiration;
+
+        /**
+         * When the expiration date was last written to the database.
+         */
+        std::chrono::steady_clock::time_point flushed_at;
+    };
+
+    DBPtr database_;
+    std::chrono::seconds validity_;
+    std::chrono::steady_clock::duration flush_interval_;
+
+    std::mutex mutex_;
+
+    /**
+     * Tokens in use, indexed by their string representation.
+     */
+    std::map<std::string, CachedToken> tokens_;
+};
+}
+}
+}
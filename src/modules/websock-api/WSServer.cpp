@@ -52,6 +52,7 @@
 #include "api/update-management/UpdateHistory.hpp"
 #include "core/CoreUtils.hpp"
 #include "core/GetServiceRegistry.hpp"
+#include "core/audit/AsyncAuditWriter.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/WSAPICall.hpp"
 #include "core/auth/Token_odb.h"
@@ -60,14 +61,15 @@
 #include "exception/ExceptionsTools.hpp"
 #include "exception/ModelException.hpp"
 #include "exception/PermissionDenied.hpp"
+#include "tools/AssertCast.hpp"
 #include "tools/db/DBService.hpp"
 #include "tools/db/DatabaseTracer.hpp"
 #include "tools/db/MultiplexedTransaction.hpp"
-#include "tools/db/OptionalTransaction.hpp"
 #include "tools/log.hpp"
 #include "tools/registry/ThreadLocalRegistry.hpp"
 #include <nlohmann/json.hpp>
 #include <odb/session.hxx>
+#include <thread>
 
 using namespace Leosac;
 using namespace Leosac::Module;
@@ -75,10 +77,46 @@ using namespace Leosac::Module::WebSockAPI;
 
 using json = nlohmann::json;
 
-WSServer::WSServer(WebSockAPIModule &module, DBPtr database)
-    : auth_(*this)
+namespace
+{
+/**
+ * A request being processed by a websocket thread.
+ */
+struct CurrentRequest
+{
+    WSServer::ConnectionStatePtr state;
+    ServerMessage response;
+    Audit::IWSAPICallPtr audit;
+    bool deferred;
+};
+
+/**
+ * The request being processed by the calling thread, if any.
+ */
+thread_local CurrentRequest *current_request = nullptr;
+
+/**
+ * Makes a request current for the lifetime of the object.
+ */
+struct CurrentRequestScope
+{
+    explicit CurrentRequestScope(CurrentRequest &request)
+    {
+        current_request = &request;
+    }
+
+    ~CurrentRequestScope()
+    {
+        current_request = nullptr;
+    }
+};
+}
+
+WSServer::WSServer(WebSockAPIModule &module, DBPtr database, bool async_audit)
+    : auth_(*this, database)
     , dbsrv_(std::make_shared<DBService>(database))
     , module_(module)
+    , async_audit_(async_audit)
 {
     ASSERT_LOG(database, "No database object passed into WSServer.");
     using websocketpp::lib::placeholders::_1;
@@ -143,47 +181,60 @@ WSServer::~WSServer()
 void WSServer::on_open(websocketpp::connection_hdl hdl)
 {
     INFO("New WebSocket connection !");
-    connection_session_.insert(
-        std::make_pair(hdl, std::make_shared<APISession>(*this)));
+    auto state = std::make_shared<ConnectionState>(
+        hdl, std::make_shared<APISession>(*this), srv_.get_io_service());
+
+    std::lock_guard<std::mutex> lg(sessions_mutex_);
+    connection_session_.insert(std::make_pair(hdl, state));
 }
 
 void WSServer::on_close(websocketpp::connection_hdl hdl)
 {
     INFO("WebSocket connection closed.");
+    std::lock_guard<std::mutex> lg(sessions_mutex_);
     connection_session_.erase(hdl);
 }
 
 void WSServer::on_message(websocketpp::connection_hdl hdl, Server::message_ptr msg)
 {
-    ASSERT_LOG(connection_session_.find(hdl) != connection_session_.end(),
-               "Cannot retrieve API pointer from connection handle.");
-    auto session_handle = connection_session_.find(hdl)->second;
-
-    // todo maybe parse first so be we can have better error handling.
-    auto db_req_counter = dbsrv_->operation_count();
-    Audit::IWSAPICallPtr audit;
-    boost::optional<ServerMessage> response = ServerMessage();
-    json req;
-    try
+    ConnectionStatePtr state;
     {
-        audit = Audit::Factory::WSAPICall(dbsrv_->db());
+        std::lock_guard<std::mutex> lg(sessions_mutex_);
+        auto itr = connection_session_.find(hdl);
+        ASSERT_LOG(itr != connection_session_.end(),
+                   "Cannot retrieve API pointer from connection handle.");
+        state = itr->second;
     }
-    catch (const odb::exception &e)
+
+    // The state is kept alive until the request is processed, even if
+    // the connection is closed in the meantime.
+    state->strand.post([this, state, msg]() { process_message(state, msg); });
+}
+
+void WSServer::process_message(ConnectionStatePtr state, Server::message_ptr msg)
+{
+    auto hdl            = state->hdl;
+    auto session_handle = state->session;
+    websocketpp::lib::error_code ec;
+    auto ws_connection_ptr = srv_.get_con_from_hdl(hdl, ec);
+    if (ec)
     {
-        WARN("Database Error in WServer::on_message. Aborting request processing. "
-             "Error: "
-             << e.what());
-        response->status_code   = APIStatusCode::DATABASE_ERROR;
-        response->status_string = e.what();
-        send_message(hdl, *response);
+        DEBUG("Dropping request from a closed WebSocket connection.");
         return;
     }
+
+    // The audit entry is built in memory, and written once the
+    // request is processed (see send_response()). Database operations
+    // are counted on this thread only: other requests may be processed
+    // concurrently.
+    auto db_req_counter = dbsrv_->operation_count();
+    Audit::IWSAPICallPtr audit = Audit::Factory::DetachedWSAPICall(dbsrv_->db());
+    boost::optional<ServerMessage> response = ServerMessage();
+    json req;
     try
     {
         audit->event_mask(Audit::EventType::WSAPI_CALL);
         audit->author(session_handle->current_user());
-        auto ws_connection_ptr = srv_.get_con_from_hdl(hdl);
-        ASSERT_LOG(ws_connection_ptr, "No websocket connection object from handle.");
         audit->source_endpoint(ws_connection_ptr->get_remote_endpoint());
 
         // todo careful potential DDOS as we store the full content without checking
@@ -196,8 +247,19 @@ void WSServer::on_message(websocketpp::connection_hdl hdl, Server::message_ptr m
         ClientMessage input_msg = parse_request(req);
         audit->uuid(input_msg.uuid);
         audit->method(input_msg.type);
-        dbsrv_->update(*audit); // update audit with new info
-        response = handle_request(session_handle, input_msg, audit);
+
+        CurrentRequest current{state, ServerMessage(), audit, false};
+        current.response.uuid = input_msg.uuid;
+        current.response.type = input_msg.type;
+        {
+            CurrentRequestScope scope(current);
+            response = handle_request(session_handle, input_msg, audit);
+        }
+        if (current.deferred)
+        {
+            count_database_operations(audit, db_req_counter);
+            return;
+        }
     }
     catch (const std::invalid_argument &e)
     {
@@ -212,17 +274,13 @@ void WSServer::on_message(websocketpp::connection_hdl hdl, Server::message_ptr m
     }
 
     if (response)
-    {
-        audit->database_operations(
-            static_cast<uint16_t>(dbsrv_->operation_count() - db_req_counter));
-        finalize_audit(audit, *response);
-        send_message(hdl, *response);
-    }
+        send_response(hdl, audit, db_req_counter, *response);
 }
 
-void WSServer::run(const std::string &interface, uint16_t port)
+void WSServer::run(const std::string &interface, uint16_t port, size_t nb_threads)
 {
-    INFO("WebSockAPI server thread id is " << gettid());
+    INFO("WebSockAPI server thread id is " << gettid() << ". Using " << nb_threads
+                                           << " threads.");
 
     boost::asio::ip::tcp::endpoint endpoint(
         boost::asio::ip::address::from_string(interface), port);
@@ -234,7 +292,13 @@ void WSServer::run(const std::string &interface, uint16_t port)
     get_service_registry().register_service<Service>(
         std::make_unique<Service>(*this));
     work_ = std::make_unique<boost::asio::io_service::work>(srv_.get_io_service());
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < nb_threads; ++i)
+        workers.emplace_back([this]() { srv_.run(); });
     srv_.run();
+    for (auto &worker : workers)
+        worker.join();
     DEBUG("END OF WSServer::run()");
     ASSERT_LOG(get_service_registry().get_service<Service>() == nullptr,
                "Service has not been unregistered");
@@ -245,10 +309,18 @@ void WSServer::start_shutdown()
     srv_.get_io_service().post([this]() {
         attempt_unregister_ws_service();
         srv_.stop_listening();
-        for (auto con_session : connection_session_)
+
+        // Closing a connection may call on_close(), which needs the lock.
+        std::vector<websocketpp::connection_hdl> connections;
+        {
+            std::lock_guard<std::mutex> lg(sessions_mutex_);
+            for (const auto &con_session : connection_session_)
+                connections.push_back(con_session.first);
+        }
+        for (const auto &hdl : connections)
         {
             websocketpp::lib::error_code ec;
-            srv_.close(con_session.first, 0, "bye", ec);
+            srv_.close(hdl, 0, "bye", ec);
             if (ec.value() == websocketpp::error::value::invalid_state)
             {
                 // Maybe the connection is already dead at this point.
@@ -266,13 +338,36 @@ APIAuth &WSServer::auth()
     return auth_;
 }
 
+AccessMatrix &WSServer::access_matrix()
+{
+    return access_matrix_;
+}
+
 boost::optional<json> WSServer::dispatch_request(APIPtr api_handle,
                                                  const ClientMessage &in,
                                                  Audit::IAuditEntryPtr audit)
 {
+    // Handlers may be (un)registered concurrently. Copy what we need,
+    // so that the lock isn't held while the request is processed.
+    Service::WSHandler asio_handler;
+    MethodHandler::Factory method_handler_factory     = nullptr;
+    json (APISession::*handler_method)(const json &) = nullptr;
+    CRUDResourceHandler::Factory crud_handler_factory = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(handlers_mutex_);
+        auto find = [&](const auto &map, auto &out) {
+            auto itr = map.find(in.type);
+            if (itr != map.end())
+                out = itr->second;
+        };
+        find(asio_handlers_, asio_handler);
+        find(individual_handlers_, method_handler_factory);
+        find(handlers_, handler_method);
+        find(crud_handlers_, crud_handler_factory);
+    }
+
     // Handlers registered by others modules.
-    auto asio_handler = asio_handlers_.find(in.type);
-    if (asio_handler != asio_handlers_.end())
+    if (asio_handler)
     {
         RequestContext ctx{.session      = api_handle,
                            .dbsrv        = dbsrv_,
@@ -281,16 +376,15 @@ boost::optional<json> WSServer::dispatch_request(APIPtr api_handle,
                            .security_ctx = api_handle->security_context(),
                            .audit        = audit};
         // Will block the current thread until the response has been built.
-        return asio_handler->second(ctx);
+        return asio_handler(ctx);
     }
 
     // A request is an "Unit-of-Work" for the application.
     // We create a default database session for the request.
     odb::session database_session;
-    auto handler_factory = individual_handlers_.find(in.type);
     api_handle->hook_before_request();
 
-    if (handler_factory != individual_handlers_.end())
+    if (method_handler_factory)
     {
         RequestContext ctx{.session      = api_handle,
                            .dbsrv        = dbsrv_,
@@ -299,17 +393,15 @@ boost::optional<json> WSServer::dispatch_request(APIPtr api_handle,
                            .security_ctx = api_handle->security_context(),
                            .audit        = audit};
 
-        MethodHandlerUPtr method_handler = handler_factory->second(ctx);
+        MethodHandlerUPtr method_handler = method_handler_factory(ctx);
         return method_handler->process(in);
     }
 
-    auto handler_method = handlers_.find(in.type);
-    if (handler_method != handlers_.end())
+    if (handler_method)
     {
         if (api_handle->allowed(in.type))
         {
-            auto method_ptr = handler_method->second;
-            return ((*api_handle).*method_ptr)(in.content);
+            return ((*api_handle).*handler_method)(in.content);
         }
         else
         {
@@ -317,8 +409,7 @@ boost::optional<json> WSServer::dispatch_request(APIPtr api_handle,
         }
     }
 
-    auto crud_handler_factory = crud_handlers_.find(in.type);
-    if (crud_handler_factory == crud_handlers_.end())
+    if (!crud_handler_factory)
         throw InvalidCall();
     else
     {
@@ -329,7 +420,7 @@ boost::optional<json> WSServer::dispatch_request(APIPtr api_handle,
                            .security_ctx = api_handle->security_context(),
                            .audit        = audit};
 
-        CRUDResourceHandlerUPtr crud_handler = crud_handler_factory->second(ctx);
+        CRUDResourceHandlerUPtr crud_handler = crud_handler_factory(ctx);
         return crud_handler->process(in);
     }
 }
@@ -355,7 +446,11 @@ void WSServer::send_message(websocketpp::connection_hdl hdl,
     json_message["status_string"] = msg.status_string;
     json_message["content"]       = msg.content;
 
-    srv_.send(hdl, json_message.dump(4), websocketpp::frame::opcode::text);
+    // The connection may have been closed while the request was processed.
+    websocketpp::lib::error_code ec;
+    srv_.send(hdl, json_message.dump(4), websocketpp::frame::opcode::text, ec);
+    if (ec)
+        DEBUG("Failed to send WebSocket message: " << ec.message());
 }
 
 ClientMessage WSServer::parse_request(const json &req)
@@ -407,36 +502,80 @@ boost::optional<ServerMessage> WSServer::handle_request(APIPtr api_handle,
     return response;
 }
 
-void WSServer::clear_user_sessions(Auth::UserPtr user, APIPtr exception)
+WSServer::Completion WSServer::defer_response()
 {
-    db::OptionalTransaction t(dbsrv_->db()->begin());
+    ASSERT_LOG(current_request, "Not processing a request.");
+    current_request->deferred = true;
+
+    auto state    = current_request->state;
+    auto response = current_request->response;
+    auto audit    = current_request->audit;
 
-    std::vector<Auth::TokenPtr> tokens_to_remove;
-    for (const auto &connection_to_session : connection_session_)
+    response.status_code = APIStatusCode::SUCCESS;
+
+    // Keep the io_service running until the request is completed.
+    auto work = std::make_shared<boost::asio::io_service::work>(srv_.get_io_service());
+    return [this, state, response, audit, work](Continuation cont) {
+        state->strand.post([this, state, response, audit, cont]() mutable {
+            auto db_req_counter = dbsrv_->operation_count();
+            try
+            {
+                odb::session database_session;
+                response.content = cont();
+            }
+            catch (...)
+            {
+                response = ExceptionConverter().convert_merge(
+                    std::current_exception(), response);
+            }
+            send_response(state->hdl, audit, db_req_counter, response);
+        });
+    };
+}
+
+void WSServer::clear_user_sessions(Auth::UserPtr user, APIPtr exception)
+{
+    std::vector<ConnectionStatePtr> states;
     {
-        const auto &session = connection_to_session.second;
-        if (session->current_user_id() == user->id() && exception != session)
+        std::lock_guard<std::mutex> lg(sessions_mutex_);
+        for (const auto &connection_to_session : connection_session_)
         {
-            // Mark the token for invalidation.
-            if (auto token = session->current_token())
-                tokens_to_remove.push_back(token);
-
-            // Clear authentication status from this user.
-            session->abort_session();
-            // Notify them
-            ServerMessage msg;
-            msg.content["reason"] = "Session cleared.";
-            msg.status_code       = APIStatusCode::SUCCESS;
-            msg.type              = "session_closed";
-            send_message(connection_to_session.first, msg);
+            if (connection_to_session.second->session != exception)
+                states.push_back(connection_to_session.second);
         }
     }
 
-    for (const auto &token : tokens_to_remove)
+    auto user_id = user->id();
+    for (const auto &state : states)
     {
-        dbsrv_->db()->erase<Auth::Token>(token->id());
+        // Sessions are only accessed from their connection's strand.
+        state->strand.post([this, state, user_id]() {
+            try
+            {
+                const auto &session = state->session;
+                if (session->current_user_id() != user_id)
+                    return;
+
+                // Invalidate the token.
+                if (auto token = session->current_token())
+                    auth_.invalidate_token(token);
+
+                // Clear authentication status from this user.
+                session->abort_session();
+                // Notify them
+                ServerMessage msg;
+                msg.content["reason"] = "Session cleared.";
+                msg.status_code       = APIStatusCode::SUCCESS;
+                msg.type              = "session_closed";
+                send_message(state->hdl, msg);
+            }
+            catch (const std::exception &e)
+            {
+                WARN("Failed to clear WebSocket session.");
+                log_exception(e);
+            }
+        });
     }
-    t.commit();
 }
 
 void WSServer::register_crud_handler(const std::string &resource_name,
@@ -462,11 +601,46 @@ bool WSServer::has_handler(const std::string &name) const
            crud_handlers_.count(name) || asio_handlers_.count(name);
 }
 
+void WSServer::count_database_operations(const Audit::IWSAPICallPtr &audit,
+                                         size_t db_req_counter)
+{
+    audit->database_operations(static_cast<uint16_t>(
+        audit->database_operations() + dbsrv_->operation_count() - db_req_counter));
+}
+
+void WSServer::send_response(websocketpp::connection_hdl hdl,
+                             const Audit::IWSAPICallPtr &audit,
+                             size_t db_req_counter, ServerMessage &msg)
+{
+    count_database_operations(audit, db_req_counter);
+
+    // An entry that was persisted while processing the request (because it
+    // is the parent of other entries) is finalized in the database first.
+    if (audit->id() || !async_audit_)
+    {
+        finalize_audit(audit, msg);
+        send_message(hdl, msg);
+        return;
+    }
+
+    audit->uuid(msg.uuid);
+    audit->method(msg.type);
+    audit->status_code(msg.status_code);
+    audit->status_string(msg.status_string);
+    send_message(hdl, msg);
+
+    auto writer = get_service_registry().get_service<Audit::AsyncAuditWriter>();
+    ASSERT_LOG(writer, "No AsyncAuditWriter service.");
+    writer->enqueue(audit);
+}
+
 void WSServer::finalize_audit(const Audit::IWSAPICallPtr &audit, ServerMessage &msg)
 {
     try
     {
         db::MultiplexedTransaction t(dbsrv_->db()->begin());
+        if (!audit->id())
+            assert_cast<Audit::AuditEntryPtr>(audit)->persist_detached();
         // If something went wrong while processing the request, the audit object
         // may need to be reload. We might as well reload it every time.
         audit->reload();
@@ -492,48 +666,29 @@ void WSServer::finalize_audit(const Audit::IWSAPICallPtr &audit, ServerMessage &
 bool WSServer::register_asio_handler(const Service::WSHandler &handler,
                                      const std::string &name)
 {
-    DEBUG("Scheduling ASIO-based-handler registration. (name: " << name << ')');
-    std::packaged_task<bool()> pt([=]() {
-        if (has_handler(name))
-            return false;
-        DEBUG("Performing registration of ASIO-based-handler. (name: " << name
-                                                                       << ')');
-        asio_handlers_[name] = handler;
-        return true;
-    });
-    std::future<bool> future = pt.get_future();
-
-    srv_.get_io_service().post([&]() { pt(); });
-    return future.get();
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
+    if (has_handler(name))
+        return false;
+    DEBUG("Performing registration of ASIO-based-handler. (name: " << name << ')');
+    asio_handlers_[name] = handler;
+    return true;
 }
 
 void WSServer::unregister_handler(const std::string &name)
 {
-    DEBUG("Scheduling removal of ASIO-based-handler (name " << name << ')');
-    std::promise<void> p;
-
-    srv_.get_io_service().post([&]() {
-        asio_handlers_.erase(name);
-        handlers_.erase(name);
-        individual_handlers_.erase(name);
-        crud_handlers_.erase(name);
-        p.set_value();
-    });
-
-    return p.get_future().get();
+    DEBUG("Removing ASIO-based-handler (name " << name << ')');
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
+    asio_handlers_.erase(name);
+    handlers_.erase(name);
+    individual_handlers_.erase(name);
+    crud_handlers_.erase(name);
 }
 
 void WSServer::register_crud_handler_external(const std::string &resource_name,
                                               CRUDResourceHandler::Factory factory)
 {
-    std::promise<void> p;
-
-    srv_.get_io_service().post([&]() {
-        register_crud_handler(resource_name, factory);
-        p.set_value();
-    });
-
-    return p.get_future().get();
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
+    register_crud_handler(resource_name, factory);
 }
 
 void WSServer::attempt_unregister_ws_service()
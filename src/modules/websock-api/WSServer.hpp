@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include "AccessMatrix.hpp"
 #include "LeosacFwd.hpp"
 #include "Messages.hpp"
 #include "Service.hpp"
@@ -31,6 +32,7 @@
 #include "core/audit/AuditFwd.hpp"
 #include "tools/db/db_fwd.hpp"
 #include <boost/optional.hpp>
+#include <mutex>
 #include <set>
 #include <type_traits>
 #include <websocketpp/config/asio_no_tls.hpp>
@@ -48,7 +50,18 @@ using json = nlohmann::json;
 /**
  * The implementation class that runs the websocket server.
  * The `run()` method is invoked in its own thread, and from this point on, the
- * object lives its life independently in this thread.
+ * object lives its life independently in a pool of threads that all run
+ * the server's io_service.
+ *
+ * Each connection has its own strand: requests from a given client are
+ * processed in order, one at a time, but requests from different clients
+ * are processed concurrently. Per-connection state (the APISession) is
+ * only ever accessed from the connection's strand.
+ *
+ * A request handler may also defer its response (see defer_response()),
+ * to wait for a result computed on an other thread without holding the
+ * strand. The next requests of the client are then processed in the
+ * meantime, and responses may be sent out of order.
  *
  * The WebSockAPIModule object can communicate with WSServer by calling any of the
  * thread safe method.
@@ -64,15 +77,46 @@ class WSServer
     /**
      * @param database A (non-null) pointer to the
      * database.
+     * @param async_audit Whether the audit entries of API calls are written
+     * in the background, after the response is sent.
      */
-    WSServer(WebSockAPIModule &module, DBPtr database);
+    WSServer(WebSockAPIModule &module, DBPtr database, bool async_audit);
     ~WSServer();
 
-    using Server           = websocketpp::server<websocketpp::config::asio>;
-    using ConnectionAPIMap = std::map<websocketpp::connection_hdl, APIPtr,
-                                      std::owner_less<websocketpp::connection_hdl>>;
+    using Server = websocketpp::server<websocketpp::config::asio>;
 
-    void run(const std::string &interface, uint16_t port);
+    /**
+     * State associated with a websocket connection.
+     */
+    struct ConnectionState
+    {
+        ConnectionState(websocketpp::connection_hdl h, APIPtr s,
+                        boost::asio::io_service &io)
+            : hdl(h)
+            , session(s)
+            , strand(io)
+        {
+        }
+
+        websocketpp::connection_hdl hdl;
+        APIPtr session;
+
+        /**
+         * Serializes the processing of the connection's requests,
+         * and any other access to `session`.
+         */
+        boost::asio::io_service::strand strand;
+    };
+    using ConnectionStatePtr = std::shared_ptr<ConnectionState>;
+    using ConnectionAPIMap =
+        std::map<websocketpp::connection_hdl, ConnectionStatePtr,
+                 std::owner_less<websocketpp::connection_hdl>>;
+
+    /**
+     * Run the server, using `nb_threads` threads (including the calling
+     * one) to process requests.
+     */
+    void run(const std::string &interface, uint16_t port, size_t nb_threads);
 
     Server srv_;
 
@@ -87,9 +131,9 @@ class WSServer
     void start_shutdown();
 
     /**
-     * This function block the calling thread until the WebSocket thread has
-     * processed the handler registration.
+     * Register an handler invoked for requests of type `name`.
      *
+     * @return false if an handler with this name already exists.
      * @note This method is thread-safe.
      */
     bool register_asio_handler(const Service::WSHandler &handler,
@@ -98,20 +142,21 @@ class WSServer
 
     /**
      * Register a CRUD handler from an external thread.
-     * The handler will be invoked on the Websocket thread.
+     * The handler will be invoked on the Websocket threads.
      *
      * This method should only be called by WebSockAPI::Service.
      *
-     * @note This method is thread-safe and will block the calling
-     * thread until the registration is done.
+     * @note This method is thread-safe.
      */
     void register_crud_handler_external(const std::string &resource_name,
                                         CRUDResourceHandler::Factory factory);
     /**
      * Remove an Asio based handler.
      *
-     * @note This method is thread-safe and runs the removal code
-     * into the WSServer's io_service.
+     * Requests that are already being processed by the handler
+     * are not waited for.
+     *
+     * @note This method is thread-safe.
      */
     void unregister_handler(const std::string &name);
 
@@ -120,6 +165,14 @@ class WSServer
      */
     APIAuth &auth();
 
+    /**
+     * Retrieve the door-to-user access matrix.
+     *
+     * Handlers that modify doors, schedules, group memberships or
+     * credentials must report their changes to it.
+     */
+    AccessMatrix &access_matrix();
+
     /**
      * Retrieve database handle
      */
@@ -135,9 +188,41 @@ class WSServer
      */
     CoreUtilsPtr core_utils();
 
+    /**
+     * Continuation of a request whose response was deferred. It runs on
+     * the connection's strand, and returns the content of the response.
+     * It may throw, as a request handler would.
+     */
+    using Continuation = std::function<json()>;
+
+    /**
+     * Completes a deferred request, by running a continuation and sending
+     * its result. It may be invoked from any thread, and must be invoked
+     * exactly once.
+     */
+    using Completion = std::function<void(Continuation)>;
+
+    /**
+     * Defer the response to the request being processed by the calling
+     * thread.
+     *
+     * No response is sent when the handler returns. Instead, the handler
+     * arranges for the returned Completion to be invoked once the
+     * response can be built, typically when an expensive computation
+     * running on an other thread is done. The connection's strand and the
+     * websocket thread are available to other requests in the meantime.
+     *
+     * The handler must not throw after calling this function.
+     *
+     * @note This must be called from a request handler.
+     */
+    Completion defer_response();
+
     /**
      * Deauthenticate all the connections of `user`, except
      * the `exception` APISession.
+     *
+     * Each session is cleared asynchronously, on its connection's strand.
      */
     void clear_user_sessions(Auth::UserPtr user, APIPtr exception);
 
@@ -151,6 +236,14 @@ class WSServer
     /**
      * A websocket message has been received.
      *
+     * The message is processed by process_message(), on the
+     * connection's strand.
+     */
+    void on_message(websocketpp::connection_hdl hdl, Server::message_ptr msg);
+
+    /**
+     * Process a websocket message.
+     *
      * At this point, all error handling happens through the use of exception.
      * Non-exceptional event, such as:
      *   + Malformed packet
@@ -163,7 +256,7 @@ class WSServer
      *
      * @note This method is responsible for saving the WSAPICall Audit event.
      */
-    void on_message(websocketpp::connection_hdl hdl, Server::message_ptr msg);
+    void process_message(ConnectionStatePtr state, Server::message_ptr msg);
 
     /**
      * Handle a request.
@@ -218,9 +311,36 @@ class WSServer
     /**
      * Returns true if an handler named `name` already
      * exists.
+     *
+     * @note `handlers_mutex_` must be held.
      */
     bool has_handler(const std::string &name) const;
 
+    /**
+     * Finalize the audit entry of a request, and send the response.
+     *
+     * Unless the entry had to be persisted while processing the request,
+     * it is written only once, by the AsyncAuditWriter, after the response
+     * is sent. Otherwise, or if asynchronous audit is disabled, it is
+     * finalized first (see finalize_audit()).
+     *
+     * @param db_req_counter The operation count of the calling thread
+     * when it started working on the request.
+     */
+    void send_response(websocketpp::connection_hdl hdl,
+                       const Audit::IWSAPICallPtr &audit, size_t db_req_counter,
+                       ServerMessage &msg);
+
+    /**
+     * Add the database operations made by the calling thread since
+     * `db_req_counter` to the operation count of `audit`.
+     *
+     * A deferred request is processed in several steps, possibly by
+     * different threads, and each step is counted separately.
+     */
+    void count_database_operations(const Audit::IWSAPICallPtr &audit,
+                                   size_t db_req_counter);
+
     /**
      * Extract values from the `msg` and finalizes the `audit` object with them.
      *
@@ -229,8 +349,22 @@ class WSServer
     void finalize_audit(const Audit::IWSAPICallPtr &audit, ServerMessage &msg);
 
     ConnectionAPIMap connection_session_;
+
+    /**
+     * Protects `connection_session_`.
+     */
+    std::mutex sessions_mutex_;
+
     APIAuth auth_;
 
+    AccessMatrix access_matrix_;
+
+    /**
+     * Protects the handler maps below. It is not held while
+     * a handler runs.
+     */
+    mutable std::mutex handlers_mutex_;
+
     /**
      * This maps (string) command name to API method.
      */
@@ -257,6 +391,12 @@ class WSServer
      */
     WebSockAPIModule &module_;
 
+    /**
+     * Hand audit entries over to the AsyncAuditWriter, instead of
+     * writing them before sending the response.
+     */
+    bool async_audit_;
+
     /**
      * Work used to keep the io_service alive while someone
      * has a reference to (WS) Service object.
@@ -21,6 +21,7 @@
 #include "WSServer.hpp"
 #include "core/CoreAPI.hpp"
 #include "core/CoreUtils.hpp"
+#include "exception/configexception.hpp"
 #include "tools/XmlPropertyTree.hpp"
 #include <boost/filesystem.hpp>
 #include <zmqpp/proxy.hpp>
@@ -36,6 +37,10 @@ WebSockAPIModule::WebSockAPIModule(zmqpp::context &ctx, zmqpp::socket *pipe,
 {
     port_      = cfg.get<uint16_t>("module_config.port", 8976);
     interface_ = cfg.get<std::string>("module_config.interface", "127.0.0.1");
+    nb_threads_ = cfg.get<size_t>("module_config.threads", 4);
+    if (nb_threads_ == 0)
+        throw Ex::Config("websock-api", "threads", false);
+    async_audit_ = cfg.get<bool>("module_config.async_audit", true);
 
     auto endpoint_colorized = Colorize::green(
         Colorize::underline(fmt::format("{}:{}", interface_, port_)));
@@ -45,8 +50,10 @@ WebSockAPIModule::WebSockAPIModule(zmqpp::context &ctx, zmqpp::socket *pipe,
 
 void WebSockAPIModule::run()
 {
-    wssrv_ = std::make_unique<WSServer>(*this, core_utils()->database());
-    std::thread thread(std::bind(&WSServer::run, wssrv_.get(), interface_, port_));
+    wssrv_ = std::make_unique<WSServer>(*this, core_utils()->database(),
+                                        async_audit_);
+    std::thread thread(
+        std::bind(&WSServer::run, wssrv_.get(), interface_, port_, nb_threads_));
 
     while (is_running_)
     {
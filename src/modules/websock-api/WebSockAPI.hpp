@@ -70,6 +70,16 @@ class WebSockAPIModule : public BaseModule
      */
     std::string interface_;
 
+    /**
+     * Number of threads processing websocket requests.
+     */
+    size_t nb_threads_;
+
+    /**
+     * Write the audit entries of API calls in the background.
+     */
+    bool async_audit_;
+
     /**
      * Our websocket server object.
      */
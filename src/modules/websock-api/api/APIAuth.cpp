@@ -18,10 +18,12 @@
 */
 
 #include "APIAuth.hpp"
+#include "Exceptions.hpp"
 #include "WSServer.hpp"
 #include "core/CoreAPI.hpp"
 #include "core/CoreUtils.hpp"
 #include "core/GetServiceRegistry.hpp"
+#include "core/auth/PasswordHasher.hpp"
 #include "core/auth/Token_odb.h"
 #include "core/auth/User.hpp"
 #include "core/auth/UserGroupMembership.hpp"
@@ -41,20 +43,28 @@ using namespace Leosac;
 using namespace Leosac::Module;
 using namespace Leosac::Module::WebSockAPI;
 
-APIAuth::APIAuth(WSServer &srv)
+constexpr std::chrono::minutes APIAuth::TOKEN_VALIDITY;
+constexpr std::chrono::seconds APIAuth::TOKEN_FLUSH_INTERVAL;
+
+APIAuth::APIAuth(WSServer &srv, DBPtr database)
     : server_(srv)
+    , tokens_(database, TOKEN_VALIDITY, TOKEN_FLUSH_INTERVAL)
 {
 }
 
 void APIAuth::invalidate_token(Auth::TokenPtr token) const
 {
-    ASSERT_LOG(token, "nullptr passed when excepting non-null token.");
+    tokens_.invalidate(token);
+}
 
-    using namespace odb;
-    using namespace odb::core;
-    odb::transaction t(server_.db()->begin());
-    server_.db()->erase<Auth::Token>(token->id());
-    t.commit();
+void APIAuth::revoke_user_tokens(Auth::UserId user_id) const
+{
+    tokens_.revoke_user_tokens(user_id);
+}
+
+bool APIAuth::refresh_token(Auth::TokenPtr token) const
+{
+    return tokens_.refresh(token);
 }
 
 Auth::TokenPtr APIAuth::authenticate_token(const std::string &token_str) const
@@ -71,20 +81,25 @@ Auth::TokenPtr APIAuth::authenticate_token(const std::string &token_str) const
     if (token && token->is_valid())
     {
         enforce_user_enabled(*token->owner());
-        token->expire_in(std::chrono::minutes(20));
+        token->expire_in(TOKEN_VALIDITY);
         db->update(token);
         t.commit();
+        tokens_.insert(*token);
         return token;
     }
     return nullptr;
 }
 
-Auth::TokenPtr APIAuth::authenticate_credentials(const std::string &username,
-                                                 const std::string &password) const
+void APIAuth::authenticate_credentials(const std::string &username,
+                                       const std::string &password,
+                                       const CredentialsCallback &callback) const
 {
     using namespace odb;
     using namespace odb::core;
     using query = odb::query<Auth::User>;
+
+    Auth::UserId user_id = 0;
+    boost::optional<ScryptResult> hash;
     {
         auto db = server_.db();
         transaction t(db->begin());
@@ -92,32 +107,113 @@ Auth::TokenPtr APIAuth::authenticate_credentials(const std::string &username,
         auto username_lowercase = boost::algorithm::to_lower_copy(username);
         Auth::UserPtr user =
             db->query_one<Auth::User>(query::username == username_lowercase);
-        if (user && user->verify_password(password))
+        if (user)
         {
-            enforce_user_enabled(*user);
-            // Create new token.
-            auto token = std::make_shared<Auth::Token>(gen_uuid(), user);
-            // Valid for 20m
-            token->expire_in(std::chrono::minutes(20));
-            db->persist(*token);
-            t.commit();
-
-            if (user->username() == "admin")
+            user_id = user->id();
+            hash    = user->password_hash();
+        }
+    }
+
+    auto hasher = get_service_registry().get_service<Auth::PasswordHasher>();
+    ASSERT_LOG(hasher, "No password hashing service.");
+
+    auto complete = server_.defer_response();
+    if (!hash)
+    {
+        complete([callback]() { return callback(nullptr); });
+        return;
+    }
+    bool rehash = hasher->needs_rehash(*hash);
+    auto params = hasher->params();
+
+    bool submitted = hasher->submit([=]() {
+        bool valid = false;
+        boost::optional<ScryptResult> new_hash;
+        std::exception_ptr error;
+        try
+        {
+            std::vector<uint8_t> pw(password.begin(), password.end());
+            valid = Scrypt::Verify(pw, *hash);
+            if (valid && rehash)
+                new_hash = Scrypt::Hash(pw, params);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        complete([=]() {
+            if (error)
+                std::rethrow_exception(error);
+            if (!valid)
+                return callback(nullptr);
+            return callback(create_token(user_id, *hash, new_hash));
+        });
+    });
+    if (!submitted)
+        complete([]() -> json { throw RateLimited(); });
+}
+
+Auth::TokenPtr
+APIAuth::create_token(Auth::UserId user_id, const ScryptResult &hash,
+                      const boost::optional<ScryptResult> &rehash) const
+{
+    using namespace odb;
+    using namespace odb::core;
+
+    auto db = server_.db();
+    Auth::TokenPtr token;
+    {
+        transaction t(db->begin());
+        Auth::UserPtr user = db->find<Auth::User>(user_id);
+        if (!user)
+            return nullptr;
+
+        enforce_user_enabled(*user);
+        // Create new token.
+        token = std::make_shared<Auth::Token>(gen_uuid(), user);
+        token->expire_in(TOKEN_VALIDITY);
+        db->persist(*token);
+        t.commit();
+        tokens_.insert(*token);
+
+        if (user->username() == "admin")
+        {
+            if (const auto &mailer =
+                    get_service_registry().get_service<SMTPService>())
             {
-                if (const auto &mailer =
-                        get_service_registry().get_service<SMTPService>())
-                {
-                    MailInfo mail;
-                    mail.title = "Admin Connected";
-                    mail.body  = "The user `admin` logged in !";
-                    mailer->async_send_to_admin(mail);
-                }
+                MailInfo mail;
+                mail.title = "Admin Connected";
+                mail.body  = "The user `admin` logged in !";
+                mailer->async_send_to_admin(mail);
             }
+        }
+    }
 
-            return token;
+    if (rehash)
+    {
+        // Failing to upgrade the hash must not prevent the login.
+        try
+        {
+            transaction t(db->begin());
+            Auth::UserPtr user = db->find<Auth::User>(user_id);
+            // Don't overwrite a password that changed in the meantime.
+            if (user && user->password_hash() && *user->password_hash() == hash)
+            {
+                user->password_hash(*rehash);
+                db->update(user);
+                t.commit();
+                INFO("Rehashed password of user " << user->username()
+                                                  << " with current parameters.");
+            }
+        }
+        catch (const odb::exception &e)
+        {
+            WARN("Failed to rehash password of user " << user_id << ": "
+                                                     << e.what());
         }
     }
-    return nullptr;
+    return token;
 }
 
 void APIAuth::enforce_user_enabled(const Auth::User &u) const
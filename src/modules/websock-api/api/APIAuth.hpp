@@ -19,9 +19,15 @@
 
 #pragma once
 
+#include "TokenCache.hpp"
 #include "core/auth/AuthFwd.hpp"
 #include "core/auth/Token.hpp"
-#include <map>
+#include "tools/db/db_fwd.hpp"
+#include "tools/scrypt/Scrypt.hpp"
+#include <boost/optional.hpp>
+#include <chrono>
+#include <functional>
+#include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
 
@@ -37,25 +43,41 @@ class WSServer;
  * authentication for Websocket client.
  *
  * The object is instantiated for the lifetime of the WSServer object.
+ *
+ * Tokens in use are cached in memory (see TokenCache). This avoids a
+ * database round-trip for each API call of an authenticated session.
  */
 class APIAuth
 {
   public:
-    APIAuth(WSServer &srv);
+    APIAuth(WSServer &srv, DBPtr database);
+
+    /**
+     * Builds the response to an authentication request, from the
+     * new authentication token (or nullptr on failure).
+     */
+    using CredentialsCallback = std::function<nlohmann::json(Auth::TokenPtr)>;
 
     /**
      * Attempt to authenticate with username/password credential
      * and generate an authentication token.
      *
-     * On success return a new authentication token that will
-     * be valid when calling for further authentication.
-     * On error returns nullptr.
+     * The password is checked on the password hashing threads (see
+     * Auth::PasswordHasher), so the response to the current request is
+     * deferred (see WSServer::defer_response()). `callback` is then
+     * invoked on the connection's strand, with a new authentication token
+     * that will be valid when calling for further authentication, or
+     * nullptr on error.
+     *
+     * If the password was hashed with outdated parameters, it is
+     * rehashed with the current ones.
      *
      * @note Username is case isensitive and will be converted to
      * lower case.
      */
-    Auth::TokenPtr authenticate_credentials(const std::string &username,
-                                            const std::string &password) const;
+    void authenticate_credentials(const std::string &username,
+                                  const std::string &password,
+                                  const CredentialsCallback &callback) const;
 
     /**
      * Attempt to authenticate with an authentication token.
@@ -70,11 +92,54 @@ class APIAuth
     Auth::TokenPtr authenticate_token(const std::string &token_str) const;
 
     /**
-     * Invalidate the authentication token, removing it from the database.
+     * Invalidate the authentication token, removing it from the database
+     * and from the cache.
+     *
+     * Tokens must be invalidated through this method, otherwise they may
+     * remain usable for up to `TOKEN_FLUSH_INTERVAL`.
      */
     void invalidate_token(Auth::TokenPtr token) const;
 
+    /**
+     * Invalidate all authentication tokens of a user, removing them from
+     * the database and from the cache.
+     */
+    void revoke_user_tokens(Auth::UserId user_id) const;
+
+    /**
+     * Make sure a token is still valid, and extend its expiration date.
+     *
+     * The new expiration date is kept in memory, and written to the
+     * database at most once every `TOKEN_FLUSH_INTERVAL`, when the token
+     * is also reloaded from the database.
+     *
+     * @return false if the token expired or doesn't exist anymore.
+     */
+    bool refresh_token(Auth::TokenPtr token) const;
+
+    /**
+     * How long a token remains valid after its last use.
+     */
+    static constexpr std::chrono::minutes TOKEN_VALIDITY{20};
+
+    /**
+     * Maximum delay between two writes of a token's expiration
+     * date to the database.
+     */
+    static constexpr std::chrono::seconds TOKEN_FLUSH_INTERVAL{60};
+
   private:
+    /**
+     * Create a token for a user whose password has been checked.
+     *
+     * @param hash the hash the password was checked against.
+     * @param rehash if set, the password hash is replaced by this one,
+     * unless the password changed in the meantime.
+     * @return the token, or nullptr if the user no longer exists.
+     */
+    Auth::TokenPtr create_token(Auth::UserId user_id, const ScryptResult &hash,
+                                const boost::optional<ScryptResult> &rehash) const;
+
     /**
      * Make sure the User `u` is authorized to log in. This means
      * that we check that their ValidityInfo is valid.
@@ -87,6 +152,8 @@ class APIAuth
      * outlive the APIAuth object.
      */
     WSServer &server_;
+
+    mutable TokenCache tokens_;
 };
 }
 }
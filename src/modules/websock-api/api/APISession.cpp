@@ -55,28 +55,31 @@ APISession::json APISession::get_leosac_version(const json &)
 
 APISession::json APISession::create_auth_token(const APISession::json &req)
 {
-    json rep;
     ASSERT_LOG(auth_status_ == AuthStatus::NONE, "Invalid auth status.");
 
     std::string username = req.at("username");
     std::string password = req.at("password");
 
-    auto token = server_.auth().authenticate_credentials(username, password);
-
-    if (token)
-    {
-        rep["status"]  = 0;
-        rep["user_id"] = token->owner()->id();
-        rep["token"]   = token->token();
-        mark_authenticated(token);
-    }
-    else
-    {
-        rep["status"]  = -1;
-        rep["message"] = "Invalid credentials";
-    }
-
-    return rep;
+    // The response is sent once the password has been checked.
+    server_.auth().authenticate_credentials(
+        username, password, [this](Auth::TokenPtr token) {
+            json rep;
+            if (token)
+            {
+                rep["status"]  = 0;
+                rep["user_id"] = token->owner()->id();
+                rep["token"]   = token->token();
+                mark_authenticated(token);
+            }
+            else
+            {
+                rep["status"]  = -1;
+                rep["message"] = "Invalid credentials";
+            }
+            return rep;
+        });
+
+    return json{};
 }
 
 APISession::json APISession::authenticate_with_token(const APISession::json &req)
@@ -136,29 +139,13 @@ void APISession::hook_before_request()
 {
     if (auth_status_ == AuthStatus::LOGGED_IN)
     {
-        odb::core::transaction t(server_.db()->begin());
-        db::MultiplexedSession s;
-        // Reload token
-        try
-        {
-            server_.db()->reload(current_auth_token_);
-        }
-        catch (const odb::object_changed &e)
+        if (!server_.auth().refresh_token(current_auth_token_))
         {
-            // Token doesn't exist anymore.
+            auto token = current_auth_token_;
             abort_session();
-            throw SessionAborted(nullptr);
+            // A token that hasn't expired was invalidated.
+            throw SessionAborted(token->is_valid() ? nullptr : token);
         }
-
-        if (!current_auth_token_->is_valid())
-        {
-            abort_session();
-            throw SessionAborted(current_auth_token_);
-        }
-
-        current_auth_token_->expire_in(std::chrono::minutes(20));
-        server_.db()->update(*current_auth_token_);
-        t.commit();
     }
 }
 
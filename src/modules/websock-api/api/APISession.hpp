@@ -106,6 +106,10 @@ class APISession
      *     + `user_id`: On success, the identifier of the logged in user.
      *     + `token`: On success, value of the generated authentication token.
      *     + `message`: An optional text message describing the status.
+     *
+     * The password is checked asynchronously, and the response is sent
+     * once the check completes. The call fails with `RATE_LIMITED` if too
+     * many passwords are being checked already.
      */
     json create_auth_token(const json &req);
 
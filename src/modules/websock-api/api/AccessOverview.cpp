@@ -18,10 +18,7 @@
 */
 
 #include "AccessOverview.hpp"
-#include "core/auth/Door.hpp"
-#include "core/auth/Door_odb.h"
-#include "core/auth/User_odb.h"
-#include "tools/JSONUtils.hpp"
+#include "WSServer.hpp"
 #include "tools/db/DBService.hpp"
 
 using namespace Leosac;
@@ -40,49 +37,11 @@ MethodHandlerUPtr AccessOverview::create(RequestContext ctx)
 
 json AccessOverview::process_impl(const json &)
 {
-    json rep;
     DBPtr db = ctx_.dbsrv->db();
     odb::transaction t(db->begin());
 
-    // todo: This probably doesn't scale very well...
-
-    auto doors = db->query<Auth::Door>();
-
-    // Since we'll be looping over users multiple time, we cannot use
-    // an odb::result object.
-    auto users_odb = db->query<Auth::User>();
-    // So we'll have to convert this to a vector of User, instead of
-    // odb::result::iterator.
-    std::vector<Auth::UserPtr> users;
-    for (auto itr_odb(users_odb.begin()); itr_odb != users_odb.end(); ++itr_odb)
-        users.push_back(itr_odb.load());
-
-    for (const auto &door : doors)
-    {
-        std::set<Auth::UserId> unique_user_ids;
-        json door_info = {{"door_id", door.id()}, {"user_ids", json::array()}};
-        for (const auto &lazy_mapping : door.lazy_mapping())
-        {
-            auto mapping = lazy_mapping.load();
-            for (const auto &user_ptr : users)
-            {
-                // Check the std::set in case the user is already authorized to
-                // access the door.
-                if (unique_user_ids.count(user_ptr->id()))
-                {
-                    continue;
-                }
-                if (mapping->has_user_indirect(user_ptr))
-                {
-                    unique_user_ids.insert(user_ptr->id());
-                }
-            }
-        }
-        for (const auto &id : unique_user_ids)
-            door_info["user_ids"].push_back(id);
-        rep.push_back(door_info);
-    }
-
+    json rep = ctx_.server.access_matrix().serialize(db);
+    t.commit();
     return rep;
 }
 
@@ -36,6 +36,9 @@ using json = nlohmann::json;
  * The overview is a simple TRUE/FALSE regarding the user permission against
  * a door. It doesn't handle timeframe yet.
  *
+ * The overview is served from the AccessMatrix, which is maintained
+ * incrementally as doors, schedules, memberships and credentials change.
+ *
  * Request:
  *     + No parameter required. This call will return an general overview.
  *
@@ -55,35 +55,44 @@ json AuditGet::process_impl(const json &req)
     {
         using namespace Tools;
         using namespace JSONUtil;
-        using Query = odb::query<Audit::AuditEntry>;
 
         int page      = extract_with_default(req, "p", 1);
         int page_size = extract_with_default(req, "ps", 20);
+        auto before_id =
+            extract_with_default(req, "before_id", Audit::AuditEntryId{0});
+        auto after_id =
+            extract_with_default(req, "after_id", Audit::AuditEntryId{0});
 
         LEOSAC_ENFORCE_ARGUMENT(page > 0, page, "Page must be >0");
         LEOSAC_ENFORCE_ARGUMENT(page_size > 0, page_size, "Page size must be >0");
 
+        auto types = enabled_types(req);
         odb::transaction t(db->begin());
-        Audit::AuditEntryCount view(
-            db->query_value<Audit::AuditEntryCount>(build_in_clause(req)));
-        rep["meta"]["count"] = view.count;
-        if (view.count)
-        {
-            rep["meta"]["total_page"] =
-                (view.count / page_size) + (view.count % page_size ? 1 : 0);
-        }
+        auto count           = ctx_.dbsrv->count_audits(types);
+        rep["meta"]["count"] = count;
+        rep["meta"]["total_page"] =
+            (count / page_size) + (count % page_size ? 1 : 0);
+
+        std::vector<Audit::AuditEntryPtr> audits;
+        if (before_id || after_id)
+            audits = ctx_.dbsrv->find_audits_range(types, before_id, after_id,
+                                                   page_size);
         else
-            rep["meta"]["total_page"] = 0;
+            audits = ctx_.dbsrv->find_audits(types, page, page_size);
 
-        auto query  = Query(build_request_string(req, page, page_size));
-        auto ret    = db->query<Audit::AuditEntry>(query);
         rep["data"] = json::array();
-        for (const auto &audit : ret)
+        for (const auto &audit : audits)
         {
             json audit_json = Audit::Serializer::PolymorphicAuditJSON::serialize(
-                audit, security_context());
+                *audit, security_context());
             rep["data"].push_back(audit_json);
         }
+
+        if (!rep["data"].empty())
+        {
+            rep["meta"]["max_id"] = rep["data"].front()["id"];
+            rep["meta"]["min_id"] = rep["data"].back()["id"];
+        }
     }
     else
     {
@@ -101,19 +110,6 @@ std::vector<ActionActionParam> AuditGet::required_permission(const json &) const
     return perm_;
 }
 
-std::string AuditGet::build_request_string(const json &req, int page,
-                                           int page_size) const
-{
-    std::stringstream request_builder;
-
-    request_builder << build_in_clause(req);
-    request_builder << " ORDER BY id DESC";
-    request_builder << " LIMIT " << page_size;
-    request_builder << " OFFSET " << page_size * (page - 1);
-    DEBUG("QUERY: " << request_builder.str());
-    return request_builder.str();
-}
-
 bool AuditGet::is_stringtype_sane(const std::string &str) const
 {
     for (const auto &c : str)
@@ -124,32 +120,22 @@ bool AuditGet::is_stringtype_sane(const std::string &str) const
     return true;
 }
 
-std::string AuditGet::build_in_clause(const json &req) const
+std::vector<std::string> AuditGet::enabled_types(const json &req) const
 {
-    std::stringstream request_builder;
+    std::vector<std::string> types;
 
-    if (req.find("enabled_type") != req.end() && req.at("enabled_type").is_array() &&
-        req.at("enabled_type").size())
+    if (req.find("enabled_type") != req.end() && req.at("enabled_type").is_array())
     {
-        const auto &enabled_types = req.at("enabled_type");
-        request_builder << "WHERE typeid IN (";
-        for (size_t i = 0; i < enabled_types.size(); ++i)
+        for (const auto &enabled_type_json : req.at("enabled_type"))
         {
-            auto enabled_type = enabled_types[i].get<std::string>();
+            auto enabled_type = enabled_type_json.get<std::string>();
             if (!is_stringtype_sane(enabled_type))
             {
                 throw LEOSACException(
                     BUILD_STR("Audit type string is invalid: " << enabled_type));
             }
-            request_builder << "'" << enabled_type << "'";
-            if (i != enabled_types.size() - 1)
-                request_builder << ",";
+            types.push_back(enabled_type);
         }
-        request_builder << ")";
-    }
-    else
-    {
-        request_builder << "1 = 1";
     }
-    return request_builder.str();
+    return types;
 }
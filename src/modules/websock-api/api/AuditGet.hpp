@@ -42,13 +42,24 @@ using json = nlohmann::json;
  *       If enabled type is not present, returns all types.
  *     + p: Page number
  *     + ps: Page size
+ *     + before_id: Optional. Only return entries older than this id.
+ *     + after_id: Optional. Only return entries newer than this id.
+ *
+ * Entries are returned newest first. When `before_id` or `after_id` is set,
+ * `p` is ignored and the `ps` entries closest to the given id are returned.
+ * Paging this way (using the `min_id` / `max_id` of the previous response)
+ * is cheap regardless of the position in the audit log, whereas the cost of
+ * a page number grows with the number of entries to skip.
  *
  * Response:
  *     + data: [JSON API data]
  *     + meta:
- *          + count: The number of entries that match the request.
+ *          + count: The number of entries that match the request. This is
+ *            a cached value that may slightly lag behind the database.
  *          + totalPage: The number of page for to retrieve all items that match
  *            the request.
+ *          + min_id: The id of the oldest entry in `data`, if any.
+ *          + max_id: The id of the newest entry in `data`, if any.
  */
 class AuditGet : public MethodHandler
 {
@@ -63,12 +74,11 @@ class AuditGet : public MethodHandler
 
   private:
     virtual json process_impl(const json &req) override;
-    std::string build_request_string(const json &req, int page, int page_size) const;
 
     /**
-     * Build the "WHERE typeid IN (...)" string based on the enabled types.
+     * Extract and validate the types enabled by the request.
      */
-    std::string build_in_clause(const json &req) const;
+    std::vector<std::string> enabled_types(const json &req) const;
 
     /**
      * Check that a given string representing an audit type
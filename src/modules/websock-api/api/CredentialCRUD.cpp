@@ -18,6 +18,7 @@
 */
 
 #include "api/CredentialCRUD.hpp"
+#include "WSServer.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/ICredentialEvent.hpp"
 #include "core/credentials/Credential.hpp"
@@ -177,6 +178,8 @@ boost::optional<json> CredentialCRUD::update_impl(const json &req)
         *cred, SystemSecurityContext::instance()));
     audit->finalize();
     t.commit();
+    // The owner may have changed.
+    ctx_.server.access_matrix().credential_changed(cid);
     return rep;
 }
 
@@ -199,6 +202,9 @@ boost::optional<json> CredentialCRUD::delete_impl(const json &req)
         audit->finalize();
         db->erase<Cred::Credential>(cred->id());
         t.commit();
+        // Mappings referencing the credential changed too.
+        ctx_.server.access_matrix().credential_changed(cid);
+        ctx_.server.access_matrix().mappings_changed();
     }
     return json{};
 }
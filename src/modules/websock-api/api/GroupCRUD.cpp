@@ -19,6 +19,7 @@
 
 #include "api/GroupCRUD.hpp"
 #include "Exceptions.hpp"
+#include "WSServer.hpp"
 #include "api/APISession.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/IGroupEvent.hpp"
@@ -157,6 +158,9 @@ boost::optional<json> GroupCRUD::delete_impl(const json &req)
     audit->finalize();
     db->erase(group);
     t.commit();
+    // Mappings referencing the group changed too.
+    ctx_.server.access_matrix().group_changed(gid);
+    ctx_.server.access_matrix().mappings_changed();
 
     return json{};
 }
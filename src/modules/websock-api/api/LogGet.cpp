@@ -51,10 +51,17 @@ json LogGet::process_impl(const json &req)
         std::string sort = extract_with_default(req, "sort", "desc");
         int p            = extract_with_default(req, "p", 0);   // page
         int ps           = extract_with_default(req, "ps", 20); // page size
+        auto before_id = extract_with_default(req, "before_id", 0ul);
+        auto after_id  = extract_with_default(req, "after_id", 0ul);
         if (ps <= 0)
             ps = 1;
 
-        LogEntry::QueryResult result = LogEntry::retrieve(db, p, ps, sort == "asc");
+        LogEntry::QueryResult result;
+        if (before_id || after_id)
+            result = LogEntry::retrieve_range(ctx_.dbsrv, before_id, after_id, ps,
+                                              sort == "asc");
+        else
+            result = LogEntry::retrieve(ctx_.dbsrv, p, ps, sort == "asc");
         for (Tools::LogEntry &entry : result.entries)
         {
             auto timestamp = boost::posix_time::to_time_t(entry.timestamp_);
@@ -37,6 +37,15 @@ using json = nlohmann::json;
  *     + `p`: The page number. Starts at 0.
  *     + `ps`: Page size: the number of item per page. Default to 20.
  *     + `sort`: Either 'asc' or 'desc'.
+ *     + `before_id`: Optional. Only return entries older than this id.
+ *     + `after_id`: Optional. Only return entries newer than this id.
+ *
+ * When `before_id` or `after_id` is set, `p` is ignored and the `ps` entries
+ * closest to the given id are returned. Unlike page numbers, this keeps the
+ * same cost wherever the cursor is in the log.
+ *
+ * The `total` count in the response is cached, and may slightly lag
+ * behind the database.
  *
  * Response:
  *     + ...
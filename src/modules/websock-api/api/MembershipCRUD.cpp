@@ -19,6 +19,7 @@
 
 #include "api/MembershipCRUD.hpp"
 #include "Exceptions.hpp"
+#include "WSServer.hpp"
 #include "api/APISession.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/IUserGroupMembershipEvent.hpp"
@@ -77,6 +78,7 @@ boost::optional<json> MembershipCRUD::create_impl(const json &req)
     db->update(group);
     audit->finalize();
     t.commit();
+    ctx_.server.access_matrix().group_changed(gid);
     rep["data"] = UserGroupMembershipJSONSerializer::serialize(*membership,
                                                                security_context());
     return rep;
@@ -114,9 +116,11 @@ boost::optional<json> MembershipCRUD::delete_impl(const json &req)
         ctx_.dbsrv->db(), membership->group().load(), membership->user().load(),
         ctx_.audit);
     audit->event_mask(Audit::EventType::GROUP_MEMBERSHIP_LEFT);
+    auto gid = membership->group_id();
     ctx_.dbsrv->db()->erase(membership);
     audit->finalize();
     t.commit();
+    ctx_.server.access_matrix().group_changed(gid);
     return json{};
 }
 
@@ -21,8 +21,10 @@
 #include "Exceptions.hpp"
 #include "WSServer.hpp"
 #include "api/APISession.hpp"
+#include "core/GetServiceRegistry.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/UserEvent.hpp"
+#include "core/auth/PasswordHasher.hpp"
 #include "core/auth/User_odb.h"
 #include "exception/EntityNotFound.hpp"
 #include "exception/PermissionDenied.hpp"
@@ -44,44 +46,95 @@ MethodHandlerUPtr PasswordChange::create(RequestContext ctx)
 
 json PasswordChange::process_impl(const json &req)
 {
-    json rep;
-
     using query = odb::query<Auth::User>;
-    DBPtr db    = ctx_.dbsrv->db();
-    odb::transaction t(db->begin());
     auto uid          = req.at("user_id").get<Auth::UserId>();
     auto new_password = req.at("new_password").get<std::string>();
 
-    Auth::UserPtr user = db->query_one<Auth::User>(query::id == uid);
-    if (user)
+    // When changing our own password, we check the `current_password` field.
+    bool check_current = uid == ctx_.session->current_user_id();
+    std::string current_password;
+    boost::optional<ScryptResult> current_hash;
     {
-        using namespace FlagSetOperator;
-        Audit::IUserEventPtr audit = Audit::Factory::UserEvent(db, user, ctx_.audit);
+        DBPtr db = ctx_.dbsrv->db();
+        odb::transaction t(db->begin());
+        Auth::UserPtr user = db->query_one<Auth::User>(query::id == uid);
+        if (!user)
+            throw EntityNotFound(uid, "user");
+        if (check_current)
+        {
+            current_password = req.at("current_password").get<std::string>();
+            current_hash     = user->password_hash();
+        }
+    }
+
+    // Hashing is done by the password hashing service. The response is
+    // sent once the new hash is stored. The context doesn't outlive this
+    // call, so we copy what the completion needs.
+    auto hasher = get_service_registry().get_service<Auth::PasswordHasher>();
+    ASSERT_LOG(hasher, "No password hashing service.");
+    auto complete = ctx_.server.defer_response();
+    auto dbsrv    = ctx_.dbsrv;
+    auto session  = ctx_.session;
+    auto parent   = ctx_.audit;
+    auto server   = &ctx_.server;
+    auto params   = hasher->params();
 
-        if (uid == ctx_.session->current_user_id())
+    bool submitted = hasher->submit([=]() {
+        bool valid = true;
+        ScryptResult new_hash;
+        std::exception_ptr error;
+        try
         {
-            auto current_password = req.at("current_password").get<std::string>();
-            // When changing our own password, we check the `current_password` field.
-            if (!user->verify_password(current_password))
+            if (check_current)
+            {
+                std::vector<uint8_t> pw(current_password.begin(),
+                                        current_password.end());
+                valid = current_hash && Scrypt::Verify(pw, *current_hash);
+            }
+            if (valid)
+            {
+                std::vector<uint8_t> pw(new_password.begin(), new_password.end());
+                new_hash = Scrypt::Hash(pw, params);
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        complete([=]() {
+            if (error)
+                std::rethrow_exception(error);
+
+            DBPtr db = dbsrv->db();
+            odb::transaction t(db->begin());
+            Auth::UserPtr user = db->query_one<Auth::User>(query::id == uid);
+            if (!user)
+                throw EntityNotFound(uid, "user");
+
+            using namespace FlagSetOperator;
+            Audit::IUserEventPtr audit = Audit::Factory::UserEvent(db, user, parent);
+            if (!valid)
             {
                 audit->event_mask(Audit::EventType::USER_PASSWORD_CHANGE_FAILURE);
                 audit->finalize();
                 t.commit();
                 throw PermissionDenied("Invalid `current_password`.");
             }
-        }
-        audit->event_mask(Audit::EventType::USER_EDITED |
-                          Audit::EventType::USER_PASSWORD_CHANGED);
-        user->password(new_password);
+            audit->event_mask(Audit::EventType::USER_EDITED |
+                              Audit::EventType::USER_PASSWORD_CHANGED);
+            user->password_hash(new_hash);
 
-        ctx_.server.clear_user_sessions(user, ctx_.session);
-        audit->finalize();
-        db->update(user);
-    }
-    else
-        throw EntityNotFound(uid, "user");
-    t.commit();
-    return rep;
+            server->clear_user_sessions(user, session);
+            audit->finalize();
+            db->update(user);
+            t.commit();
+            return json{};
+        });
+    });
+    if (!submitted)
+        complete([]() -> json { throw RateLimited(); });
+    return json{};
 }
 
 std::vector<ActionActionParam>
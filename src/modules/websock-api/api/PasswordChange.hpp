@@ -41,6 +41,9 @@ using json = nlohmann::json;
  *
  * Response:
  *     + Empty response. Refer to the global status code for error detection.
+ *
+ * Passwords are hashed by the password hashing service, and the response
+ * is sent once the new password is stored.
  */
 class PasswordChange : public MethodHandler
 {
@@ -18,6 +18,7 @@
 */
 
 #include "api/ScheduleCRUD.hpp"
+#include "WSServer.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/IDoorEvent.hpp"
 #include "core/audit/IScheduleEvent.hpp"
@@ -210,6 +211,7 @@ boost::optional<json> ScheduleCRUD::update_impl(const json &req)
     rep["data"] =
         Tools::ScheduleJSONSerializer::serialize(*schedule, security_context());
     t.commit();
+    ctx_.server.access_matrix().mappings_changed();
     return rep;
 }
 
@@ -238,6 +240,7 @@ boost::optional<json> ScheduleCRUD::delete_impl(const json &req)
         audit->finalize();
         db->erase<Tools::Schedule>(schedule->id());
         t.commit();
+        ctx_.server.access_matrix().mappings_changed();
     }
     return json{};
 }
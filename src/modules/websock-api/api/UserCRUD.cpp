@@ -19,6 +19,7 @@
 
 #include "api/UserCRUD.hpp"
 #include "Exceptions.hpp"
+#include "WSServer.hpp"
 #include "api/APISession.hpp"
 #include "core/audit/AuditFactory.hpp"
 #include "core/audit/UserEvent.hpp"
@@ -135,6 +136,8 @@ boost::optional<json> UserCRUD::update_impl(const json &req)
         *user, SystemSecurityContext::instance()));
     audit->finalize();
     t.commit();
+    if (enabled_status && !user->validity().is_enabled())
+        ctx_.server.auth().revoke_user_tokens(uid);
     return rep;
 }
 
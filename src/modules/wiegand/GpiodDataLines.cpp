@@ -0,0 +1,232 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "modules/wiegand/GpiodDataLines.hpp"
+#include "exception/gpioexception.hpp"
+#include "tools/log.hpp"
+#include <algorithm>
+#include <ctime>
+
+#ifdef LEOSAC_WIEGAND_GPIOD
+#include <gpiod.h>
+#endif
+
+using namespace Leosac::Module::Wiegand;
+
+#ifdef LEOSAC_WIEGAND_GPIOD
+
+/**
+ * Upper bound on the number of events consumed from one line
+ * in a single call. This is more than a Wiegand frame can hold.
+ */
+static constexpr int MAX_EVENTS_PER_LINE = 256;
+
+static std::chrono::nanoseconds to_duration(const timespec &ts)
+{
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+static std::chrono::nanoseconds clock_now(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return to_duration(ts);
+}
+
+GpiodDataLines::GpiodDataLines(const std::string &device, unsigned int high_offset,
+                               unsigned int low_offset, const std::string &consumer,
+                               std::chrono::microseconds min_pulse_width)
+    : chip_(nullptr)
+    , high_{nullptr, true, false, {0, 0}}
+    , low_{nullptr, false, false, {0, 0}}
+    , min_pulse_width_(min_pulse_width)
+    , glitches_(0)
+    , monotonic_now_(0)
+    , realtime_now_(0)
+{
+    chip_ = gpiod_chip_open_lookup(device.c_str());
+    if (!chip_)
+        throw GpioException("Cannot open gpiochip " + device);
+
+    high_.line = gpiod_chip_get_line(chip_, high_offset);
+    low_.line  = gpiod_chip_get_line(chip_, low_offset);
+    if (!high_.line || !low_.line)
+    {
+        release();
+        throw GpioException("Invalid line offset on gpiochip " + device);
+    }
+
+    // Measuring the pulse width requires both edges.
+    auto request = min_pulse_width_.count() ? &gpiod_line_request_both_edges_events
+                                            : &gpiod_line_request_falling_edge_events;
+    if (request(high_.line, consumer.c_str()) < 0 ||
+        request(low_.line, consumer.c_str()) < 0)
+    {
+        release();
+        throw GpioException("Cannot request edge events on gpiochip " + device);
+    }
+}
+
+GpiodDataLines::~GpiodDataLines()
+{
+    release();
+}
+
+void GpiodDataLines::release()
+{
+    // Lines are released when the chip is closed.
+    if (chip_)
+        gpiod_chip_close(chip_);
+    chip_      = nullptr;
+    high_.line = nullptr;
+    low_.line  = nullptr;
+}
+
+int GpiodDataLines::high_fd() const
+{
+    return gpiod_line_event_get_fd(high_.line);
+}
+
+int GpiodDataLines::low_fd() const
+{
+    return gpiod_line_event_get_fd(low_.line);
+}
+
+size_t GpiodDataLines::glitch_count() const
+{
+    return glitches_;
+}
+
+void GpiodDataLines::read_pending(std::vector<DataBit> &bits)
+{
+    bits.clear();
+    monotonic_now_ = clock_now(CLOCK_MONOTONIC);
+    realtime_now_  = clock_now(CLOCK_REALTIME);
+
+    drain(high_, bits);
+    drain(low_, bits);
+
+    // Each line has been drained in order, but bits from both lines
+    // are interleaved.
+    std::stable_sort(bits.begin(), bits.end(),
+                     [](const DataBit &lhs, const DataBit &rhs) {
+                         return lhs.time < rhs.time;
+                     });
+}
+
+void GpiodDataLines::drain(Line &line, std::vector<DataBit> &bits)
+{
+    const timespec no_wait{0, 0};
+    gpiod_line_event event;
+
+    for (int i = 0; i < MAX_EVENTS_PER_LINE; ++i)
+    {
+        if (gpiod_line_event_wait(line.line, &no_wait) != 1)
+            return;
+        if (gpiod_line_event_read(line.line, &event) < 0)
+        {
+            WARN("Failed to read event on Wiegand data line.");
+            return;
+        }
+
+        if (!min_pulse_width_.count())
+        {
+            bits.push_back(DataBit{to_time_point(event.ts), line.high});
+        }
+        else if (event.event_type == GPIOD_LINE_EVENT_FALLING_EDGE)
+        {
+            line.pulse_started = true;
+            line.pulse_start   = event.ts;
+        }
+        else if (line.pulse_started)
+        {
+            line.pulse_started = false;
+            if (to_duration(event.ts) - to_duration(line.pulse_start) <
+                min_pulse_width_)
+            {
+                ++glitches_;
+                continue;
+            }
+            bits.push_back(DataBit{to_time_point(line.pulse_start), line.high});
+        }
+    }
+}
+
+GpiodDataLines::TimePoint GpiodDataLines::to_time_point(const timespec &ts) const
+{
+    using namespace std::chrono;
+    auto t = to_duration(ts);
+
+    auto distance = [&](nanoseconds now) { return now > t ? now - t : t - now; };
+    if (distance(realtime_now_) < distance(monotonic_now_))
+        t -= realtime_now_ - monotonic_now_;
+    return TimePoint(duration_cast<TimePoint::duration>(t));
+}
+
+bool GpiodDataLines::supported()
+{
+    return true;
+}
+
+#else
+
+GpiodDataLines::GpiodDataLines(const std::string &device, unsigned int, unsigned int,
+                               const std::string &, std::chrono::microseconds)
+    : chip_(nullptr)
+    , high_{nullptr, true, false, {0, 0}}
+    , low_{nullptr, false, false, {0, 0}}
+    , min_pulse_width_(0)
+    , glitches_(0)
+    , monotonic_now_(0)
+    , realtime_now_(0)
+{
+    throw GpioException("Cannot open gpiochip " + device +
+                        ": Leosac was built without libgpiod support");
+}
+
+GpiodDataLines::~GpiodDataLines()
+{
+}
+
+int GpiodDataLines::high_fd() const
+{
+    return -1;
+}
+
+int GpiodDataLines::low_fd() const
+{
+    return -1;
+}
+
+size_t GpiodDataLines::glitch_count() const
+{
+    return glitches_;
+}
+
+void GpiodDataLines::read_pending(std::vector<DataBit> &bits)
+{
+    bits.clear();
+}
+
+bool GpiodDataLines::supported()
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+struct gpiod_chip;
+struct gpiod_line;
+
+namespace Leosac
+{
+namespace Module
+{
+
+namespace Wiegand
+{
+/**
+ * Direct access to the two data lines of a Wiegand reader, through
+ * libgpiod.
+ *
+ * When a reader is configured to use this, the Wiegand module requests
+ * edge events on the DATA0 and DATA1 lines itself, instead of relying
+ * on a GPIO module to publish one `S_INT:` message per bit on the
+ * message bus.
+ *
+ * Both event file descriptors are meant to be registered in the module's
+ * reactor. Bits are timestamped with the kernel timestamp of their edge,
+ * which is used to order bits pending on both lines and to detect the end
+ * of a frame regardless of how late the events are processed.
+ *
+ * libgpiod is optional: when Leosac is built without it, the data lines
+ * cannot be acquired and the constructor always throws.
+ */
+class GpiodDataLines
+{
+  public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /**
+     * A bit read from the data lines.
+     */
+    struct DataBit
+    {
+        /**
+         * Time of the falling edge that started the pulse.
+         */
+        TimePoint time;
+        bool high;
+    };
+
+    /**
+     * Request edge events on the data lines.
+     *
+     * @param device gpiochip name, path or number (see gpiod_chip_open_lookup())
+     * @param high_offset offset of the line that sends "high" data (DATA1).
+     * @param low_offset offset of the line that sends "low" data (DATA0).
+     * @param consumer consumer name reported to the kernel.
+     * @param min_pulse_width pulses shorter than this are considered noise
+     *        and ignored. If zero, only falling edges are monitored and every
+     *        edge is a bit.
+     *
+     * @throws GpioException if the chip or the lines cannot be acquired,
+     *         or if libgpiod support was not built in.
+     */
+    GpiodDataLines(const std::string &device, unsigned int high_offset,
+                   unsigned int low_offset, const std::string &consumer,
+                   std::chrono::microseconds min_pulse_width =
+                       std::chrono::microseconds(0));
+
+    ~GpiodDataLines();
+
+    GpiodDataLines(const GpiodDataLines &) = delete;
+    GpiodDataLines &operator=(const GpiodDataLines &) = delete;
+
+    /**
+     * Whether Leosac was built with libgpiod support.
+     */
+    static bool supported();
+
+    /**
+     * File descriptor that becomes readable when an edge is detected
+     * on the "high" line.
+     */
+    int high_fd() const;
+
+    /**
+     * File descriptor that becomes readable when an edge is detected
+     * on the "low" line.
+     */
+    int low_fd() const;
+
+    /**
+     * Consume all the events pending on both lines, and store the
+     * corresponding bits, in chronological order, into `bits`.
+     *
+     * This call doesn't block. `bits` is cleared first.
+     */
+    void read_pending(std::vector<DataBit> &bits);
+
+    /**
+     * Number of pulses rejected because they were too short.
+     */
+    size_t glitch_count() const;
+
+  private:
+    /**
+     * State of one data line.
+     */
+    struct Line
+    {
+        gpiod_line *line;
+        bool high;
+
+        /**
+         * Whether a falling edge was seen without its
+         * matching rising edge yet.
+         */
+        bool pulse_started;
+        timespec pulse_start;
+    };
+
+    /**
+     * Consume the events pending on one line, appending the
+     * resulting bits to `bits`.
+     */
+    void drain(Line &line, std::vector<DataBit> &bits);
+
+    /**
+     * Convert a kernel event timestamp to the steady clock.
+     */
+    TimePoint to_time_point(const timespec &ts) const;
+
+    void release();
+
+    gpiod_chip *chip_;
+    Line high_;
+    Line low_;
+
+    std::chrono::nanoseconds min_pulse_width_;
+    size_t glitches_;
+
+    /**
+     * Depending on the kernel version, event timestamps are either
+     * taken from CLOCK_MONOTONIC or from CLOCK_REALTIME. Both clocks
+     * are sampled on each read, and each timestamp is converted
+     * relative to the closest one.
+     */
+    std::chrono::nanoseconds monotonic_now_;
+    std::chrono::nanoseconds realtime_now_;
+};
+}
+}
+}
@@ -49,7 +49,12 @@ struct WiegandReaderConfig : public Hardware::RFIDReader
         : mode("SIMPLE_WIEGAND")
         , pin_timeout(2500)
         , pin_key_end('#')
-        , nowait(0){};
+        , nowait(0)
+        , gpiod_high(0)
+        , gpiod_low(0)
+        , gpiod_frame_gap(25)
+        , gpiod_min_pulse(0)
+        , check_parity(false){};
 
     WiegandReaderConfig(const WiegandReaderConfig &) = default;
 
@@ -99,6 +104,56 @@ struct WiegandReaderConfig : public Hardware::RFIDReader
     char pin_key_end;
     bool nowait;
 
+    /**
+     * If not empty, the gpiochip the reader's data lines are
+     * connected to. The Wiegand module then reads the data lines
+     * directly instead of relying on `gpio_high_` and `gpio_low_`.
+     *
+     * This is only configurable through the XML configuration.
+     */
+#pragma db transient
+    std::string gpiod_device;
+
+    /**
+     * Offset of the "high" data line on `gpiod_device`.
+     */
+#pragma db transient
+    unsigned int gpiod_high;
+
+    /**
+     * Offset of the "low" data line on `gpiod_device`.
+     */
+#pragma db transient
+    unsigned int gpiod_low;
+
+    /**
+     * Consumer name used when requesting the data lines.
+     */
+#pragma db transient
+    std::string gpiod_consumer;
+
+    /**
+     * Silence on the data lines that marks the end of a frame.
+     */
+#pragma db transient
+    std::chrono::milliseconds gpiod_frame_gap;
+
+    /**
+     * Pulses on the data lines shorter than this are ignored.
+     * Zero disables the filter.
+     */
+#pragma db transient
+    std::chrono::microseconds gpiod_min_pulse;
+
+    /**
+     * Decode card frames using known Wiegand formats, and drop
+     * the ones with an invalid parity.
+     *
+     * This is only configurable through the XML configuration.
+     */
+#pragma db transient
+    bool check_parity;
+
     /**
      * List of valid operation mode for a reader.
      */
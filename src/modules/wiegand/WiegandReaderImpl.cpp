@@ -23,26 +23,40 @@
 #include <core/auth/Auth.hpp>
 #include <iomanip>
 
+using namespace Leosac;
 using namespace Leosac::Module::Wiegand;
 using namespace Leosac::Module::Wiegand::Strategy;
 using namespace Leosac::Hardware;
 using namespace Leosac::Auth;
 
+/**
+ * How often a reader is timed-out while no frame is being read, so
+ * that strategies can expire their PIN timeouts.
+ */
+static constexpr std::chrono::milliseconds IDLE_TICK(50);
+
 WiegandReaderImpl::WiegandReaderImpl(zmqpp::context &ctx,
                                      const std::string &reader_name,
                                      const std::string &data_high_pin,
                                      const std::string &data_low_pin,
                                      const std::string &green_led_name,
                                      const std::string &buzzer_name,
-                                     std::unique_ptr<WiegandStrategy> strategy)
+                                     std::unique_ptr<WiegandStrategy> strategy,
+                                     std::unique_ptr<GpiodDataLines> data_lines,
+                                     std::chrono::milliseconds frame_gap,
+                                     std::shared_ptr<const Tools::WiegandFormatRegistry> formats)
     : bus_sub_(ctx, zmqpp::socket_type::sub)
-    , sock_(ctx, zmqpp::socket_type::rep)
+    , sock_(ctx, zmqpp::socket_type::router)
     , bus_push_(ctx, zmqpp::socket_type::push)
     , counter_(0)
     , name_(reader_name)
     , green_led_(nullptr)
     , buzzer_(nullptr)
     , strategy_(std::move(strategy))
+    , data_lines_(std::move(data_lines))
+    , frame_gap_(frame_gap)
+    , frame_open_(false)
+    , formats_(formats)
 {
     bus_sub_.connect("inproc://zmq-bus-pub");
     bus_push_.connect("inproc://zmq-bus-pull");
@@ -52,16 +66,21 @@ WiegandReaderImpl::WiegandReaderImpl(zmqpp::context &ctx,
     topic_high_ = "S_INT:" + data_high_pin;
     topic_low_  = "S_INT:" + data_low_pin;
 
-    bus_sub_.subscribe(topic_high_);
-    bus_sub_.subscribe(topic_low_);
+    // When we own the data lines, nothing of interest is published
+    // on the bus.
+    if (!data_lines_)
+    {
+        bus_sub_.subscribe(topic_high_);
+        bus_sub_.subscribe(topic_low_);
+    }
 
     std::fill(buffer_.begin(), buffer_.end(), 0);
 
     if (!green_led_name.empty())
-        green_led_ = std::make_unique<FLED>(ctx, green_led_name);
+        green_led_ = std::make_unique<AsyncFLED>(ctx, green_led_name);
 
     if (!buzzer_name.empty())
-        buzzer_ = std::make_unique<FBuzzer>(ctx, buzzer_name);
+        buzzer_ = std::make_unique<AsyncFBuzzer>(ctx, buzzer_name);
 }
 
 WiegandReaderImpl::~WiegandReaderImpl()
@@ -74,6 +93,13 @@ WiegandReaderImpl::WiegandReaderImpl(WiegandReaderImpl &&o)
     , bus_push_(std::move(o.bus_push_))
     , name_(std::move(o.name_))
     , strategy_(std::move(o.strategy_))
+    , data_lines_(std::move(o.data_lines_))
+    , pending_bits_(std::move(o.pending_bits_))
+    , frame_gap_(o.frame_gap_)
+    , last_bit_time_(o.last_bit_time_)
+    , frame_open_(o.frame_open_)
+    , next_idle_tick_(o.next_idle_tick_)
+    , formats_(std::move(o.formats_))
 {
     topic_high_ = o.topic_high_;
     topic_low_  = o.topic_low_;
@@ -93,13 +119,61 @@ void WiegandReaderImpl::handle_bus_msg()
     std::string msg;
     bus_sub_.receive(msg);
 
+    if (msg == topic_high_)
+        read_bit(true, std::chrono::steady_clock::now());
+    else if (msg == topic_low_)
+        read_bit(false, std::chrono::steady_clock::now());
+}
+
+void WiegandReaderImpl::handle_data_lines()
+{
+    assert(data_lines_);
+    data_lines_->read_pending(pending_bits_);
+    for (const auto &bit : pending_bits_)
+        read_bit(bit.high, bit.time);
+}
+
+void WiegandReaderImpl::read_bit(bool high,
+                                 const std::chrono::steady_clock::time_point &time)
+{
+    // Events may have been queued for a while: a long enough silence
+    // between two bits means they belong to different frames.
+    if (frame_open_ && time - last_bit_time_ >= frame_gap_)
+        timeout();
+    push_bit(high);
+    last_bit_time_ = time;
+    frame_open_    = true;
+}
+
+std::chrono::steady_clock::time_point WiegandReaderImpl::next_timeout() const
+{
+    if (frame_open_)
+        return last_bit_time_ + frame_gap_;
+    return next_idle_tick_;
+}
+
+void WiegandReaderImpl::check_timeout(const std::chrono::steady_clock::time_point &now)
+{
+    if (now < next_timeout())
+        return;
+    timeout();
+    next_idle_tick_ = now + IDLE_TICK;
+}
+
+const GpiodDataLines *WiegandReaderImpl::data_lines() const
+{
+    return data_lines_.get();
+}
+
+void WiegandReaderImpl::push_bit(bool high)
+{
     if (counter_ < 128)
     {
-        if (msg == topic_high_)
+        if (high)
         {
             buffer_[counter_ / 8] |= (1 << (7 - counter_ % 8));
         }
-        else if (msg == topic_low_)
+        else
         {
             // set the bit to 0. it doesn't cost much
             // and is safer in case the buffer wasn't fully filled with 0.
@@ -117,6 +191,7 @@ void WiegandReaderImpl::handle_bus_msg()
 void WiegandReaderImpl::timeout()
 {
     assert(strategy_);
+    frame_open_ = false;
     strategy_->timeout();
 
     if (strategy_->completed())
@@ -128,28 +203,74 @@ void WiegandReaderImpl::timeout()
     }
 }
 
+void WiegandReaderImpl::register_sockets(zmqpp::reactor *reactor)
+{
+    if (data_lines_)
+    {
+        auto handler = std::bind(&WiegandReaderImpl::handle_data_lines, this);
+        reactor->add(data_lines_->high_fd(), handler, zmqpp::poller::poll_in);
+        reactor->add(data_lines_->low_fd(), handler, zmqpp::poller::poll_in);
+    }
+    else
+    {
+        reactor->add(bus_sub_, std::bind(&WiegandReaderImpl::handle_bus_msg, this));
+    }
+    reactor->add(sock_, std::bind(&WiegandReaderImpl::handle_request, this));
+
+    if (green_led_)
+        green_led_->register_sockets(reactor);
+    if (buzzer_)
+        buzzer_->register_sockets(reactor);
+}
+
+void WiegandReaderImpl::expire_commands(
+    const std::chrono::steady_clock::time_point &now)
+{
+    if (green_led_)
+        green_led_->check_timeouts(now);
+    if (buzzer_)
+        buzzer_->check_timeouts(now);
+}
+
 void WiegandReaderImpl::handle_request()
 {
     zmqpp::message msg;
     std::string str;
     sock_.receive(msg);
 
+    // Routing frames, up to and including the empty delimiter.
+    std::vector<std::string> envelope;
+    do
+    {
+        if (!msg.parts())
+        {
+            WARN("Malformed request to reader " << name_);
+            return;
+        }
+        msg.get(str, 0);
+        msg.pop_front();
+        envelope.push_back(str);
+    } while (!str.empty());
+
     msg >> str;
     assert(str == "GREEN_LED" || str == "BEEP" || str == "BEEP_ON" ||
            str == "BEEP_OFF");
+
+    // The reply is sent once the LED or buzzer acknowledged the command.
+    auto on_completion = [this, envelope](bool ok) {
+        reply(envelope, ok ? "OK" : "KO");
+    };
+
     if (str == "GREEN_LED")
     {
         msg.pop_front();
         if (!green_led_)
         {
-            sock_.send("KO");
+            reply(envelope, "KO");
             return;
         }
         // forward the request to the led.
-        green_led_->backend().send(msg);
-        green_led_->backend().receive(str);
-        assert(str == "OK" || str == "KO");
-        sock_.send(str == "OK" ? "OK" : "KO");
+        green_led_->send_command(msg, on_completion);
     }
     else if (str == "BEEP")
     {
@@ -158,37 +279,41 @@ void WiegandReaderImpl::handle_request()
         msg >> duration;
         if (!buzzer_)
         {
-            sock_.send("KO");
+            reply(envelope, "KO");
             return;
         }
-        bool ret = buzzer_->turnOn(std::chrono::milliseconds(duration));
-        ASSERT_LOG(ret, "Turning the buzzer ON failed.");
-        sock_.send("OK");
+        buzzer_->turnOn(std::chrono::milliseconds(duration), on_completion);
     }
     else if (str == "BEEP_ON")
     {
         if (!buzzer_)
         {
-            sock_.send("KO");
+            reply(envelope, "KO");
             return;
         }
-        bool ret = buzzer_->turnOn();
-        ASSERT_LOG(ret, "Turning the buzzer ON failed.");
-        sock_.send("OK");
+        buzzer_->turnOn(on_completion);
     }
     else if (str == "BEEP_OFF")
     {
         if (!buzzer_)
         {
-            sock_.send("KO");
+            reply(envelope, "KO");
             return;
         }
-        bool ret = buzzer_->turnOff();
-        ASSERT_LOG(ret, "Turning the buzzer OFF failed.");
-        sock_.send("OK");
+        buzzer_->turnOff(on_completion);
     }
 }
 
+void WiegandReaderImpl::reply(const std::vector<std::string> &envelope,
+                              const std::string &status)
+{
+    zmqpp::message msg;
+    for (const auto &frame : envelope)
+        msg.add_raw(frame.data(), frame.size());
+    msg << status;
+    sock_.send(msg);
+}
+
 void WiegandReaderImpl::read_reset()
 {
     counter_ = 0;
@@ -209,3 +334,8 @@ std::string const &WiegandReaderImpl::name() const
 {
     return name_;
 }
+
+const Tools::WiegandFormatRegistry *WiegandReaderImpl::formats() const
+{
+    return formats_.get();
+}
@@ -20,12 +20,15 @@
 #pragma once
 
 #include "core/auth/Auth.hpp"
-#include "hardware/facades/FBuzzer.hpp"
-#include "hardware/facades/FLED.hpp"
+#include "hardware/facades/AsyncFBuzzer.hpp"
+#include "hardware/facades/AsyncFLED.hpp"
+#include "modules/wiegand/GpiodDataLines.hpp"
 #include "modules/wiegand/strategies/WiegandStrategy.hpp"
+#include "tools/WiegandFormat.hpp"
 #include "zmqpp/zmqpp.hpp"
 #include <chrono>
 #include <string>
+#include <vector>
 
 namespace Leosac
 {
@@ -49,13 +52,25 @@ class WiegandReaderImpl
     * @param green_led_name name of the "green led" LED device.
     * @param buzzer_name name of the buzzer device. -- no buzzer module yet.
     * @param strategy strategy (mode implementation) the reader is using
+    * @param data_lines optional direct access to the data lines. When set, bits
+    *        are read from the lines instead of from the message bus, and the
+    *        data pins names are ignored.
+    * @param frame_gap a frame is considered complete after this much time
+    *        without a bit from this reader.
+    * @param formats if set, card frames whose length matches one of the formats
+    *        are decoded, and dropped if their parity is invalid.
     */
     WiegandReaderImpl(zmqpp::context &ctx, const std::string &reader_name,
                       const std::string &data_high_pin,
                       const std::string &data_low_pin,
                       const std::string &green_led_name,
                       const std::string &buzzer_name,
-                      std::unique_ptr<Strategy::WiegandStrategy> strategy);
+                      std::unique_ptr<Strategy::WiegandStrategy> strategy,
+                      std::unique_ptr<GpiodDataLines> data_lines = nullptr,
+                      std::chrono::milliseconds frame_gap =
+                          std::chrono::milliseconds(25),
+                      std::shared_ptr<const Tools::WiegandFormatRegistry> formats =
+                          nullptr);
 
     ~WiegandReaderImpl();
 
@@ -71,23 +86,63 @@ class WiegandReaderImpl
     zmqpp::socket bus_sub_;
 
     /**
-    * REP socket to receive command on.
+    * ROUTER socket to receive command on.
+    *
+    * Commands that involve the reader's LED or buzzer are answered once the
+    * device replied, without blocking the module in the meantime.
     */
     zmqpp::socket sock_;
 
+    /**
+    * Register the reader's sockets, and those of its facades, into the
+    * module's reactor.
+    */
+    void register_sockets(zmqpp::reactor *reactor);
+
+    /**
+    * Fail the LED and buzzer commands whose reply didn't come in time.
+    */
+    void expire_commands(const std::chrono::steady_clock::time_point &now);
+
     /**
     * Something happened on the bus.
     */
     void handle_bus_msg();
 
+    /**
+    * An edge was detected on one of the data lines. Only used when the
+    * reader owns its data lines.
+    */
+    void handle_data_lines();
+
+    /**
+    * Direct access to the data lines, or nullptr if the reader
+    * receives its bits from the message bus.
+    */
+    const GpiodDataLines *data_lines() const;
+
+    /**
+    * The time at which the reader next needs to call timeout(): either
+    * the end of the frame being read, or the next idle tick.
+    */
+    std::chrono::steady_clock::time_point next_timeout() const;
+
+    /**
+    * Call timeout() if next_timeout() is reached.
+    *
+    * The end of a frame is detected from this reader's bits only,
+    * independently of other readers' activity.
+    */
+    void check_timeout(const std::chrono::steady_clock::time_point &now);
+
     /**
     * Someone sent a request.
     */
     void handle_request();
 
     /**
-    * Timeout (no more data burst to handle). The WiegandModule call this when
-    * polling on any wiegand reader times out.
+    * Timeout (no more data burst to handle). Called by check_timeout() once
+    * the frame gap has elapsed, and periodically when idle.
     * The reader shall publish an event if it received any meaningful message since
     * the last timeout.
     */
@@ -119,7 +174,28 @@ class WiegandReaderImpl
     */
     const std::string &name() const;
 
+    /**
+    * Formats the reader validates card frames against, or nullptr.
+    */
+    const Tools::WiegandFormatRegistry *formats() const;
+
   private:
+    /**
+    * Store a bit received from the data lines.
+    */
+    void push_bit(bool high);
+
+    /**
+    * Store a bit received at `time`, closing the current frame first
+    * if the frame gap elapsed since the previous bit.
+    */
+    void read_bit(bool high, const std::chrono::steady_clock::time_point &time);
+
+    /**
+    * Send a reply to the client identified by `envelope`.
+    */
+    void reply(const std::vector<std::string> &envelope, const std::string &status);
+
     /**
     * Socket to write to the message bus.
     */
@@ -153,17 +229,44 @@ class WiegandReaderImpl
     /**
     * Facade to control the reader green led.
     */
-    std::unique_ptr<Hardware::FLED> green_led_;
+    std::unique_ptr<Hardware::AsyncFLED> green_led_;
 
     /**
     * Facade to the buzzer object
     */
-    std::unique_ptr<Hardware::FBuzzer> buzzer_;
+    std::unique_ptr<Hardware::AsyncFBuzzer> buzzer_;
 
     /**
     * Concrete implementation of the reader mode.
     */
     std::unique_ptr<Strategy::WiegandStrategy> strategy_;
+
+    std::unique_ptr<GpiodDataLines> data_lines_;
+
+    /**
+    * Scratch buffer for bits read from the data lines.
+    */
+    std::vector<GpiodDataLines::DataBit> pending_bits_;
+
+    /**
+    * Silence, on this reader's data lines, that marks the end of a frame.
+    */
+    std::chrono::milliseconds frame_gap_;
+
+    /**
+    * Time of the last bit: its kernel timestamp when reading from the
+    * data lines, or its reception time when it comes from the bus.
+    */
+    std::chrono::steady_clock::time_point last_bit_time_;
+
+    /**
+    * Whether bits were read since the last timeout().
+    */
+    bool frame_open_;
+
+    std::chrono::steady_clock::time_point next_idle_tick_;
+
+    std::shared_ptr<const Tools::WiegandFormatRegistry> formats_;
 };
 }
 }
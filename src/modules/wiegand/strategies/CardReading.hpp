@@ -20,6 +20,7 @@
 #pragma once
 
 #include "WiegandStrategy.hpp"
+#include "tools/WiegandFormat.hpp"
 
 namespace Leosac
 {
@@ -53,6 +54,18 @@ class CardReading : public WiegandStrategy
     * Returns the number of bits in the card.
     */
     virtual int get_nb_bits() const = 0;
+
+    /**
+    * Returns the format the card was decoded with, or nullptr if the
+    * card wasn't decoded.
+    */
+    virtual const Tools::WiegandFormat *get_format() const = 0;
+
+    /**
+    * Returns the facility code and card number of the card.
+    * This is only meaningful if get_format() is not null.
+    */
+    virtual const Tools::WiegandCardData &get_card_data() const = 0;
 };
 }
 }
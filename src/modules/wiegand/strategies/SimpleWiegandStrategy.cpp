@@ -19,7 +19,6 @@
 
 #include "SimpleWiegandStrategy.hpp"
 #include "modules/wiegand/WiegandReaderImpl.hpp"
-#include <iomanip>
 #include <tools/log.hpp>
 
 using namespace Leosac::Module::Wiegand;
@@ -30,6 +29,8 @@ SimpleWiegandStrategy::SimpleWiegandStrategy(WiegandReaderImpl *reader)
     : CardReading(reader)
     , ready_(false)
     , nb_bits_(0)
+    , format_(nullptr)
+    , card_data_{0, 0}
 {
 }
 
@@ -39,21 +40,28 @@ void SimpleWiegandStrategy::timeout()
         return;
 
     DEBUG("timeout, buffer size = " << reader_->counter());
-    std::size_t size = ((reader_->counter() - 1) / 8) + 1;
-
-    std::stringstream card_hex;
-
-    for (std::size_t i = 0; i < size; ++i)
+    auto formats = reader_->formats();
+    if (formats && formats->has_format(reader_->counter()))
     {
-        card_hex << std::hex << std::setfill('0') << std::setw(2)
-                 << static_cast<int>(reader_->buffer()[i]);
-        if (i + 1 < size)
-            card_hex << ":";
+        auto frame =
+            Leosac::Tools::WiegandFormat::pack(reader_->buffer(), reader_->counter());
+        format_ = formats->decode(frame, reader_->counter(), card_data_);
+        if (!format_)
+        {
+            WARN("Wiegand frame of " << reader_->counter() << " bits from "
+                                     << reader_->name()
+                                     << " failed parity check. Ignoring it.");
+            reader_->read_reset();
+            return;
+        }
+        DEBUG("Decoded as " << format_->name() << ": facility code "
+                            << card_data_.facility_code << ", card number "
+                            << card_data_.card_number);
     }
 
     ready_   = true;
     nb_bits_ = reader_->counter();
-    card_id_ = card_hex.str();
+    card_id_ = Leosac::Tools::WiegandFormat::card_id(reader_->buffer(), nb_bits_);
 }
 
 bool SimpleWiegandStrategy::completed() const
@@ -82,10 +90,21 @@ int SimpleWiegandStrategy::get_nb_bits() const
     return nb_bits_;
 }
 
+const Leosac::Tools::WiegandFormat *SimpleWiegandStrategy::get_format() const
+{
+    return format_;
+}
+
+const Leosac::Tools::WiegandCardData &SimpleWiegandStrategy::get_card_data() const
+{
+    return card_data_;
+}
+
 void SimpleWiegandStrategy::reset()
 {
     ready_   = false;
     card_id_ = "";
     nb_bits_ = 0;
+    format_  = nullptr;
     reader_->read_reset();
 }
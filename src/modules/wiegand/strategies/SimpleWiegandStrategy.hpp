@@ -47,12 +47,18 @@ class SimpleWiegandStrategy : public CardReading
 
     virtual int get_nb_bits() const override;
 
+    virtual const Tools::WiegandFormat *get_format() const override;
+
+    virtual const Tools::WiegandCardData &get_card_data() const override;
+
     virtual void reset() override;
 
   private:
     bool ready_;
     int nb_bits_;
     std::string card_id_;
+    const Tools::WiegandFormat *format_;
+    Tools::WiegandCardData card_data_;
 };
 }
 }
@@ -20,6 +20,7 @@
 #include "modules/wiegand/wiegand.hpp"
 #include "core/Scheduler.hpp"
 #include "core/kernel.hpp"
+#include "exception/gpioexception.hpp"
 #include "hardware/Buzzer.hpp"
 #include "hardware/HardwareService.hpp"
 #include "hardware/LED.hpp"
@@ -28,6 +29,7 @@
 #include "modules/wiegand/ws/WSHelperThread.hpp"
 #include "tools/log.hpp"
 #include "ws/WiegandConfigSerializer.hpp"
+#include <algorithm>
 #include <boost/property_tree/ptree.hpp>
 #include <memory>
 #include <zmqpp/context.hpp>
@@ -35,6 +37,13 @@
 
 using namespace Leosac::Module::Wiegand;
 
+/**
+ * Silence that ends a frame for readers that receive their bits from the
+ * message bus. Bits are timestamped when they are received, which leaves
+ * room for the bus latency.
+ */
+static constexpr std::chrono::milliseconds BUS_FRAME_GAP(50);
+
 extern "C" {
 const char *get_module_name()
 {
@@ -62,12 +71,7 @@ WiegandReaderModule::WiegandReaderModule(zmqpp::context &ctx, zmqpp::socket *pip
     process_config();
 
     for (auto &reader : readers_)
-    {
-        reactor_.add(reader.bus_sub_,
-                     std::bind(&WiegandReaderImpl::handle_bus_msg, &reader));
-        reactor_.add(reader.sock_,
-                     std::bind(&WiegandReaderImpl::handle_request, &reader));
-    }
+        reader.register_sockets(&reactor_);
 }
 
 WiegandReaderModule::~WiegandReaderModule()
@@ -96,6 +100,10 @@ void WiegandReaderModule::process_config()
         load_xml_config(module_config);
     }
 
+    auto formats = std::make_shared<Tools::WiegandFormatRegistry>();
+    if (auto formats_cfg = module_config.get_child_optional("formats"))
+        formats->load_config(*formats_cfg);
+
     // Now we process the configuration object.
     for (const auto &reader_config : wiegand_config_->readers())
     {
@@ -109,16 +117,54 @@ void WiegandReaderModule::process_config()
              << green(underline(reader_config->gpio_high_name()))
              << "\n\t Mode: " << green(underline(reader_config->mode)));
 
+        auto data_lines = open_data_lines(*reader_config);
+        auto frame_gap =
+            data_lines ? reader_config->gpiod_frame_gap : BUS_FRAME_GAP;
         WiegandReaderImpl reader(
             ctx_, reader_config->name(), reader_config->gpio_high_name(),
             reader_config->gpio_low_name(), reader_config->green_led_name(),
-            reader_config->buzzer_name(), create_strategy(*reader_config, &reader));
+            reader_config->buzzer_name(), create_strategy(*reader_config, &reader),
+            std::move(data_lines), frame_gap,
+            reader_config->check_parity ? formats : nullptr);
         utils_->config_checker().register_object(reader.name(),
                                                  Leosac::Hardware::DeviceClass::RFID_READER);
         readers_.push_back(std::move(reader));
     }
 }
 
+std::unique_ptr<GpiodDataLines>
+WiegandReaderModule::open_data_lines(const WiegandReaderConfig &reader_config)
+{
+    if (reader_config.gpiod_device.empty())
+        return nullptr;
+
+    try
+    {
+        auto data_lines = std::make_unique<GpiodDataLines>(
+            reader_config.gpiod_device, reader_config.gpiod_high,
+            reader_config.gpiod_low, reader_config.gpiod_consumer,
+            reader_config.gpiod_min_pulse);
+        INFO("WiegandReader " << reader_config.name()
+                              << " reads its data lines directly from "
+                              << reader_config.gpiod_device << " (high: "
+                              << reader_config.gpiod_high
+                              << ", low: " << reader_config.gpiod_low << ")");
+        return data_lines;
+    }
+    catch (const GpioException &e)
+    {
+        if (reader_config.gpio_high_name().empty() ||
+            reader_config.gpio_low_name().empty())
+            throw;
+        WARN("WiegandReader " << reader_config.name()
+                              << " cannot read its data lines directly ("
+                              << e.what() << "). Falling back to GPIO "
+                              << reader_config.gpio_high_name() << " and "
+                              << reader_config.gpio_low_name());
+    }
+    return nullptr;
+}
+
 void WiegandReaderModule::run()
 {
     if (config_.get_child("module_config").get<bool>("use_database", false))
@@ -126,12 +172,29 @@ void WiegandReaderModule::run()
         ws_helper_thread_ = std::make_unique<WSHelperThread>(utils_);
         ws_helper_thread_->start_running();
     }
+    using namespace std::chrono;
+    const milliseconds idle_timeout(50);
+
     while (is_running_)
     {
-        if (!reactor_.poll(50))
+        // Wake up in time for the earliest end of frame.
+        auto now     = steady_clock::now();
+        auto timeout = idle_timeout;
+        for (const auto &reader : readers_)
         {
-            for (auto &reader : readers_)
-                reader.timeout();
+            auto remaining =
+                duration_cast<milliseconds>(reader.next_timeout() - now) +
+                milliseconds(1);
+            timeout = std::max(milliseconds(0), std::min(timeout, remaining));
+        }
+
+        reactor_.poll(timeout.count());
+
+        now = steady_clock::now();
+        for (auto &reader : readers_)
+        {
+            reader.expire_commands(now);
+            reader.check_timeout(now);
         }
     }
     auto ws_service = get_service_registry().get_service<WebSockAPI::Service>();
@@ -247,15 +310,40 @@ void WiegandReaderModule::load_xml_config(
         auto reader_config = std::make_shared<WiegandReaderConfig>();
         boost::property_tree::ptree xml_reader_cfg = node.second;
 
+        // The data lines may be owned by the reader itself, in which case
+        // the "high" and "low" GPIO objects are not needed.
+        auto gpiod_cfg = xml_reader_cfg.get_child_optional("gpiod");
+        if (gpiod_cfg)
+        {
+            reader_config->gpiod_device = gpiod_cfg->get<std::string>("device");
+            reader_config->gpiod_high   = gpiod_cfg->get<unsigned int>("high");
+            reader_config->gpiod_low    = gpiod_cfg->get<unsigned int>("low");
+            reader_config->gpiod_consumer =
+                gpiod_cfg->get<std::string>("consumer", "leosac");
+            reader_config->gpiod_frame_gap =
+                std::chrono::milliseconds(gpiod_cfg->get<int>("frame_gap", 25));
+            reader_config->gpiod_min_pulse =
+                std::chrono::microseconds(gpiod_cfg->get<int>("min_pulse", 0));
+        }
+
         // For GPIO object, we instanciate a "dummy" GPIO object that would
         // normally be fetched from the database. The only goal of the GPIO
         // object is to hold the device's name
 
+        // When the data lines are owned by the reader, the GPIO objects are
+        // optional and only used as a fallback.
         auto gpio_high = std::make_shared<Hardware::GPIO>();
-        gpio_high->name(xml_reader_cfg.get<std::string>("high"));
-
-        auto gpio_low = std::make_shared<Hardware::GPIO>();
-        gpio_low->name(xml_reader_cfg.get<std::string>("low"));
+        auto gpio_low  = std::make_shared<Hardware::GPIO>();
+        if (!gpiod_cfg)
+        {
+            gpio_high->name(xml_reader_cfg.get<std::string>("high"));
+            gpio_low->name(xml_reader_cfg.get<std::string>("low"));
+        }
+        else
+        {
+            gpio_high->name(xml_reader_cfg.get<std::string>("high", ""));
+            gpio_low->name(xml_reader_cfg.get<std::string>("low", ""));
+        }
 
         auto green_led = std::make_shared<Hardware::LED>();
         green_led->name(xml_reader_cfg.get<std::string>("green_led", ""));
@@ -275,11 +363,15 @@ void WiegandReaderModule::load_xml_config(
             std::chrono::milliseconds(xml_reader_cfg.get<int>("pin_timeout", 2500));
         reader_config->pin_key_end = xml_reader_cfg.get<char>("pin_key_end", '#');
         reader_config->nowait = xml_reader_cfg.get<bool>("nowait", 0);
-
-        config_check(reader_config->gpio_low_name(),
-                     Leosac::Hardware::DeviceClass::GPIO);
-        config_check(reader_config->gpio_high_name(),
-                     Leosac::Hardware::DeviceClass::GPIO);
+        reader_config->check_parity =
+            xml_reader_cfg.get<bool>("check_parity", false);
+
+        if (!reader_config->gpio_low_name().empty())
+            config_check(reader_config->gpio_low_name(),
+                         Leosac::Hardware::DeviceClass::GPIO);
+        if (!reader_config->gpio_high_name().empty())
+            config_check(reader_config->gpio_high_name(),
+                         Leosac::Hardware::DeviceClass::GPIO);
 
         if (!reader_config->green_led_name().empty())
             config_check(reader_config->green_led_name(),
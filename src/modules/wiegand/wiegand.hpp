@@ -58,6 +58,22 @@ class WiegandReaderModule : public BaseModule
     */
     virtual void run() override;
 
+    /**
+     * Select how a reader receives its bits.
+     *
+     * If the reader has a `gpiod` block, its data lines are acquired
+     * directly. When that's not possible (libgpiod support not built in,
+     * or the lines are unavailable), the reader falls back to its GPIO
+     * objects if it has any.
+     *
+     * @return the data lines, or nullptr if bits come from the GPIO objects
+     *         through the message bus.
+     * @throws GpioException if the data lines cannot be acquired and there
+     *         is no GPIO object to fall back to.
+     */
+    static std::unique_ptr<GpiodDataLines>
+    open_data_lines(const WiegandReaderConfig &reader_config);
+
   private:
     /**
     * Create wiegand reader instances based on configuration.
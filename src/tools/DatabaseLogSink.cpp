@@ -22,19 +22,48 @@
 #include "log.hpp"
 #include "tools/DateTimeConverter.hpp"
 #include "tools/LogEntry_odb.h"
-#include "tools/db/MultiplexedTransaction.hpp"
+#include "tools/ThreadUtils.hpp"
 #include "tools/db/database.hpp"
+#include <odb/transaction.hxx>
 
 using namespace Leosac;
 using namespace Leosac::Tools;
 
-DatabaseLogSink::DatabaseLogSink(DBPtr database)
+DatabaseLogSink::Config::Config()
+    : queue_size(4096)
+    , batch_size(256)
+    , flush_interval(500)
+{
+}
+
+DatabaseLogSink::DatabaseLogSink(DBPtr database, const Config &cfg)
     : database_(database)
+    , config_(cfg)
+    , queue_(cfg.queue_size)
+    , queued_(0)
+    , written_(0)
+    , dropped_(0)
+    , flush_requested_(false)
+    , stop_(false)
 {
     std::cout << "ENABLING SQL DATABASE LOGGER." << std::endl;
     ASSERT_LOG(database_, "No database object.");
     // Generate a "run id"
     run_id_ = Leosac::gen_uuid();
+    thread_ = std::thread(std::bind(&DatabaseLogSink::run, this));
+}
+
+DatabaseLogSink::~DatabaseLogSink()
+{
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        stop_ = true;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+    if (dropped_)
+        std::cerr << "DatabaseLogSink dropped " << dropped_ << " log entries."
+                  << std::endl;
 }
 
 void DatabaseLogSink::log(const spdlog::details::log_msg &msg)
@@ -47,18 +76,113 @@ void DatabaseLogSink::log(const spdlog::details::log_msg &msg)
     entry.timestamp_ = time_point_ptime(msg.time);
     entry.run_id_    = run_id_;
 
-    try
+    if (!queue_.try_push(std::move(entry)))
+    {
+        ++dropped_;
+        return;
+    }
+    ++queued_;
+
+    // Don't wait for the flush interval if a batch is ready. Notifying
+    // without the lock may be missed, in which case the writer will
+    // pick the batch up a bit later.
+    if (queue_.size() >= config_.batch_size)
+        wakeup_.notify_one();
+}
+
+void DatabaseLogSink::flush()
+{
+    uint64_t target = queued_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    flush_requested_ = true;
+    wakeup_.notify_one();
+    written_cv_.wait(lock, [&]() { return written_ >= target || stop_; });
+}
+
+size_t DatabaseLogSink::dropped_count() const
+{
+    return dropped_;
+}
+
+void DatabaseLogSink::run()
+{
+    set_thread_name("log_db_writer");
+    std::vector<LogEntry> batch;
+    batch.reserve(config_.batch_size);
+
+    bool stop = false;
+    while (!stop)
     {
-        using namespace odb;
-        using namespace odb::core;
-        db::MultiplexedTransaction t(database_->begin());
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeup_.wait_for(lock, config_.flush_interval, [&]() {
+                return stop_ || flush_requested_ ||
+                       queue_.size() >= config_.batch_size;
+            });
+            flush_requested_ = false;
+            // Entries queued before the stop request are still written.
+            stop = stop_;
+        }
+
+        size_t handled = 0;
+        LogEntry entry;
+        while (queue_.try_pop(entry))
+        {
+            batch.push_back(std::move(entry));
+            if (batch.size() == config_.batch_size)
+            {
+                handled += batch.size();
+                write_batch(batch);
+            }
+        }
+        handled += batch.size();
+        write_batch(batch);
 
-        database_->persist(entry);
+        if (handled)
+        {
+            {
+                std::lock_guard<std::mutex> lg(mutex_);
+                written_ += handled;
+            }
+            written_cv_.notify_all();
+        }
+    }
+}
+
+void DatabaseLogSink::write_batch(std::vector<LogEntry> &batch)
+{
+    if (batch.empty())
+        return;
+
+    try
+    {
+        odb::transaction t(database_->begin());
+        for (auto &entry : batch)
+            database_->persist(entry);
         t.commit();
+        batch.clear();
+        return;
     }
     catch (const odb::exception &e)
     {
-        std::cerr << "DatabaseLogSink encountered odb::exception: " << e.what()
+        std::cerr << "DatabaseLogSink failed to persist a batch of " << batch.size()
+                  << " entries: " << e.what() << ". Will retry one by one."
                   << std::endl;
     }
+
+    for (auto &entry : batch)
+    {
+        try
+        {
+            odb::transaction t(database_->begin());
+            database_->persist(entry);
+            t.commit();
+        }
+        catch (const odb::exception &e)
+        {
+            std::cerr << "DatabaseLogSink encountered odb::exception: " << e.what()
+                      << std::endl;
+        }
+    }
+    batch.clear();
 }
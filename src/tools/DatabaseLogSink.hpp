@@ -19,8 +19,16 @@
 
 #pragma once
 
+#include "tools/LogEntry.hpp"
+#include "tools/MPSCRing.hpp"
 #include "tools/db/db_fwd.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <spdlog/sinks/sink.h>
+#include <thread>
+#include <vector>
 
 namespace Leosac
 {
@@ -29,26 +37,105 @@ namespace Tools
 /**
  * A custom sink that write LogEntry object
  * to a SQLite database.
+ *
+ * Logging threads only queue the entry in a lock-free ring. A background
+ * thread persists queued entries in batches, one transaction per batch.
+ * When the ring is full, entries are dropped and counted.
+ *
+ * The sink must not log itself: errors are reported on `stderr`.
  */
 class DatabaseLogSink : public spdlog::sinks::sink
 {
   public:
+    struct Config
+    {
+        Config();
+
+        /**
+         * Maximum number of entries waiting to be persisted.
+         */
+        size_t queue_size;
+
+        /**
+         * Maximum number of entries persisted in one transaction.
+         */
+        size_t batch_size;
+
+        /**
+         * Maximum time an entry waits before being persisted.
+         */
+        std::chrono::milliseconds flush_interval;
+    };
+
     /**
      * Construct a SQLite backed log sink.
      * @param database A non null pointer to a ODB database object.
      */
-    DatabaseLogSink(DBPtr database);
+    DatabaseLogSink(DBPtr database, const Config &cfg = Config());
+
+    /**
+     * Persist all pending entries, then stop the writer thread.
+     */
+    ~DatabaseLogSink();
 
     virtual void log(const spdlog::details::log_msg &msg) override;
 
-    virtual void flush() override
-    {
-        // Noop as writing to a SQL database is transactional.
-    }
+    /**
+     * Block until all entries queued so far have been persisted.
+     */
+    virtual void flush() override;
+
+    /**
+     * Number of entries that were dropped because the queue was full.
+     */
+    size_t dropped_count() const;
 
   private:
+    void run();
+
+    /**
+     * Persist a batch of entries in a single transaction.
+     *
+     * If the transaction fails, entries are persisted one by one
+     * so that a single faulty entry doesn't cause the loss of
+     * the whole batch.
+     */
+    void write_batch(std::vector<LogEntry> &batch);
+
     DBPtr database_;
     std::string run_id_;
+    const Config config_;
+
+    MPSCRing<LogEntry> queue_;
+
+    /**
+     * Number of entries queued, and number of entries handled by
+     * the writer thread. Used to implement flush().
+     */
+    std::atomic<uint64_t> queued_;
+    uint64_t written_;
+
+    std::atomic<size_t> dropped_;
+
+    /**
+     * Protects `written_`, `flush_requested_` and `stop_`.
+     */
+    std::mutex mutex_;
+
+    /**
+     * Wakes the writer thread up before the flush interval has elapsed.
+     */
+    std::condition_variable wakeup_;
+
+    /**
+     * Signaled when a batch has been written.
+     */
+    std::condition_variable written_cv_;
+
+    bool flush_requested_;
+    bool stop_;
+
+    std::thread thread_;
 };
 }
-}
\ No newline at end of file
+}
@@ -59,6 +59,15 @@ class ISchedule : public std::enable_shared_from_this<ISchedule>
     virtual bool
     is_in_schedule(const std::chrono::system_clock::time_point &tp) const = 0;
 
+    /**
+    * Check whether or not the given minute of the week can be found in
+    * the schedule.
+    *
+    * This avoid converting the same time point over and over when checking
+    * multiple schedules. See ScheduleBitmap::week_minute().
+    */
+    virtual bool is_in_schedule_minute(WeekMinute minute) const = 0;
+
     /**
     * Add the given timeframe to this schedule;
     */
@@ -22,7 +22,9 @@
 #include "tools/LogEntry_odb.h"
 #include "tools/LogEntry_odb_pgsql.h"
 #include "tools/LogEntry_odb_sqlite.h"
+#include "tools/db/DBService.hpp"
 #include "tools/db/database.hpp"
+#include <algorithm>
 #include <odb/pgsql/database.hxx>
 #include <odb/sqlite/database.hxx>
 
@@ -36,59 +38,100 @@ LogEntry::LogEntry()
 using Query  = odb::query<Tools::LogEntry>;
 using Result = odb::result<Tools::LogEntry>;
 
-static Result fetch_sqlite(DBPtr database, const std::string &order_by,
-                           int page_size, int offset)
+static Result fetch_sqlite(DBPtr database, const Query &filter,
+                           const std::string &order_by, int page_size, int offset)
 {
     using SQLiteQuery = odb::sqlite::query<Tools::LogEntry>;
     auto sl_db        = std::static_pointer_cast<odb::sqlite::database>(database);
-    odb::sqlite::query<Tools::LogEntry> sl_q("ORDER BY" + Query::id + order_by +
-                                             "LIMIT" + SQLiteQuery::_val(page_size) +
-                                             "OFFSET" + SQLiteQuery::_val(offset));
+    odb::sqlite::query<Tools::LogEntry> sl_q(
+        filter + "ORDER BY" + Query::id + order_by + "LIMIT" +
+        SQLiteQuery::_val(page_size) + "OFFSET" + SQLiteQuery::_val(offset));
     return sl_db->query<Tools::LogEntry>(sl_q);
 }
 
-static Result fetch_pgsql(DBPtr database, const std::string &order_by, int page_size,
-                          int offset)
+static Result fetch_pgsql(DBPtr database, const Query &filter,
+                          const std::string &order_by, int page_size, int offset)
 {
     using PGSQLQuery = odb::pgsql::query<Tools::LogEntry>;
     auto pg_db       = std::static_pointer_cast<odb::pgsql::database>(database);
-    odb::pgsql::query<Tools::LogEntry> pg_q("ORDER BY" + Query::id + order_by +
-                                            "LIMIT" + PGSQLQuery::_val(page_size) +
-                                            "OFFSET" + PGSQLQuery::_val(offset));
+    odb::pgsql::query<Tools::LogEntry> pg_q(
+        filter + "ORDER BY" + Query::id + order_by + "LIMIT" +
+        PGSQLQuery::_val(page_size) + "OFFSET" + PGSQLQuery::_val(offset));
     return pg_db->query<Tools::LogEntry>(pg_q);
 }
 
-LogEntry::QueryResult LogEntry::retrieve(DBPtr database, int page_number,
+static Result fetch(DBPtr database, const Query &filter, bool order_asc,
+                    int page_size, int offset)
+{
+    std::string order_by = order_asc ? "ASC" : "DESC";
+
+    // LIMIT needs to be database specific.
+    if (database->id() == odb::database_id::id_sqlite)
+        return fetch_sqlite(database, filter, order_by, page_size, offset);
+    else if (database->id() == odb::database_id::id_pgsql)
+        return fetch_pgsql(database, filter, order_by, page_size, offset);
+    return Result();
+}
+
+LogEntry::QueryResult LogEntry::retrieve(DBServicePtr dbsrv, int page_number,
                                          int page_size, bool order_asc)
 {
     std::vector<LogEntry> entries;
 
-    if (database)
+    if (dbsrv && dbsrv->db())
     {
+        auto database = dbsrv->db();
         odb::transaction t(database->begin());
 
-        int offset           = page_number * page_size;
-        std::string order_by = order_asc ? "ASC" : "DESC";
-        Result res;
-
-        // LIMIT needs to be database specific.
-        if (database->id() == odb::database_id::id_sqlite)
-        {
-            res = fetch_sqlite(database, order_by, page_size, offset);
-        }
-        else if (database->id() == odb::database_id::id_pgsql)
+        int offset = page_number * page_size;
+        Result res = fetch(database, Query(true), order_asc, page_size, offset);
+        auto count = dbsrv->count_logs();
+        for (Tools::LogEntry &entry : res)
         {
-            res = fetch_pgsql(database, order_by, page_size, offset);
+            entries.push_back(entry);
         }
-        Tools::LogView view(database->query_value<Tools::LogView>());
+
+        return {.entries = entries,
+                .total   = count,
+                .last    = count / page_size,
+                .first   = 0};
+    }
+    return {};
+}
+
+LogEntry::QueryResult LogEntry::retrieve_range(DBServicePtr dbsrv,
+                                               unsigned long before_id,
+                                               unsigned long after_id, int page_size,
+                                               bool order_asc)
+{
+    std::vector<LogEntry> entries;
+
+    if (dbsrv && dbsrv->db())
+    {
+        auto database = dbsrv->db();
+        odb::transaction t(database->begin());
+
+        Query filter(true);
+        if (before_id)
+            filter = filter && Query::id < before_id;
+        if (after_id)
+            filter = filter && Query::id > after_id;
+
+        // Fetch the entries closest to the cursor, then put
+        // them in the requested order.
+        bool scan_asc = after_id && !before_id;
+        Result res    = fetch(database, filter, scan_asc, page_size, 0);
+        auto count    = dbsrv->count_logs();
         for (Tools::LogEntry &entry : res)
         {
             entries.push_back(entry);
         }
+        if (scan_asc != order_asc)
+            std::reverse(entries.begin(), entries.end());
 
         return {.entries = entries,
-                .total   = view.count,
-                .last    = view.count / page_size,
+                .total   = count,
+                .last    = count / page_size,
                 .first   = 0};
     }
     return {};
@@ -21,6 +21,7 @@
 
 #include "tools/db/database.hpp"
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/optional.hpp>
 #include <odb/core.hxx>
 
 namespace Leosac
@@ -78,9 +79,25 @@ class LogEntry
         size_t last;
         size_t first;
     };
-    static QueryResult retrieve(DBPtr database, int page_number, int page_size,
+    static QueryResult retrieve(DBServicePtr dbsrv, int page_number, int page_size,
                                 bool order_asc);
 
+    /**
+     * Retrieve the `page_size` entries closest to a cursor, instead
+     * of using a page number.
+     *
+     * Only entries whose id is lower than `before_id` (if non zero) and
+     * greater than `after_id` (if non zero) are considered. Entries are
+     * searched starting from `after_id` if only `after_id` is set, and
+     * from `before_id` otherwise. They are returned in the requested order.
+     *
+     * Unlike an offset, this doesn't get slower as the position of
+     * the cursor in the log table grows.
+     */
+    static QueryResult retrieve_range(DBServicePtr dbsrv, unsigned long before_id,
+                                      unsigned long after_id, int page_size,
+                                      bool order_asc);
+
   private:
     friend class odb::access;
 
@@ -96,6 +113,9 @@ struct LogView
 {
 #pragma db column("count(" + LogEntry::id_ + ")")
     size_t count;
+
+#pragma db column("max(" + LogEntry::id_ + ")")
+    boost::optional<unsigned long> max_id;
 };
 }
 }
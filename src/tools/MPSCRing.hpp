@@ -0,0 +1,154 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Leosac
+{
+namespace Tools
+{
+/**
+ * A bounded, lock-free, multi-producer single-consumer queue.
+ *
+ * This is a ring of cells, each tagged with a sequence number telling
+ * whether it is ready to be written or read for the current lap. Producers
+ * claim a cell with a single compare-and-swap, and never wait on each
+ * other unless they race for the same cell.
+ *
+ * The capacity is rounded up to a power of two.
+ *
+ * try_push() may be called from any thread. try_pop() must only
+ * ever be called from one thread at a time.
+ */
+template <typename T>
+class MPSCRing
+{
+  public:
+    explicit MPSCRing(size_t capacity)
+        : mask_(round_up(capacity) - 1)
+        , cells_(new Cell[mask_ + 1])
+        , enqueue_pos_(0)
+        , dequeue_pos_(0)
+    {
+        for (size_t i = 0; i <= mask_; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MPSCRing(const MPSCRing &) = delete;
+    MPSCRing &operator=(const MPSCRing &) = delete;
+
+    /**
+     * Add a value to the queue.
+     *
+     * @return false if the queue is full. `value` is left untouched then.
+     */
+    bool try_push(T &&value)
+    {
+        Cell *cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell         = &cells_[pos & mask_];
+            size_t seq   = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the oldest value out of the queue.
+     *
+     * @return false if the queue is empty, or if the producer that claimed
+     * the next cell hasn't finished writing it yet.
+     */
+    bool try_pop(T &value)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell &cell = cells_[pos & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+            return false;
+
+        value = std::move(cell.value);
+        cell.value = T();
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Number of values in the queue. This is only an estimate
+     * when other threads are using the queue.
+     */
+    size_t size() const
+    {
+        size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+  private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t round_up(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    /**
+     * Producers and the consumer update their position independently.
+     * Keep them on separate cache lines.
+     */
+    std::atomic<size_t> enqueue_pos_;
+    char padding_[64];
+    std::atomic<size_t> dequeue_pos_;
+};
+}
+}
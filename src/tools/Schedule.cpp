@@ -32,17 +32,37 @@ Schedule::Schedule(const std::string &sched_name)
 
 bool Schedule::is_in_schedule(const std::chrono::system_clock::time_point &tp) const
 {
-    for (const auto &tf : timeframes_)
+    return is_in_schedule_minute(ScheduleBitmap::week_minute(tp));
+}
+
+bool Schedule::is_in_schedule_minute(WeekMinute minute) const
+{
+    return bitmap()->test(minute);
+}
+
+std::shared_ptr<const ScheduleBitmap> Schedule::bitmap() const
+{
+    auto bitmap = std::atomic_load(&bitmap_);
+    if (!bitmap)
     {
-        if (tf.is_in_timeframe(tp))
-            return true;
+        // Concurrent compilations are harmless: they all
+        // produce the same bitmap.
+        bitmap = std::make_shared<const ScheduleBitmap>(timeframes_);
+        std::atomic_store(&bitmap_, bitmap);
     }
-    return false;
+    return bitmap;
+}
+
+void Schedule::odb_callback(odb::callback_event e, odb::database &) const
+{
+    if (e == odb::callback_event::post_load)
+        std::atomic_store(&bitmap_, std::shared_ptr<const ScheduleBitmap>());
 }
 
 void Schedule::add_timeframe(const SingleTimeFrame &tf)
 {
     timeframes_.push_back(tf);
+    std::atomic_store(&bitmap_, std::shared_ptr<const ScheduleBitmap>());
 }
 
 const std::string &Schedule::name() const
@@ -84,6 +104,7 @@ void Schedule::description(const std::string &desc)
 void Schedule::clear_timeframes()
 {
     timeframes_.clear();
+    std::atomic_store(&bitmap_, std::shared_ptr<const ScheduleBitmap>());
 }
 
 void Schedule::add_mapping(const ScheduleMappingPtr &map)
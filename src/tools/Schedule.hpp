@@ -21,11 +21,14 @@
 
 #include "LeosacFwd.hpp"
 #include "tools/ISchedule.hpp"
+#include "tools/ScheduleBitmap.hpp"
 #include "tools/ScheduleMapping.hpp"
 #include "tools/SingleTimeFrame.hpp"
 #include "tools/ToolsFwd.hpp"
 #include "tools/db/database.hpp"
 #include <chrono>
+#include <memory>
+#include <odb/callback.hxx>
 #include <string>
 #include <vector>
 
@@ -37,7 +40,7 @@ namespace Tools
 * A schedule is simply a list of time frame (SingleTimeFrame) with
 * a name.
 */
-#pragma db object optimistic
+#pragma db object optimistic callback(odb_callback)
 class Schedule : public virtual ISchedule
 {
   public:
@@ -50,6 +53,8 @@ class Schedule : public virtual ISchedule
     bool
     is_in_schedule(const std::chrono::system_clock::time_point &tp) const override;
 
+    bool is_in_schedule_minute(WeekMinute minute) const override;
+
     void add_timeframe(const SingleTimeFrame &tf) override;
 
     const std::string &description() const override;
@@ -76,6 +81,18 @@ class Schedule : public virtual ISchedule
     friend class odb::access;
     friend class ::Leosac::TestAccess;
 
+    /**
+     * Returns the compiled form of the timeframes, building it
+     * if needed.
+     */
+    std::shared_ptr<const ScheduleBitmap> bitmap() const;
+
+    /**
+     * Drop the compiled timeframes when the object is (re)loaded
+     * from the database.
+     */
+    void odb_callback(odb::callback_event e, odb::database &) const;
+
 #pragma db id auto
     ScheduleId id_;
 
@@ -92,6 +109,16 @@ class Schedule : public virtual ISchedule
 
 #pragma db version
     size_t odb_version_;
+
+/**
+ * Lazily compiled form of `timeframes_`.
+ *
+ * It is reset whenever the timeframes change, and is accessed
+ * through std::atomic_load() / std::atomic_store() so that
+ * concurrent readers are safe.
+ */
+#pragma db transient
+    mutable std::shared_ptr<const ScheduleBitmap> bitmap_;
 };
 
 class ScheduleValidator
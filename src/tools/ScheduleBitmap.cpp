@@ -0,0 +1,86 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/ScheduleBitmap.hpp"
+#include "tools/SingleTimeFrame.hpp"
+#include <algorithm>
+#include <ctime>
+
+namespace Leosac
+{
+namespace Tools
+{
+
+constexpr int ScheduleBitmap::MINUTES_PER_DAY;
+constexpr int ScheduleBitmap::MINUTES_PER_WEEK;
+constexpr int ScheduleBitmap::PACKED_SIZE;
+
+ScheduleBitmap::ScheduleBitmap(const std::vector<SingleTimeFrame> &timeframes)
+{
+    for (const auto &tf : timeframes)
+        add(tf);
+}
+
+void ScheduleBitmap::add(const SingleTimeFrame &tf)
+{
+    if (tf.day < 0 || tf.day > 6)
+        return;
+
+    int start = std::max(tf.start_hour * 60 + tf.start_min, 0);
+    int end   = std::min(tf.end_hour * 60 + tf.end_min, MINUTES_PER_DAY - 1);
+    for (int minute = start; minute <= end; ++minute)
+        bits_.set(tf.day * MINUTES_PER_DAY + minute);
+}
+
+bool ScheduleBitmap::test(WeekMinute minute) const
+{
+    if (minute >= static_cast<WeekMinute>(MINUTES_PER_WEEK))
+        return false;
+    return bits_.test(minute);
+}
+
+void ScheduleBitmap::pack(uint8_t *out) const
+{
+    std::fill(out, out + PACKED_SIZE, 0);
+    for (int minute = 0; minute < MINUTES_PER_WEEK; ++minute)
+    {
+        if (bits_.test(minute))
+            out[minute / 8] |= 1 << (minute % 8);
+    }
+}
+
+bool ScheduleBitmap::test_packed(const uint8_t *packed, WeekMinute minute)
+{
+    if (minute >= static_cast<WeekMinute>(MINUTES_PER_WEEK))
+        return false;
+    return packed[minute / 8] & (1 << (minute % 8));
+}
+
+WeekMinute
+ScheduleBitmap::week_minute(const std::chrono::system_clock::time_point &tp)
+{
+    std::time_t time_temp = std::chrono::system_clock::to_time_t(tp);
+    std::tm time_out;
+
+    localtime_r(&time_temp, &time_out);
+    return time_out.tm_wday * MINUTES_PER_DAY + time_out.tm_hour * 60 +
+           time_out.tm_min;
+}
+}
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "tools/ToolsFwd.hpp"
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Leosac
+{
+namespace Tools
+{
+/**
+ * Compiled representation of a set of SingleTimeFrame.
+ *
+ * The week is split into 7 * 1440 minutes, and each minute is stored
+ * as a single bit. Checking whether a time point is part of a schedule
+ * is therefore a single bit test, once the time point has been converted
+ * to a WeekMinute.
+ *
+ * Objects of this class are immutable once built and can be shared
+ * between threads.
+ */
+class ScheduleBitmap
+{
+  public:
+    static constexpr int MINUTES_PER_DAY  = 24 * 60;
+    static constexpr int MINUTES_PER_WEEK = 7 * MINUTES_PER_DAY;
+
+    /**
+     * Size, in bytes, of a bitmap written by pack().
+     */
+    static constexpr int PACKED_SIZE = MINUTES_PER_WEEK / 8;
+
+    ScheduleBitmap() = default;
+
+    explicit ScheduleBitmap(const std::vector<SingleTimeFrame> &timeframes);
+
+    /**
+     * Mark all the minutes covered by the timeframe.
+     *
+     * Bounds are inclusive, in the same way as
+     * SingleTimeFrame::is_in_timeframe(). Timeframes with an invalid
+     * day are ignored.
+     */
+    void add(const SingleTimeFrame &tf);
+
+    /**
+     * Is the given minute of the week part of the bitmap?
+     */
+    bool test(WeekMinute minute) const;
+
+    /**
+     * Write the bitmap to `out`, which must hold PACKED_SIZE bytes.
+     *
+     * Minute `m` is stored in bit `m % 8` of byte `m / 8`. The layout
+     * doesn't depend on the host, so packed bitmaps can be stored in files.
+     */
+    void pack(uint8_t *out) const;
+
+    /**
+     * Same as test(), for a bitmap written by pack().
+     */
+    static bool test_packed(const uint8_t *packed, WeekMinute minute);
+
+    /**
+     * Convert a time point to a minute of the week, in local time.
+     *
+     * This performs a single, reentrant, `localtime_r()` call. The result
+     * can be used to check multiple schedules against the same time point.
+     */
+    static WeekMinute week_minute(const std::chrono::system_clock::time_point &tp);
+
+  private:
+    std::bitset<MINUTES_PER_WEEK> bits_;
+};
+}
+}
@@ -42,6 +42,14 @@ using ScheduleMappingPtr   = std::shared_ptr<ScheduleMapping>;
 using ScheduleMappingLPtr  = odb::lazy_shared_ptr<ScheduleMapping>;
 using ScheduleMappingLWPtr = odb::lazy_weak_ptr<ScheduleMapping>;
 using ScheduleMappingId    = unsigned long;
+
+class ScheduleBitmap;
+
+/**
+ * A minute of the week, in local time.
+ * 0 is sunday 00:00.
+ */
+using WeekMinute = unsigned int;
 }
 
 struct MailInfo;
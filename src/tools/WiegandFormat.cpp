@@ -0,0 +1,297 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/WiegandFormat.hpp"
+#include "exception/configexception.hpp"
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cctype>
+#include <stdexcept>
+
+namespace Leosac
+{
+namespace Tools
+{
+
+static constexpr int MAX_BITS = 64;
+
+WiegandFormat::WiegandFormat(const std::string &name, int nb_bits,
+                             const Field &facility_code, const Field &card_number,
+                             const std::vector<Parity> &parity)
+    : name_(name)
+    , nb_bits_(nb_bits)
+{
+    if (nb_bits_ <= 0 || nb_bits_ > MAX_BITS)
+        throw std::invalid_argument("Wiegand format " + name_ +
+                                    ": invalid number of bits.");
+
+    facility_code_ = compile(facility_code);
+    card_number_   = compile(card_number);
+    for (const auto &p : parity)
+    {
+        CompiledParity compiled{0, p.type == ParityType::ODD};
+        for (int bit : p.bits)
+            compiled.mask |= bit_mask(bit);
+        parity_.push_back(compiled);
+    }
+}
+
+WiegandFormat WiegandFormat::from_ptree(const boost::property_tree::ptree &cfg)
+{
+    auto name = cfg.get<std::string>("name", "");
+    if (name.empty())
+        throw Ex::Config("wiegand_format", "name", true);
+
+    auto read_field = [&](const std::string &key) {
+        Field f{0, 0};
+        if (auto node = cfg.get_child_optional(key))
+        {
+            f.start  = node->get<int>("start");
+            f.length = node->get<int>("length");
+        }
+        return f;
+    };
+
+    try
+    {
+        std::vector<Parity> parity;
+        for (const auto &node : cfg)
+        {
+            if (node.first != "parity")
+                continue;
+            auto type = node.second.get<std::string>("type");
+            if (type != "even" && type != "odd")
+                throw Ex::Config(name, "parity.type", false);
+            parity.push_back(
+                Parity{type == "odd" ? ParityType::ODD : ParityType::EVEN,
+                       parse_bit_list(node.second.get<std::string>("bits"))});
+        }
+        return WiegandFormat(name, cfg.get<int>("bits"), read_field("facility_code"),
+                             read_field("card_number"), parity);
+    }
+    catch (const boost::property_tree::ptree_error &e)
+    {
+        throw Ex::Config(name, e.what(), false);
+    }
+    catch (const std::invalid_argument &e)
+    {
+        throw Ex::Config(name, e.what(), false);
+    }
+}
+
+const std::string &WiegandFormat::name() const
+{
+    return name_;
+}
+
+int WiegandFormat::nb_bits() const
+{
+    return nb_bits_;
+}
+
+bool WiegandFormat::decode(uint64_t frame, WiegandCardData &out) const
+{
+    for (const auto &p : parity_)
+    {
+        bool odd = __builtin_popcountll(frame & p.mask) & 1;
+        if (odd != p.odd)
+            return false;
+    }
+    out.facility_code = extract(frame, facility_code_);
+    out.card_number   = extract(frame, card_number_);
+    return true;
+}
+
+uint64_t WiegandFormat::pack(const uint8_t *buffer, int nb_bits)
+{
+    uint64_t frame = 0;
+    int i          = 0;
+    for (; nb_bits - i * 8 >= 8; ++i)
+        frame = (frame << 8) | buffer[i];
+
+    int remaining = nb_bits - i * 8;
+    if (remaining)
+        frame = (frame << remaining) | (buffer[i] >> (8 - remaining));
+    return frame;
+}
+
+bool WiegandFormat::pack(const std::string &card_id, int nb_bits, uint64_t &frame)
+{
+    if (nb_bits <= 0 || nb_bits > MAX_BITS)
+        return false;
+
+    uint64_t value = 0;
+    int digits     = 0;
+    for (char c : card_id)
+    {
+        if (c == ':')
+            continue;
+        if (!isxdigit(c))
+            return false;
+        int nibble = isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+        value      = (value << 4) | nibble;
+        ++digits;
+    }
+    int nb_bytes = (nb_bits - 1) / 8 + 1;
+    if (digits != nb_bytes * 2)
+        return false;
+
+    // The card id is padded with 0 up to a full byte.
+    frame = value >> (nb_bytes * 8 - nb_bits);
+    return true;
+}
+
+std::string WiegandFormat::card_id(const uint8_t *buffer, int nb_bits)
+{
+    static const char digits[] = "0123456789abcdef";
+    if (nb_bits <= 0)
+        return "";
+
+    int size = (nb_bits - 1) / 8 + 1;
+    std::string out;
+    out.reserve(size * 3);
+    for (int i = 0; i < size; ++i)
+    {
+        if (i)
+            out += ':';
+        out += digits[buffer[i] >> 4];
+        out += digits[buffer[i] & 0x0F];
+    }
+    return out;
+}
+
+std::vector<int> WiegandFormat::parse_bit_list(const std::string &list)
+{
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+
+    std::vector<int> bits;
+    for (auto &item : items)
+    {
+        boost::trim(item);
+        auto dash = item.find('-');
+        try
+        {
+            if (dash == std::string::npos)
+            {
+                bits.push_back(std::stoi(item));
+                continue;
+            }
+            int first = std::stoi(item.substr(0, dash));
+            int last  = std::stoi(item.substr(dash + 1));
+            if (first > last)
+                throw std::invalid_argument("");
+            for (int bit = first; bit <= last; ++bit)
+                bits.push_back(bit);
+        }
+        catch (const std::exception &)
+        {
+            throw std::invalid_argument("Invalid bit list: " + list);
+        }
+    }
+    return bits;
+}
+
+WiegandFormat::CompiledField WiegandFormat::compile(const Field &field) const
+{
+    if (field.length == 0)
+        return CompiledField{0, 0};
+    if (field.start < 0 || field.length < 0 || field.start + field.length > nb_bits_)
+        throw std::invalid_argument("Wiegand format " + name_ +
+                                    ": field out of bounds.");
+
+    CompiledField compiled;
+    compiled.shift = nb_bits_ - (field.start + field.length);
+    compiled.mask =
+        field.length == MAX_BITS ? ~uint64_t(0) : (uint64_t(1) << field.length) - 1;
+    return compiled;
+}
+
+uint64_t WiegandFormat::bit_mask(int bit) const
+{
+    if (bit < 0 || bit >= nb_bits_)
+        throw std::invalid_argument("Wiegand format " + name_ +
+                                    ": parity bit out of bounds.");
+    return uint64_t(1) << (nb_bits_ - 1 - bit);
+}
+
+uint64_t WiegandFormat::extract(uint64_t frame, const CompiledField &field)
+{
+    return (frame >> field.shift) & field.mask;
+}
+
+WiegandFormatRegistry::WiegandFormatRegistry()
+{
+    using Field      = WiegandFormat::Field;
+    using ParityType = WiegandFormat::ParityType;
+    auto bits        = &WiegandFormat::parse_bit_list;
+
+    formats_.emplace_back("H10304", 37, Field{1, 16}, Field{17, 19},
+                          std::vector<WiegandFormat::Parity>{
+                              {ParityType::EVEN, bits("0-18")},
+                              {ParityType::ODD, bits("18-36")}});
+    formats_.emplace_back(
+        "CORPORATE_1000_35", 35, Field{2, 12}, Field{14, 20},
+        std::vector<WiegandFormat::Parity>{
+            {ParityType::EVEN,
+             bits("1-3,5-6,8-9,11-12,14-15,17-18,20-21,23-24,26-27,29-30,32-33")},
+            {ParityType::ODD,
+             bits("1-2,4-5,7-8,10-11,13-14,16-17,19-20,22-23,25-26,28-29,31-32,34")},
+            {ParityType::ODD, bits("0-34")}});
+    formats_.emplace_back("H10306", 34, Field{1, 16}, Field{17, 16},
+                          std::vector<WiegandFormat::Parity>{
+                              {ParityType::EVEN, bits("0-16")},
+                              {ParityType::ODD, bits("17-33")}});
+    formats_.emplace_back("H10301", 26, Field{1, 8}, Field{9, 16},
+                          std::vector<WiegandFormat::Parity>{
+                              {ParityType::EVEN, bits("0-12")},
+                              {ParityType::ODD, bits("13-25")}});
+}
+
+void WiegandFormatRegistry::add(const WiegandFormat &format)
+{
+    formats_.push_back(format);
+}
+
+void WiegandFormatRegistry::load_config(const boost::property_tree::ptree &cfg)
+{
+    for (const auto &node : cfg)
+        add(WiegandFormat::from_ptree(node.second));
+}
+
+const WiegandFormat *WiegandFormatRegistry::decode(uint64_t frame, int nb_bits,
+                                                   WiegandCardData &out) const
+{
+    for (auto itr = formats_.rbegin(); itr != formats_.rend(); ++itr)
+    {
+        if (itr->nb_bits() == nb_bits && itr->decode(frame, out))
+            return &*itr;
+    }
+    return nullptr;
+}
+
+bool WiegandFormatRegistry::has_format(int nb_bits) const
+{
+    return std::any_of(
+        formats_.begin(), formats_.end(),
+        [&](const WiegandFormat &f) { return f.nb_bits() == nb_bits; });
+}
+}
+}
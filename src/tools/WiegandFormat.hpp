@@ -0,0 +1,214 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/property_tree/ptree_fwd.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Leosac
+{
+namespace Tools
+{
+/**
+ * Data extracted from a Wiegand frame.
+ */
+struct WiegandCardData
+{
+    uint64_t facility_code;
+    uint64_t card_number;
+};
+
+/**
+ * Description of a Wiegand frame layout.
+ *
+ * Bits are numbered in transmission order: bit 0 is the first bit
+ * sent by the reader. A frame is represented as an integer whose least
+ * significant bit is the last bit sent (see pack()), which limits formats
+ * to 64 bits.
+ *
+ * The layout is compiled into masks and shifts at construction, so that
+ * decoding a frame only involves a few bitwise operations.
+ */
+class WiegandFormat
+{
+  public:
+    /**
+     * A range of contiguous bits.
+     */
+    struct Field
+    {
+        int start;
+        int length;
+    };
+
+    enum class ParityType
+    {
+        /**
+         * The number of bits set, parity bit included, must be even.
+         */
+        EVEN,
+        /**
+         * The number of bits set, parity bit included, must be odd.
+         */
+        ODD
+    };
+
+    /**
+     * A parity check.
+     */
+    struct Parity
+    {
+        ParityType type;
+
+        /**
+         * Bits covered by the check, including the parity bit itself.
+         */
+        std::vector<int> bits;
+    };
+
+    /**
+     * Build a format.
+     *
+     * A field with a length of 0 is absent from the frame, and is
+     * always decoded as 0.
+     *
+     * @throws std::invalid_argument if the layout doesn't fit in `nb_bits`.
+     */
+    WiegandFormat(const std::string &name, int nb_bits, const Field &facility_code,
+                  const Field &card_number, const std::vector<Parity> &parity);
+
+    /**
+     * Build a format from its configuration.
+     *
+     * @throws Ex::Config if the configuration is invalid.
+     */
+    static WiegandFormat from_ptree(const boost::property_tree::ptree &cfg);
+
+    const std::string &name() const;
+
+    int nb_bits() const;
+
+    /**
+     * Check the frame's parity and extract its fields.
+     *
+     * @param frame the frame, as returned by pack(). It must have
+     *        nb_bits() bits.
+     * @return false if a parity check failed.
+     */
+    bool decode(uint64_t frame, WiegandCardData &out) const;
+
+    /**
+     * Pack the first `nb_bits` bits of a buffer into an integer.
+     * The buffer holds bits in transmission order, MSB first.
+     */
+    static uint64_t pack(const uint8_t *buffer, int nb_bits);
+
+    /**
+     * Parse a card id (the colon separated, hexadecimal, representation
+     * of a frame) into an integer, as pack() would.
+     *
+     * @return false if the card id is malformed.
+     */
+    static bool pack(const std::string &card_id, int nb_bits, uint64_t &frame);
+
+    /**
+     * Format the first `nb_bits` bits of a buffer as a card id
+     * (eg "ab:cd:ef:01").
+     */
+    static std::string card_id(const uint8_t *buffer, int nb_bits);
+
+    /**
+     * Parse a list of bits or bit ranges, such as "0-12" or "1,2,4-5".
+     *
+     * @throws std::invalid_argument on malformed input.
+     */
+    static std::vector<int> parse_bit_list(const std::string &list);
+
+  private:
+    struct CompiledField
+    {
+        int shift;
+        uint64_t mask;
+    };
+
+    struct CompiledParity
+    {
+        uint64_t mask;
+        bool odd;
+    };
+
+    CompiledField compile(const Field &field) const;
+
+    uint64_t bit_mask(int bit) const;
+
+    static uint64_t extract(uint64_t frame, const CompiledField &field);
+
+    std::string name_;
+    int nb_bits_;
+    CompiledField facility_code_;
+    CompiledField card_number_;
+    std::vector<CompiledParity> parity_;
+};
+
+/**
+ * A set of Wiegand formats, used to decode frames of known lengths.
+ *
+ * It is initialized with the usual formats: H10301 (26 bits),
+ * H10306 (34 bits), Corporate 1000 (35 bits) and H10304 (37 bits).
+ * Custom formats can be added, and take precedence over the
+ * built-in ones.
+ */
+class WiegandFormatRegistry
+{
+  public:
+    WiegandFormatRegistry();
+
+    /**
+     * Register a format. Formats registered last are tried first.
+     */
+    void add(const WiegandFormat &format);
+
+    /**
+     * Register the formats described by a configuration tree. Each
+     * child is a format, as expected by WiegandFormat::from_ptree().
+     */
+    void load_config(const boost::property_tree::ptree &cfg);
+
+    /**
+     * Decode a frame using the first format of the frame's length whose
+     * parity checks pass.
+     *
+     * @return the format that was used, or nullptr if no format matched.
+     */
+    const WiegandFormat *decode(uint64_t frame, int nb_bits,
+                                WiegandCardData &out) const;
+
+    /**
+     * Is there any format of this length?
+     */
+    bool has_format(int nb_bits) const;
+
+  private:
+    std::vector<WiegandFormat> formats_;
+};
+}
+}
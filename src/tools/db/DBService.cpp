@@ -30,15 +30,37 @@
 #include "core/credentials/Credential_odb.h"
 #include "exception/EntityNotFound.hpp"
 #include "tools/AssertCast.hpp"
+#include "tools/LogEntry.hpp"
+#include "tools/LogEntry_odb.h"
 #include "tools/Schedule_odb.h"
+#include "tools/enforce.hpp"
 #include "tools/log.hpp"
+#include <algorithm>
 #include <odb/database.hxx>
+#include <sstream>
 
 using namespace Leosac;
 
 
 DBService::DBService(DBPtr db)
     : database_(db)
+    , audit_counts_([this](unsigned long after_id) {
+        using Query = odb::query<Audit::AuditEntryTypeCount>;
+        std::vector<db::EntryCountCache::Count> counts;
+        for (const auto &row : database_->query<Audit::AuditEntryTypeCount>(
+                 Query(Query::AuditEntry::id > after_id)))
+        {
+            counts.push_back({row.type, row.count, row.max_id});
+        }
+        return counts;
+    })
+    , log_counts_([this](unsigned long after_id) {
+        using Query = odb::query<Tools::LogView>;
+        Tools::LogView view(database_->query_value<Tools::LogView>(
+            Query(Query::LogEntry::id > after_id)));
+        return std::vector<db::EntryCountCache::Count>{
+            {"", view.count, view.max_id ? *view.max_id : 0}};
+    })
 {
     ASSERT_LOG(database_, "Not valid database pointer for DBService.");
 }
@@ -51,10 +73,7 @@ DBPtr DBService::db() const
 size_t DBService::operation_count() const
 {
     if (database_->tracer())
-    {
-        auto tracer = assert_cast<db::DatabaseTracer *>(database_->tracer());
-        return tracer->count();
-    }
+        return db::DatabaseTracer::thread_count();
     return 0;
 }
 
@@ -196,3 +215,99 @@ void DBService::update(Audit::IAuditEntry &ientry)
 {
     update_impl(database_, assert_cast<Audit::AuditEntry &>(ientry));
 }
+
+/**
+ * Build the "typeid IN (...)" condition matching the given audit types.
+ */
+static std::string build_in_clause(const std::vector<std::string> &types)
+{
+    std::stringstream request_builder;
+
+    if (types.empty())
+        return "1 = 1";
+
+    request_builder << "typeid IN (";
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        // Types are inlined in the request.
+        LEOSAC_ENFORCE(std::all_of(types[i].begin(), types[i].end(),
+                                   [](char c) { return c == ':' || isalpha(c); }),
+                       "Invalid audit type.");
+        request_builder << "'" << types[i] << "'";
+        if (i != types.size() - 1)
+            request_builder << ",";
+    }
+    request_builder << ")";
+    return request_builder.str();
+}
+
+static std::vector<Audit::AuditEntryPtr> find_audits_impl(const DBPtr db,
+                                                          const std::string &request)
+{
+    using Query = odb::query<Audit::AuditEntry>;
+    std::vector<Audit::AuditEntryPtr> audits;
+
+    DEBUG("QUERY: " << request);
+    db::OptionalTransaction t(db->begin());
+    auto result = db->query<Audit::AuditEntry>(Query(request));
+    for (auto itr = result.begin(); itr != result.end(); ++itr)
+    {
+        auto audit = itr.load();
+        audit->database(db);
+        audits.push_back(audit);
+    }
+    t.commit();
+    return audits;
+}
+
+std::vector<Audit::AuditEntryPtr>
+DBService::find_audits(const std::vector<std::string> &types, int page,
+                       int page_size)
+{
+    std::stringstream request_builder;
+
+    request_builder << "WHERE " << build_in_clause(types);
+    request_builder << " ORDER BY id DESC";
+    request_builder << " LIMIT " << page_size;
+    request_builder << " OFFSET " << page_size * (page - 1);
+    return find_audits_impl(database_, request_builder.str());
+}
+
+std::vector<Audit::AuditEntryPtr>
+DBService::find_audits_range(const std::vector<std::string> &types,
+                             const Audit::AuditEntryId &before_id,
+                             const Audit::AuditEntryId &after_id, int page_size)
+{
+    std::stringstream request_builder;
+
+    request_builder << "WHERE " << build_in_clause(types);
+    if (before_id)
+        request_builder << " AND id < " << before_id;
+    if (after_id)
+        request_builder << " AND id > " << after_id;
+    // Fetch the entries closest to the cursor.
+    bool scan_asc = after_id && !before_id;
+    request_builder << " ORDER BY id " << (scan_asc ? "ASC" : "DESC");
+    request_builder << " LIMIT " << page_size;
+
+    auto audits = find_audits_impl(database_, request_builder.str());
+    if (scan_asc)
+        std::reverse(audits.begin(), audits.end());
+    return audits;
+}
+
+size_t DBService::count_audits(const std::vector<std::string> &types)
+{
+    db::OptionalTransaction t(database_->begin());
+    auto count = audit_counts_.count(types);
+    t.commit();
+    return count;
+}
+
+size_t DBService::count_logs()
+{
+    db::OptionalTransaction t(database_->begin());
+    auto count = log_counts_.count();
+    t.commit();
+    return count;
+}
@@ -24,6 +24,7 @@
 #include "core/credentials/CredentialFwd.hpp"
 #include "core/update/UpdateFwd.hpp"
 #include "tools/ToolsFwd.hpp"
+#include "tools/db/EntryCountCache.hpp"
 #include "tools/db/db_fwd.hpp"
 
 namespace Leosac
@@ -47,7 +48,8 @@ class DBService
     DBPtr db() const;
 
     /**
-     * Return the number of operation against the database.
+     * Return the number of operation against the database made
+     * by the calling thread.
      */
     size_t operation_count() const;
 
@@ -102,7 +104,52 @@ class DBService
      */
     void update(Audit::IAuditEntry &);
 
+    /**
+     * Retrieve a page of audit entries, newest first.
+     *
+     * Only entries whose type is in `types` are considered, or entries
+     * of any type if `types` is empty. Pages start at 1.
+     */
+    std::vector<Audit::AuditEntryPtr>
+    find_audits(const std::vector<std::string> &types, int page, int page_size);
+
+    /**
+     * Retrieve the `page_size` audit entries closest to a cursor, newest
+     * first.
+     *
+     * Only entries whose id is lower than `before_id` (if non zero) and
+     * greater than `after_id` (if non zero) are considered. Entries are
+     * searched starting from `after_id` if only `after_id` is set, and
+     * from `before_id` otherwise.
+     *
+     * Unlike a page number, this doesn't get slower as the position of
+     * the cursor in the audit table grows.
+     */
+    std::vector<Audit::AuditEntryPtr>
+    find_audits_range(const std::vector<std::string> &types,
+                      const Audit::AuditEntryId &before_id,
+                      const Audit::AuditEntryId &after_id, int page_size);
+
+    /**
+     * Return the number of audit entries whose type is in `types`, or the
+     * number of audit entries if `types` is empty.
+     *
+     * The value is cached (see db::EntryCountCache), and may slightly
+     * lag behind the database.
+     */
+    size_t count_audits(const std::vector<std::string> &types);
+
+    /**
+     * Return the number of log entries.
+     *
+     * The value is cached, like for count_audits().
+     */
+    size_t count_logs();
+
   private:
     const DBPtr database_;
+
+    db::EntryCountCache audit_counts_;
+    db::EntryCountCache log_counts_;
 };
 }
@@ -0,0 +1,36 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DatabaseTracer.hpp"
+
+using namespace Leosac;
+using namespace Leosac::db;
+
+thread_local size_t DatabaseTracer::thread_count_ = 0;
+
+size_t DatabaseTracer::thread_count()
+{
+    return thread_count_;
+}
+
+void DatabaseTracer::count_thread_statement()
+{
+    ++thread_count_;
+}
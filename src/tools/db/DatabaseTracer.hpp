@@ -29,6 +29,10 @@ namespace db
 {
 /**
  * A Leosac specific base class for tracing database operation.
+ *
+ * Besides their total count, statements are counted per thread, so
+ * that the operations of one request can be told apart from those
+ * of requests processed concurrently.
  */
 class DatabaseTracer : public odb::tracer
 {
@@ -39,6 +43,21 @@ class DatabaseTracer : public odb::tracer
      * Return the number of statement that have been traced.
      */
     virtual size_t count() const = 0;
+
+    /**
+     * Return the number of statement that have been traced on
+     * the calling thread, by any tracer.
+     */
+    static size_t thread_count();
+
+  protected:
+    /**
+     * Implementations call this for each statement they trace.
+     */
+    static void count_thread_statement();
+
+  private:
+    static thread_local size_t thread_count_;
 };
 }
 }
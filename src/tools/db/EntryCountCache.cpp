@@ -0,0 +1,67 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EntryCountCache.hpp"
+#include <algorithm>
+
+using namespace Leosac;
+using namespace Leosac::db;
+
+EntryCountCache::EntryCountCache(
+    CountFunction count_entries,
+    std::chrono::steady_clock::duration full_refresh_interval)
+    : count_entries_(count_entries)
+    , full_refresh_interval_(full_refresh_interval)
+    , last_id_(0)
+    , last_full_refresh_(std::chrono::steady_clock::now())
+{
+}
+
+size_t EntryCountCache::count(const std::vector<std::string> &keys)
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_full_refresh_ >= full_refresh_interval_)
+    {
+        counts_.clear();
+        last_id_           = 0;
+        last_full_refresh_ = now;
+    }
+
+    for (const auto &key_count : count_entries_(last_id_))
+    {
+        counts_[key_count.key] += key_count.count;
+        last_id_ = std::max(last_id_, key_count.max_id);
+    }
+
+    size_t total = 0;
+    if (keys.empty())
+    {
+        for (const auto &key_count : counts_)
+            total += key_count.second;
+    }
+    for (const auto &key : keys)
+    {
+        auto itr = counts_.find(key);
+        if (itr != counts_.end())
+            total += itr->second;
+    }
+    return total;
+}
@@ -0,0 +1,88 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Leosac
+{
+namespace db
+{
+/**
+ * Number of entries, per key, of a table that only grows.
+ *
+ * Counting such a table gets slower as it grows. Counts are computed
+ * once, then refreshed incrementally by counting only the entries whose
+ * id is greater than the highest id seen so far, which is a range scan
+ * on the primary key.
+ *
+ * An entry whose id was allocated before, but that was committed after,
+ * the last refresh is missed. Counts are therefore an estimate, and are
+ * fully recomputed every `full_refresh_interval`.
+ *
+ * The cache is tied to one database: it is owned by the DBService
+ * of that database.
+ */
+class EntryCountCache
+{
+  public:
+    /**
+     * Number of entries, and highest entry id, of a key.
+     */
+    struct Count
+    {
+        std::string key;
+        size_t count;
+        unsigned long max_id;
+    };
+
+    /**
+     * Count the entries whose id is greater than the given id, per key.
+     */
+    using CountFunction = std::function<std::vector<Count>(unsigned long)>;
+
+    explicit EntryCountCache(CountFunction count_entries,
+                             std::chrono::steady_clock::duration
+                                 full_refresh_interval = std::chrono::minutes(10));
+
+    /**
+     * Refresh the cache, and return the number of entries of the given
+     * keys, or of all keys if `keys` is empty.
+     *
+     * This must be called with a transaction active on the database.
+     */
+    size_t count(const std::vector<std::string> &keys = {});
+
+  private:
+    const CountFunction count_entries_;
+    const std::chrono::steady_clock::duration full_refresh_interval_;
+
+    std::mutex mutex_;
+    std::map<std::string, size_t> counts_;
+    unsigned long last_id_;
+    std::chrono::steady_clock::time_point last_full_refresh_;
+};
+}
+}
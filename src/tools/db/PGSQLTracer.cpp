@@ -24,7 +24,8 @@ using namespace Leosac;
 using namespace Leosac::db;
 
 PGSQLTracer::PGSQLTracer(bool count_only)
-    : count_only_(count_only)
+    : count_(0)
+    , count_only_(count_only)
 {
 }
 
@@ -33,6 +34,7 @@ void PGSQLTracer::execute(odb::connection &, const char *statement)
     if (!count_only_)
         DEBUG("SQL: " << statement);
     ++count_;
+    count_thread_statement();
 }
 
 size_t PGSQLTracer::count() const
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "DatabaseTracer.hpp"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <odb/pgsql/tracer.hxx>
@@ -44,7 +45,10 @@ class PGSQLTracer : public DatabaseTracer
     virtual size_t count() const override;
 
   private:
-    size_t count_;
+    /**
+     * Statements may be executed from any thread.
+     */
+    std::atomic<size_t> count_;
     bool count_only_;
 };
 }
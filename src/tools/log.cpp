@@ -19,6 +19,7 @@
 
 #include "log.hpp"
 #include "ThreadUtils.hpp"
+#include <algorithm>
 #include <boost/regex.hpp>
 
 namespace
@@ -44,6 +45,28 @@ std::string remove_ascii_format(const std::string &in)
 namespace LogHelper
 {
 
+// Before the loggers are set up, messages are written to stderr
+// regardless of their level.
+std::atomic<int> active_level(LogLevel::DEBUG);
+
+void update_active_level()
+{
+    auto console = spdlog::get("console");
+    auto syslog  = spdlog::get("syslog");
+    if (!console && !syslog)
+    {
+        active_level = LogLevel::DEBUG;
+        return;
+    }
+
+    int level = LogLevel::CRIT;
+    if (console)
+        level = std::min<int>(level, console->level());
+    if (syslog)
+        level = std::min<int>(level, syslog->level());
+    active_level = level;
+}
+
 void log(const std::string &log_msg, int /*line*/, const char * /*funcName*/,
          const char * /*fileName*/, LogLevel level)
 {
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <csignal>
 #include <iostream>
@@ -35,12 +36,48 @@ enum LogLevel
     DEBUG = spdlog::level::debug,
 };
 
+/**
+* @def LEOSAC_MIN_LOG_LEVEL
+* Lowest level of the messages that are compiled in.
+*
+* Logging statements below this level are dead code, and their message is
+* never formatted. Set through the `LEOSAC_MIN_LOG_LEVEL` CMake option.
+*/
+#ifndef LEOSAC_MIN_LOG_LEVEL
+#define LEOSAC_MIN_LOG_LEVEL LogLevel::DEBUG
+#endif
+
 namespace LogHelper
 {
 LogLevel log_level_from_string(const std::string &level);
 
 void log(const std::string &log_msg, int /*line*/, const char * /*funcName*/,
          const char * /*fileName*/, LogLevel level);
+
+/**
+* Lowest level accepted by at least one of the loggers.
+*
+* @see update_active_level()
+*/
+extern std::atomic<int> active_level;
+
+/**
+* Recompute `active_level` from the levels of the current loggers.
+*
+* This must be called whenever the loggers, or their levels, change.
+*/
+void update_active_level();
+
+/**
+* Would a message of level `level` be written anywhere?
+*
+* This is checked by the logging macros before formatting the message.
+*/
+inline bool is_enabled(LogLevel level)
+{
+    return level >= LEOSAC_MIN_LOG_LEVEL &&
+           level >= active_level.load(std::memory_order_relaxed);
+}
 };
 
 /**
@@ -68,19 +105,28 @@ void log(const std::string &log_msg, int /*line*/, const char * /*funcName*/,
     }()
 
 
+/**
+* Internal macro.
+* Format and log the message only if a logger accepts `level`.
+*/
+#define LOG_IF_ENABLED(msg, level)                                                  \
+    (LogHelper::is_enabled(level)                                                   \
+         ? LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,  \
+                          level)                                                    \
+         : (void)0)
+
+
 /**
 * See "Internal macros documentation"
 */
 #define DEBUG_0(msg)                                                                \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::DEBUG)
+    LOG_IF_ENABLED(msg, LogLevel::DEBUG)
 
 /**
 * See "Internal macros documentation"
 */
 #define DEBUG_1(msg, loggers)                                                       \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::DEBUG, loggers)
+    LOG_IF_ENABLED(msg, LogLevel::DEBUG)
 
 /**
 * See "Internal macros documentation"
@@ -100,15 +146,13 @@ void log(const std::string &log_msg, int /*line*/, const char * /*funcName*/,
 * See "Internal macros documentation"
 */
 #define INFO_0(msg)                                                                 \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::INFO)
+    LOG_IF_ENABLED(msg, LogLevel::INFO)
 
 /**
 * See "Internal macros documentation"
 */
 #define INFO_1(msg, loggers)                                                        \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::INFO, loggers)
+    LOG_IF_ENABLED(msg, LogLevel::INFO)
 
 /**
 * See "Internal macros documentation"
@@ -128,15 +172,13 @@ void log(const std::string &log_msg, int /*line*/, const char * /*funcName*/,
 * See "Internal macros documentation"
 */
 #define WARN_0(msg)                                                                 \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::WARN)
+    LOG_IF_ENABLED(msg, LogLevel::WARN)
 
 /**
 * See "Internal macros documentation"
 */
 #define WARN_1(msg, loggers)                                                        \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::WARN)
+    LOG_IF_ENABLED(msg, LogLevel::WARN)
 
 /**
 * See "Internal macros documentation"
@@ -156,15 +198,13 @@ void log(const std::string &log_msg, int /*line*/, const char * /*funcName*/,
 * See "Internal macros documentation"
 */
 #define ERROR_0(msg)                                                                \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::ERROR)
+    LOG_IF_ENABLED(msg, LogLevel::ERROR)
 
 /**
 * See "Internal macros documentation"
 */
 #define ERROR_1(msg, loggers)                                                       \
-    LogHelper::log(BUILD_STR(msg), __LINE__, FUNCTION_NAME_MACRO, __FILE__,         \
-                   LogLevel::ERROR)
+    LOG_IF_ENABLED(msg, LogLevel::ERROR)
 
 /**
 * See "Internal macros documentation"
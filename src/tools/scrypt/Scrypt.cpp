@@ -41,6 +41,16 @@ ScryptResult Scrypt::Hash(const std::vector<uint8_t> &in,
     return res;
 }
 
+ScryptParam Scrypt::DefaultParam()
+{
+    return default_;
+}
+
+uint64_t Scrypt::MemoryUsage(const ScryptParam &param)
+{
+    return 128 * param.N * param.r * param.p;
+}
+
 ScryptResult Scrypt::Hash(const std::vector<uint8_t> &in, const ScryptParam &param)
 {
     return Hash(in, Random::GetBytes(16), param);
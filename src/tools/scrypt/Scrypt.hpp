@@ -165,6 +165,16 @@ class Scrypt
      */
     static bool Verify(const std::vector<uint8_t> &in, const ScryptResult &expected);
 
+    /**
+     * Parameters used when none are specified.
+     */
+    static ScryptParam DefaultParam();
+
+    /**
+     * Memory, in bytes, used to compute a hash with `param`.
+     */
+    static uint64_t MemoryUsage(const ScryptParam &param);
+
   private:
     static ScryptParam default_;
 };
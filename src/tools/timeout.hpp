@@ -21,6 +21,8 @@
 
 #include "log.hpp"
 #include <chrono>
+#include <iterator>
+#include <type_traits>
 
 namespace Leosac
 {
@@ -30,7 +32,8 @@ namespace Tools
  * Compute the time until the next timeout from a collection of time point.
  *
  * This function will iterate over a collection of time point and return
- * the number of milliseconds until the soonest timeout.
+ * the number of milliseconds until the soonest timeout. Time points may
+ * come from any clock, as long as they all come from the same one.
  *
  * If the collection is empty or if all the time point are time_point::max()
  * the function return -1.
@@ -38,12 +41,10 @@ namespace Tools
 template <class InputIterator>
 int compute_timeout(InputIterator begin, InputIterator end)
 {
-    static_assert(
-        std::is_same<
-            std::chrono::system_clock::time_point,
-            typename std::iterator_traits<InputIterator>::value_type>::value,
-        "Iterator dereference to wrong type");
-    auto tp = std::chrono::system_clock::time_point::max();
+    using TimePoint =
+        typename std::decay<typename std::iterator_traits<InputIterator>::value_type>::type;
+    using Clock = typename TimePoint::clock;
+    auto tp     = TimePoint::max();
 
     while (begin != end)
     {
@@ -52,12 +53,12 @@ int compute_timeout(InputIterator begin, InputIterator end)
         ++begin;
     }
 
-    if (tp == std::chrono::system_clock::time_point::max())
+    if (tp == TimePoint::max())
         return -1; // no update asked.
 
-    int timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      tp - std::chrono::system_clock::now())
-                      .count();
+    int timeout =
+        std::chrono::duration_cast<std::chrono::milliseconds>(tp - Clock::now())
+            .count();
     DEBUG("Next timeout: " << timeout);
     return timeout < 0 ? 0 : timeout;
 }
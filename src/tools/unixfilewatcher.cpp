@@ -32,9 +32,15 @@ extern "C" {
 #include "exception/fsexception.hpp"
 #include "tools/log.hpp"
 #include "tools/unixsyscall.hpp"
+#include <boost/filesystem/path.hpp>
 
 using namespace Leosac::Tools;
 
+/**
+ * Events that mean a watched file has a new content.
+ */
+static const std::uint32_t CHANGE_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+
 UnixFileWatcher::UnixFileWatcher()
     : _isRunning(false)
 {
@@ -67,9 +73,10 @@ void UnixFileWatcher::stop()
     _isRunning = false;
     INFO("inotify stop");
     _thread.join();
-    for (auto watch : _watches)
+    for (auto itr = _watches.begin(); itr != _watches.end();
+         itr = _watches.upper_bound(itr->first))
     {
-        if (inotify_rm_watch(_inotifyFd, watch.first) == -1)
+        if (inotify_rm_watch(_inotifyFd, itr->first) == -1)
             throw(
                 FsException(UnixSyscall::getErrorString("inotify_rm_watch", errno)));
     }
@@ -78,15 +85,26 @@ void UnixFileWatcher::stop()
 
 void UnixFileWatcher::watchFile(const std::string &path)
 {
-    std::uint32_t mask = IN_CLOSE_WRITE;
+    watchFile(path, nullptr);
+}
+
+void UnixFileWatcher::watchFile(const std::string &path, ChangeCallback callback)
+{
+    boost::filesystem::path file(path);
+    std::string directory = file.parent_path().string();
     WatchParams params;
     UnixFd watch;
 
-    if ((watch = inotify_add_watch(_inotifyFd, path.c_str(), mask)) == -1)
+    if (directory.empty())
+        directory = ".";
+    if ((watch = inotify_add_watch(_inotifyFd, directory.c_str(), CHANGE_MASK)) ==
+        -1)
         throw(FsException(UnixSyscall::getErrorString("inotify_add_watch", errno)));
     params.path     = path;
+    params.name     = file.filename().string();
     params.mask     = 0;
-    _watches[watch] = params;
+    params.callback = callback;
+    _watches.emplace(watch, params);
 }
 
 bool UnixFileWatcher::fileHasChanged(const std::string &path) const
@@ -94,7 +112,7 @@ bool UnixFileWatcher::fileHasChanged(const std::string &path) const
     for (auto &param : _watches)
     {
         if (param.second.path == path)
-            return ((param.second.mask & IN_CLOSE_WRITE) > 0);
+            return ((param.second.mask & CHANGE_MASK) > 0);
     }
     throw(FsException("no registered watch for path:" + path));
 }
@@ -159,8 +177,29 @@ void UnixFileWatcher::run()
                 {
                     event = reinterpret_cast<inotify_event *>(
                         &buf[i]); // NOTE Alignment should not be an issue here
-                    _watches.at(event->wd).mask |= event->mask;
                     i += sizeof(inotify_event) + event->len;
+                    // Events about the directory itself carry no name.
+                    if (!event->len)
+                        continue;
+                    auto range = _watches.equal_range(event->wd);
+                    for (auto itr = range.first; itr != range.second; ++itr)
+                    {
+                        auto &params = itr->second;
+                        if (params.name != event->name)
+                            continue;
+                        params.mask |= event->mask;
+                        if ((event->mask & CHANGE_MASK) && params.callback)
+                        {
+                            try
+                            {
+                                params.callback(params.path);
+                            }
+                            catch (const std::exception &e)
+                            {
+                                ERROR("Exception caught: " << e.what());
+                            }
+                        }
+                    }
                 }
             }
         }
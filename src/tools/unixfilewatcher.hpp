@@ -26,6 +26,7 @@
 #define UNIXFILEWATCHER_HPP
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <string>
 #include <thread>
@@ -37,13 +38,26 @@ namespace Tools
 
 class UnixFileWatcher
 {
+  public:
+    using ChangeCallback = std::function<void(const std::string &path)>;
+
+  private:
     using UnixFd = int;
     struct WatchParams
     {
         std::string path;
+        /**
+         * Name of the file in its directory.
+         */
+        std::string name;
         int mask;
+        ChangeCallback callback;
     };
-    using Watches = std::map<UnixFd, WatchParams>;
+    /**
+     * Files are watched through their directory: several files
+     * may share a watch descriptor.
+     */
+    using Watches = std::multimap<UnixFd, WatchParams>;
 
     static const long DefaultTimeoutMs = 2000;
 
@@ -64,6 +78,18 @@ class UnixFileWatcher
   public:
     void watchFile(const std::string &path);
 
+    /**
+     * Watch `path` and invoke `callback`, from the watcher's thread,
+     * each time the file is closed after being written, or replaced
+     * by renaming another file over it.
+     *
+     * The directory of `path` is watched rather than the file itself,
+     * so that the watch survives the file being replaced.
+     *
+     * Like watchFile(), this must be called before start().
+     */
+    void watchFile(const std::string &path, ChangeCallback callback);
+
     bool fileHasChanged(const std::string &path) const;
 
     void fileReset(const std::string &path);
@@ -26,6 +26,7 @@
 
 extern "C" {
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 }
 
@@ -116,3 +117,51 @@ bool UnixFs::fileExists(const std::string &path)
     else
         return (true);
 }
+
+int UnixFs::openSysFsFile(const std::string &path, int flags)
+{
+    int fd = open(path.c_str(), flags);
+
+    if (fd == -1)
+        throw(FsException("could not open \'" + path + "\': " +
+                          UnixSyscall::getErrorString("open", errno)));
+    return (fd);
+}
+
+void UnixFs::reopenSysFsFile(int fd, const std::string &path, int flags)
+{
+    int new_fd = openSysFsFile(path, flags);
+
+    if (dup2(new_fd, fd) == -1)
+    {
+        int err = errno;
+        close(new_fd);
+        throw(FsException(UnixSyscall::getErrorString("dup2", err)));
+    }
+    close(new_fd);
+}
+
+void UnixFs::closeSysFsFile(int fd)
+{
+    if (fd != -1 && close(fd) == -1)
+        throw(FsException(UnixSyscall::getErrorString("close", errno)));
+}
+
+void UnixFs::writeSysFsValue(int fd, const char *buf, std::size_t len)
+{
+    ssize_t ret = pwrite(fd, buf, len, 0);
+
+    if (ret == -1)
+        throw(FsException(UnixSyscall::getErrorString("pwrite", errno)));
+    if (static_cast<std::size_t>(ret) != len)
+        throw(FsException("short write on sysfs file"));
+}
+
+std::size_t UnixFs::readSysFsValue(int fd, char *buf, std::size_t len)
+{
+    ssize_t ret = pread(fd, buf, len, 0);
+
+    if (ret == -1)
+        throw(FsException(UnixSyscall::getErrorString("pread", errno)));
+    return (static_cast<std::size_t>(ret));
+}
@@ -113,6 +113,49 @@ class UnixFs
         file.clear();
         file.seekp(0);
     }
+
+    /**
+    * open a sysfs file and keep it open for repeated use with
+    * the fd based functions below
+    * @param path Path of the sysfs target
+    * @param flags open(2) flags
+    * @return file descriptor
+    */
+    static int openSysFsFile(const std::string &path, int flags);
+
+    /**
+    * open a sysfs file again, in place of a file descriptor returned by
+    * openSysFsFile() that stopped working. The file descriptor number
+    * doesn't change, so it can stay registered in a poller.
+    * @param fd file descriptor to replace
+    * @param path Path of the sysfs target
+    * @param flags open(2) flags
+    */
+    static void reopenSysFsFile(int fd, const std::string &path, int flags);
+
+    /**
+    * close a file descriptor returned by openSysFsFile()
+    * @param fd file descriptor, ignored if -1
+    */
+    static void closeSysFsFile(int fd);
+
+    /**
+    * write a preformatted value at the beginning of an open sysfs file,
+    * using a single pwrite(2) call
+    * @param fd file descriptor of the sysfs target
+    * @param buf value to write
+    * @param len length of the value
+    */
+    static void writeSysFsValue(int fd, const char *buf, std::size_t len);
+
+    /**
+    * read the beginning of an open sysfs file, using a single pread(2) call
+    * @param fd file descriptor of the sysfs target
+    * @param buf buffer to read into
+    * @param len size of the buffer
+    * @return number of bytes read
+    */
+    static std::size_t readSysFsValue(int fd, char *buf, std::size_t len);
 };
 }
 }
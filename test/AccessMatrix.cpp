@@ -0,0 +1,289 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/auth/Door.hpp"
+#include "core/auth/Door_odb.h"
+#include "core/auth/Group.hpp"
+#include "core/auth/Group_odb.h"
+#include "core/auth/User.hpp"
+#include "core/auth/UserGroupMembership.hpp"
+#include "core/auth/UserGroupMembership_odb.h"
+#include "core/auth/User_odb.h"
+#include "core/credentials/Credential_odb.h"
+#include "core/credentials/RFIDCard.hpp"
+#include "core/credentials/RFIDCard_odb.h"
+#include "modules/websock-api/AccessMatrix.hpp"
+#include "tools/Schedule.hpp"
+#include "tools/ScheduleMapping.hpp"
+#include "tools/ScheduleMapping_odb.h"
+#include "tools/Schedule_odb.h"
+#include "gtest/gtest.h"
+#include <odb/schema-catalog.hxx>
+#include <odb/sqlite/database.hxx>
+#include <unistd.h>
+
+using namespace Leosac;
+using namespace Leosac::Module::WebSockAPI;
+
+namespace Leosac
+{
+namespace Test
+{
+
+/**
+* Each test modifies the database the way the matching CRUD handler
+* does, reports the change to an already built matrix, and checks
+* that the result matches a matrix built from scratch.
+*/
+class AccessMatrixTest : public ::testing::Test
+{
+  public:
+    AccessMatrixTest()
+        : db_path_("/tmp/leosac-test-AccessMatrix.db")
+    {
+        unlink(db_path_.c_str());
+        database_ = std::make_shared<odb::sqlite::database>(
+            db_path_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+        odb::transaction t(database_->begin());
+        odb::schema_catalog::create_schema(*database_, "core");
+        for (auto name : {"alice", "bob", "carol", "dave"})
+        {
+            auto user = std::make_shared<Auth::User>(name);
+            database_->persist(user);
+            users_.push_back(user);
+        }
+        for (auto alias : {"front", "back", "garage"})
+        {
+            auto door = std::make_shared<Auth::Door>();
+            door->alias(alias);
+            database_->persist(door);
+            doors_.push_back(door);
+        }
+
+        // staff: alice and bob. night: carol.
+        staff_ = make_group("staff", {users_[0], users_[1]});
+        night_ = make_group("night", {users_[2]});
+
+        // dave's card, and one alice owns.
+        dave_card_  = make_card("aa:bb:cc:dd", users_[3]);
+        alice_card_ = make_card("aa:bb:cc:ee", users_[0]);
+
+        // The `day` schedule maps staff to the front and back doors, and
+        // dave's card to the back door. The `night` schedule maps carol
+        // and the night group to the garage, and alice's card and the
+        // night group to the front door.
+        day_ = make_schedule("day");
+        add_mapping(day_, {doors_[0], doors_[1]}, {}, {staff_}, {});
+        add_mapping(day_, {doors_[1]}, {}, {}, {dave_card_});
+        night_sched_ = make_schedule("night");
+        add_mapping(night_sched_, {doors_[2]}, {users_[2]}, {night_}, {});
+        add_mapping(night_sched_, {doors_[0]}, {}, {night_}, {alice_card_});
+        t.commit();
+
+        initial_ = serialize(matrix_);
+    }
+
+    ~AccessMatrixTest()
+    {
+        database_ = nullptr;
+        unlink(db_path_.c_str());
+    }
+
+    Auth::GroupPtr make_group(const std::string &name,
+                              const std::vector<Auth::UserPtr> &members)
+    {
+        auto group = std::make_shared<Auth::Group>();
+        group->name(name);
+        for (const auto &member : members)
+            group->member_add(member);
+        database_->persist(group);
+        return group;
+    }
+
+    Cred::RFIDCardPtr make_card(const std::string &card_id,
+                                const Auth::UserPtr &owner)
+    {
+        auto card = std::make_shared<Cred::RFIDCard>(card_id, 32);
+        card->owner(Auth::UserLPtr(*database_, owner));
+        database_->persist(card);
+        return card;
+    }
+
+    Tools::SchedulePtr make_schedule(const std::string &name)
+    {
+        auto schedule = std::make_shared<Tools::Schedule>(name);
+        database_->persist(schedule);
+        return schedule;
+    }
+
+    void add_mapping(const Tools::SchedulePtr &schedule,
+                     const std::vector<Auth::DoorPtr> &doors,
+                     const std::vector<Auth::UserPtr> &users,
+                     const std::vector<Auth::GroupPtr> &groups,
+                     const std::vector<Cred::RFIDCardPtr> &credentials)
+    {
+        auto mapping = std::make_shared<Tools::ScheduleMapping>();
+        for (const auto &door : doors)
+            mapping->add_door(Auth::DoorLPtr(*database_, door));
+        for (const auto &user : users)
+            mapping->add_user(Auth::UserLPtr(*database_, user));
+        for (const auto &group : groups)
+            mapping->add_group(Auth::GroupLPtr(*database_, group));
+        for (const auto &cred : credentials)
+        {
+            mapping->add_credential(Cred::CredentialLPtr(
+                *database_, std::static_pointer_cast<Cred::Credential>(cred)));
+        }
+        database_->persist(mapping);
+        schedule->add_mapping(mapping);
+        database_->update(schedule);
+    }
+
+    nlohmann::json serialize(AccessMatrix &matrix)
+    {
+        odb::transaction t(database_->begin());
+        auto rep = matrix.serialize(database_);
+        t.commit();
+        return rep;
+    }
+
+    /**
+     * Bring the matrix up to date, and check it against one
+     * built from scratch.
+     */
+    void check_against_rebuild()
+    {
+        auto incremental = serialize(matrix_);
+        AccessMatrix rebuilt;
+        ASSERT_EQ(serialize(rebuilt), incremental);
+        ASSERT_NE(initial_, incremental);
+    }
+
+    /**
+     * Users who can access `door`, according to `rep`.
+     */
+    static std::vector<Auth::UserId> users_of(const nlohmann::json &rep,
+                                              const Auth::DoorPtr &door)
+    {
+        for (const auto &entry : rep)
+        {
+            if (entry.at("door_id").get<Auth::DoorId>() == door->id())
+                return entry.at("user_ids").get<std::vector<Auth::UserId>>();
+        }
+        return {};
+    }
+
+    std::string db_path_;
+    DBPtr database_;
+    std::vector<Auth::UserPtr> users_;
+    std::vector<Auth::DoorPtr> doors_;
+    Auth::GroupPtr staff_;
+    Auth::GroupPtr night_;
+    Cred::RFIDCardPtr dave_card_;
+    Cred::RFIDCardPtr alice_card_;
+    Tools::SchedulePtr day_;
+    Tools::SchedulePtr night_sched_;
+
+    AccessMatrix matrix_;
+    nlohmann::json initial_;
+};
+
+TEST_F(AccessMatrixTest, Build)
+{
+    AccessMatrix rebuilt;
+    ASSERT_EQ(initial_, serialize(rebuilt));
+    ASSERT_EQ(3u, initial_.size());
+
+    auto alice = users_[0]->id(), bob = users_[1]->id(), carol = users_[2]->id(),
+         dave = users_[3]->id();
+    ASSERT_EQ(std::vector<Auth::UserId>({alice, bob, carol}),
+              users_of(initial_, doors_[0]));
+    ASSERT_EQ(std::vector<Auth::UserId>({alice, bob, dave}),
+              users_of(initial_, doors_[1]));
+    ASSERT_EQ(std::vector<Auth::UserId>({carol}), users_of(initial_, doors_[2]));
+}
+
+TEST_F(AccessMatrixTest, DeleteDoor)
+{
+    odb::transaction t(database_->begin());
+    database_->erase<Auth::Door>(doors_[1]->id());
+    t.commit();
+    matrix_.mappings_changed();
+
+    check_against_rebuild();
+}
+
+TEST_F(AccessMatrixTest, DeleteSchedule)
+{
+    odb::transaction t(database_->begin());
+    auto schedule = database_->load<Tools::Schedule>(night_sched_->id());
+    for (const auto &mapping : schedule->mapping())
+        database_->erase(mapping);
+    database_->erase<Tools::Schedule>(schedule->id());
+    t.commit();
+    matrix_.mappings_changed();
+
+    check_against_rebuild();
+}
+
+TEST_F(AccessMatrixTest, DeleteGroup)
+{
+    odb::transaction t(database_->begin());
+    database_->erase<Auth::Group>(staff_->id());
+    t.commit();
+    matrix_.group_changed(staff_->id());
+    matrix_.mappings_changed();
+
+    check_against_rebuild();
+}
+
+TEST_F(AccessMatrixTest, DeleteMembership)
+{
+    odb::transaction t(database_->begin());
+    auto group = database_->load<Auth::Group>(staff_->id());
+    for (const auto &membership : group->user_memberships())
+    {
+        if (membership->user_id() == users_[1]->id())
+            database_->erase(membership);
+    }
+    t.commit();
+    matrix_.group_changed(staff_->id());
+
+    check_against_rebuild();
+    ASSERT_EQ(std::vector<Auth::UserId>({users_[0]->id(), users_[3]->id()}),
+              users_of(serialize(matrix_), doors_[1]));
+}
+
+TEST_F(AccessMatrixTest, UpdateCredential)
+{
+    odb::transaction t(database_->begin());
+    auto card = database_->load<Cred::RFIDCard>(dave_card_->id());
+    card->owner(Auth::UserLPtr(*database_, users_[2]));
+    database_->update(card);
+    t.commit();
+    matrix_.credential_changed(dave_card_->id());
+
+    check_against_rebuild();
+    ASSERT_EQ(std::vector<Auth::UserId>(
+                  {users_[0]->id(), users_[1]->id(), users_[2]->id()}),
+              users_of(serialize(matrix_), doors_[1]));
+}
+}
+}
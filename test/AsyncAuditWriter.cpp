@@ -0,0 +1,199 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/audit/AsyncAuditWriter.hpp"
+#include "core/audit/AuditEntry_odb.h"
+#include "core/audit/AuditFactory.hpp"
+#include "core/audit/WSAPICall.hpp"
+#include "core/audit/WSAPICall_odb.h"
+#include "gtest/gtest.h"
+#include <future>
+#include <odb/schema-catalog.hxx>
+#include <odb/sqlite/database.hxx>
+#include <thread>
+#include <unistd.h>
+
+using namespace Leosac;
+using namespace Leosac::Audit;
+
+namespace Leosac
+{
+namespace Test
+{
+
+class AsyncAuditWriterTest : public ::testing::Test
+{
+  public:
+    AsyncAuditWriterTest()
+        : db_path_("/tmp/leosac-test-AsyncAuditWriter.db")
+    {
+        unlink(db_path_.c_str());
+        database_ = std::make_shared<odb::sqlite::database>(
+            db_path_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+        odb::transaction t(database_->begin());
+        odb::schema_catalog::create_schema(*database_, "core");
+        t.commit();
+
+        // Unless a test says otherwise, the writer waits much longer than
+        // the test lasts for incomplete batches.
+        config_.queue_size     = 2;
+        config_.batch_size     = 100;
+        config_.flush_interval = std::chrono::seconds(30);
+        config_.overflow       = AsyncAuditWriter::OverflowPolicy::DROP_NEWEST;
+    }
+
+    ~AsyncAuditWriterTest()
+    {
+        database_ = nullptr;
+        unlink(db_path_.c_str());
+    }
+
+    IWSAPICallPtr make_entry(const std::string &method)
+    {
+        auto entry = Factory::DetachedWSAPICall(database_);
+        entry->method(method);
+        return entry;
+    }
+
+    /**
+     * Method of the persisted entries, in insertion order.
+     */
+    std::vector<std::string> persisted()
+    {
+        std::vector<std::string> methods;
+        odb::transaction t(database_->begin());
+        odb::result<WSAPICall> res(database_->query<WSAPICall>(
+            "ORDER BY" + odb::query<WSAPICall>::id));
+        for (const auto &entry : res)
+            methods.push_back(entry.method());
+        t.commit();
+        return methods;
+    }
+
+    std::string db_path_;
+    DBPtr database_;
+    AsyncAuditWriter::Config config_;
+};
+
+TEST_F(AsyncAuditWriterTest, DropNewest)
+{
+    AsyncAuditWriter writer(database_, config_);
+    ASSERT_TRUE(writer.enqueue(make_entry("1")));
+    ASSERT_TRUE(writer.enqueue(make_entry("2")));
+    ASSERT_FALSE(writer.enqueue(make_entry("3")));
+    ASSERT_EQ(1u, writer.dropped_count());
+
+    writer.flush();
+    ASSERT_EQ(std::vector<std::string>({"1", "2"}), persisted());
+}
+
+TEST_F(AsyncAuditWriterTest, DropOldest)
+{
+    config_.overflow = AsyncAuditWriter::OverflowPolicy::DROP_OLDEST;
+    AsyncAuditWriter writer(database_, config_);
+    ASSERT_TRUE(writer.enqueue(make_entry("1")));
+    ASSERT_TRUE(writer.enqueue(make_entry("2")));
+    ASSERT_TRUE(writer.enqueue(make_entry("3")));
+    ASSERT_EQ(1u, writer.dropped_count());
+
+    writer.flush();
+    ASSERT_EQ(std::vector<std::string>({"2", "3"}), persisted());
+}
+
+TEST_F(AsyncAuditWriterTest, Block)
+{
+    config_.overflow = AsyncAuditWriter::OverflowPolicy::BLOCK;
+    AsyncAuditWriter writer(database_, config_);
+    ASSERT_TRUE(writer.enqueue(make_entry("1")));
+    ASSERT_TRUE(writer.enqueue(make_entry("2")));
+
+    auto entry    = make_entry("3");
+    auto producer = std::async(std::launch::async,
+                               [&]() { return writer.enqueue(entry); });
+    ASSERT_EQ(std::future_status::timeout,
+              producer.wait_for(std::chrono::milliseconds(200)));
+
+    // Flushing makes room in the queue.
+    writer.flush();
+    ASSERT_TRUE(producer.get());
+    writer.flush();
+    ASSERT_EQ(0u, writer.dropped_count());
+    ASSERT_EQ(std::vector<std::string>({"1", "2", "3"}), persisted());
+}
+
+/**
+* A full batch is written without waiting for the flush interval,
+* an incomplete one is not.
+*/
+TEST_F(AsyncAuditWriterTest, Batch)
+{
+    config_.queue_size = 10;
+    config_.batch_size = 3;
+    AsyncAuditWriter writer(database_, config_);
+    for (auto method : {"1", "2", "3", "4"})
+        ASSERT_TRUE(writer.enqueue(make_entry(method)));
+
+    std::vector<std::string> methods;
+    for (int i = 0; i < 100 && methods.size() < 3; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        try
+        {
+            methods = persisted();
+        }
+        catch (const odb::exception &)
+        {
+            // The writer holds the database.
+        }
+    }
+    ASSERT_EQ(std::vector<std::string>({"1", "2", "3"}), methods);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ASSERT_EQ(3u, persisted().size());
+    writer.flush();
+    ASSERT_EQ(4u, persisted().size());
+}
+
+TEST_F(AsyncAuditWriterTest, FlushOnDestruction)
+{
+    {
+        AsyncAuditWriter writer(database_, config_);
+        ASSERT_TRUE(writer.enqueue(make_entry("1")));
+        ASSERT_TRUE(writer.enqueue(make_entry("2")));
+    }
+    ASSERT_EQ(std::vector<std::string>({"1", "2"}), persisted());
+}
+
+/**
+* Entries are finalized when they are enqueued.
+*/
+TEST_F(AsyncAuditWriterTest, Finalize)
+{
+    auto entry = make_entry("1");
+    ASSERT_FALSE(entry->finalized());
+    {
+        AsyncAuditWriter writer(database_, config_);
+        ASSERT_TRUE(writer.enqueue(entry));
+        ASSERT_TRUE(entry->finalized());
+    }
+    ASSERT_TRUE(entry->id());
+}
+}
+}
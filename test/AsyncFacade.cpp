@@ -0,0 +1,243 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "hardware/facades/AsyncFacade.hpp"
+#include "tools/timeout.hpp"
+#include "gtest/gtest.h"
+#include <boost/optional.hpp>
+#include <zmqpp/zmqpp.hpp>
+
+using namespace Leosac::Hardware;
+
+namespace Leosac
+{
+namespace Test
+{
+
+/**
+* The facade talks to an in-process device, which is either a ROUTER or
+* a REP socket. The test drives the facade's reactor itself, the way the
+* owner of a facade does.
+*/
+class AsyncFacadeTest : public ::testing::Test
+{
+  public:
+    AsyncFacadeTest()
+        : device_(ctx_, zmqpp::socket_type::router)
+        , rep_device_(ctx_, zmqpp::socket_type::rep)
+    {
+        device_.bind("inproc://DEVICE");
+        rep_device_.bind("inproc://REP_DEVICE");
+    }
+
+    /**
+    * A command, as received by the ROUTER device.
+    */
+    struct Request
+    {
+        std::string identity;
+        std::string request_id;
+        std::string command;
+    };
+
+    Request receive_request()
+    {
+        zmqpp::message msg;
+        device_.receive(msg);
+        EXPECT_EQ(4u, msg.parts());
+        Request req;
+        std::string delimiter;
+        msg >> req.identity >> req.request_id >> delimiter >> req.command;
+        EXPECT_EQ("", delimiter);
+        return req;
+    }
+
+    void reply(const Request &req, const std::string &content)
+    {
+        zmqpp::message msg;
+        msg << req.identity << req.request_id << "" << content;
+        device_.send(msg);
+    }
+
+    /**
+    * Poll the reactor until `done` returns true, or give up after
+    * a second.
+    */
+    template <typename Predicate>
+    bool poll_until(Predicate done)
+    {
+        for (int i = 0; i < 100 && !done(); ++i)
+            reactor_.poll(10);
+        return done();
+    }
+
+    zmqpp::context ctx_;
+    zmqpp::socket device_;
+    zmqpp::socket rep_device_;
+    zmqpp::reactor reactor_;
+};
+
+TEST_F(AsyncFacadeTest, MatchReplies)
+{
+    AsyncFacade facade(ctx_, "DEVICE");
+    facade.register_sockets(&reactor_);
+
+    boost::optional<std::string> first, second;
+    auto record = [](boost::optional<std::string> &dest) {
+        return [&dest](zmqpp::message *reply) {
+            ASSERT_TRUE(reply);
+            ASSERT_EQ(1u, reply->parts());
+            dest = reply->get(0);
+        };
+    };
+    zmqpp::message cmd1;
+    cmd1 << "first";
+    zmqpp::message cmd2;
+    cmd2 << "second";
+    facade.send(cmd1, record(first));
+    facade.send(cmd2, record(second));
+    ASSERT_EQ(2u, facade.pending());
+
+    auto req1 = receive_request();
+    auto req2 = receive_request();
+    ASSERT_EQ("first", req1.command);
+    ASSERT_EQ("second", req2.command);
+    ASSERT_NE(req1.request_id, req2.request_id);
+
+    // Replies come back out of order.
+    reply(req2, "reply-second");
+    reply(req1, "reply-first");
+    ASSERT_TRUE(poll_until([&]() { return first && second; }));
+    ASSERT_EQ("reply-first", *first);
+    ASSERT_EQ("reply-second", *second);
+    ASSERT_EQ(0u, facade.pending());
+}
+
+TEST_F(AsyncFacadeTest, RepDevice)
+{
+    AsyncFacade facade(ctx_, "REP_DEVICE");
+    facade.register_sockets(&reactor_);
+
+    boost::optional<bool> success;
+    zmqpp::message cmd;
+    cmd << "ON";
+    facade.send_command(cmd, [&](bool ok) { success = ok; });
+
+    // The REP socket strips the envelope, and puts it back on the reply.
+    zmqpp::message req;
+    rep_device_.receive(req);
+    ASSERT_EQ(1u, req.parts());
+    ASSERT_EQ("ON", req.get(0));
+    rep_device_.send("OK");
+
+    ASSERT_TRUE(poll_until([&]() { return !!success; }));
+    ASSERT_TRUE(*success);
+}
+
+TEST_F(AsyncFacadeTest, Timeout)
+{
+    AsyncFacade facade(ctx_, "DEVICE", std::chrono::milliseconds(100));
+    facade.register_sockets(&reactor_);
+    ASSERT_EQ(std::chrono::steady_clock::time_point::max(), facade.next_timeout());
+
+    auto start = std::chrono::steady_clock::now();
+    boost::optional<bool> success;
+    zmqpp::message cmd;
+    cmd << "ON";
+    facade.send_command(cmd, [&](bool ok) { success = ok; });
+    auto deadline = facade.next_timeout();
+    ASSERT_LE(start + std::chrono::milliseconds(100), deadline);
+
+    facade.check_timeouts(deadline - std::chrono::milliseconds(1));
+    ASSERT_FALSE(success);
+    ASSERT_EQ(1u, facade.pending());
+
+    facade.check_timeouts(deadline);
+    ASSERT_TRUE(success);
+    ASSERT_FALSE(*success);
+    ASSERT_EQ(0u, facade.pending());
+    ASSERT_EQ(std::chrono::steady_clock::time_point::max(), facade.next_timeout());
+}
+
+/**
+* The owner's loop, as in DoormanModule::run(): the reactor is polled
+* until the next deadline, then expired commands are completed.
+*/
+TEST_F(AsyncFacadeTest, TimeoutFromPollLoop)
+{
+    AsyncFacade facade(ctx_, "DEVICE", std::chrono::milliseconds(100));
+    facade.register_sockets(&reactor_);
+
+    auto start = std::chrono::steady_clock::now();
+    boost::optional<bool> success;
+    zmqpp::message cmd;
+    cmd << "ON";
+    facade.send_command(cmd, [&](bool ok) { success = ok; });
+
+    while (!success &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+    {
+        auto deadline = facade.next_timeout();
+        ASSERT_FALSE(reactor_.poll(Tools::compute_timeout(&deadline, &deadline + 1)));
+        facade.check_timeouts(std::chrono::steady_clock::now());
+    }
+    ASSERT_TRUE(success);
+    ASSERT_FALSE(*success);
+    ASSERT_LE(start + std::chrono::milliseconds(100),
+              std::chrono::steady_clock::now());
+}
+
+/**
+* A reply that arrives after its command timed out is dropped, and
+* doesn't disturb the commands that follow.
+*/
+TEST_F(AsyncFacadeTest, LateReply)
+{
+    AsyncFacade facade(ctx_, "DEVICE", std::chrono::milliseconds(100));
+    facade.register_sockets(&reactor_);
+
+    int late_calls = 0;
+    zmqpp::message late_cmd;
+    late_cmd << "late";
+    facade.send(late_cmd, [&](zmqpp::message *reply) {
+        ++late_calls;
+        ASSERT_FALSE(reply);
+    });
+    auto late_req = receive_request();
+    facade.check_timeouts(facade.next_timeout());
+    ASSERT_EQ(1, late_calls);
+
+    boost::optional<std::string> result;
+    zmqpp::message cmd;
+    cmd << "next";
+    facade.send(cmd, [&](zmqpp::message *reply) {
+        ASSERT_TRUE(reply);
+        result = reply->get(0);
+    });
+    auto req = receive_request();
+
+    reply(late_req, "late-reply");
+    reply(req, "next-reply");
+    ASSERT_TRUE(poll_until([&]() { return !!result; }));
+    ASSERT_EQ("next-reply", *result);
+    ASSERT_EQ(1, late_calls);
+    ASSERT_EQ(0u, facade.pending());
+}
+}
+}
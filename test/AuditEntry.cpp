@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/audit/AuditEntry_odb.h"
+#include "core/audit/AuditFactory.hpp"
+#include "core/audit/IUserEvent.hpp"
+#include "core/audit/IWSAPICall.hpp"
+#include "core/auth/User.hpp"
+#include "core/auth/User_odb.h"
+#include "tools/db/MultiplexedTransaction.hpp"
+#include "gtest/gtest.h"
+#include <odb/schema-catalog.hxx>
+#include <odb/sqlite/database.hxx>
+#include <unistd.h>
+
+using namespace Leosac;
+
+namespace Leosac
+{
+namespace Test
+{
+
+class AuditEntryTest : public ::testing::Test
+{
+  public:
+    AuditEntryTest()
+        : db_path_("/tmp/leosac-test-AuditEntry.db")
+    {
+        unlink(db_path_.c_str());
+        database_ = std::make_shared<odb::sqlite::database>(
+            db_path_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+        odb::transaction t(database_->begin());
+        odb::schema_catalog::create_schema(*database_, "core");
+        user_ = std::make_shared<Auth::User>();
+        user_->username("audit_test");
+        database_->persist(user_);
+        t.commit();
+    }
+
+    ~AuditEntryTest()
+    {
+        database_ = nullptr;
+        unlink(db_path_.c_str());
+    }
+
+    std::string db_path_;
+    DBPtr database_;
+    Auth::UserPtr user_;
+};
+
+/**
+* A handler whose transaction is rolled back after creating a child
+* of the (detached) API call entry must not take the parent down
+* with it: WSServer still finalizes the parent afterward.
+*/
+TEST_F(AuditEntryTest, ParentSurvivesHandlerRollback)
+{
+    auto parent = Audit::Factory::DetachedWSAPICall(database_);
+    ASSERT_FALSE(parent->id());
+
+    Audit::AuditEntryId child_id;
+    {
+        db::MultiplexedTransaction t(database_->begin());
+        auto child = Audit::Factory::UserEvent(database_, user_, parent);
+        ASSERT_TRUE(parent->id());
+        child_id = child->id();
+        ASSERT_TRUE(child_id);
+        t.rollback();
+    }
+
+    db::MultiplexedTransaction t(database_->begin());
+    ASSERT_NO_THROW(parent->reload());
+    parent->status_code(APIStatusCode::PERMISSION_DENIED);
+    parent->finalize();
+    ASSERT_FALSE(database_->find<Audit::AuditEntry>(child_id));
+    t.commit();
+}
+}
+}
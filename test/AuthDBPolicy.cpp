@@ -0,0 +1,159 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/credentials/PinCode.hpp"
+#include "core/credentials/RFIDCard.hpp"
+#include "core/credentials/RFIDCardPin.hpp"
+#include "modules/auth/auth-db/CompiledPolicy.hpp"
+#include "tools/ScheduleBitmap.hpp"
+#include "tools/SingleTimeFrame.hpp"
+#include "gtest/gtest.h"
+
+using namespace Leosac;
+using namespace Leosac::Module::Auth;
+
+namespace Leosac
+{
+namespace Test
+{
+
+class AuthDBPolicyTest : public ::testing::Test
+{
+  public:
+    AuthDBPolicyTest()
+        : now(std::chrono::system_clock::now())
+    {
+        std::vector<Tools::SingleTimeFrame> always;
+        for (int day = 0; day < 7; ++day)
+            always.emplace_back(day, 0, 0, 23, 59);
+        data.schedules[1] = std::make_shared<const Tools::ScheduleBitmap>(always);
+        data.schedules[2] = std::make_shared<const Tools::ScheduleBitmap>();
+
+        Leosac::Auth::ValidityInfo disabled;
+        disabled.set_enabled(false);
+        data.users[1]       = {Leosac::Auth::ValidityInfo()};
+        data.users[2]       = {disabled};
+        data.memberships[1] = {1, 10};
+        data.memberships[2] = {2, 10};
+
+        data.credentials[100] = {1, {}, "AA:BB:CC:DD", 32, ""};
+        data.credentials[101] = {2, {}, "aa:bb:cc:ee", 32, ""};
+        data.credentials[102] = {1, {}, "", 0, "1234"};
+        data.credentials[103] = {0, {}, "aa:bb:cc:ff", 32, ""};
+        data.credentials[104] = {1, disabled, "aa:bb:cc:00", 32, ""};
+
+        data.doors[1] = "front";
+        data.doors[2] = "back";
+        data.doors[3] = "garage";
+        data.zones[7] = {{}, {8}};
+        data.zones[8] = {{3}, {7}};
+
+        // Groups at the front door, all day.
+        data.mappings[1] = {1, {}, {10}, {}, {1}, {}};
+        // One credential in zone 7, all day.
+        data.mappings[2] = {1, {}, {}, {103}, {}, {7}};
+        // Everyone at the back door, but never.
+        data.mappings[3] = {2, {1, 2}, {}, {}, {2}, {}};
+    }
+
+    bool check_card(const CompiledPolicy &policy, const std::string &card_id,
+                    const std::string &door)
+    {
+        Cred::RFIDCard card(card_id, 32);
+        return policy.check(card, policy.door_id(door), now).granted;
+    }
+
+    PolicyData data;
+    std::chrono::system_clock::time_point now;
+};
+
+TEST_F(AuthDBPolicyTest, empty_policy)
+{
+    CompiledPolicy policy;
+    ASSERT_EQ(0, policy.door_id("front"));
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:dd", "front"));
+}
+
+TEST_F(AuthDBPolicyTest, card)
+{
+    CompiledPolicy policy(data);
+
+    // Granted through group 10, card id is case insensitive.
+    ASSERT_TRUE(check_card(policy, "aa:bb:cc:dd", "front"));
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:dd", "garage"));
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:dd", "unknown"));
+    // Out of schedule.
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:dd", "back"));
+    // Unknown card, or wrong number of bits.
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:dc", "front"));
+    Cred::RFIDCard card("aa:bb:cc:dd", 26);
+    ASSERT_FALSE(policy.check(card, policy.door_id("front"), now).granted);
+}
+
+TEST_F(AuthDBPolicyTest, validity)
+{
+    CompiledPolicy policy(data);
+
+    // Owner is disabled.
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:ee", "front"));
+    // Credential is disabled.
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:00", "front"));
+
+    data.users[2] = {Leosac::Auth::ValidityInfo()};
+    ASSERT_TRUE(check_card(CompiledPolicy(data), "aa:bb:cc:ee", "front"));
+}
+
+TEST_F(AuthDBPolicyTest, zones)
+{
+    CompiledPolicy policy(data);
+
+    // Zone 8 is a child of zone 7 (and the other way around).
+    ASSERT_TRUE(check_card(policy, "aa:bb:cc:ff", "garage"));
+    ASSERT_FALSE(check_card(policy, "aa:bb:cc:ff", "front"));
+}
+
+TEST_F(AuthDBPolicyTest, pin_code)
+{
+    auto pin = std::make_shared<Cred::PinCode>();
+    pin->pin_code("1234");
+    auto card = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    auto door = CompiledPolicy(data).door_id("front");
+
+    {
+        CompiledPolicy policy(data);
+        auto decision = policy.check(*pin, door, now);
+        ASSERT_TRUE(decision.granted);
+        ASSERT_EQ(102, decision.credential);
+        ASSERT_EQ(1, decision.user);
+        ASSERT_TRUE(policy.check(Cred::RFIDCardPin(card, pin), door, now).granted);
+    }
+
+    // PIN codes that don't belong to the card owner are refused.
+    auto other = std::make_shared<Cred::RFIDCard>("aa:bb:cc:ff", 32);
+    Cred::RFIDCardPin other_card_pin(other, pin);
+    ASSERT_FALSE(CompiledPolicy(data).check(other_card_pin, door, now).granted);
+
+    // A bare PIN code must be unique.
+    data.credentials[105] = {2, {}, "", 0, "1234"};
+    CompiledPolicy policy(data);
+    ASSERT_FALSE(policy.check(*pin, door, now).granted);
+    ASSERT_TRUE(policy.check(Cred::RFIDCardPin(card, pin), door, now).granted);
+}
+}
+}
@@ -29,11 +29,17 @@
 #include "core/credentials/PinCode.hpp"
 #include "core/credentials/RFIDCard.hpp"
 #include "core/credentials/RFIDCardPin.hpp"
+#include "modules/auth/auth-file/AuthImageWriter.hpp"
 #include "modules/auth/auth-file/FileAuthSourceMapper.hpp"
+#include "modules/auth/auth-file/ImageAuthSourceMapper.hpp"
+#include "modules/auth/auth-file/UnknownCredentialFilter.hpp"
 #include "tools/unixshellscript.hpp"
 #include <chrono>
+#include <exception/fsexception.hpp>
 #include <exception/moduleexception.hpp>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <unistd.h>
 
 /**
 * Path to test-data file.
@@ -279,6 +285,22 @@ TEST_F(AuthFileMapperTest, TimeFrameMapping2)
     ASSERT_FALSE(profile_toto->isAccessGranted(date_monday_16_31, doorC_));
 }
 
+/**
+* Profiles are compiled when the file is loaded: building the profile
+* twice for the same credential yields the same object.
+*/
+TEST_F(AuthFileMapperTest, PrecompiledProfile)
+{
+    mapper_->mapToUser(my_card_);
+    mapper_->mapToUser(my_pin_);
+    IAccessProfilePtr profile = mapper_->buildProfile(my_card_);
+    ASSERT_TRUE(profile.get());
+    ASSERT_EQ(profile, mapper_->buildProfile(my_card_));
+    ASSERT_NE(profile, mapper_->buildProfile(my_pin_));
+    ASSERT_FALSE(profile->isAccessGranted(date_thursday_14_00, doorA_));
+    ASSERT_TRUE(profile->isAccessGranted(date_monday_12_00, doorA_));
+}
+
 /**
 * Card ID doesn't exist in the file.
 */
@@ -360,6 +382,216 @@ TEST_F(AuthFileMapperTest, TestGroupPermission)
     ASSERT_FALSE(profile->isAccessGranted(date_monday_16_31, doorC_));
 }
 
+/**
+* Reloading reuses unchanged objects, and rebuilds the others.
+*/
+TEST_F(AuthFileMapperTest, IncrementalReload)
+{
+    auto card  = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    auto card2 = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    auto card3 = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+
+    // Nothing changed: credentials, users and profiles are shared.
+    const auto &previous = *static_cast<FileAuthSourceMapper *>(mapper_);
+    FileAuthSourceMapper same(gl_data_path + "AuthFile-1.xml", previous);
+    mapper_->mapToUser(card);
+    same.mapToUser(card2);
+    ASSERT_TRUE(card2->id());
+    ASSERT_EQ(card->id(), card2->id());
+    ASSERT_EQ(card->owner().get_eager(), card2->owner().get_eager());
+    ASSERT_EQ(mapper_->buildProfile(card), same.buildProfile(card2));
+
+    // Access rights changed: the profile is rebuilt.
+    FileAuthSourceMapper reloaded(gl_data_path + "AuthFile-3.xml", previous);
+    reloaded.mapToUser(card3);
+    ASSERT_EQ("my_user", card3->owner()->username());
+    auto profile = reloaded.buildProfile(card3);
+    ASSERT_TRUE(profile.get());
+    ASSERT_NE(mapper_->buildProfile(card), profile);
+    ASSERT_TRUE(profile->isAccessGranted(date_monday_12_00, doorA_));
+    ASSERT_FALSE(profile->isAccessGranted(date_monday_16_31, doorA_));
+    ASSERT_TRUE(profile->isAccessGranted(date_monday_16_31, doorB_));
+    ASSERT_TRUE(profile->isAccessGranted(date_sunday_18_50, doorC_));
+
+    // One credential changed and one added: the other credentials
+    // are still shared, and so are their owner and profile.
+    FileAuthSourceMapper updated(gl_data_path + "AuthFile-10.xml", previous);
+    auto card4      = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    auto toto_card  = std::make_shared<Cred::RFIDCard>("cc:dd:ee:ff", 32);
+    auto toto_card2 = std::make_shared<Cred::RFIDCard>("cc:dd:ee:ff", 32);
+    updated.mapToUser(card4);
+    ASSERT_EQ(card->id(), card4->id());
+    ASSERT_EQ(card->owner().get_eager(), card4->owner().get_eager());
+    ASSERT_EQ(mapper_->buildProfile(card), updated.buildProfile(card4));
+    mapper_->mapToUser(toto_card);
+    updated.mapToUser(toto_card2);
+    ASSERT_TRUE(toto_card2->id());
+    ASSERT_EQ(toto_card->id(), toto_card2->id());
+    ASSERT_EQ(toto_card->owner().get_eager(), toto_card2->owner().get_eager());
+    ASSERT_EQ(mapper_->buildProfile(toto_card), updated.buildProfile(toto_card2));
+
+    // The changed credential is rebuilt, and gets a new id.
+    auto old_changed = std::make_shared<Cred::RFIDCard>("00:11:22:33", 32);
+    auto changed     = std::make_shared<Cred::RFIDCard>("00:11:22:33", 32);
+    mapper_->mapToUser(old_changed);
+    updated.mapToUser(changed);
+    ASSERT_TRUE(changed->id());
+    ASSERT_NE(old_changed->id(), changed->id());
+    ASSERT_EQ(26, changed->nb_bits());
+    ASSERT_EQ(card->owner().get_eager(), changed->owner().get_eager());
+    profile = updated.buildProfile(changed);
+    ASSERT_TRUE(profile.get());
+    ASSERT_TRUE(profile->isAccessGranted(date_monday_12_00, doorA_));
+
+    // The added credential gets an id of its own.
+    auto added = std::make_shared<Cred::RFIDCard>("11:22:33:44", 32);
+    updated.mapToUser(added);
+    ASSERT_TRUE(added->id());
+    for (const auto &other : {card4, toto_card2, changed})
+        ASSERT_NE(other->id(), added->id());
+    ASSERT_EQ(card->owner().get_eager(), added->owner().get_eager());
+    profile = updated.buildProfile(added);
+    ASSERT_TRUE(profile.get());
+    ASSERT_TRUE(profile->isAccessGranted(date_monday_12_00, doorA_));
+}
+
+/**
+* The reverse indexes of a reloaded mapper reference the objects of the
+* new file, whether they were reused or rebuilt.
+*/
+TEST_F(AuthFileMapperTest, ReverseIndexesAfterReload)
+{
+    const auto &previous = *static_cast<FileAuthSourceMapper *>(mapper_);
+    auto card            = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    mapper_->mapToUser(card);
+    auto my_user = card->owner().get_eager();
+    ASSERT_EQ(1u, previous.user_mappings(my_user->id()).size());
+
+    // MY_USER's access now comes from the Admins group.
+    FileAuthSourceMapper grouped(gl_data_path + "AuthFile-3.xml", previous);
+    auto grouped_card = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    grouped.mapToUser(grouped_card);
+    auto grouped_user = grouped_card->owner().get_eager();
+    ASSERT_EQ(my_user->username(), grouped_user->username());
+    ASSERT_TRUE(grouped.user_mappings(grouped_user->id()).empty());
+    ASSERT_TRUE(grouped.credential_mappings(grouped_card->id()).empty());
+    for (const auto &group : grouped.groups())
+    {
+        auto mappings = grouped.group_mappings(group->id());
+        if (group->name() == "Admins")
+        {
+            ASSERT_EQ(3u, mappings.size());
+            for (const auto &mapping : mappings)
+                ASSERT_TRUE(mapping->has_group(group->id()));
+        }
+        else
+            ASSERT_TRUE(mappings.empty());
+    }
+
+    // Mappings that reference a credential directly.
+    FileAuthSourceMapper direct(gl_data_path + "AuthFile-8.xml", grouped);
+    auto pin        = std::make_shared<Cred::PinCode>();
+    auto owner_card = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    pin->pin_code("1234");
+    direct.mapToUser(pin);
+    direct.mapToUser(owner_card);
+    ASSERT_TRUE(pin->id());
+    auto pin_mappings = direct.credential_mappings(pin->id());
+    ASSERT_EQ(2u, pin_mappings.size());
+    for (const auto &mapping : pin_mappings)
+        ASSERT_TRUE(mapping->has_cred(pin->id()));
+    ASSERT_TRUE(direct.credential_mappings(owner_card->id()).empty());
+
+    auto llamasticot = owner_card->owner().get_eager();
+    ASSERT_EQ("llamasticot", llamasticot->username());
+    auto user_mappings = direct.user_mappings(llamasticot->id());
+    ASSERT_EQ(1u, user_mappings.size());
+    ASSERT_TRUE(user_mappings[0]->has_user(llamasticot->id()));
+}
+
+/**
+* A compiled image maps credentials and grants access the same way
+* as the file it was compiled from.
+*/
+TEST_F(AuthFileMapperTest, CompiledImage)
+{
+    std::string source = gl_data_path + "AuthFile-1.xml";
+    std::string image  = "/tmp/leosac-test-AuthFile-1.img";
+    AuthImageWriter(*static_cast<FileAuthSourceMapper *>(mapper_))
+        .write(source, AuthImageWriter::stat_source(source), image);
+
+    ImageAuthSourceMapper compiled(image);
+    unlink(image.c_str());
+    ASSERT_TRUE(compiled.is_up_to_date(source));
+    ASSERT_FALSE(compiled.is_up_to_date(gl_data_path + "AuthFile-3.xml"));
+
+    auto card = std::make_shared<Cred::RFIDCard>("aa:bb:cc:dd", 32);
+    mapper_->mapToUser(card);
+    compiled.mapToUser(my_card_);
+    ASSERT_EQ(card->id(), my_card_->id());
+    ASSERT_EQ("my_user", my_card_->owner()->username());
+
+    compiled.mapToUser(my_pin_);
+    ASSERT_EQ("my_user", my_pin_->owner()->username());
+    compiled.mapToUser(my_card2_);
+    ASSERT_EQ("toto", my_card2_->owner()->username());
+
+    compiled.mapToUser(unknown_card_);
+    ASSERT_FALSE(unknown_card_->owner().get());
+    ASSERT_FALSE(compiled.buildProfile(unknown_card_));
+
+    auto profile = compiled.buildProfile(my_card_);
+    ASSERT_TRUE(profile.get());
+    ASSERT_TRUE(profile->isAccessGranted(date_monday_12_00, doorA_));
+    ASSERT_TRUE(profile->isAccessGranted(date_monday_16_31, doorB_));
+    ASSERT_FALSE(profile->isAccessGranted(date_thursday_14_00, doorA_));
+    ASSERT_TRUE(profile->isAccessGranted(date_sunday_18_50, doorC_));
+
+    auto profile_toto = compiled.buildProfile(my_card2_);
+    ASSERT_TRUE(profile_toto.get());
+    ASSERT_TRUE(profile_toto->isAccessGranted(date_sunday_18_50, doorC_));
+    ASSERT_FALSE(profile_toto->isAccessGranted(date_monday_16_31, doorC_));
+}
+
+/**
+* An image that was tampered with is rejected.
+*/
+TEST_F(AuthFileMapperTest, CorruptedImage)
+{
+    std::string source = gl_data_path + "AuthFile-1.xml";
+    std::string image  = "/tmp/leosac-test-AuthFile-1-corrupted.img";
+    auto content = AuthImageWriter(*static_cast<FileAuthSourceMapper *>(mapper_))
+                       .build(AuthImageWriter::stat_source(source));
+    content.back() ^= 0xFF;
+    std::ofstream(image, std::ios::binary)
+        .write(reinterpret_cast<const char *>(content.data()), content.size());
+
+    ASSERT_THROW(ImageAuthSourceMapper compiled(image), ModuleException);
+    unlink(image.c_str());
+}
+
+/**
+* No image is written if the source file is modified after it was stat'ed,
+* since the image could record the new size and mtime for stale content.
+*/
+TEST_F(AuthFileMapperTest, SourceModifiedWhileCompiling)
+{
+    std::string source = "/tmp/leosac-test-AuthFile-modified.xml";
+    std::string image  = "/tmp/leosac-test-AuthFile-modified.img";
+    std::ofstream(source) << std::ifstream(gl_data_path + "AuthFile-1.xml").rdbuf();
+    unlink(image.c_str());
+
+    auto source_stat = AuthImageWriter::stat_source(source);
+    std::ofstream(source, std::ios::app) << "<!-- edited -->" << std::endl;
+
+    ASSERT_THROW(AuthImageWriter(*static_cast<FileAuthSourceMapper *>(mapper_))
+                     .write(source, source_stat, image),
+                 FsException);
+    ASSERT_NE(0, access(image.c_str(), F_OK));
+    ASSERT_NE(0, access((image + ".tmp").c_str(), F_OK));
+    unlink(source.c_str());
+}
+
 /**
 * Tests that permissions from multiple groups are added together.
 * If a user is in 2 groups it should have both group permissions.
@@ -529,6 +761,133 @@ TEST_F(AuthFileMapperTest, TestReservedUserID)
         ModuleException);
     // Nested exception. The original type is a ConfigException.
 }
+
+TEST(UnknownCredentialFilterTest, CacheUnknownCredentials)
+{
+    using Verdict = UnknownCredentialFilter::Verdict;
+    UnknownCredentialFilter::Config cfg;
+    cfg.cache_size = 2;
+    cfg.rate       = 0;
+    UnknownCredentialFilter filter(cfg);
+    auto now  = UnknownCredentialFilter::Clock::now();
+    auto card = std::make_shared<Cred::RFIDCard>("00:00:00:01", 32);
+
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k1", card, 0, now));
+    ASSERT_EQ(Verdict::KNOWN_UNKNOWN, filter.check("r1", "k1", card, 0, now));
+    ASSERT_EQ(Verdict::KNOWN_UNKNOWN, filter.check("r1", "k1", card, 0, now));
+
+    // Least recently used entry is evicted.
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k2", card, 0, now));
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k3", card, 0, now));
+    ASSERT_EQ(2u, filter.cache_size());
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k1", card, 0, now));
+
+    // Entries expire.
+    ASSERT_EQ(Verdict::REPORT,
+              filter.check("r1", "k3", card, 0, now + cfg.cache_ttl));
+
+    filter.clear();
+    ASSERT_EQ(1u, filter.generation());
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k2", card, 1, now));
+}
+
+/**
+* A credential looked up before the filter was cleared (ie with the
+* previous mapper) is not remembered: it may be known now.
+*/
+TEST(UnknownCredentialFilterTest, IgnoreStaleGeneration)
+{
+    using Verdict = UnknownCredentialFilter::Verdict;
+    UnknownCredentialFilter::Config cfg;
+    cfg.rate = 0;
+    UnknownCredentialFilter filter(cfg);
+    auto now  = UnknownCredentialFilter::Clock::now();
+    auto card = std::make_shared<Cred::RFIDCard>("00:00:00:01", 32);
+
+    auto generation = filter.generation();
+    filter.clear();
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k1", card, generation, now));
+    ASSERT_EQ(0u, filter.cache_size());
+    ASSERT_EQ(Verdict::REPORT,
+              filter.check("r1", "k1", card, filter.generation(), now));
+    ASSERT_EQ(Verdict::KNOWN_UNKNOWN,
+              filter.check("r1", "k1", card, filter.generation(), now));
+}
+
+TEST(UnknownCredentialFilterTest, RateLimitReaders)
+{
+    using Verdict = UnknownCredentialFilter::Verdict;
+    UnknownCredentialFilter::Config cfg;
+    cfg.cache_size = 0;
+    cfg.rate       = 1;
+    cfg.burst      = 2;
+    UnknownCredentialFilter filter(cfg);
+    auto now  = UnknownCredentialFilter::Clock::now();
+    auto card = std::make_shared<Cred::RFIDCard>("00:00:00:01", 32);
+
+    for (int i = 0; i < 2; ++i)
+        ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k", card, 0, now));
+    ASSERT_EQ(Verdict::THROTTLED, filter.check("r1", "k", card, 0, now));
+    // Other readers are not affected.
+    ASSERT_EQ(Verdict::REPORT, filter.check("r2", "k", card, 0, now));
+    ASSERT_EQ(Verdict::REPORT,
+              filter.check("r1", "k", card, 0, now + std::chrono::seconds(1)));
+
+    auto reports = filter.collect_reports(now, true);
+    ASSERT_EQ(1u, reports.size());
+    ASSERT_EQ("r1", reports[0].reader);
+    ASSERT_FALSE(reports[0].credential);
+    ASSERT_EQ(1u, reports[0].count);
+}
+
+TEST(UnknownCredentialFilterTest, CoalesceReports)
+{
+    using Verdict = UnknownCredentialFilter::Verdict;
+    UnknownCredentialFilter::Config cfg;
+    cfg.rate = 0;
+    UnknownCredentialFilter filter(cfg);
+    auto now  = UnknownCredentialFilter::Clock::now();
+    auto card = std::make_shared<Cred::RFIDCard>("00:00:00:01", 32);
+
+    // The first denial is reported on its own.
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k1", card, 0, now));
+    ASSERT_FALSE(filter.has_pending_reports());
+    for (int i = 0; i < 5; ++i)
+        filter.check("r1", "k1", card, 0, now + std::chrono::seconds(i));
+    ASSERT_TRUE(filter.has_pending_reports());
+    ASSERT_TRUE(filter.collect_reports(now + std::chrono::seconds(10)).empty());
+
+    auto reports = filter.collect_reports(now + cfg.audit_window);
+    ASSERT_EQ(1u, reports.size());
+    ASSERT_EQ("r1", reports[0].reader);
+    ASSERT_EQ(card, reports[0].credential);
+    ASSERT_EQ(5u, reports[0].count);
+    ASSERT_EQ(now + std::chrono::seconds(4), reports[0].last);
+    ASSERT_FALSE(filter.has_pending_reports());
+}
+
+/**
+* Known credentials don't go through the filter: they are found
+* by the mapper however many unknown credentials the reader submitted.
+*/
+TEST_F(AuthFileMapperTest, KnownCredentialWhileThrottled)
+{
+    using Verdict = UnknownCredentialFilter::Verdict;
+    UnknownCredentialFilter::Config cfg;
+    cfg.rate  = 1;
+    cfg.burst = 1;
+    UnknownCredentialFilter filter(cfg);
+    auto now = UnknownCredentialFilter::Clock::now();
+
+    mapper_->mapToUser(unknown_card_);
+    ASSERT_FALSE(unknown_card_->id());
+    ASSERT_EQ(Verdict::REPORT, filter.check("r1", "k1", unknown_card_, 0, now));
+    ASSERT_EQ(Verdict::THROTTLED, filter.check("r1", "k2", unknown_card_, 0, now));
+
+    mapper_->mapToUser(my_card_);
+    ASSERT_TRUE(my_card_->id());
+    ASSERT_TRUE(mapper_->buildProfile(my_card_));
+}
 }
 }
 
@@ -0,0 +1,247 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/audit/AuditEntry.hpp"
+#include "core/audit/AuditEntry_odb.h"
+#include "core/audit/AuditFactory.hpp"
+#include "core/audit/IUserEvent.hpp"
+#include "core/audit/IWSAPICall.hpp"
+#include "core/auth/User.hpp"
+#include "core/auth/User_odb.h"
+#include "tools/LogEntry.hpp"
+#include "tools/LogEntry_odb.h"
+#include "tools/db/DBService.hpp"
+#include "tools/db/DatabaseTracer.hpp"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <odb/schema-catalog.hxx>
+#include <odb/sqlite/database.hxx>
+#include <thread>
+#include <unistd.h>
+
+using namespace Leosac;
+
+namespace Leosac
+{
+namespace Test
+{
+
+class CountingTracer : public db::DatabaseTracer
+{
+  public:
+    void execute(odb::connection &, const char *) override
+    {
+        ++count_;
+        count_thread_statement();
+    }
+
+    size_t count() const override
+    {
+        return count_;
+    }
+
+  private:
+    std::atomic<size_t> count_{0};
+};
+
+class DBServiceTest : public ::testing::Test
+{
+  public:
+    DBServiceTest()
+        : db_path_("/tmp/leosac-test-DBService.db")
+    {
+        unlink(db_path_.c_str());
+        database_ = std::make_shared<odb::sqlite::database>(
+            db_path_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+        odb::transaction t(database_->begin());
+        odb::schema_catalog::create_schema(*database_, "core");
+        user_ = std::make_shared<Auth::User>();
+        user_->username("dbservice_test");
+        database_->persist(user_);
+        t.commit();
+
+        dbsrv_ = std::make_shared<DBService>(database_);
+    }
+
+    ~DBServiceTest()
+    {
+        dbsrv_    = nullptr;
+        database_ = nullptr;
+        unlink(db_path_.c_str());
+    }
+
+    /**
+     * Persist `count` log entries, and return their ids.
+     */
+    std::vector<unsigned long> add_logs(int count)
+    {
+        std::vector<unsigned long> ids;
+        odb::transaction t(database_->begin());
+        for (int i = 0; i < count; ++i)
+        {
+            Tools::LogEntry entry;
+            entry.timestamp_ = boost::posix_time::second_clock::local_time();
+            entry.msg_       = "message " + std::to_string(i);
+            entry.run_id_    = "run";
+            entry.level_     = 0;
+            entry.thread_id_ = 0;
+            database_->persist(entry);
+            ids.push_back(entry.id_);
+        }
+        t.commit();
+        return ids;
+    }
+
+    static std::vector<unsigned long> ids(const Tools::LogEntry::QueryResult &result)
+    {
+        std::vector<unsigned long> ids;
+        for (const auto &entry : result.entries)
+            ids.push_back(entry.id_);
+        return ids;
+    }
+
+    static std::vector<Audit::AuditEntryId>
+    ids(const std::vector<Audit::AuditEntryPtr> &audits)
+    {
+        std::vector<Audit::AuditEntryId> ids;
+        for (const auto &audit : audits)
+            ids.push_back(audit->id());
+        return ids;
+    }
+
+    std::string db_path_;
+    DBPtr database_;
+    DBServicePtr dbsrv_;
+    Auth::UserPtr user_;
+};
+
+TEST_F(DBServiceTest, CountLogs)
+{
+    ASSERT_EQ(0u, dbsrv_->count_logs());
+    add_logs(5);
+    ASSERT_EQ(5u, dbsrv_->count_logs());
+
+    // Only the new entries are counted, on top of the cached count.
+    add_logs(3);
+    ASSERT_EQ(8u, dbsrv_->count_logs());
+
+    // A new service counts the entries from scratch.
+    ASSERT_EQ(8u, DBService(database_).count_logs());
+}
+
+TEST_F(DBServiceTest, LogKeysetPaging)
+{
+    auto log_ids = add_logs(10);
+
+    // Older than the 8th entry, newest first.
+    auto result = Tools::LogEntry::retrieve_range(dbsrv_, log_ids[7], 0, 3, false);
+    ASSERT_EQ(std::vector<unsigned long>({log_ids[6], log_ids[5], log_ids[4]}),
+              ids(result));
+    ASSERT_EQ(10u, result.total);
+
+    // Newer than the 3rd entry: the closest entries are returned.
+    result = Tools::LogEntry::retrieve_range(dbsrv_, 0, log_ids[2], 3, false);
+    ASSERT_EQ(std::vector<unsigned long>({log_ids[5], log_ids[4], log_ids[3]}),
+              ids(result));
+    result = Tools::LogEntry::retrieve_range(dbsrv_, 0, log_ids[2], 3, true);
+    ASSERT_EQ(std::vector<unsigned long>({log_ids[3], log_ids[4], log_ids[5]}),
+              ids(result));
+
+    // Both bounds.
+    result =
+        Tools::LogEntry::retrieve_range(dbsrv_, log_ids[5], log_ids[2], 10, true);
+    ASSERT_EQ(std::vector<unsigned long>({log_ids[3], log_ids[4]}), ids(result));
+
+    // Past the end.
+    result = Tools::LogEntry::retrieve_range(dbsrv_, log_ids[0], 0, 3, false);
+    ASSERT_TRUE(result.entries.empty());
+}
+
+TEST_F(DBServiceTest, AuditCountAndKeysetPaging)
+{
+    const std::string api_call   = "Leosac::Audit::WSAPICall";
+    const std::string user_event = "Leosac::Audit::UserEvent";
+
+    // 1: call, 2: event, 3: call, 4: event, 5: call
+    std::vector<Audit::AuditEntryId> audit_ids;
+    Audit::IAuditEntryPtr parent;
+    for (int i = 0; i < 5; ++i)
+    {
+        if (i % 2)
+            audit_ids.push_back(
+                Audit::Factory::UserEvent(database_, user_, parent)->id());
+        else
+        {
+            parent = Audit::Factory::WSAPICall(database_);
+            audit_ids.push_back(parent->id());
+        }
+    }
+
+    ASSERT_EQ(5u, dbsrv_->count_audits({}));
+    ASSERT_EQ(3u, dbsrv_->count_audits({api_call}));
+    ASSERT_EQ(2u, dbsrv_->count_audits({user_event}));
+    ASSERT_EQ(5u, dbsrv_->count_audits({api_call, user_event}));
+    ASSERT_EQ(0u, dbsrv_->count_audits({"Leosac::Audit::DoorEvent"}));
+
+    audit_ids.push_back(Audit::Factory::WSAPICall(database_)->id());
+    ASSERT_EQ(6u, dbsrv_->count_audits({}));
+    ASSERT_EQ(4u, dbsrv_->count_audits({api_call}));
+
+    // Page numbers, newest first.
+    ASSERT_EQ(std::vector<Audit::AuditEntryId>({audit_ids[5], audit_ids[4]}),
+              ids(dbsrv_->find_audits({}, 1, 2)));
+    ASSERT_EQ(std::vector<Audit::AuditEntryId>({audit_ids[2], audit_ids[0]}),
+              ids(dbsrv_->find_audits({api_call}, 2, 2)));
+
+    // Cursors, newest first.
+    ASSERT_EQ(std::vector<Audit::AuditEntryId>({audit_ids[3], audit_ids[2]}),
+              ids(dbsrv_->find_audits_range({}, audit_ids[4], 0, 2)));
+    ASSERT_EQ(std::vector<Audit::AuditEntryId>({audit_ids[2], audit_ids[1]}),
+              ids(dbsrv_->find_audits_range({}, 0, audit_ids[0], 2)));
+    ASSERT_EQ(std::vector<Audit::AuditEntryId>({audit_ids[4], audit_ids[2]}),
+              ids(dbsrv_->find_audits_range({api_call}, audit_ids[5],
+                                            audit_ids[0], 10)));
+    ASSERT_TRUE(dbsrv_->find_audits_range({}, audit_ids[0], 0, 2).empty());
+}
+
+/**
+* Operations are counted per thread, so concurrent requests
+* don't count each other's operations.
+*/
+TEST_F(DBServiceTest, OperationCountPerThread)
+{
+    ASSERT_EQ(0u, dbsrv_->operation_count());
+
+    CountingTracer tracer;
+    database_->tracer(&tracer);
+    auto before = dbsrv_->operation_count();
+    std::thread other([&]() { add_logs(3); });
+    other.join();
+    ASSERT_LT(0u, tracer.count());
+    ASSERT_EQ(before, dbsrv_->operation_count());
+
+    auto total = tracer.count();
+    add_logs(3);
+    ASSERT_LT(before, dbsrv_->operation_count());
+    ASSERT_EQ(before + tracer.count() - total, dbsrv_->operation_count());
+    database_->tracer(nullptr);
+}
+}
+}
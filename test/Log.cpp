@@ -0,0 +1,80 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/log.hpp"
+#include "gtest/gtest.h"
+#include <spdlog/sinks/null_sink.h>
+
+namespace Leosac
+{
+namespace Test
+{
+
+class LogTest : public ::testing::Test
+{
+  public:
+    LogTest()
+        : formatted_(0)
+    {
+    }
+
+    ~LogTest()
+    {
+        spdlog::drop("console");
+        LogHelper::update_active_level();
+    }
+
+    std::string format(const std::string &msg)
+    {
+        ++formatted_;
+        return msg;
+    }
+
+    void add_console(spdlog::level::level_enum level)
+    {
+        auto console = std::make_shared<spdlog::logger>(
+            "console", std::make_shared<spdlog::sinks::null_sink_mt>());
+        console->set_level(level);
+        spdlog::register_logger(console);
+        LogHelper::update_active_level();
+    }
+
+    int formatted_;
+};
+
+TEST_F(LogTest, no_logger_enables_everything)
+{
+    LogHelper::update_active_level();
+    ASSERT_TRUE(LogHelper::is_enabled(LogLevel::DEBUG));
+}
+
+TEST_F(LogTest, disabled_level_is_not_formatted)
+{
+    add_console(spdlog::level::warn);
+
+    DEBUG(format("debug"));
+    INFO(format("info"));
+    ASSERT_EQ(0, formatted_);
+
+    WARN(format("warn"));
+    ERROR(format("error"));
+    ASSERT_EQ(2, formatted_);
+}
+}
+}
@@ -0,0 +1,90 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/MPSCRing.hpp"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+using namespace Leosac::Tools;
+
+namespace Leosac
+{
+namespace Test
+{
+
+TEST(TestMPSCRing, fifo)
+{
+    MPSCRing<int> ring(3);
+    ASSERT_EQ(4, ring.capacity());
+
+    for (int i = 0; i < 4; ++i)
+        ASSERT_TRUE(ring.try_push(int(i)));
+    ASSERT_FALSE(ring.try_push(42));
+    ASSERT_EQ(4, ring.size());
+
+    int value;
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(ring.try_pop(value));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_FALSE(ring.try_pop(value));
+
+    // Wrap around.
+    ASSERT_TRUE(ring.try_push(5));
+    ASSERT_TRUE(ring.try_pop(value));
+    ASSERT_EQ(5, value);
+}
+
+TEST(TestMPSCRing, multiple_producers)
+{
+    static constexpr int PRODUCERS = 4;
+    static constexpr int COUNT     = 2000;
+    MPSCRing<std::pair<int, int>> ring(64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p)
+    {
+        producers.emplace_back([&ring, p]() {
+            for (int i = 0; i < COUNT; ++i)
+            {
+                while (!ring.try_push(std::make_pair(p, i)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    // Values from a given producer are received in order.
+    std::vector<int> next(PRODUCERS, 0);
+    std::pair<int, int> value;
+    for (int received = 0; received < PRODUCERS * COUNT;)
+    {
+        if (!ring.try_pop(value))
+            continue;
+        ASSERT_EQ(next[value.first], value.second);
+        ++next[value.first];
+        ++received;
+    }
+    for (auto &t : producers)
+        t.join();
+    ASSERT_EQ(0, ring.size());
+}
+}
+}
@@ -0,0 +1,93 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/auth/PasswordHasher.hpp"
+#include "exception/leosacexception.hpp"
+#include "gtest/gtest.h"
+#include <future>
+
+using namespace Leosac;
+using namespace Leosac::Auth;
+
+namespace Leosac
+{
+namespace Test
+{
+
+TEST(TestPasswordHasher, invalid_config)
+{
+    PasswordHasher::Config cfg;
+    cfg.params.N = 1000;
+    ASSERT_THROW(PasswordHasher hasher(cfg), LEOSACException);
+
+    cfg.params.N = 1024;
+    cfg.threads  = 0;
+    ASSERT_THROW(PasswordHasher hasher(cfg), LEOSACException);
+}
+
+TEST(TestPasswordHasher, reject_when_too_many_pending)
+{
+    PasswordHasher::Config cfg;
+    cfg.threads     = 1;
+    cfg.max_pending = 2;
+    PasswordHasher hasher(cfg);
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> done;
+
+    ASSERT_TRUE(hasher.submit([=]() { released.wait(); }));
+    ASSERT_TRUE(hasher.submit([&]() { done.set_value(); }));
+    ASSERT_FALSE(hasher.submit([]() {}));
+    ASSERT_EQ(2u, hasher.pending());
+
+    release.set_value();
+    done.get_future().wait();
+    ASSERT_TRUE(hasher.submit([]() {}));
+}
+
+TEST(TestPasswordHasher, needs_rehash)
+{
+    PasswordHasher::Config cfg;
+    cfg.params.N = 1024;
+    PasswordHasher hasher(cfg);
+
+    ScryptResult hash;
+    hash.p = cfg.params;
+    ASSERT_FALSE(hasher.needs_rehash(hash));
+    hash.p.N = 16384;
+    ASSERT_TRUE(hasher.needs_rehash(hash));
+}
+
+/**
+* The parameters of a hasher don't leak to other Scrypt users.
+*/
+TEST(TestPasswordHasher, default_params_untouched)
+{
+    auto defaults = Scrypt::DefaultParam();
+    PasswordHasher::Config cfg;
+    cfg.params.N = 1024;
+    PasswordHasher hasher(cfg);
+
+    ASSERT_EQ(1024u, hasher.params().N);
+    ASSERT_EQ(defaults, Scrypt::DefaultParam());
+    ASSERT_FALSE(hasher.params() == Scrypt::DefaultParam());
+}
+}
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/Schedule.hpp"
+#include "tools/ScheduleBitmap.hpp"
+#include "tools/SingleTimeFrame.hpp"
+#include "gtest/gtest.h"
+
+using namespace Leosac;
+using namespace Leosac::Tools;
+
+namespace Leosac
+{
+namespace Test
+{
+
+/**
+ * The compiled bitmap must agree with SingleTimeFrame::is_in_timeframe()
+ * for every minute of the week.
+ */
+TEST(TestScheduleBitmap, match_timeframes)
+{
+    std::vector<SingleTimeFrame> timeframes = {
+        {1, 8, 0, 12, 30}, {3, 23, 0, 24, 0}, {0, 0, 0, 0, 0}, {5, 18, 0, 9, 0}};
+    ScheduleBitmap bitmap(timeframes);
+    Schedule sched;
+    for (const auto &tf : timeframes)
+        sched.add_timeframe(tf);
+
+    auto start = std::chrono::time_point_cast<std::chrono::minutes>(
+        std::chrono::system_clock::now());
+    for (int i = 0; i < ScheduleBitmap::MINUTES_PER_WEEK; ++i)
+    {
+        auto tp = start + std::chrono::minutes(i) + std::chrono::seconds(17);
+        bool expected = false;
+        for (const auto &tf : timeframes)
+            expected |= tf.is_in_timeframe(tp);
+
+        ASSERT_EQ(expected, bitmap.test(ScheduleBitmap::week_minute(tp)));
+        ASSERT_EQ(expected, sched.is_in_schedule(tp));
+    }
+}
+
+TEST(TestScheduleBitmap, invalidated_on_change)
+{
+    Schedule sched;
+    auto minute = 2 * ScheduleBitmap::MINUTES_PER_DAY + 10 * 60;
+
+    ASSERT_FALSE(sched.is_in_schedule_minute(minute));
+    sched.add_timeframe(SingleTimeFrame(2, 9, 0, 11, 0));
+    ASSERT_TRUE(sched.is_in_schedule_minute(minute));
+    sched.clear_timeframes();
+    ASSERT_FALSE(sched.is_in_schedule_minute(minute));
+}
+
+TEST(TestScheduleBitmap, invalid_day)
+{
+    ScheduleBitmap bitmap;
+    bitmap.add(SingleTimeFrame(7, 0, 0, 23, 59));
+    bitmap.add(SingleTimeFrame(-1, 0, 0, 23, 59));
+    for (int i = 0; i < ScheduleBitmap::MINUTES_PER_WEEK; ++i)
+        ASSERT_FALSE(bitmap.test(i));
+    ASSERT_FALSE(bitmap.test(ScheduleBitmap::MINUTES_PER_WEEK));
+}
+
+TEST(TestScheduleBitmap, packed)
+{
+    ScheduleBitmap bitmap({{1, 8, 0, 12, 30}, {6, 23, 55, 23, 59}});
+    uint8_t packed[ScheduleBitmap::PACKED_SIZE];
+    bitmap.pack(packed);
+
+    for (int i = 0; i < ScheduleBitmap::MINUTES_PER_WEEK; ++i)
+        ASSERT_EQ(bitmap.test(i), ScheduleBitmap::test_packed(packed, i));
+    ASSERT_FALSE(
+        ScheduleBitmap::test_packed(packed, ScheduleBitmap::MINUTES_PER_WEEK));
+}
+}
+}
@@ -0,0 +1,53 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/Scheduler.hpp"
+#include "gtest/gtest.h"
+#include <poll.h>
+
+using namespace Leosac;
+
+namespace Leosac
+{
+namespace Test
+{
+TEST(TestScheduler, main_wakeup_fd)
+{
+    Scheduler sched(nullptr, 1);
+    pollfd pfd{sched.wakeup_fd(TargetThread::MAIN), POLLIN, 0};
+    ASSERT_EQ(0, poll(&pfd, 1, 0));
+
+    bool ran = false;
+    sched.enqueue(
+        [&]() {
+            ran = true;
+            return true;
+        },
+        TargetThread::MAIN);
+    ASSERT_EQ(1, poll(&pfd, 1, 0));
+
+    sched.update(TargetThread::MAIN);
+    ASSERT_TRUE(ran);
+    ASSERT_EQ(0, poll(&pfd, 1, 0));
+
+    sched.wakeup(TargetThread::MAIN);
+    ASSERT_EQ(1, poll(&pfd, 1, 0));
+}
+}
+}
@@ -0,0 +1,164 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "hardware/facades/FGPIO.hpp"
+#include "helper/TestHelper.hpp"
+#include "modules/sysfsgpio/SysFsGpioModule.hpp"
+#include "tools/unixfs.hpp"
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Leosac::Module::SysFsGpio;
+using namespace Leosac::Test::Helper;
+using namespace Leosac::Hardware;
+using Leosac::Tools::UnixFs;
+
+namespace Leosac
+{
+namespace Test
+{
+
+/**
+* Run the module against regular files laid out like sysfs.
+*/
+class SysFsGpioPinTest : public Helper::TestHelper
+{
+  private:
+    virtual bool run_module(zmqpp::socket *pipe) override
+    {
+        boost::property_tree::ptree cfg, module_cfg, aliases_cfg, gpios_cfg,
+            gpio_cfg;
+
+        module_cfg.add("export_path", dir_ + "/export");
+        module_cfg.add("unexport_path", dir_ + "/unexport");
+        module_cfg.add("value_path", dir_ + "/__PLACEHOLDER__/value");
+        module_cfg.add("edge_path", dir_ + "/__PLACEHOLDER__/edge");
+        module_cfg.add("direction_path", dir_ + "/__PLACEHOLDER__/direction");
+        aliases_cfg.add("default", "gpio__NO__");
+        module_cfg.add_child("aliases", aliases_cfg);
+
+        gpio_cfg.add("name", "my_gpio");
+        gpio_cfg.add("no", "5");
+        gpio_cfg.add("direction", "out");
+        gpios_cfg.add_child("gpio", gpio_cfg);
+        module_cfg.add_child("gpios", gpios_cfg);
+
+        cfg.add("name", "SYSFS_GPIO");
+        cfg.add_child("module_config", module_cfg);
+        return test_run_module<SysFsGpioModule>(&ctx_, pipe, cfg);
+    }
+
+  public:
+    SysFsGpioPinTest()
+    {
+        char tmpl[] = "/tmp/leosac-test-SysFsGpioPin-XXXXXX";
+        dir_        = mkdtemp(tmpl);
+        value_path_ = dir_ + "/gpio5/value";
+        mkdir((dir_ + "/gpio5").c_str(), 0700);
+        std::ofstream(value_path_) << "0";
+    }
+
+    ~SysFsGpioPinTest()
+    {
+        // Stop the module before removing its files.
+        module_actor_ = nullptr;
+        for (auto file : {"gpio5/value", "gpio5/direction", "gpio5/edge", "export",
+                          "unexport"})
+            unlink((dir_ + "/" + file).c_str());
+        rmdir((dir_ + "/gpio5").c_str());
+        rmdir(dir_.c_str());
+    }
+
+    /**
+    * File descriptors of this process that refer to the value file.
+    */
+    std::vector<int> value_fds() const
+    {
+        std::vector<int> fds;
+        DIR *dir = opendir("/proc/self/fd");
+        while (dirent *entry = readdir(dir))
+        {
+            char target[4096];
+            std::string link = std::string("/proc/self/fd/") + entry->d_name;
+            ssize_t len      = readlink(link.c_str(), target, sizeof(target) - 1);
+            if (len > 0 && std::string(target, len) == value_path_)
+                fds.push_back(std::stoi(entry->d_name));
+        }
+        closedir(dir);
+        return fds;
+    }
+
+    std::string dir_;
+    std::string value_path_;
+};
+
+/**
+* The value file is opened once, and every command goes through it.
+*/
+TEST_F(SysFsGpioPinTest, ReuseValueFile)
+{
+    FGPIO gpio(ctx_, "my_gpio");
+
+    ASSERT_TRUE(gpio.turnOn());
+    ASSERT_EQ("1", UnixFs::readAll(value_path_));
+    auto fds = value_fds();
+    ASSERT_EQ(1u, fds.size());
+
+    ASSERT_TRUE(gpio.turnOff());
+    ASSERT_EQ("0", UnixFs::readAll(value_path_));
+    ASSERT_TRUE(gpio.toggle());
+    ASSERT_EQ("1", UnixFs::readAll(value_path_));
+    ASSERT_EQ(fds, value_fds());
+}
+
+/**
+* When the value file stops working, it is reopened with the same file
+* descriptor number and the command still succeeds.
+*/
+TEST_F(SysFsGpioPinTest, ReopenAfterError)
+{
+    FGPIO gpio(ctx_, "my_gpio");
+    ASSERT_TRUE(gpio.turnOn());
+    auto fds = value_fds();
+    ASSERT_EQ(1u, fds.size());
+
+    // Replace the value file by a read-only /dev/null: writes fail,
+    // and reads return nothing.
+    auto break_value_file = [&]() {
+        int null_fd = open("/dev/null", O_RDONLY);
+        ASSERT_NE(-1, dup2(null_fd, fds[0]));
+        close(null_fd);
+        ASSERT_TRUE(value_fds().empty());
+    };
+
+    break_value_file();
+    ASSERT_TRUE(gpio.turnOff());
+    ASSERT_EQ("0", UnixFs::readAll(value_path_));
+    ASSERT_EQ(fds, value_fds());
+
+    break_value_file();
+    ASSERT_TRUE(gpio.toggle());
+    ASSERT_EQ("1", UnixFs::readAll(value_path_));
+    ASSERT_EQ(fds, value_fds());
+}
+}
+}
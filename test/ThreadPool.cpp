@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/tasks/GenericTask.hpp"
+#include "core/tasks/ThreadPool.hpp"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <set>
+
+using namespace Leosac;
+using namespace Leosac::Tasks;
+
+namespace Leosac
+{
+namespace Test
+{
+
+TEST(TestThreadPool, run_all_tasks_on_bounded_threads)
+{
+    ThreadPool pool(3);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> count(0);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_TRUE(pool.enqueue(GenericTask::build([&]() {
+            std::lock_guard<std::mutex> lg(mutex);
+            threads.insert(std::this_thread::get_id());
+            ++count;
+            return true;
+        })));
+    }
+    pool.drain();
+
+    ASSERT_EQ(100, count);
+    ASSERT_LE(threads.size(), 3u);
+    ASSERT_EQ(0u, threads.count(std::this_thread::get_id()));
+
+    auto stats = pool.stats();
+    ASSERT_EQ(3u, stats.threads);
+    ASSERT_EQ(100u, stats.completed);
+    ASSERT_EQ(0u, stats.queued);
+    ASSERT_EQ(0u, stats.running);
+}
+
+TEST(TestThreadPool, idle_worker_steals_work)
+{
+    ThreadPool pool(2);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    // Block one worker. Tasks queued behind it must be run
+    // by the other one.
+    pool.enqueue(GenericTask::build([=]() {
+        released.wait();
+        return true;
+    }));
+
+    std::vector<TaskPtr> tasks;
+    for (int i = 0; i < 10; ++i)
+    {
+        tasks.push_back(GenericTask::build([]() { return true; }));
+        pool.enqueue(tasks.back());
+    }
+    for (auto &t : tasks)
+        t->wait();
+    ASSERT_GE(pool.stats().stolen, 1u);
+
+    release.set_value();
+    pool.drain();
+    ASSERT_EQ(11u, pool.stats().completed);
+}
+
+TEST(TestThreadPool, shutdown_runs_queued_tasks)
+{
+    std::atomic<int> count(0);
+    ThreadPool pool(1);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        pool.enqueue(GenericTask::build([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ++count;
+            return true;
+        }));
+    }
+    pool.shutdown();
+    ASSERT_EQ(20, count);
+
+    // The pool doesn't accept tasks anymore.
+    ASSERT_FALSE(pool.enqueue(GenericTask::build([]() { return true; })));
+    pool.shutdown();
+}
+
+TEST(TestThreadPool, task_can_enqueue_task)
+{
+    ThreadPool pool(2);
+    std::atomic<bool> inner_ran(false);
+
+    pool.enqueue(GenericTask::build([&]() {
+        pool.enqueue(GenericTask::build([&]() {
+            inner_ran = true;
+            return true;
+        }));
+        return true;
+    }));
+    pool.drain();
+    ASSERT_TRUE(inner_ran);
+}
+}
+}
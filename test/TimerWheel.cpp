@@ -0,0 +1,142 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/Scheduler.hpp"
+#include "core/tasks/TimerWheel.hpp"
+#include "gtest/gtest.h"
+
+using namespace Leosac;
+using namespace Leosac::Tasks;
+using namespace std::chrono;
+
+namespace Leosac
+{
+namespace Test
+{
+
+class TimerWheelTest : public ::testing::Test
+{
+  public:
+    TimerWheelTest()
+        : origin_(steady_clock::now())
+        , wheel_(milliseconds(10), origin_)
+    {
+    }
+
+    std::vector<int> advance(milliseconds elapsed)
+    {
+        std::vector<int> expired;
+        wheel_.advance(origin_ + elapsed, expired);
+        return expired;
+    }
+
+    steady_clock::time_point origin_;
+    TimerWheel<int> wheel_;
+};
+
+TEST_F(TimerWheelTest, expire_in_order)
+{
+    wheel_.add(origin_ + milliseconds(50), 2);
+    wheel_.add(origin_ + milliseconds(20), 1);
+    wheel_.add(origin_ + seconds(5), 3);
+    ASSERT_EQ(3u, wheel_.size());
+    ASSERT_EQ(origin_ + milliseconds(20), wheel_.next_expiry());
+
+    ASSERT_TRUE(advance(milliseconds(19)).empty());
+    ASSERT_EQ(std::vector<int>({1}), advance(milliseconds(20)));
+    ASSERT_EQ(std::vector<int>({2}), advance(milliseconds(60)));
+    ASSERT_TRUE(advance(milliseconds(4990)).empty());
+    ASSERT_EQ(std::vector<int>({3}), advance(seconds(5)));
+    ASSERT_TRUE(wheel_.empty());
+    ASSERT_EQ(steady_clock::time_point::max(), wheel_.next_expiry());
+}
+
+TEST_F(TimerWheelTest, never_expire_early)
+{
+    // Not a multiple of the resolution.
+    wheel_.add(origin_ + milliseconds(25), 1);
+    ASSERT_TRUE(advance(milliseconds(24)).empty());
+    ASSERT_EQ(std::vector<int>({1}), advance(milliseconds(30)));
+}
+
+TEST_F(TimerWheelTest, cancel)
+{
+    auto id = wheel_.add(origin_ + milliseconds(100), 1);
+    wheel_.add(origin_ + milliseconds(200), 2);
+
+    ASSERT_TRUE(wheel_.cancel(id));
+    ASSERT_FALSE(wheel_.cancel(id));
+    ASSERT_EQ(std::vector<int>({2}), advance(milliseconds(200)));
+    ASSERT_FALSE(wheel_.cancel(id));
+}
+
+TEST_F(TimerWheelTest, next_expiry_covers_upper_levels)
+{
+    // Stored in an upper level: the wheel must wake up in time to
+    // redistribute it, and never after its deadline.
+    auto deadline = origin_ + minutes(10) + milliseconds(30);
+    wheel_.add(deadline, 1);
+
+    int wakeups = 0;
+    std::vector<int> expired;
+    while (expired.empty())
+    {
+        auto next = wheel_.next_expiry();
+        ASSERT_LE(next, deadline);
+        wheel_.advance(next, expired);
+        ++wakeups;
+    }
+    ASSERT_EQ(std::vector<int>({1}), expired);
+    ASSERT_LT(wakeups, 10);
+}
+
+TEST_F(TimerWheelTest, beyond_wheel_range)
+{
+    // More than 2^24 ticks ahead.
+    wheel_.add(origin_ + hours(100), 1);
+    ASSERT_TRUE(advance(hours(50)).empty());
+    ASSERT_TRUE(advance(hours(99)).empty());
+    ASSERT_EQ(std::vector<int>({1}), advance(hours(100)));
+}
+
+TEST(TestScheduler, enqueue_after)
+{
+    Scheduler sched(nullptr, 1);
+    auto start = steady_clock::now();
+    auto task  = GenericTask::build([]() { return true; });
+
+    sched.enqueue_after(milliseconds(30), task, TargetThread::POOL);
+    task->wait();
+    ASSERT_GE(steady_clock::now() - start, milliseconds(30));
+
+    bool ran    = false;
+    auto handle = sched.enqueue_after(
+        milliseconds(20),
+        [&]() {
+            ran = true;
+            return true;
+        },
+        TargetThread::POOL);
+    ASSERT_TRUE(sched.cancel(handle));
+    ASSERT_FALSE(sched.cancel(handle));
+    std::this_thread::sleep_for(milliseconds(50));
+    ASSERT_FALSE(ran);
+}
+}
+}
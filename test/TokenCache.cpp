@@ -0,0 +1,182 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/auth/Token.hpp"
+#include "core/auth/Token_odb.h"
+#include "core/auth/User.hpp"
+#include "core/auth/User_odb.h"
+#include "modules/websock-api/TokenCache.hpp"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <odb/schema-catalog.hxx>
+#include <odb/sqlite/database.hxx>
+#include <odb/tracer.hxx>
+#include <thread>
+#include <unistd.h>
+
+using namespace Leosac;
+using namespace Leosac::Module::WebSockAPI;
+
+namespace Leosac
+{
+namespace Test
+{
+
+/**
+* Count the statements executed against the database.
+*/
+class CountingTracer : public odb::tracer
+{
+  public:
+    void execute(odb::connection &, const char *) override
+    {
+        ++count_;
+    }
+
+    std::atomic<size_t> count_{0};
+};
+
+class TokenCacheTest : public ::testing::Test
+{
+  public:
+    TokenCacheTest()
+        : db_path_("/tmp/leosac-test-TokenCache.db")
+    {
+        unlink(db_path_.c_str());
+        database_ = std::make_shared<odb::sqlite::database>(
+            db_path_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+        odb::transaction t(database_->begin());
+        odb::schema_catalog::create_schema(*database_, "core");
+        user_ = std::make_shared<Auth::User>("token_test");
+        database_->persist(user_);
+        other_user_ = std::make_shared<Auth::User>("other_token_test");
+        database_->persist(other_user_);
+        t.commit();
+
+        database_->tracer(&tracer_);
+    }
+
+    ~TokenCacheTest()
+    {
+        database_->tracer(nullptr);
+        database_ = nullptr;
+        unlink(db_path_.c_str());
+    }
+
+    Auth::TokenPtr make_token(const std::string &str, const Auth::UserPtr &owner)
+    {
+        auto token = std::make_shared<Auth::Token>(str, owner);
+        token->expire_in(std::chrono::minutes(20));
+        odb::transaction t(database_->begin());
+        database_->persist(*token);
+        t.commit();
+        return token;
+    }
+
+    bool exists(const Auth::TokenPtr &token)
+    {
+        odb::transaction t(database_->begin());
+        bool found = database_->find<Auth::Token>(token->id()) != nullptr;
+        t.commit();
+        return found;
+    }
+
+    std::string db_path_;
+    DBPtr database_;
+    CountingTracer tracer_;
+    Auth::UserPtr user_;
+    Auth::UserPtr other_user_;
+};
+
+TEST_F(TokenCacheTest, CachedHitSkipsDatabase)
+{
+    TokenCache cache(database_, std::chrono::minutes(20), std::chrono::seconds(60));
+    auto token = make_token("token", user_);
+    cache.insert(*token);
+
+    auto count = tracer_.count_.load();
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(cache.refresh(token));
+    ASSERT_EQ(count, tracer_.count_.load());
+}
+
+TEST_F(TokenCacheTest, ReloadAfterInterval)
+{
+    TokenCache cache(database_, std::chrono::minutes(20),
+                     std::chrono::milliseconds(50));
+    auto token = make_token("token", user_);
+    cache.insert(*token);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto count = tracer_.count_.load();
+    ASSERT_TRUE(cache.refresh(token));
+    ASSERT_LT(count, tracer_.count_.load());
+
+    // The extended expiration date was written back.
+    {
+        odb::transaction t(database_->begin());
+        auto stored = database_->load<Auth::Token>(token->id());
+        ASSERT_EQ(token->expiration(), stored->expiration());
+        t.commit();
+    }
+
+    // A token deleted from the database is noticed at the next reload.
+    {
+        odb::transaction t(database_->begin());
+        database_->erase<Auth::Token>(token->id());
+        t.commit();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_FALSE(cache.refresh(token));
+}
+
+TEST_F(TokenCacheTest, Invalidate)
+{
+    TokenCache cache(database_, std::chrono::minutes(20), std::chrono::seconds(60));
+    auto token = make_token("token", user_);
+    cache.insert(*token);
+    ASSERT_TRUE(cache.refresh(token));
+
+    cache.invalidate(token);
+    ASSERT_FALSE(exists(token));
+    ASSERT_FALSE(cache.refresh(token));
+}
+
+TEST_F(TokenCacheTest, RevokeUserTokens)
+{
+    TokenCache cache(database_, std::chrono::minutes(20), std::chrono::seconds(60));
+    auto first  = make_token("first", user_);
+    auto second = make_token("second", user_);
+    auto other  = make_token("other", other_user_);
+    for (const auto &token : {first, second, other})
+        cache.insert(*token);
+
+    cache.revoke_user_tokens(user_->id());
+    ASSERT_FALSE(exists(first));
+    ASSERT_FALSE(exists(second));
+    ASSERT_FALSE(cache.refresh(first));
+    ASSERT_FALSE(cache.refresh(second));
+
+    auto count = tracer_.count_.load();
+    ASSERT_TRUE(cache.refresh(other));
+    ASSERT_EQ(count, tracer_.count_.load());
+}
+}
+}
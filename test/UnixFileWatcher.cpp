@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/unixfilewatcher.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace Leosac::Tools;
+
+namespace Leosac
+{
+namespace Test
+{
+
+class UnixFileWatcherTest : public ::testing::Test
+{
+  public:
+    UnixFileWatcherTest()
+        : changes_(0)
+    {
+        char dir_template[] = "/tmp/leosac-test-UnixFileWatcher-XXXXXX";
+        dir_                = mkdtemp(dir_template);
+        path_               = dir_ + "/watched.xml";
+        write(path_, "initial");
+
+        watcher_.watchFile(path_, [this](const std::string &) {
+            std::lock_guard<std::mutex> lg(mutex_);
+            ++changes_;
+            cv_.notify_all();
+        });
+        watcher_.start();
+    }
+
+    ~UnixFileWatcherTest()
+    {
+        watcher_.stop();
+        unlink(path_.c_str());
+        unlink((path_ + ".tmp").c_str());
+        unlink((dir_ + "/other.xml").c_str());
+        rmdir(dir_.c_str());
+    }
+
+    static void write(const std::string &path, const std::string &content)
+    {
+        std::ofstream out(path, std::ios::trunc);
+        out << content;
+    }
+
+    /**
+     * Wait until the callback was invoked `count` times in total.
+     */
+    bool wait_changes(int count)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(5),
+                            [&]() { return changes_ >= count; });
+    }
+
+    std::string dir_;
+    std::string path_;
+    UnixFileWatcher watcher_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int changes_;
+};
+
+TEST_F(UnixFileWatcherTest, WriteInPlace)
+{
+    write(path_, "modified");
+    ASSERT_TRUE(wait_changes(1));
+    ASSERT_TRUE(watcher_.fileHasChanged(path_));
+    watcher_.fileReset(path_);
+    ASSERT_FALSE(watcher_.fileHasChanged(path_));
+}
+
+TEST_F(UnixFileWatcherTest, ReplaceWithRename)
+{
+    // Editors and deployment tools often write a new file, then
+    // rename it over the old one. The watch must survive this.
+    for (int i = 1; i <= 2; ++i)
+    {
+        write(path_ + ".tmp", "replaced " + std::to_string(i));
+        ASSERT_EQ(0, rename((path_ + ".tmp").c_str(), path_.c_str()));
+        ASSERT_TRUE(wait_changes(i));
+    }
+
+    write(path_, "modified");
+    ASSERT_TRUE(wait_changes(3));
+}
+
+TEST_F(UnixFileWatcherTest, IgnoreOtherFiles)
+{
+    write(dir_ + "/other.xml", "other");
+    write(path_, "modified");
+    ASSERT_TRUE(wait_changes(1));
+    std::lock_guard<std::mutex> lg(mutex_);
+    ASSERT_EQ(1, changes_);
+}
+}
+}
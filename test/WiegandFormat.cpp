@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2014-2022 Leosac
+
+    This file is part of Leosac.
+
+    Leosac is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Leosac is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "exception/configexception.hpp"
+#include "tools/WiegandFormat.hpp"
+#include "gtest/gtest.h"
+#include <boost/property_tree/ptree.hpp>
+
+using namespace Leosac;
+using namespace Leosac::Tools;
+
+namespace Leosac
+{
+namespace Test
+{
+
+static const WiegandFormat *decode(const WiegandFormatRegistry &registry,
+                                   const std::string &card_id, int nb_bits,
+                                   WiegandCardData &data)
+{
+    uint64_t frame;
+    EXPECT_TRUE(WiegandFormat::pack(card_id, nb_bits, frame));
+    return registry.decode(frame, nb_bits, data);
+}
+
+TEST(TestWiegandFormat, builtin_formats)
+{
+    WiegandFormatRegistry registry;
+    WiegandCardData data;
+    const WiegandFormat *format;
+
+    format = decode(registry, "bd:88:eb:80", 26, data);
+    ASSERT_TRUE(format);
+    ASSERT_EQ("H10301", format->name());
+    ASSERT_EQ(123, data.facility_code);
+    ASSERT_EQ(4567, data.card_number);
+
+    format = decode(registry, "89:1a:2b:3c:40", 34, data);
+    ASSERT_TRUE(format);
+    ASSERT_EQ("H10306", format->name());
+    ASSERT_EQ(0x1234, data.facility_code);
+    ASSERT_EQ(0x5678, data.card_number);
+
+    format = decode(registry, "d3:4a:2a:94:80", 35, data);
+    ASSERT_TRUE(format);
+    ASSERT_EQ("CORPORATE_1000_35", format->name());
+    ASSERT_EQ(1234, data.facility_code);
+    ASSERT_EQ(567890, data.card_number);
+
+    format = decode(registry, "00:96:1e:24:08", 37, data);
+    ASSERT_TRUE(format);
+    ASSERT_EQ("H10304", format->name());
+    ASSERT_EQ(300, data.facility_code);
+    ASSERT_EQ(123456, data.card_number);
+}
+
+TEST(TestWiegandFormat, parity_error)
+{
+    WiegandFormatRegistry registry;
+    WiegandCardData data;
+
+    // Flip one bit of each valid frame.
+    ASSERT_FALSE(decode(registry, "bd:88:eb:c0", 26, data));
+    ASSERT_FALSE(decode(registry, "89:1a:2b:3d:40", 34, data));
+    ASSERT_FALSE(decode(registry, "d3:4a:2a:94:00", 35, data));
+    ASSERT_FALSE(decode(registry, "00:96:1e:25:08", 37, data));
+
+    ASSERT_TRUE(registry.has_format(26));
+    ASSERT_FALSE(registry.has_format(32));
+}
+
+TEST(TestWiegandFormat, pack_buffer)
+{
+    uint8_t buffer[] = {0xbd, 0x88, 0xeb, 0x80};
+    uint64_t frame;
+
+    ASSERT_TRUE(WiegandFormat::pack("bd:88:eb:80", 26, frame));
+    ASSERT_EQ(frame, WiegandFormat::pack(buffer, 26));
+    ASSERT_EQ("bd:88:eb:80", WiegandFormat::card_id(buffer, 26));
+    ASSERT_EQ("bd:88", WiegandFormat::card_id(buffer, 16));
+
+    ASSERT_FALSE(WiegandFormat::pack("bd:88:eb", 26, frame));
+    ASSERT_FALSE(WiegandFormat::pack("bd:88:eb:zz", 26, frame));
+}
+
+TEST(TestWiegandFormat, custom_format)
+{
+    boost::property_tree::ptree cfg;
+    cfg.put("name", "CUSTOM_16");
+    cfg.put("bits", 16);
+    cfg.put("card_number.start", 1);
+    cfg.put("card_number.length", 14);
+    boost::property_tree::ptree parity;
+    parity.put("type", "odd");
+    parity.put("bits", "0-7,15");
+    cfg.add_child("parity", parity);
+
+    WiegandFormatRegistry registry;
+    registry.add(WiegandFormat::from_ptree(cfg));
+
+    WiegandCardData data;
+    // 1 000 0000 0000 011 0: card number 3, 1 bit set in 0-7,15.
+    auto format = registry.decode(0x8006, 16, data);
+    ASSERT_TRUE(format);
+    ASSERT_EQ("CUSTOM_16", format->name());
+    ASSERT_EQ(0, data.facility_code);
+    ASSERT_EQ(3, data.card_number);
+    ASSERT_FALSE(registry.decode(0x8007, 16, data));
+
+    cfg.put("card_number.length", 16);
+    ASSERT_THROW(WiegandFormat::from_ptree(cfg), Ex::Config);
+}
+}
+}
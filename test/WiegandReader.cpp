@@ -19,6 +19,8 @@
 
 #include "core/Scheduler.hpp"
 #include "core/auth/Auth.hpp"
+#include "exception/gpioexception.hpp"
+#include "hardware/GPIO.hpp"
 #include "helper/TestHelper.hpp"
 #include "modules/wiegand/wiegand.hpp"
 #include "modules/wiegand/WiegandConfig.hpp"
@@ -36,13 +38,9 @@ class WiegandReaderTest : public Helper::TestHelper
   private:
     virtual bool run_module(zmqpp::socket *pipe) override
     {
-        boost::property_tree::ptree cfg, module_cfg, readers_cfg, reader1_cfg;
+        boost::property_tree::ptree cfg, module_cfg, readers_cfg;
 
-        reader1_cfg.add("name", "WIEGAND_1");
-        reader1_cfg.add("high", "GPIO_HIGH");
-        reader1_cfg.add("low", "GPIO_LOW");
-
-        readers_cfg.add_child("reader", reader1_cfg);
+        readers_cfg.add_child("reader", reader1_cfg_);
         module_cfg.add_child("readers", readers_cfg);
 
         cfg.add("name", "WIEGAND_READER");
@@ -57,6 +55,9 @@ class WiegandReaderTest : public Helper::TestHelper
         , high_(ctx_, "GPIO_HIGH")
         , low_(ctx_, "GPIO_LOW")
     {
+        reader1_cfg_.add("name", "WIEGAND_1");
+        reader1_cfg_.add("high", "GPIO_HIGH");
+        reader1_cfg_.add("low", "GPIO_LOW");
         bus_sub_.subscribe("S_WIEGAND_1");
     }
 
@@ -64,10 +65,51 @@ class WiegandReaderTest : public Helper::TestHelper
     {
     }
 
+    /**
+    * Configuration of the reader, which derived fixtures may amend
+    * in their constructor.
+    */
+    boost::property_tree::ptree reader1_cfg_;
+
     FakeGPIO high_;
     FakeGPIO low_;
 };
 
+/**
+* The reader is configured to own its data lines, but they cannot be
+* acquired: it falls back to its GPIO objects.
+*/
+class WiegandReaderFallbackTest : public WiegandReaderTest
+{
+  public:
+    WiegandReaderFallbackTest()
+    {
+        reader1_cfg_.add("gpiod.device", "/nonexistent/gpiochip");
+        reader1_cfg_.add("gpiod.high", "17");
+        reader1_cfg_.add("gpiod.low", "18");
+    }
+};
+
+/**
+* A reader configuration whose data lines cannot be acquired.
+*/
+static WiegandReaderConfig unavailable_gpiod_config()
+{
+    WiegandReaderConfig config;
+    config.name("WIEGAND_1");
+    config.gpiod_device = "/nonexistent/gpiochip";
+    config.gpiod_high   = 17;
+    config.gpiod_low    = 18;
+    return config;
+}
+
+static Hardware::GPIOPtr make_gpio(const std::string &name)
+{
+    auto gpio = std::make_shared<Hardware::GPIO>();
+    gpio->name(name);
+    return gpio;
+}
+
 TEST_F(WiegandReaderTest, readCard)
 {
     for (int i = 0; i < 32; i++)
@@ -95,5 +137,88 @@ TEST_F(WiegandReaderTest, readCard)
                          Leosac::Auth::SourceType::SIMPLE_WIEGAND, "00:00:00:ff",
                          32));
 }
+
+/**
+* A frame ends once no bit was received for the frame gap.
+*/
+TEST_F(WiegandReaderTest, frameEndsAfterGap)
+{
+    using namespace std::chrono;
+    for (int i = 0; i < 31; i++)
+        high_.interrupt();
+    auto last_bit = steady_clock::now();
+    high_.interrupt();
+
+    ASSERT_TRUE(bus_read(bus_sub_, "S_WIEGAND_1",
+                         Leosac::Auth::SourceType::SIMPLE_WIEGAND, "ff:ff:ff:ff",
+                         32));
+    ASSERT_LE(last_bit + milliseconds(50), steady_clock::now());
+}
+
+/**
+* Bits separated by more than the frame gap belong to two frames.
+*/
+TEST_F(WiegandReaderTest, gapSplitsFrames)
+{
+    for (int i = 0; i < 16; i++)
+        high_.interrupt();
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    for (int i = 0; i < 16; i++)
+        low_.interrupt();
+
+    ASSERT_TRUE(bus_read(bus_sub_, "S_WIEGAND_1",
+                         Leosac::Auth::SourceType::SIMPLE_WIEGAND, "ff:ff", 16));
+    ASSERT_TRUE(bus_read(bus_sub_, "S_WIEGAND_1",
+                         Leosac::Auth::SourceType::SIMPLE_WIEGAND, "00:00", 16));
+}
+
+TEST(WiegandBackendTest, GpioWithoutGpiodBlock)
+{
+    WiegandReaderConfig config;
+    config.name("WIEGAND_1");
+    config.gpio_high_ = make_gpio("GPIO_HIGH");
+    config.gpio_low_  = make_gpio("GPIO_LOW");
+    ASSERT_EQ(nullptr, WiegandReaderModule::open_data_lines(config));
+}
+
+TEST(WiegandBackendTest, FallbackToGpio)
+{
+    auto config       = unavailable_gpiod_config();
+    config.gpio_high_ = make_gpio("GPIO_HIGH");
+    config.gpio_low_  = make_gpio("GPIO_LOW");
+    ASSERT_EQ(nullptr, WiegandReaderModule::open_data_lines(config));
+}
+
+TEST(WiegandBackendTest, NoFallback)
+{
+    auto config = unavailable_gpiod_config();
+    ASSERT_THROW(WiegandReaderModule::open_data_lines(config), GpioException);
+
+    // Both GPIOs are needed to fall back.
+    config.gpio_high_ = make_gpio("GPIO_HIGH");
+    ASSERT_THROW(WiegandReaderModule::open_data_lines(config), GpioException);
+}
+
+TEST(WiegandBackendTest, WithoutLibgpiod)
+{
+    if (GpiodDataLines::supported())
+        return;
+    // Even an existing chip cannot be used.
+    auto config         = unavailable_gpiod_config();
+    config.gpiod_device = "gpiochip0";
+    ASSERT_THROW(WiegandReaderModule::open_data_lines(config), GpioException);
+}
+
+TEST_F(WiegandReaderFallbackTest, readCard)
+{
+    for (int i = 0; i < 32; i++)
+    {
+        high_.interrupt();
+    }
+
+    ASSERT_TRUE(bus_read(bus_sub_, "S_WIEGAND_1",
+                         Leosac::Auth::SourceType::SIMPLE_WIEGAND, "ff:ff:ff:ff",
+                         32));
+}
 }
 }